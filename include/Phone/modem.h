@@ -187,9 +187,10 @@ typedef enum _ModemEventType
 	MODEM_EVENT_TYPE_MODEL,
 	MODEM_EVENT_TYPE_NOTIFICATION,
 	MODEM_EVENT_TYPE_REGISTRATION,
-	MODEM_EVENT_TYPE_STATUS
+	MODEM_EVENT_TYPE_STATUS,
+	MODEM_EVENT_TYPE_STATISTICS
 } ModemEventType;
-# define MODEM_EVENT_TYPE_LAST MODEM_EVENT_TYPE_STATUS
+# define MODEM_EVENT_TYPE_LAST MODEM_EVENT_TYPE_STATISTICS
 # define MODEM_EVENT_TYPE_COUNT (MODEM_EVENT_TYPE_LAST + 1)
 
 typedef union _ModemEvent
@@ -325,6 +326,13 @@ typedef union _ModemEvent
 		ModemEventType type;
 		ModemStatus status;
 	} status;
+
+	/* MODEM_EVENT_TYPE_STATISTICS */
+	struct
+	{
+		ModemEventType type;
+		char const * commands;		/* one line per command */
+	} statistics;
 } ModemEvent;
 
 /* ModemRequest */
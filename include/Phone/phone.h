@@ -153,7 +153,8 @@ typedef enum _PhoneMessageShow
 	PHONE_MESSAGE_SHOW_LOGS,
 	PHONE_MESSAGE_SHOW_MESSAGES,
 	PHONE_MESSAGE_SHOW_SETTINGS,
-	PHONE_MESSAGE_SHOW_WRITE
+	PHONE_MESSAGE_SHOW_WRITE,
+	PHONE_MESSAGE_SHOW_STATISTICS
 } PhoneMessageShow;
 
 
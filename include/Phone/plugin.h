@@ -35,6 +35,8 @@
 /* types */
 typedef struct _PhonePlugin PhonePlugin;
 
+typedef struct _PhoneConfigSection PhoneConfigSection;
+
 typedef void (PhoneConfigForeachCallback)(char const * variable,
 		char const * value, void * priv);
 
@@ -54,6 +56,12 @@ typedef struct _PhonePluginHelper
 	void (*message)(Phone * phone, PhoneMessage message, ...);
 	int (*request)(Phone * phone, ModemRequest * request);
 	int (*trigger)(Phone * phone, ModemEventType event);
+	PhoneConfigSection * (*config_section)(Phone * phone,
+			char const * section);
+	char const * (*config_section_get)(Phone * phone,
+			PhoneConfigSection * section, char const * variable);
+	int (*config_section_set)(Phone * phone, PhoneConfigSection * section,
+			char const * variable, char const * value);
 } PhonePluginHelper;
 
 typedef const struct _PhonePluginDefinition
@@ -23,8 +23,6 @@
  * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 /* TODO:
- * - implement priorities again
- * - parse messages from within +CMGL already
  * - add MCT callbacks/buttons to change the SIM code (via a helper in phone.c)
  * - implement new contacts
  * - implement +PBREADY?
@@ -36,6 +34,7 @@
 
 
 #ifdef __linux__
+# define _GNU_SOURCE /* for splice() */
 # include <sys/file.h>
 #endif
 #include <sys/stat.h>
@@ -53,16 +52,30 @@
 #include <System.h>
 #include <Phone/modem.h>
 #include "hayes/channel.h"
+#include "hayes/cmux.h"
 #include "hayes/command.h"
 #include "hayes/common.h"
+#include "hayes/concat.h"
+#include "hayes/gsm.h"
+#include "hayes/latency.h"
 #include "hayes/pdu.h"
 #include "hayes/quirks.h"
+#include "hayes/trace.h"
 #include "hayes.h"
 
 /* constants */
 #ifndef PROGNAME_PPPD
 # define PROGNAME_PPPD	"pppd"
 #endif
+#ifndef HAYES_BATCH_SIZE
+# define HAYES_BATCH_SIZE 80 /* longest command line sent as a batch */
+#endif
+#ifndef HAYES_TIMEOUT_FLOOR
+# define HAYES_TIMEOUT_FLOOR 3000 /* shortest timeout learned, in ms */
+#endif
+#ifndef HAYES_SETTLE_TIMEOUT
+# define HAYES_SETTLE_TIMEOUT 500 /* in ms, up to 4 times as much */
+#endif
 
 /* macros */
 #define max(a, b) ((a) > (b) ? (a) : (b))
@@ -80,6 +93,21 @@ typedef struct _ModemPlugin
 
 	/* modem */
 	HayesChannel channel;
+	gint64 started;
+	gint64 ready;
+
+	/* multiplexing */
+	HayesCMUX * cmux;
+	HayesChannel data;
+	HayesChannel unsollicited;
+
+	/* logging */
+	HayesTrace * trace;
+
+	/* statistics */
+	HayesLatency * latency;		/* for every request handler */
+	HayesLatency settle;
+	char * statistics;
 } Hayes;
 
 #ifdef DEBUG
@@ -103,17 +131,25 @@ typedef struct _HayesRequestMessageData
 	ModemMessageStatus status;
 } HayesRequestMessageData;
 
+typedef struct _HayesMessagePart
+{
+	unsigned int reference;
+	unsigned int sequence;
+	unsigned int count;
+} HayesMessagePart;
+
 typedef struct _HayesRequestHandler
 {
 	unsigned int type;
 	char const * attention;
 	HayesCommandCallback callback;
+	int network;	/* answered after the network or the SIM */
 } HayesRequestHandler;
 
 typedef struct _HayesCodeHandler
 {
 	char const * code;
-	void (*callback)(HayesChannel * channel, char const * answer);
+	HayesCommandHandler callback;
 } HayesCodeHandler;
 
 
@@ -123,6 +159,7 @@ enum
 	HAYES_REQUEST_ALIVE = MODEM_REQUEST_COUNT,
 	HAYES_REQUEST_CALL_WAITING_UNSOLLICITED_DISABLE,
 	HAYES_REQUEST_CALL_WAITING_UNSOLLICITED_ENABLE,
+	HAYES_REQUEST_CMUX,
 	HAYES_REQUEST_CONNECTED_LINE_DISABLE,
 	HAYES_REQUEST_CONNECTED_LINE_ENABLE,
 	HAYES_REQUEST_CONTACT_LIST,
@@ -136,10 +173,7 @@ enum
 	HAYES_REQUEST_LOCAL_ECHO_DISABLE,
 	HAYES_REQUEST_LOCAL_ECHO_ENABLE,
 	HAYES_REQUEST_MESSAGE_FORMAT_PDU,
-	HAYES_REQUEST_MESSAGE_LIST_INBOX_READ,
-	HAYES_REQUEST_MESSAGE_LIST_INBOX_UNREAD,
-	HAYES_REQUEST_MESSAGE_LIST_SENT_READ,
-	HAYES_REQUEST_MESSAGE_LIST_SENT_UNREAD,
+	HAYES_REQUEST_MESSAGE_MORE_ENABLE,
 	HAYES_REQUEST_MESSAGE_UNSOLLICITED_DISABLE,
 	HAYES_REQUEST_MESSAGE_UNSOLLICITED_ENABLE,
 	HAYES_REQUEST_MODEL,
@@ -164,6 +198,14 @@ enum
 	HAYES_REQUEST_VERBOSE_ENABLE,
 	HAYES_REQUEST_VERSION
 };
+#define HAYES_REQUEST_LAST	HAYES_REQUEST_VERSION
+#define HAYES_REQUEST_COUNT	(HAYES_REQUEST_LAST + 1)
+
+/* phonebook windows */
+#define HAYES_CONTACT_LIST_DEPTH	2	/* windows queued at once */
+#define HAYES_CONTACT_LIST_LATENCY	1000	/* in milliseconds per window */
+#define HAYES_CONTACT_LIST_WINDOW	20	/* entries in the first window */
+#define HAYES_CONTACT_LIST_WINDOW_MAX	250
 
 
 /* prototypes */
@@ -180,22 +222,30 @@ static void _hayes_set_mode(Hayes * hayes, HayesChannel * channel,
 		HayesChannelMode mode);
 
 /* useful */
-/* conversions */
-static unsigned char _hayes_convert_gsm_to_iso(unsigned char c);
-static void _hayes_convert_gsm_string_to_iso(char * str);
-static unsigned char _hayes_convert_iso_to_gsm(unsigned char c);
-static void _hayes_convert_iso_string_to_gsm(char * str);
+/* contacts */
+static int _hayes_contact_list(Hayes * hayes, HayesChannel * channel);
 
 /* messages */
-static char * _hayes_message_to_pdu(HayesChannel * channel, char const * number,
-		ModemMessageEncoding encoding, size_t length,
-		char const * content);
+static void _hayes_message_expire(HayesChannel * channel, time_t now);
+static HayesConcatMessage * _hayes_message_parts(HayesChannel * channel,
+		unsigned int id);
+static void _hayes_message_report(HayesChannel * channel,
+		HayesConcatMessage * message);
+static char ** _hayes_message_to_pdus(HayesChannel * channel,
+		char const * number, ModemMessageEncoding encoding,
+		size_t length, char const * content, size_t * count);
 
 /* logging */
 static void _hayes_log(Hayes * hayes, HayesChannel * channel,
-		char const * prefix, char const * buf, size_t cnt);
+		HayesTraceDirection direction, char const * buf, size_t cnt);
+
+/* data mode */
+static int _hayes_pump_start(Hayes * hayes, HayesChannel * channel);
+static void _hayes_pump_stop(HayesChannel * channel);
 
 /* parser */
+static void _hayes_code_init(void);
+static HayesCodeHandler * _hayes_code_lookup(char const * code, size_t len);
 static int _hayes_parse(Hayes * hayes, HayesChannel * channel);
 static int _hayes_parse_pdu(Hayes * hayes, HayesChannel * channel);
 static int _hayes_parse_trigger(HayesChannel * channel, char const * answer,
@@ -211,6 +261,7 @@ static int _hayes_queue_command_full(Hayes * hayes,
 static int _hayes_queue_push(Hayes * hayes, HayesChannel * channel);
 
 /* requests */
+static void _hayes_request_init(void);
 static int _hayes_request_channel(Hayes * hayes, HayesChannel * channel,
 		ModemRequest * request, void * data);
 static int _hayes_request_type(Hayes * hayes, HayesChannel * channel,
@@ -221,20 +272,25 @@ static void _hayes_reset(Hayes * hayes);
 
 /* callbacks */
 static gboolean _on_channel_authenticate(gpointer data);
+static gboolean _on_channel_cmux(gpointer data);
 static gboolean _on_channel_reset(gpointer data);
 static gboolean _on_channel_timeout(gpointer data);
+static gboolean _on_channel_timeout_late(gpointer data);
+static gboolean _on_message_expire(gpointer data);
 static gboolean _on_queue_timeout(gpointer data);
 static gboolean _on_reset_settle(gpointer data);
 static gboolean _on_reset_settle2(gpointer data);
 static gboolean _on_watch_can_read(GIOChannel * source, GIOCondition condition,
 		gpointer data);
-static gboolean _on_watch_can_read_ppp(GIOChannel * source,
-		GIOCondition condition, gpointer data);
 static gboolean _on_watch_can_write(GIOChannel * source, GIOCondition condition,
 		gpointer data);
-static gboolean _on_watch_can_write_ppp(GIOChannel * source,
+static gboolean _on_watch_pump_read(GIOChannel * source, GIOCondition condition,
+		gpointer data);
+static gboolean _on_watch_pump_write(GIOChannel * source,
 		GIOCondition condition, gpointer data);
 
+static void _on_cmux_channel(void * data, unsigned int dlci, int fd);
+
 static HayesCommandStatus _on_request_authenticate(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel);
 static HayesCommandStatus _on_request_battery_level(HayesCommand * command,
@@ -247,10 +303,15 @@ static HayesCommandStatus _on_request_call_outgoing(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel);
 static HayesCommandStatus _on_request_call_status(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel);
+static HayesCommandStatus _on_request_cmux(HayesCommand * command,
+		HayesCommandStatus status, HayesChannel * channel);
 static HayesCommandStatus _on_request_contact_delete(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel);
 static HayesCommandStatus _on_request_contact_list(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel);
+static HayesCommandStatus _on_request_contact_list_window(
+		HayesCommand * command, HayesCommandStatus status,
+		HayesChannel * channel);
 static HayesCommandStatus _on_request_functional(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel);
 static HayesCommandStatus _on_request_functional_enable(HayesCommand * command,
@@ -268,6 +329,9 @@ static HayesCommandStatus _on_request_message_list(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel);
 static HayesCommandStatus _on_request_message_send(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel);
+static HayesCommandStatus _on_request_message_send_part(
+		HayesCommand * command, HayesCommandStatus status,
+		HayesChannel * channel);
 static HayesCommandStatus _on_request_model(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel);
 static HayesCommandStatus _on_request_registration(HayesCommand * command,
@@ -312,6 +376,8 @@ static void _on_code_cusd(HayesChannel * channel, char const * answer);
 static void _on_code_ext_error(HayesChannel * channel, char const * answer);
 
 /* helpers */
+static int _is_action_command(char const * attention);
+static int _is_final_result(char const * answer);
 static int _is_ussd_code(char const * number);
 
 
@@ -323,190 +389,139 @@ static ModemConfig _hayes_config[] =
 	{ "hwflow",	"Hardware flow control",MCT_BOOLEAN	},
 	{ NULL,		"Advanced",		MCT_SUBSECTION	},
 	{ "logfile",	"Log file",		MCT_FILENAME	},
+	{ "logsize",	"Log rotation size (kB)",MCT_UINT32	},
+	{ "cmux",	"Multiplexing (27.010)",MCT_BOOLEAN	},
 	{ NULL,		NULL,			MCT_NONE	},
 };
 
-static struct
-{
-	unsigned char gsm;
-	unsigned char iso;
-} _hayes_gsm_iso[] =
-{
-	{ '\0', '@'	},
-	{ 0x01, 163	}, /* £ */
-	{ 0x02, '$'	},
-	{ 0x03, 165	}, /* ¥ */
-	{ 0x04, 232	}, /* è */
-	{ 0x05, 233	}, /* é */
-	{ 0x06, 249	}, /* ù */
-	{ 0x07, 236	}, /* ì */
-	{ 0x08, 242	}, /* ò */
-	{ 0x09, 199	}, /* Ç */
-	{ 0x0b, 216	}, /* Ø */
-	{ 0x0c, 248	}, /* ø */
-	{ 0x0e, 197	}, /* Å */
-	{ 0x0f, 229	}, /* å */
-	{ 0x10, ' '	}, /* XXX delta */
-	{ 0x11, '_'	},
-	{ 0x12, ' '	}, /* XXX phi */
-	{ 0x13, ' '	}, /* XXX gamma */
-	{ 0x14, ' '	}, /* XXX lambda */
-	{ 0x15, ' '	}, /* XXX omega */
-	{ 0x16, ' '	}, /* XXX pi */
-	{ 0x17, ' '	}, /* XXX psi */
-	{ 0x18, ' '	}, /* XXX sigma */
-	{ 0x19, ' '	}, /* XXX theta */
-	{ 0x1a, ' '	}, /* XXX xi */
-	{ 0x1b, ' '	}, /* FIXME escape */
-	{ 0x1c, 198	},
-	{ 0x1d, 230	},
-	{ 0x1e, 223	},
-	{ 0x1f, 201	},
-	{ 0x24, 164	}, /* $ */
-	{ 0x40, 161	}, /* @ */
-	{ 0x5b, 196	}, /* [ */
-	{ 0x5c, 214	}, /* \ */
-	{ 0x5d, 209	}, /* ] */
-	{ 0x5e, 220	}, /* ^ */
-	{ 0x5f, 167	}, /* _ */
-	{ 0x60, 191	}, /* ` */
-	{ 0x7b, 228	}, /* { */
-	{ 0x7c, 246	}, /* | */
-	{ 0x7d, 241	}, /* } */
-	{ 0x7e, 252	}, /* ~ */
-	{ 0x7f, 224	}
-};
-
 static HayesRequestHandler _hayes_request_handlers[] =
 {
 	{ HAYES_REQUEST_ALIVE,				"AT",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_CALL_WAITING_UNSOLLICITED_DISABLE,"AT+CCWA=1",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_CALL_WAITING_UNSOLLICITED_ENABLE,"AT+CCWA=1",
-		_on_request_generic },
+		_on_request_generic, 0 },
+	{ HAYES_REQUEST_CMUX,				"AT+CMUX=0",
+		_on_request_cmux, 0 },
 	{ HAYES_REQUEST_CONNECTED_LINE_DISABLE,		"AT+COLP=0",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_CONNECTED_LINE_ENABLE,		"AT+COLP=1",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_CONTACT_LIST,			NULL,
-		_on_request_generic },
+		_on_request_contact_list_window, 1 },
 	{ HAYES_REQUEST_EXTENDED_ERRORS,		"AT+CMEE=1",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_EXTENDED_RING_REPORTS,		"AT+CRC=1",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_FUNCTIONAL,			"AT+CFUN?",
-		_on_request_functional },
+		_on_request_functional, 0 },
 	{ HAYES_REQUEST_FUNCTIONAL_DISABLE,		"AT+CFUN=0",
-		_on_request_generic },
+		_on_request_generic, 1 },
 	{ HAYES_REQUEST_FUNCTIONAL_ENABLE,		"AT+CFUN=1",
-		_on_request_functional_enable },
+		_on_request_functional_enable, 1 },
 	/* XXX AT+CFUN=16 on Sierra Wireless? */
 	{ HAYES_REQUEST_FUNCTIONAL_ENABLE_RESET,	"AT+CFUN=1,1",
-		_on_request_functional_enable_reset },
+		_on_request_functional_enable_reset, 1 },
 	{ HAYES_REQUEST_GPRS_ATTACHED,			"AT+CGATT?",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_LOCAL_ECHO_DISABLE,		"ATE0",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_LOCAL_ECHO_ENABLE,		"ATE1",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_MESSAGE_FORMAT_PDU,		"AT+CMGF=0",
-		_on_request_generic },
-	{ HAYES_REQUEST_MESSAGE_LIST_INBOX_UNREAD,	"AT+CMGL=0",
-		_on_request_message_list },
-	{ HAYES_REQUEST_MESSAGE_LIST_INBOX_READ,	"AT+CMGL=1",
-		_on_request_message_list },
-	{ HAYES_REQUEST_MESSAGE_LIST_SENT_UNREAD,	"AT+CMGL=2",
-		_on_request_message_list },
-	{ HAYES_REQUEST_MESSAGE_LIST_SENT_READ,		"AT+CMGL=3",
-		_on_request_message_list },
+		_on_request_generic, 0 },
+	{ HAYES_REQUEST_MESSAGE_MORE_ENABLE,		"AT+CMMS=1",
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_MESSAGE_UNSOLLICITED_DISABLE,	"AT+CNMI=0",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_MESSAGE_UNSOLLICITED_ENABLE,	"AT+CNMI=1,1",
-		_on_request_generic }, /* XXX report error? */
+		_on_request_generic, 0 }, /* XXX report error? */
 	{ HAYES_REQUEST_MODEL,				"AT+CGMM",
-		_on_request_model },
+		_on_request_model, 0 },
 	{ HAYES_REQUEST_OPERATOR,			"AT+COPS?",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_OPERATOR_FORMAT_LONG,		"AT+COPS=3,0",
-		_on_request_registration },
+		_on_request_registration, 0 },
 	{ HAYES_REQUEST_OPERATOR_FORMAT_NUMERIC,	"AT+COPS=3,2",
-		_on_request_registration },
+		_on_request_registration, 0 },
 	{ HAYES_REQUEST_OPERATOR_FORMAT_SHORT,		"AT+COPS=3,1",
-		_on_request_registration },
+		_on_request_registration, 0 },
 	{ HAYES_REQUEST_PHONE_ACTIVE,			"AT+CPAS",
-		_on_request_call },
+		_on_request_call, 0 },
 	{ HAYES_REQUEST_REGISTRATION,			"AT+CREG?",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_REGISTRATION_AUTOMATIC,		"AT+COPS=0",
-		_on_request_registration_automatic },
+		_on_request_registration_automatic, 1 },
 	{ HAYES_REQUEST_REGISTRATION_DISABLED,		"AT+COPS=2",
-		_on_request_registration_disabled },
+		_on_request_registration_disabled, 1 },
 	{ HAYES_REQUEST_REGISTRATION_UNSOLLICITED_DISABLE,"AT+CREG=0",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_REGISTRATION_UNSOLLICITED_ENABLE,"AT+CREG=2",
-		_on_request_registration },
+		_on_request_registration, 0 },
 	{ HAYES_REQUEST_SERIAL_NUMBER,			"AT+CGSN",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_SIM_PIN_VALID,			"AT+CPIN?",
-		_on_request_sim_pin_valid },
+		_on_request_sim_pin_valid, 1 },
 	{ HAYES_REQUEST_SUBSCRIBER_IDENTITY,		"AT+CIMI",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_SUPPLEMENTARY_SERVICE_DATA_CANCEL,"AT+CUSD=2",
-		_on_request_generic },
+		_on_request_generic, 1 },
 	{ HAYES_REQUEST_SUPPLEMENTARY_SERVICE_DATA_DISABLE,"AT+CUSD=0",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_SUPPLEMENTARY_SERVICE_DATA_ENABLE,"AT+CUSD=1",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_VENDOR,				"AT+CGMI",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_VERBOSE_DISABLE,		"ATV0",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_VERBOSE_ENABLE,			"ATV1",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ HAYES_REQUEST_VERSION,			"AT+CGMR",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ MODEM_REQUEST_AUTHENTICATE,			NULL,
-		_on_request_authenticate },
+		_on_request_authenticate, 1 },
 	{ MODEM_REQUEST_BATTERY_LEVEL,			"AT+CBC",
-		_on_request_battery_level },
+		_on_request_battery_level, 0 },
 	{ MODEM_REQUEST_CALL,				NULL,
-		_on_request_call_outgoing },
+		_on_request_call_outgoing, 1 },
 	{ MODEM_REQUEST_CALL_ANSWER,			"ATA",
-		_on_request_call_incoming },
+		_on_request_call_incoming, 1 },
 	{ MODEM_REQUEST_CALL_HANGUP,			NULL,
-		_on_request_call_status },
+		_on_request_call_status, 1 },
 	{ MODEM_REQUEST_CALL_PRESENTATION,		NULL,
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ MODEM_REQUEST_CONNECTIVITY,			NULL,
-		_on_request_generic },
+		_on_request_generic, 1 },
 	{ MODEM_REQUEST_CONTACT_DELETE,			NULL,
-		_on_request_contact_delete },
+		_on_request_contact_delete, 1 },
 	{ MODEM_REQUEST_CONTACT_EDIT,			NULL,
-		_on_request_contact_list },
+		_on_request_contact_list, 1 },
 	{ MODEM_REQUEST_CONTACT_LIST,			"AT+CPBR=?",
-		_on_request_generic },
+		_on_request_generic, 1 },
 	{ MODEM_REQUEST_CONTACT_NEW,			NULL,
-		_on_request_contact_list },
+		_on_request_contact_list, 1 },
 	{ MODEM_REQUEST_DTMF_SEND,			NULL,
-		_on_request_generic },
+		_on_request_generic, 1 },
 	{ MODEM_REQUEST_MESSAGE,			NULL,
-		_on_request_message },
+		_on_request_message, 1 },
 	{ MODEM_REQUEST_MESSAGE_DELETE,			NULL,
-		_on_request_message_delete },
-	{ MODEM_REQUEST_MESSAGE_LIST,			NULL,
-		_on_request_message_list },
+		_on_request_message_delete, 1 },
+	{ MODEM_REQUEST_MESSAGE_LIST,			"AT+CMGL=4",
+		_on_request_message_list, 1 },
 	{ MODEM_REQUEST_MESSAGE_SEND,			NULL,
-		_on_request_message_send },
+		_on_request_message_send, 1 },
 	{ MODEM_REQUEST_PASSWORD_SET,			NULL,
-		_on_request_generic },
+		_on_request_generic, 1 },
 	{ MODEM_REQUEST_REGISTRATION,			NULL,
-		_on_request_registration },
+		_on_request_registration, 1 },
 	{ MODEM_REQUEST_SIGNAL_LEVEL,			"AT+CSQ",
-		_on_request_generic },
+		_on_request_generic, 0 },
 	{ MODEM_REQUEST_UNSUPPORTED,			NULL,
-		_on_request_unsupported }
+		_on_request_unsupported, 0 }
 };
+/* indexed by request type */
+static HayesRequestHandler * _hayes_request_table[HAYES_REQUEST_COUNT];
 
 static HayesCodeHandler _hayes_code_handlers[] =
 {
@@ -541,6 +556,9 @@ static HayesCodeHandler _hayes_code_handlers[] =
 	{ "NO DIALTONE",_on_code_call_error	},
 	{ "RING",	_on_code_cring		}
 };
+#define HAYES_CODE_TABLE_SIZE 64
+static HayesCodeHandler * _hayes_code_table[HAYES_CODE_TABLE_SIZE];
+static size_t _hayes_code_table_len = 0;
 
 
 /* public */
@@ -565,12 +583,28 @@ ModemPluginDefinition plugin =
 static ModemPlugin * _hayes_init(ModemPluginHelper * helper)
 {
 	Hayes * hayes;
+	const size_t count = sizeof(_hayes_request_handlers)
+		/ sizeof(*_hayes_request_handlers);
+	size_t i;
 
 	if((hayes = object_new(sizeof(*hayes))) == NULL)
 		return NULL;
 	memset(hayes, 0, sizeof(*hayes));
+	if((hayes->latency = object_new(sizeof(*hayes->latency) * count))
+			== NULL)
+	{
+		object_delete(hayes);
+		return NULL;
+	}
+	for(i = 0; i < count; i++)
+		hayeslatency_init(&hayes->latency[i]);
+	hayeslatency_init(&hayes->settle);
 	hayes->helper = helper;
 	hayeschannel_init(&hayes->channel, hayes);
+	hayeschannel_init(&hayes->data, hayes);
+	hayeschannel_init(&hayes->unsollicited, hayes);
+	_hayes_code_init();
+	_hayes_request_init();
 	return hayes;
 }
 
@@ -579,7 +613,11 @@ static ModemPlugin * _hayes_init(ModemPluginHelper * helper)
 static void _hayes_destroy(Hayes * hayes)
 {
 	_hayes_stop(hayes);
+	hayeschannel_destroy(&hayes->unsollicited);
+	hayeschannel_destroy(&hayes->data);
 	hayeschannel_destroy(&hayes->channel);
+	free(hayes->statistics);
+	object_delete(hayes->latency);
 	object_delete(hayes);
 }
 
@@ -611,17 +649,49 @@ static int _start_is_started(Hayes * hayes)
 		return 1;
 	if(hayeschannel_is_started(&hayes->channel))
 		return 1;
+	if(hayes->cmux != NULL) /* still being multiplexed */
+		return 1;
 	return 0;
 }
 
 
 /* hayes_stop */
+static void _stop_channel(Hayes * hayes, HayesChannel * channel);
+
 static int _hayes_stop(Hayes * hayes)
 {
 	HayesChannel * channel = &hayes->channel;
 	ModemEvent * event;
 
+	_stop_channel(hayes, &hayes->unsollicited);
+	_stop_channel(hayes, &hayes->data);
+	_stop_channel(hayes, channel);
+	/* this also closes the serial port */
+	if(hayes->cmux != NULL)
+		hayescmux_delete(hayes->cmux);
+	hayes->cmux = NULL;
+	/* this also writes the remaining records */
+	if(hayes->trace != NULL)
+		hayestrace_delete(hayes->trace);
+	hayes->trace = NULL;
+	/* reset battery information */
+	event = &channel->events[MODEM_EVENT_TYPE_BATTERY_LEVEL];
+	if(event->battery_level.status != MODEM_BATTERY_STATUS_UNKNOWN)
+	{
+		event->battery_level.status = MODEM_BATTERY_STATUS_UNKNOWN;
+		event->battery_level.level = 0.0 / 0.0;
+		event->battery_level.charging = 0;
+		hayes->helper->event(hayes->helper->modem, event);
+	}
+	return 0;
+}
+
+static void _stop_channel(Hayes * hayes, HayesChannel * channel)
+{
+	ModemEvent * event;
+
 	hayescommon_source_reset(&channel->source);
+	hayescommon_source_reset(&channel->message_source);
 	hayeschannel_stop(channel);
 	/* report disconnection if already connected */
 	event = &channel->events[MODEM_EVENT_TYPE_CONNECTION];
@@ -632,20 +702,14 @@ static int _hayes_stop(Hayes * hayes)
 		event->connection.out = 0;
 		hayes->helper->event(hayes->helper->modem, event);
 	}
-	/* reset battery information */
-	event = &channel->events[MODEM_EVENT_TYPE_BATTERY_LEVEL];
-	if(event->battery_level.status != MODEM_BATTERY_STATUS_UNKNOWN)
-	{
-		event->battery_level.status = MODEM_BATTERY_STATUS_UNKNOWN;
-		event->battery_level.level = 0.0 / 0.0;
-		event->battery_level.charging = 0;
-		hayes->helper->event(hayes->helper->modem, event);
-	}
-	return 0;
 }
 
 
 /* hayes_trigger */
+static int _trigger_statistics(Hayes * hayes);
+static size_t _trigger_statistics_latency(HayesLatency * latency,
+		char * buf, size_t size);
+
 static int _hayes_trigger(Hayes * hayes, ModemEventType event)
 {
 	int ret = 0;
@@ -659,11 +723,16 @@ static int _hayes_trigger(Hayes * hayes, ModemEventType event)
 	{
 		case MODEM_EVENT_TYPE_BATTERY_LEVEL: /* use the existing data */
 		case MODEM_EVENT_TYPE_CALL:
-		case MODEM_EVENT_TYPE_CONNECTION:
 		case MODEM_EVENT_TYPE_STATUS:
 			e = &channel->events[event];
 			hayes->helper->event(hayes->helper->modem, e);
 			break;
+		case MODEM_EVENT_TYPE_CONNECTION:
+			if(hayes->cmux != NULL)
+				channel = &hayes->data;
+			e = &channel->events[event];
+			hayes->helper->event(hayes->helper->modem, e);
+			break;
 		case MODEM_EVENT_TYPE_AUTHENTICATION:
 			return _hayes_request_type(hayes, channel,
 					HAYES_REQUEST_SIM_PIN_VALID);
@@ -694,6 +763,8 @@ static int _hayes_trigger(Hayes * hayes, ModemEventType event)
 			else
 				hayes->helper->event(hayes->helper->modem, e);
 			break;
+		case MODEM_EVENT_TYPE_STATISTICS:
+			return _trigger_statistics(hayes);
 		case MODEM_EVENT_TYPE_CONTACT_DELETED: /* do not make sense */
 		case MODEM_EVENT_TYPE_ERROR:
 		case MODEM_EVENT_TYPE_NOTIFICATION:
@@ -705,12 +776,64 @@ static int _hayes_trigger(Hayes * hayes, ModemEventType event)
 	return ret;
 }
 
+static int _trigger_statistics(Hayes * hayes)
+{
+	const size_t count = sizeof(_hayes_request_handlers)
+		/ sizeof(*_hayes_request_handlers);
+	const size_t line = 80;
+	ModemEvent event;
+	size_t size = line * (count + 3);
+	size_t pos;
+	char * p;
+	size_t i;
+
+	if((p = realloc(hayes->statistics, size)) == NULL)
+		return -hayes->helper->error(NULL, strerror(errno), 1);
+	hayes->statistics = p;
+	pos = snprintf(p, size, "%-15s %7s %8s %8s %8s %8s %7s\n", "Command",
+			"Answers", "Timeouts", "p50 (ms)", "p95 (ms)",
+			"p99 (ms)", "Timeout");
+	pos += _trigger_statistics_latency(&hayes->settle, &p[pos],
+			size - pos);
+	for(i = 0; i < count; i++)
+		pos += _trigger_statistics_latency(&hayes->latency[i], &p[pos],
+				size - pos);
+	if(hayes->ready != 0)
+		snprintf(&p[pos], size - pos, "%-15s %.1f ms\n", "Registered",
+				hayes->ready / 1000.0);
+	memset(&event, 0, sizeof(event));
+	event.statistics.type = MODEM_EVENT_TYPE_STATISTICS;
+	event.statistics.commands = hayes->statistics;
+	hayes->helper->event(hayes->helper->modem, &event);
+	return 0;
+}
+
+static size_t _trigger_statistics_latency(HayesLatency * latency,
+		char * buf, size_t size)
+{
+	int res;
+
+	if(latency->answers == 0 && latency->timeouts == 0)
+		return 0;
+	res = snprintf(buf, size, "%-15s %7lu %8lu %8.1f %8.1f %8.1f %7u\n",
+			latency->name, latency->answers, latency->timeouts,
+			hayeslatency_get_percentile(latency, 50) / 1000.0,
+			hayeslatency_get_percentile(latency, 95) / 1000.0,
+			hayeslatency_get_percentile(latency, 99) / 1000.0,
+			latency->timeout);
+	return (res > 0 && (size_t)res < size) ? (size_t)res : 0;
+}
+
 
 /* accessors */
 /* hayes_set_mode */
+static void _set_mode_hangup(Hayes * hayes, HayesChannel * channel);
+
 static void _hayes_set_mode(Hayes * hayes, HayesChannel * channel,
 		HayesChannelMode mode)
 {
+	/* the registration is tracked on the command channel */
+	HayesChannel * registration = &hayes->channel;
 	ModemEvent * event;
 
 #ifdef DEBUG
@@ -725,13 +848,19 @@ static void _hayes_set_mode(Hayes * hayes, HayesChannel * channel,
 		case HAYESCHANNEL_MODE_PDU:
 			break; /* nothing to do */
 		case HAYESCHANNEL_MODE_DATA:
-			hayescommon_source_reset(&channel->rd_ppp_source);
-			hayescommon_source_reset(&channel->wr_ppp_source);
+			_hayes_pump_stop(channel);
 			/* reset registration media */
-			event = &channel->events[MODEM_EVENT_TYPE_REGISTRATION];
-			free(channel->registration_media);
-			channel->registration_media = NULL;
+			event = &registration->events[
+				MODEM_EVENT_TYPE_REGISTRATION];
+			free(registration->registration_media);
+			registration->registration_media = NULL;
 			event->registration.media = NULL;
+			if(channel != &hayes->channel)
+			{
+				/* only hang up the multiplexed channel */
+				_set_mode_hangup(hayes, channel);
+				break;
+			}
 			/* reset modem */
 			_hayes_reset(hayes);
 			break;
@@ -744,9 +873,10 @@ static void _hayes_set_mode(Hayes * hayes, HayesChannel * channel,
 			break; /* nothing to do */
 		case HAYESCHANNEL_MODE_DATA:
 			/* report GPRS registration */
-			event = &channel->events[MODEM_EVENT_TYPE_REGISTRATION];
-			free(channel->registration_media);
-			channel->registration_media = NULL;
+			event = &registration->events[
+				MODEM_EVENT_TYPE_REGISTRATION];
+			free(registration->registration_media);
+			registration->registration_media = NULL;
 			event->registration.media = "GPRS";
 			hayes->helper->event(hayes->helper->modem, event);
 			break;
@@ -754,140 +884,389 @@ static void _hayes_set_mode(Hayes * hayes, HayesChannel * channel,
 	channel->mode = mode;
 }
 
+static void _set_mode_hangup(Hayes * hayes, HayesChannel * channel)
+{
+	hayeschannel_stop_ppp(channel);
+	if(hayes->cmux == NULL || channel->channel == NULL)
+		return;
+	hayescmux_hangup(hayes->cmux, HAYESCMUX_DLCI_DATA);
+	/* the parser reads from the channel again */
+	if(channel->rd_source == 0)
+		channel->rd_source = g_io_add_watch(channel->channel, G_IO_IN,
+				_on_watch_can_read, channel);
+	/* and it has to settle again */
+	hayescommon_source_reset(&channel->source);
+	channel->source = g_idle_add(_on_reset_settle2, channel);
+}
+
 
-/* conversions */
-/* hayes_convert_gsm_to_iso */
-static unsigned char _hayes_convert_gsm_to_iso(unsigned char c)
+/* logging */
+/* hayes_log */
+static void _hayes_log(Hayes * hayes, HayesChannel * channel,
+		HayesTraceDirection direction, char const * buf, size_t cnt)
 {
-	size_t i;
+	unsigned int id = 0;
 
-	for(i = 0; i < sizeof(_hayes_gsm_iso) / sizeof(*_hayes_gsm_iso); i++)
-		if(_hayes_gsm_iso[i].gsm == c)
-			return _hayes_gsm_iso[i].iso;
-	return c;
+	if(hayes->trace == NULL)
+		return;
+	if(channel == &hayes->data)
+		id = 1;
+	else if(channel == &hayes->unsollicited)
+		id = 2;
+	/* the record is dropped if the writer thread lags behind */
+	hayestrace_record(hayes->trace, direction, id, buf, cnt);
 }
 
 
-/* hayes_convert_gsm_string_to_iso */
-static void _hayes_convert_gsm_string_to_iso(char * str)
+/* data mode */
+/* hayes_pump_start */
+static void _pump_init(HayesChannelPump * pump, HayesChannel * channel,
+		GIOChannel * from, GIOChannel * to, size_t * counter);
+static int _pump_set_nonblocking(GIOChannel * channel);
+static guint _pump_watch_read(HayesChannelPump * pump);
+
+static int _hayes_pump_start(Hayes * hayes, HayesChannel * channel)
 {
-	unsigned char * ustr = (unsigned char *)str;
-	size_t i;
+	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_CONNECTION];
+	HayesChannelPump * pump = &channel->ppp_in;
 
-	for(i = 0; str[i] != '\0'; i++)
-		ustr[i] = _hayes_convert_gsm_to_iso(ustr[i]);
+	if(channel->channel == NULL || channel->rd_ppp_channel == NULL
+			|| channel->wr_ppp_channel == NULL)
+		return -1;
+	if(_pump_set_nonblocking(channel->channel) != 0
+			|| _pump_set_nonblocking(channel->rd_ppp_channel) != 0
+			|| _pump_set_nonblocking(channel->wr_ppp_channel) != 0)
+		return -hayes->helper->error(NULL, strerror(errno), 1);
+	_pump_init(&channel->ppp_in, channel, channel->channel,
+			channel->wr_ppp_channel, &event->connection.in);
+	_pump_init(&channel->ppp_out, channel, channel->rd_ppp_channel,
+			channel->channel, &event->connection.out);
+	/* the pump reads from the modem instead of the parser */
+	hayescommon_source_reset(&channel->rd_source);
+	/* forward any data already received after CONNECT */
+	if((pump->cnt = min(channel->rd_buf_cnt, sizeof(pump->buf))) > 0)
+	{
+		memcpy(pump->buf, hayeschannel_read_data(channel), pump->cnt);
+		pump->wr_source = g_io_add_watch(pump->to, G_IO_OUT,
+				_on_watch_pump_write, pump);
+	}
+	hayeschannel_read_consume(channel, channel->rd_buf_cnt);
+	channel->ppp_in.rd_source = _pump_watch_read(&channel->ppp_in);
+	channel->ppp_out.rd_source = _pump_watch_read(&channel->ppp_out);
+	return 0;
 }
 
+static void _pump_init(HayesChannelPump * pump, HayesChannel * channel,
+		GIOChannel * from, GIOChannel * to, size_t * counter)
+{
+	pump->channel = channel;
+	pump->from = from;
+	pump->to = to;
+	pump->rd_source = 0;
+	pump->wr_source = 0;
+#ifdef SPLICE_F_MOVE
+	/* logging requires the data to go through the buffer */
+	pump->splice = (channel->hayes->trace == NULL) ? 1 : 0;
+#else
+	pump->splice = 0;
+#endif
+	pump->counter = counter;
+	pump->pos = 0;
+	pump->cnt = 0;
+}
 
-/* hayes_convert_iso_to_gsm */
-static unsigned char _hayes_convert_iso_to_gsm(unsigned char c)
+static int _pump_set_nonblocking(GIOChannel * channel)
 {
-	size_t i;
+	int fd = g_io_channel_unix_get_fd(channel);
+	int fl;
+
+	if((fl = fcntl(fd, F_GETFL, 0)) == -1)
+		return -1;
+	if((fl | O_NONBLOCK) != fl && fcntl(fd, F_SETFL, fl | O_NONBLOCK) == -1)
+		return -1;
+	return 0;
+}
 
-	for(i = 0; i < sizeof(_hayes_gsm_iso) / sizeof(*_hayes_gsm_iso); i++)
-		if(_hayes_gsm_iso[i].iso == c)
-			return _hayes_gsm_iso[i].gsm;
-	return c;
+static guint _pump_watch_read(HayesChannelPump * pump)
+{
+	return g_io_add_watch(pump->from, G_IO_IN | G_IO_HUP | G_IO_ERR,
+			_on_watch_pump_read, pump);
 }
 
 
-/* hayes_convert_iso_string_to_gsm */
-static void _hayes_convert_iso_string_to_gsm(char * str)
+/* hayes_pump_stop */
+static void _hayes_pump_stop(HayesChannel * channel)
 {
-	unsigned char * ustr = (unsigned char *)str;
-	size_t i;
+	hayescommon_source_reset(&channel->ppp_in.rd_source);
+	hayescommon_source_reset(&channel->ppp_in.wr_source);
+	channel->ppp_in.cnt = 0;
+	hayescommon_source_reset(&channel->ppp_out.rd_source);
+	hayescommon_source_reset(&channel->ppp_out.wr_source);
+	channel->ppp_out.cnt = 0;
+}
+
+
+/* contacts */
+/* hayes_contact_list */
+static int _contact_list_window(Hayes * hayes, HayesChannel * channel,
+		unsigned int from, unsigned int to);
+
+static int _hayes_contact_list(Hayes * hayes, HayesChannel * channel)
+{
+	unsigned int to;
+
+	/* keep the next windows queued so that the modem never waits */
+	while(channel->contact_window > 0
+			&& channel->contact_next <= channel->contact_last
+			&& channel->contact_pending < HAYES_CONTACT_LIST_DEPTH)
+	{
+		to = min(channel->contact_last, channel->contact_next
+				+ channel->contact_window - 1);
+		if(_contact_list_window(hayes, channel, channel->contact_next,
+					to) != 0)
+			return -1;
+		channel->contact_next = to + 1;
+	}
+	return 0;
+}
+
+static int _contact_list_window(Hayes * hayes, HayesChannel * channel,
+		unsigned int from, unsigned int to)
+{
+	ModemRequest request;
+	HayesRequestContactList list;
 
-	for(i = 0; str[i] != '\0'; i++)
-		ustr[i] = _hayes_convert_iso_to_gsm(ustr[i]);
+	memset(&request, 0, sizeof(request));
+	request.type = HAYES_REQUEST_CONTACT_LIST;
+	list.from = from;
+	list.to = to;
+	request.plugin.data = &list;
+	if(_hayes_request_channel(hayes, channel, &request, NULL) != 0)
+		return -1;
+	channel->contact_pending++;
+	return 0;
 }
 
 
-/* logging */
-/* hayes_log */
-static void _hayes_log(Hayes * hayes, HayesChannel * channel,
-		char const * prefix, char const * buf, size_t cnt)
+/* messages */
+/* hayes_message_expire */
+static void _hayes_message_expire(HayesChannel * channel, time_t now)
 {
-	ModemPluginHelper * helper = hayes->helper;
+	HayesConcatMessage * message;
+	time_t expiry;
+
+	hayescommon_source_reset(&channel->message_source);
+	if(channel->message_concat == NULL)
+		return;
+	/* report the messages given up on, as far as received */
+	while((message = hayesconcat_expire(channel->message_concat, now))
+			!= NULL)
+		_hayes_message_report(channel, message);
+	/* and check again when the next one is due */
+	if((expiry = hayesconcat_get_expiry(channel->message_concat)) != 0)
+		channel->message_source = g_timeout_add((expiry > now)
+				? (expiry - now) * 1000 : 0,
+				_on_message_expire, channel);
+}
+
 
-	if(channel->fp == NULL)
+/* hayes_message_parts */
+static HayesConcatMessage * _hayes_message_parts(HayesChannel * channel,
+		unsigned int id)
+{
+	GSList * l;
+	HayesConcatMessage * message;
+
+	for(l = channel->message_parts; l != NULL; l = l->next)
+		if((message = l->data)->id == id)
+			return message;
+	return NULL;
+}
+
+
+/* hayes_message_report */
+static void _hayes_message_report(HayesChannel * channel,
+		HayesConcatMessage * message)
+{
+	Hayes * hayes = channel->hayes;
+	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_MESSAGE];
+	HayesConcatMessage * previous;
+
+	/* the message is known by the identifier of its first part */
+	event->message.id = message->id;
+	event->message.date = message->date;
+	event->message.folder = message->folder;
+	event->message.status = message->status;
+	event->message.encoding = message->encoding;
+	event->message.number = message->number;
+	event->message.content = message->content;
+	event->message.length = message->length;
+	hayes->helper->event(hayes->helper->modem, event);
+	if(message->ids_cnt <= 1)
+	{
+		hayesconcatmessage_delete(message);
 		return;
-	if(fprintf(channel->fp, "\n%s", (prefix != NULL) ? prefix : "") == EOF
-			|| fwrite(buf, sizeof(*buf), cnt, channel->fp) < cnt)
+	}
+	/* remember the other parts, to delete them along with it */
+	if((previous = _hayes_message_parts(channel, message->id)) != NULL)
 	{
-		helper->error(NULL, strerror(errno), 1);
-		fclose(channel->fp);
-		channel->fp = NULL;
+		channel->message_parts = g_slist_remove(channel->message_parts,
+				previous);
+		hayesconcatmessage_delete(previous);
 	}
+	free(message->content);
+	message->content = NULL;
+	channel->message_parts = g_slist_prepend(channel->message_parts,
+			message);
 }
 
 
-/* messages */
-/* hayes_message_to_pdu */
-static char * _hayes_message_to_pdu(HayesChannel * channel, char const * number,
-		ModemMessageEncoding encoding, size_t length,
-		char const * content)
+/* hayes_message_to_pdus */
+static char ** _hayes_message_to_pdus(HayesChannel * channel,
+		char const * number, ModemMessageEncoding encoding,
+		size_t length, char const * content, size_t * count)
 {
 	unsigned int flags = 0;
 
 	flags |= hayeschannel_has_quirks(channel, HAYES_QUIRK_WANT_SMSC_IN_PDU)
 		? HAYESPDU_FLAG_WANT_SMSC : 0;
-	return hayespdu_encode(number, encoding, length, content, flags);
+	return hayespdu_encode_concatenated(number, encoding, length, content,
+			flags, channel->message_reference++, count);
 }
 
 
 /* parser */
+/* hayes_code_init */
+static size_t _code_hash(char const * code, size_t len);
+
+static void _hayes_code_init(void)
+{
+	static int initialized = 0;
+	const size_t count = sizeof(_hayes_code_handlers)
+		/ sizeof(*_hayes_code_handlers);
+	size_t i;
+	size_t len;
+	size_t h;
+
+	if(initialized)
+		return;
+	for(i = 0; i < count; i++)
+	{
+		len = strlen(_hayes_code_handlers[i].code);
+		if(len > _hayes_code_table_len)
+			_hayes_code_table_len = len;
+		h = _code_hash(_hayes_code_handlers[i].code, len);
+		/* linear probing (the table is sparse enough) */
+		while(_hayes_code_table[h] != NULL)
+			h = (h + 1) % HAYES_CODE_TABLE_SIZE;
+		_hayes_code_table[h] = &_hayes_code_handlers[i];
+	}
+	initialized = 1;
+}
+
+static size_t _code_hash(char const * code, size_t len)
+{
+	guint32 h = 2166136261u; /* FNV-1a */
+	size_t i;
+
+	for(i = 0; i < len; i++)
+		h = (h ^ (unsigned char)code[i]) * 16777619u;
+	return h % HAYES_CODE_TABLE_SIZE;
+}
+
+
+/* hayes_code_lookup */
+static HayesCodeHandler * _hayes_code_lookup(char const * code, size_t len)
+{
+	size_t h;
+	HayesCodeHandler * hch;
+
+	if(len > _hayes_code_table_len) /* avoid hashing PDUs and the like */
+		return NULL;
+	for(h = _code_hash(code, len); (hch = _hayes_code_table[h]) != NULL;
+			h = (h + 1) % HAYES_CODE_TABLE_SIZE)
+		if(strncmp(hch->code, code, len) == 0 && hch->code[len] == '\0')
+			return hch;
+	return NULL;
+}
+
+
 /* hayes_parse */
-static int _parse_do(Hayes * hayes, HayesChannel * channel);
+static int _parse_do(Hayes * hayes, HayesChannel * channel, char const * line);
+static int _parse_do_batch(Hayes * hayes, HayesChannel * channel,
+		HayesCommand * command, char const * line);
+static int _parse_do_batch_complete(HayesChannel * channel,
+		HayesCommand * command, HayesCommand * last);
+static HayesCommand * _parse_do_batch_route(HayesCommand * command,
+		char const * line);
+static void _parse_do_batch_split(Hayes * hayes, HayesChannel * channel);
 
 static int _hayes_parse(Hayes * hayes, HayesChannel * channel)
 {
 	int ret = 0;
+	char * line = hayeschannel_read_data(channel);
+	size_t cnt = channel->rd_buf_cnt;
 	size_t i;
-	char * p;
 
 #ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s() cnt=%zu\n", __func__, channel->rd_buf_cnt);
+	fprintf(stderr, "DEBUG: %s() cnt=%zu\n", __func__, cnt);
 #endif
-	for(i = 0; i < channel->rd_buf_cnt;)
+	for(i = 0; i < cnt;)
 	{
-		if(channel->rd_buf[i] == '\r')
+		if(line[i] == '\r')
 		{
-			if(i + 1 < channel->rd_buf_cnt
-					&& channel->rd_buf[i + 1] == '\n')
-				channel->rd_buf[i++] = '\0';
+			if(i + 1 < cnt && line[i + 1] == '\n')
+				line[i++] = '\0';
 		}
-		else if(channel->rd_buf[i] != '\n')
+		else if(line[i] != '\n')
 		{
 			i++;
 			continue;
 		}
-		channel->rd_buf[i++] = '\0';
-		if(channel->rd_buf[0] != '\0')
-			ret |= _parse_do(hayes, channel);
-		channel->rd_buf_cnt -= i;
-		memmove(channel->rd_buf, &channel->rd_buf[i],
-				channel->rd_buf_cnt);
+		line[i++] = '\0';
+		/* consume the line in place */
+		hayeschannel_read_consume(channel, i);
+		cnt -= i;
+		if(line[0] != '\0')
+			ret |= _parse_do(hayes, channel, line);
+		if(channel->rd_buf_cnt != cnt)
+			/* the channel was reset meanwhile */
+			return ret;
+		line += i;
 		i = 0;
 	}
-	if((p = realloc(channel->rd_buf, channel->rd_buf_cnt)) != NULL)
-		/* we can ignore errors... */
-		channel->rd_buf = p;
-	else if(channel->rd_buf_cnt == 0)
-		/* ...except when it's not one */
-		channel->rd_buf = NULL;
+	if(cnt + 1 >= sizeof(channel->rd_buf))
+	{
+		/* the line is too long for the buffer: handle it anyway */
+		hayeschannel_read_consume(channel, cnt);
+		ret |= _parse_do(hayes, channel, line);
+	}
 	return ret;
 }
 
-static int _parse_do(Hayes * hayes, HayesChannel * channel)
+static int _parse_do(Hayes * hayes, HayesChannel * channel, char const * line)
 {
-	char const * line = channel->rd_buf;
-	HayesCommand * command = (channel->queue != NULL) ? channel->queue->data
-		: NULL;
+	HayesCommand * command = hayeschannel_queue_get_current(channel);
 	HayesCommandStatus status;
 
+	if(command == NULL && channel->timeout_late != 0
+			&& _is_final_result(line))
+	{
+		/* the command timed out is answered at last: ignore it */
+		hayescommon_source_reset(&channel->timeout_late);
+		_hayes_queue_push(hayes, channel);
+		return 0;
+	}
 	if(command == NULL || hayes_command_get_status(command) != HCS_ACTIVE)
+	{
 		/* this was most likely unsollicited */
+		if(channel == &hayes->unsollicited)
+			/* the command channel keeps track of the state */
+			channel = &hayes->channel;
 		return _hayes_parse_trigger(channel, line, NULL);
+	}
+	if(hayes_command_get_next(command) != NULL)
+		return _parse_do_batch(hayes, channel, command, line);
 	_hayes_parse_trigger(channel, line, command);
 	if(hayes_command_answer_append(command, line) != 0)
 		return -1;
@@ -902,6 +1281,108 @@ static int _parse_do(Hayes * hayes, HayesChannel * channel)
 	return 0;
 }
 
+static int _parse_do_batch(Hayes * hayes, HayesChannel * channel,
+		HayesCommand * command, char const * line)
+{
+	HayesCommand * c;
+	int res;
+
+	if(strcmp(line, "OK") == 0)
+	{
+		/* the whole batch was successful */
+		if((res = _parse_do_batch_complete(channel, command, NULL))
+				!= 0)
+			return (res < 0) ? -1 : 0;
+		hayeschannel_queue_pop(channel);
+		_hayes_queue_push(hayes, channel);
+		return 0;
+	}
+	if(strcmp(line, "ERROR") == 0 || strncmp(line, "+CME ERROR:", 11) == 0
+			|| strncmp(line, "+CMS ERROR:", 11) == 0)
+	{
+		/* the remaining commands were not executed */
+		_parse_do_batch_split(hayes, channel);
+		return 0;
+	}
+	c = _parse_do_batch_route(command, line);
+	_hayes_parse_trigger(channel, line, c);
+	if(hayes_command_answer_append(c, line) != 0)
+		return -1;
+	if(hayes_command_get_status(c) == HCS_ACTIVE)
+		hayes_command_callback(c);
+	return 0;
+}
+
+static int _parse_do_batch_complete(HayesChannel * channel,
+		HayesCommand * command, HayesCommand * last)
+{
+	HayesCommand * c;
+
+	/* up to the last command, excluded */
+	for(c = command; c != last; c = hayes_command_get_next(c))
+	{
+		_hayes_parse_trigger(channel, "OK", c);
+		if(hayes_command_answer_append(c, "OK") != 0)
+			return -1;
+		if(hayes_command_get_status(c) == HCS_ACTIVE)
+			hayes_command_callback(c);
+		if(hayeschannel_queue_get_current(channel) != command)
+			/* the channel was reset meanwhile */
+			return 1;
+	}
+	return 0;
+}
+
+static HayesCommand * _parse_do_batch_route(HayesCommand * command,
+		char const * line)
+{
+	HayesCommand * c;
+	HayesCommand * action = NULL;
+	char const * attention;
+	size_t len;
+
+	for(len = 0; line[len] != '\0' && line[len] != ':'; len++);
+	for(c = command; c != NULL; c = hayes_command_get_next(c))
+	{
+		attention = hayes_command_get_attention(c) + 2;
+		/* look for the command with the same prefix */
+		if(line[0] == '+' && line[len] == ':'
+				&& strncmp(attention, line, len) == 0
+				&& !isalnum((unsigned char)attention[len]))
+			return c;
+		if(_is_action_command(attention))
+			action = c;
+	}
+	/* answers without a prefix belong to the only action command */
+	if(line[0] != '+' && action != NULL)
+		return action;
+	/* otherwise this was most likely unsollicited */
+	return command;
+}
+
+static void _parse_do_batch_split(Hayes * hayes, HayesChannel * channel)
+{
+	HayesCommand * command = hayeschannel_queue_get_current(channel);
+	HayesCommand * failed = command;
+	HayesCommand * c;
+
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s()\n", __func__);
+#endif
+	/* the commands answered were executed, and so were the previous ones */
+	for(c = command; hayes_command_get_next(c) != NULL;
+			c = hayes_command_get_next(c))
+		if(hayes_command_get_answer(c) != NULL)
+			failed = hayes_command_get_next(c);
+	if(_parse_do_batch_complete(channel, command, failed) > 0)
+		return;
+	/* issue the others again one at a time from now on */
+	channel->queue_batch_disabled = 1;
+	hayeschannel_queue_split(channel, failed);
+	hayeschannel_queue_pop(channel);
+	_hayes_queue_push(hayes, channel);
+}
+
 
 /* hayes_parse_pdu */
 static int _parse_pdu_resume(Hayes * hayes, HayesChannel * channel);
@@ -909,37 +1390,36 @@ static int _parse_pdu_send(Hayes * hayes, HayesChannel * channel);
 
 static int _hayes_parse_pdu(Hayes * hayes, HayesChannel * channel)
 {
+	char const * buf = hayeschannel_read_data(channel);
 	size_t i;
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s() cnt=%zu\n", __func__, channel->rd_buf_cnt);
 	for(i = 0; i < channel->rd_buf_cnt; i++)
-		fprintf(stderr, " %02x", channel->rd_buf[i]);
+		fprintf(stderr, " %02x", buf[i]);
 	fputc('\n', stderr);
 #endif
 	for(i = 0; i < channel->rd_buf_cnt;)
 	{
-		if(channel->rd_buf[i] == '\r'
-				|| channel->rd_buf[i] == '\n')
+		if(buf[i] == '\r' || buf[i] == '\n')
 		{
 			/* ignore carriage returns */
 			i++;
 			continue;
 		}
 		/* look for the PDU prompt */
-		if(channel->rd_buf[i] != '>')
+		if(buf[i] != '>')
 			return _parse_pdu_resume(hayes, channel);
 		if(i + 1 >= channel->rd_buf_cnt)
 			/* we need more data */
 			break;
-		if(channel->rd_buf[++i] != ' ')
+		if(buf[++i] != ' ')
 			return _parse_pdu_resume(hayes, channel);
 		_parse_pdu_send(hayes, channel);
 		i++;
 		break;
 	}
-	channel->rd_buf_cnt -= i;
-	memmove(channel->rd_buf, &channel->rd_buf[i], channel->rd_buf_cnt);
+	hayeschannel_read_consume(channel, i);
 	return 0;
 }
 
@@ -961,8 +1441,7 @@ static int _parse_pdu_resume(Hayes * hayes, HayesChannel * channel)
 
 static int _parse_pdu_send(Hayes * hayes, HayesChannel * channel)
 {
-	HayesCommand * command = (channel->queue != NULL)
-		? channel->queue->data : NULL;
+	HayesCommand * command = hayeschannel_queue_get_current(channel);
 	char * pdu;
 
 #ifdef DEBUG
@@ -984,60 +1463,37 @@ static int _parse_pdu_send(Hayes * hayes, HayesChannel * channel)
 static int _hayes_parse_trigger(HayesChannel * channel, char const * answer,
 		HayesCommand * command)
 {
-	size_t i;
-	const size_t count = sizeof(_hayes_code_handlers)
-		/ sizeof(*_hayes_code_handlers);
 	size_t len;
 	HayesCodeHandler * hch;
-	char const * p;
-	int j;
+	HayesCommandHandler handler;
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s(\"%s\", command)\n", __func__, answer);
 #endif
 	/* if the handler is obvious return directly */
-	for(i = 0; i < count; i++)
+	for(len = 0; answer[len] != '\0' && answer[len] != ':'; len++);
+	if((hch = _hayes_code_lookup(answer, len)) != NULL)
 	{
-		hch = &_hayes_code_handlers[i];
-		len = strlen(hch->code);
-		if(strncmp(hch->code, answer, len) != 0)
-			continue;
-		if(answer[len] == ':')
-		{
-			if(answer[++len] == ' ') /* skip the optional space */
-				len++;
-		}
-		else if(answer[len] != '\0')
-			continue;
+		if(answer[len] == ':' && answer[++len] == ' ')
+			len++; /* skip the optional space */
 		hch->callback(channel, &answer[len]);
 		return 0;
 	}
 	/* if the answer has no prefix choose it from the command issued */
-	if(command == NULL
-			|| (p = hayes_command_get_attention(command)) == NULL
-			|| strncmp(p, "AT", 2) != 0)
-		return 0;
-	for(i = 0; i < count; i++)
-	{
-		hch = &_hayes_code_handlers[i];
-		len = strlen(hch->code);
-		if(strncmp(hch->code, &p[2], len) != 0
-				|| isalnum((j = p[2 + len])))
-			continue;
-		hch->callback(channel, answer);
-		return 0;
-	}
+	if(command != NULL
+			&& (handler = hayes_command_get_handler(command)) != NULL)
+		handler(channel, answer);
 	return 0;
 }
 
 
 /* queue */
 /* hayes_queue_command */
+static void _queue_command_bind(HayesCommand * command);
+
 static int _hayes_queue_command(Hayes * hayes, HayesChannel * channel,
 		HayesCommand * command)
 {
-	GSList * queue;
-
 	switch(channel->mode)
 	{
 		case HAYESCHANNEL_MODE_INIT:
@@ -1052,10 +1508,9 @@ static int _hayes_queue_command(Hayes * hayes, HayesChannel * channel,
 			if(hayes_command_set_status(command, HCS_QUEUED)
 					!= HCS_QUEUED)
 				return -1;
-			queue = channel->queue;
-			channel->queue = g_slist_append(channel->queue,
-					command);
-			if(queue == NULL)
+			_queue_command_bind(command);
+			hayeschannel_queue_append(channel, command);
+			if(hayeschannel_queue_get_current(channel) == NULL)
 				_hayes_queue_push(hayes, channel);
 			break;
 	}
@@ -1063,6 +1518,25 @@ static int _hayes_queue_command(Hayes * hayes, HayesChannel * channel,
 }
 
 
+static void _queue_command_bind(HayesCommand * command)
+{
+	char const * p;
+	size_t len = 0;
+	HayesCodeHandler * hch;
+
+	/* answers without a prefix are handled as per the command issued */
+	if((p = hayes_command_get_attention(command)) == NULL
+			|| strncmp(p, "AT", 2) != 0)
+		return;
+	p += 2;
+	if(p[len] == '+')
+		len++;
+	while(isalnum((unsigned char)p[len]))
+		len++;
+	if((hch = _hayes_code_lookup(p, len)) != NULL)
+		hayes_command_set_handler(command, hch->callback);
+}
+
 #if 0 /* XXX no longer used */
 /* hayes_queue_command_full */
 static int _hayes_queue_command_full(Hayes * hayes,
@@ -1089,6 +1563,8 @@ static int _hayes_queue_command_full(Hayes * hayes,
 
 /* hayes_queue_push */
 static int _queue_push_do(Hayes * hayes, HayesChannel * channel);
+static char * _queue_push_batch(HayesChannel * channel, HayesCommand * command,
+		guint * timeout);
 
 static int _hayes_queue_push(Hayes * hayes, HayesChannel * channel)
 {
@@ -1104,17 +1580,21 @@ static int _queue_push_do(Hayes * hayes, HayesChannel * channel)
 	const char suffix[] = "\r\n";
 	size_t size;
 	char * buf;
+	char * batch = NULL;
 	guint timeout;
 
-	if(channel->queue == NULL) /* nothing to send */
-		return 0;
-	command = channel->queue->data;
+	if(hayeschannel_queue_get_current(channel) != NULL)
+		return 0; /* wait for the current command to complete */
+	if(channel->timeout_late != 0)
+		return 0; /* wait for the command timed out to be answered */
 	if(channel->mode == HAYESCHANNEL_MODE_DATA)
 #if 0 /* FIXME does not seem to work (see ATS2, ATS12) */
 		prefix = "+++\r\n";
 #else
 		return 0; /* XXX keep commands in the queue in DATA mode */
 #endif
+	if((command = hayeschannel_queue_next(channel)) == NULL)
+		return 0; /* nothing to send */
 	if(hayes_command_set_status(command, HCS_PENDING) != HCS_PENDING)
 	{
 		/* no longer push the command */
@@ -1122,6 +1602,11 @@ static int _queue_push_do(Hayes * hayes, HayesChannel * channel)
 		return -1;
 	}
 	attention = hayes_command_get_attention(command);
+	timeout = hayes_command_get_timeout(command);
+	if(hayes_command_get_batch(command)
+			&& (batch = _queue_push_batch(channel, command,
+					&timeout)) != NULL)
+		attention = batch;
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s() pushing \"%s\"\n", __func__, attention);
 #endif
@@ -1132,77 +1617,164 @@ static int _queue_push_do(Hayes * hayes, HayesChannel * channel)
 			|| hayeschannel_queue_data(channel, buf, size - 1) != 0)
 	{
 		free(buf);
+		free(batch);
 		hayes_command_set_status(command, HCS_ERROR);
 		hayeschannel_queue_pop(channel);
 		return -hayes->helper->error(hayes->helper->modem, strerror(
 					errno), 1);
 	}
 	free(buf);
+	free(batch);
 	if(channel->channel != NULL && channel->wr_source == 0)
 		channel->wr_source = g_io_add_watch(channel->channel, G_IO_OUT,
 				_on_watch_can_write, channel);
 	hayescommon_source_reset(&channel->timeout);
-	if((timeout = hayes_command_get_timeout(command)) != 0)
+	if(timeout != 0)
 		channel->timeout = g_timeout_add(timeout, _on_channel_timeout,
 				channel);
 	return 0;
 }
 
+static char * _queue_push_batch(HayesChannel * channel, HayesCommand * command,
+		guint * timeout)
+{
+	char buf[HAYES_BATCH_SIZE];
+	char const * attention = hayes_command_get_attention(command);
+	size_t len;
+	size_t size;
+	int action;
+	int extended;
+	HayesCommand * next;
+	char const * p;
+
+	/* only for the modems known to accept it */
+	if(channel->queue_batch_disabled
+			|| !hayeschannel_has_quirks(channel, HAYES_QUIRK_BATCH)
+			|| strncmp(attention, "AT", 2) != 0
+			|| (len = strlen(attention)) >= sizeof(buf))
+		return NULL;
+	memcpy(buf, attention, len + 1);
+	action = _is_action_command(&attention[2]);
+	extended = (attention[2] == '+') ? 1 : 0;
+	/* append the next commands as long as they are independent */
+	while((next = hayeschannel_queue_peek(channel)) != NULL
+			&& hayes_command_get_batch(next))
+	{
+		if(strncmp((p = hayes_command_get_attention(next)), "AT", 2)
+				!= 0)
+			break;
+		p += 2;
+		/* only one command may answer without a prefix */
+		if(_is_action_command(p) && action++)
+			break;
+		/* extended commands are separated by semicolons */
+		if((size = strlen(p) + extended) >= sizeof(buf) - len)
+			break;
+		if(hayes_command_set_status(next, HCS_PENDING) != HCS_PENDING)
+			break;
+		if(extended)
+			buf[len++] = ';';
+		memcpy(&buf[len], p, size - extended + 1);
+		len += size - extended;
+		extended = (p[0] == '+') ? 1 : 0;
+		*timeout = max(*timeout, hayes_command_get_timeout(next));
+		hayeschannel_queue_join(channel);
+	}
+	if(hayes_command_get_next(command) == NULL)
+		return NULL;
+	return strdup(buf);
+}
+
+
+
+/* hayes_request_init */
+static void _hayes_request_init(void)
+{
+	static int initialized = 0;
+	const size_t count = sizeof(_hayes_request_handlers)
+		/ sizeof(*_hayes_request_handlers);
+	size_t i;
+	unsigned int type;
+
+	if(initialized)
+		return;
+	for(i = 0; i < count; i++)
+	{
+		type = _hayes_request_handlers[i].type;
+		if(type < HAYES_REQUEST_COUNT
+				&& _hayes_request_table[type] == NULL)
+			_hayes_request_table[type] = &_hayes_request_handlers[i];
+	}
+	initialized = 1;
+}
+
 
 /* hayes_request_channel */
-static char * _request_attention(Hayes * hayes, HayesChannel * channel,
+static char const * _request_attention(Hayes * hayes, HayesChannel * channel,
 		ModemRequest * request, void ** data);
-static char * _request_attention_apn(char const * protocol, char const * apn);
-static char * _request_attention_call(HayesChannel * channel,
+static char const * _request_attention_apn(HayesChannel * channel,
+		char const * protocol, char const * apn);
+static char const * _request_attention_call(HayesChannel * channel,
+		ModemRequest * request);
+static char const * _request_attention_call_data(HayesChannel * channel,
 		ModemRequest * request);
-static char * _request_attention_call_data(HayesChannel * channel,
+static char const * _request_attention_call_ussd(HayesChannel * channel,
 		ModemRequest * request);
-static char * _request_attention_call_ussd(ModemRequest * request);
-static char * _request_attention_call_hangup(Hayes * hayes,
+static char const * _request_attention_call_hangup(Hayes * hayes,
 		HayesChannel * channel);
-static char * _request_attention_connectivity(Hayes * hayes,
+static char const * _request_attention_connectivity(Hayes * hayes,
 		HayesChannel * channel, unsigned int enabled);
-static char * _request_attention_contact_delete(HayesChannel * channel,
+static char const * _request_attention_contact_delete(HayesChannel * channel,
 		unsigned int id);
-static char * _request_attention_contact_edit(unsigned int id,
+static char const * _request_attention_contact_edit(HayesChannel * channel,
+		unsigned int id, char const * name, char const * number);
+static char const * _request_attention_contact_list(HayesChannel * channel,
+		ModemRequest * request);
+static char const * _request_attention_contact_new(HayesChannel * channel,
 		char const * name, char const * number);
-static char * _request_attention_contact_list(ModemRequest * request);
-static char * _request_attention_contact_new(char const * name,
-		char const * number);
-static char * _request_attention_dtmf_send(ModemRequest * request);
-static char * _request_attention_gprs(Hayes * hayes, HayesChannel * channel,
-		char const * username, char const * password);
-static char * _request_attention_message(unsigned int id);
-static char * _request_attention_message_delete(HayesChannel * channel,
+static char const * _request_attention_dtmf_send(HayesChannel * channel,
+		ModemRequest * request);
+static char const * _request_attention_gprs(Hayes * hayes,
+		HayesChannel * channel, char const * username,
+		char const * password);
+static char const * _request_attention_message(HayesChannel * channel,
 		unsigned int id);
-static char * _request_attention_message_list(Hayes * hayes,
-		HayesChannel * channel);
-static char * _request_attention_message_send(Hayes * hayes,
+static char const * _request_attention_message_delete(HayesChannel * channel,
+		unsigned int id);
+static void _message_delete_part(HayesChannel * channel, unsigned int id);
+static char const * _request_attention_message_send(Hayes * hayes,
 		HayesChannel * channel, char const * number,
 		ModemMessageEncoding encoding, size_t length,
 		char const * content, void ** data);
-static char * _request_attention_password_set(Hayes * hayes, char const * name,
+static char const * _message_send_attention(HayesChannel * channel,
+		char const * pdu);
+static void _message_send_error(Hayes * hayes, HayesChannel * channel);
+static HayesCommand * _message_send_part(HayesChannel * channel, char * pdu);
+static char const * _request_attention_password_set(Hayes * hayes,
+		HayesChannel * channel, char const * name,
 		char const * oldpassword, char const * newpassword);
-static char * _request_attention_registration(Hayes * hayes,
+static char const * _request_attention_registration(Hayes * hayes,
 		HayesChannel * channel, ModemRegistrationMode mode,
 		char const * _operator);
-static char * _request_attention_sim_pin(Hayes * hayes, HayesChannel * channel,
-		char const * password);
-static char * _request_attention_sim_puk(Hayes * hayes, HayesChannel * channel,
-		char const * password);
-static char * _request_attention_unsupported(Hayes * hayes,
-		ModemRequest * request);
+static char const * _request_attention_sim_pin(Hayes * hayes,
+		HayesChannel * channel, char const * password);
+static char const * _request_attention_sim_puk(Hayes * hayes,
+		HayesChannel * channel, char const * password);
+static char const * _request_attention_unsupported(Hayes * hayes,
+		HayesChannel * channel, ModemRequest * request);
+static int _request_batch(unsigned int type);
 static int _request_channel_handler(Hayes * hayes, HayesChannel * channel,
 		ModemRequest * request, void * data,
 		HayesRequestHandler * handler);
+static HayesCommandPriority _request_priority(unsigned int type);
+static HayesChannel * _request_route(Hayes * hayes, HayesChannel * channel,
+		ModemRequest * request);
 
 static int _hayes_request_channel(Hayes * hayes, HayesChannel * channel,
 		ModemRequest * request, void * data)
 {
 	unsigned int type = request->type;
-	size_t i;
-	const size_t count = sizeof(_hayes_request_handlers)
-		/ sizeof(*_hayes_request_handlers);
+	HayesRequestHandler * handler;
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s(%u)\n", __func__,
@@ -1210,13 +1782,13 @@ static int _hayes_request_channel(Hayes * hayes, HayesChannel * channel,
 #endif
 	if(request == NULL)
 		return -1;
+	channel = _request_route(hayes, channel, request);
 	if(hayeschannel_has_quirks(channel, HAYES_QUIRK_CONNECTED_LINE_DISABLED)
 			&& type == HAYES_REQUEST_CONNECTED_LINE_ENABLE)
 		request->type = HAYES_REQUEST_CONNECTED_LINE_DISABLE;
-	for(i = 0; i < count; i++)
-		if(_hayes_request_handlers[i].type == request->type)
-			break;
-	if(i == count)
+	if(request->type >= HAYES_REQUEST_COUNT
+			|| (handler = _hayes_request_table[request->type])
+			== NULL)
 #ifdef DEBUG
 		return -hayes->helper->error(hayes->helper->modem,
 				"Unable to handle request", 1);
@@ -1225,7 +1797,7 @@ static int _hayes_request_channel(Hayes * hayes, HayesChannel * channel,
 				1);
 #endif
 	return _request_channel_handler(hayes, channel, request, data,
-			&_hayes_request_handlers[i]);
+			handler);
 }
 
 static int _request_channel_handler(Hayes * hayes, HayesChannel * channel,
@@ -1234,44 +1806,159 @@ static int _request_channel_handler(Hayes * hayes, HayesChannel * channel,
 {
 	HayesCommand * command;
 	char const * attention;
-	char * p = NULL;
+	HayesLatency * latency;
+	unsigned int timeout;
 
-	if((attention = handler->attention) == NULL)
-	{
-		if((p = _request_attention(hayes, channel, request, &data))
-				== NULL)
-			return 0; /* XXX errors should not be ignored */
-		attention = p;
-	}
+	if((attention = handler->attention) == NULL
+			&& (attention = _request_attention(hayes, channel,
+					request, &data)) == NULL)
+		return 0; /* XXX errors should not be ignored */
 	/* XXX using _hayes_queue_command_full() was more elegant */
-	command = hayes_command_new(attention);
-	free(p);
+	/* only the attentions formatted on the fly need to be copied */
+	command = (attention == channel->attention)
+		? hayes_command_new(attention)
+		: hayes_command_new_static(attention);
 	if(command == NULL)
 		return -1;
+	latency = &hayes->latency[handler - _hayes_request_handlers];
+	if(latency->name[0] == '\0')
+		hayeslatency_set_name(latency, attention);
+	/* learn how long this kind of command takes, unless the network or
+	 * the SIM can make it much longer than observed */
+	timeout = hayes_command_get_timeout(command);
+	hayes_command_set_timeout(command, hayeslatency_get_timeout(latency,
+				timeout, handler->network ? timeout
+				: HAYES_TIMEOUT_FLOOR, timeout));
+	hayes_command_set_latency(command, latency);
 	hayes_command_set_callback(command, handler->callback, channel);
+	hayes_command_set_priority(command, _request_priority(request->type));
+	hayes_command_set_batch(command, _request_batch(request->type));
+	/* the data may be needed as soon as the command is pushed */
+	hayes_command_set_data(command, data);
 	if(_hayes_queue_command(hayes, channel, command) != 0)
 	{
+		hayes_command_set_data(command, NULL);
 		hayes_command_delete(command);
 		return -1;
 	}
-	if(data != NULL)
-		hayes_command_set_data(command, data);
 	return 0;
 }
 
-static char * _request_attention(Hayes * hayes, HayesChannel * channel,
+static int _request_batch(unsigned int type)
+{
+	switch(type)
+	{
+		/* settings and queries which can be issued again safely */
+		case HAYES_REQUEST_CALL_WAITING_UNSOLLICITED_ENABLE:
+		case HAYES_REQUEST_CONNECTED_LINE_DISABLE:
+		case HAYES_REQUEST_CONNECTED_LINE_ENABLE:
+		case HAYES_REQUEST_EXTENDED_ERRORS:
+		case HAYES_REQUEST_EXTENDED_RING_REPORTS:
+		case HAYES_REQUEST_FUNCTIONAL:
+		case HAYES_REQUEST_GPRS_ATTACHED:
+		case HAYES_REQUEST_LOCAL_ECHO_DISABLE:
+		case HAYES_REQUEST_MESSAGE_FORMAT_PDU:
+		case HAYES_REQUEST_MESSAGE_UNSOLLICITED_ENABLE:
+		case HAYES_REQUEST_OPERATOR:
+		case HAYES_REQUEST_REGISTRATION:
+		case HAYES_REQUEST_REGISTRATION_UNSOLLICITED_ENABLE:
+		case HAYES_REQUEST_SERIAL_NUMBER:
+		case HAYES_REQUEST_SUBSCRIBER_IDENTITY:
+		case HAYES_REQUEST_SUPPLEMENTARY_SERVICE_DATA_ENABLE:
+		case HAYES_REQUEST_VERBOSE_ENABLE:
+		case HAYES_REQUEST_VERSION:
+		case MODEM_REQUEST_BATTERY_LEVEL:
+		case MODEM_REQUEST_CALL_PRESENTATION:
+		case MODEM_REQUEST_SIGNAL_LEVEL:
+			return 1;
+		/* anything changing the state or taking data */
+		default:
+			return 0;
+	}
+}
+
+static HayesCommandPriority _request_priority(unsigned int type)
+{
+	switch(type)
+	{
+		/* still part of the initialization */
+		case HAYES_REQUEST_CMUX:
+			return HCP_IMMEDIATE;
+		/* calls must not wait for background requests */
+		case MODEM_REQUEST_CALL_ANSWER:
+		case MODEM_REQUEST_CALL_HANGUP:
+		case MODEM_REQUEST_DTMF_SEND:
+			return HCP_HIGHER;
+		/* polling and bulk reads */
+		case HAYES_REQUEST_CONTACT_LIST:
+		case MODEM_REQUEST_BATTERY_LEVEL:
+		case MODEM_REQUEST_CONTACT_LIST:
+		case MODEM_REQUEST_MESSAGE:
+		case MODEM_REQUEST_MESSAGE_LIST:
+		case MODEM_REQUEST_SIGNAL_LEVEL:
+			return HCP_LOWER;
+		default:
+			return HCP_NORMAL;
+	}
+}
+
+static HayesChannel * _request_route(Hayes * hayes, HayesChannel * channel,
+		ModemRequest * request)
+{
+	HayesChannel * route = &hayes->channel;
+	unsigned int type = request->type;
+
+	if(hayes->cmux == NULL)
+		return channel;
+	switch(type)
+	{
+		/* data calls have a channel of their own */
+		case MODEM_REQUEST_CALL:
+			if(request->call.call_type == MODEM_CALL_TYPE_DATA)
+				route = &hayes->data;
+			break;
+		case MODEM_REQUEST_CALL_HANGUP:
+			if(hayes->data.mode == HAYESCHANNEL_MODE_DATA)
+				route = &hayes->data;
+			break;
+		/* so do the unsollicited notifications */
+		case HAYES_REQUEST_CALL_WAITING_UNSOLLICITED_DISABLE:
+		case HAYES_REQUEST_CALL_WAITING_UNSOLLICITED_ENABLE:
+		case HAYES_REQUEST_CONNECTED_LINE_DISABLE:
+		case HAYES_REQUEST_CONNECTED_LINE_ENABLE:
+		case HAYES_REQUEST_EXTENDED_RING_REPORTS:
+		case HAYES_REQUEST_MESSAGE_UNSOLLICITED_DISABLE:
+		case HAYES_REQUEST_MESSAGE_UNSOLLICITED_ENABLE:
+		case HAYES_REQUEST_REGISTRATION_UNSOLLICITED_DISABLE:
+		case HAYES_REQUEST_REGISTRATION_UNSOLLICITED_ENABLE:
+		case HAYES_REQUEST_SUPPLEMENTARY_SERVICE_DATA_DISABLE:
+		case HAYES_REQUEST_SUPPLEMENTARY_SERVICE_DATA_ENABLE:
+		case MODEM_REQUEST_CALL_PRESENTATION:
+			route = &hayes->unsollicited;
+			break;
+		default:
+			break;
+	}
+	/* fallback to the command channel until the others are settled */
+	if(route == &hayes->channel || route->mode == HAYESCHANNEL_MODE_INIT)
+		return &hayes->channel;
+	hayeschannel_set_quirks(route, hayes->channel.quirks);
+	return route;
+}
+
+static char const * _request_attention(Hayes * hayes, HayesChannel * channel,
 		ModemRequest * request, void ** data)
 {
 	unsigned int type = request->type;
-	char buf[32];
 
 	switch(type)
 	{
 		case HAYES_REQUEST_CONTACT_LIST:
-			return _request_attention_contact_list(request);
+			return _request_attention_contact_list(channel,
+					request);
 		case MODEM_REQUEST_AUTHENTICATE:
 			if(strcmp(request->authenticate.name, "APN") == 0)
-				return _request_attention_apn(
+				return _request_attention_apn(channel,
 						request->authenticate.username,
 						request->authenticate.password);
 			if(strcmp(request->authenticate.name, "GPRS") == 0)
@@ -1290,7 +1977,8 @@ static char * _request_attention(Hayes * hayes, HayesChannel * channel,
 		case MODEM_REQUEST_CALL:
 			if(request->call.call_type == MODEM_CALL_TYPE_VOICE
 					&& _is_ussd_code(request->call.number))
-				return _request_attention_call_ussd(request);
+				return _request_attention_call_ussd(channel,
+						request);
 			else if(request->call.call_type == MODEM_CALL_TYPE_DATA)
 				return _request_attention_call_data(channel,
 						request);
@@ -1299,10 +1987,8 @@ static char * _request_attention(Hayes * hayes, HayesChannel * channel,
 		case MODEM_REQUEST_CALL_HANGUP:
 			return _request_attention_call_hangup(hayes, channel);
 		case MODEM_REQUEST_CALL_PRESENTATION:
-			snprintf(buf, sizeof(buf), "%s%u", "AT+CLIP=",
-					request->call_presentation.enabled
-					? 1 : 0);
-			return strdup(buf);
+			return request->call_presentation.enabled
+				? "AT+CLIP=1" : "AT+CLIP=0";
 		case MODEM_REQUEST_CONNECTIVITY:
 			return _request_attention_connectivity(hayes, channel,
 					request->connectivity.enabled);
@@ -1310,20 +1996,19 @@ static char * _request_attention(Hayes * hayes, HayesChannel * channel,
 			return _request_attention_contact_delete(channel,
 					request->contact_delete.id);
 		case MODEM_REQUEST_CONTACT_EDIT:
-			return _request_attention_contact_edit(
+			return _request_attention_contact_edit(channel,
 					request->contact_edit.id,
 					request->contact_edit.name,
 					request->contact_edit.number);
 		case MODEM_REQUEST_CONTACT_NEW:
-			return _request_attention_contact_new(
+			return _request_attention_contact_new(channel,
 					request->contact_new.name,
 					request->contact_new.number);
 		case MODEM_REQUEST_DTMF_SEND:
-			return _request_attention_dtmf_send(request);
+			return _request_attention_dtmf_send(channel, request);
 		case MODEM_REQUEST_MESSAGE:
-			return _request_attention_message(request->message.id);
-		case MODEM_REQUEST_MESSAGE_LIST:
-			return _request_attention_message_list(hayes, channel);
+			return _request_attention_message(channel,
+					request->message.id);
 		case MODEM_REQUEST_MESSAGE_DELETE:
 			return _request_attention_message_delete(channel,
 					request->message_delete.id);
@@ -1334,7 +2019,7 @@ static char * _request_attention(Hayes * hayes, HayesChannel * channel,
 					request->message_send.length,
 					request->message_send.content, data);
 		case MODEM_REQUEST_PASSWORD_SET:
-			return _request_attention_password_set(hayes,
+			return _request_attention_password_set(hayes, channel,
 					request->password_set.name,
 					request->password_set.oldpassword,
 					request->password_set.newpassword);
@@ -1343,38 +2028,31 @@ static char * _request_attention(Hayes * hayes, HayesChannel * channel,
 					request->registration.mode,
 					request->registration._operator);
 		case MODEM_REQUEST_UNSUPPORTED:
-			return _request_attention_unsupported(hayes, request);
+			return _request_attention_unsupported(hayes, channel,
+					request);
 		default:
 			break;
 	}
 	return NULL;
 }
 
-static char * _request_attention_apn(char const * protocol, char const * apn)
+static char const * _request_attention_apn(HayesChannel * channel,
+		char const * protocol, char const * apn)
 {
-	char * ret;
-	const char cmd[] = "AT+CGDCONT=1,";
-	size_t len;
-
 	if(protocol == NULL || apn == NULL)
 		return NULL;
-	len = sizeof(cmd) + strlen(protocol) + 2 + strlen(apn) + 3;
-	if((ret = malloc(len)) == NULL)
-		return NULL;
-	snprintf(ret, len, "%s\"%s\",\"%s\"", cmd, protocol, apn);
-	return ret;
+	return hayeschannel_attention_format(channel, "%s\"%s\",\"%s\"",
+			"AT+CGDCONT=1,", protocol, apn);
 }
 
-static char * _request_attention_call(HayesChannel * channel,
+static char const * _request_attention_call(HayesChannel * channel,
 		ModemRequest * request)
 {
-	char * ret;
 	char const * number = request->call.number;
 	ModemEvent * event;
 	const char cmd[] = "ATD";
 	const char anonymous[] = "I";
 	const char voice[] = ";";
-	size_t len;
 
 	if(request->call.number == NULL)
 		request->call.number = "";
@@ -1391,42 +2069,33 @@ static char * _request_attention_call(HayesChannel * channel,
 	else if((channel->call_number = strdup(request->call.number)) == NULL)
 		return NULL;
 	event->call.number = channel->call_number;
-	len = sizeof(cmd) + strlen(number) + sizeof(anonymous) + sizeof(voice);
-	if((ret = malloc(len)) == NULL)
-		return NULL;
-	snprintf(ret, len, "%s%s%s%s", cmd, number,
+	return hayeschannel_attention_format(channel, "%s%s%s%s", cmd, number,
 			(request->call.anonymous) ? anonymous : "",
 			(request->call.call_type == MODEM_CALL_TYPE_VOICE)
 			? voice : "");
-	return ret;
 }
 
-static char * _request_attention_call_data(HayesChannel * channel,
+static char const * _request_attention_call_data(HayesChannel * channel,
 		ModemRequest * request)
 {
 	if(request->call.number == NULL)
-		return strdup("AT+CGDATA=\"PPP\"");
+		return "AT+CGDATA=\"PPP\"";
 	return _request_attention_call(channel, request);
 }
 
-static char * _request_attention_call_ussd(ModemRequest * request)
+static char const * _request_attention_call_ussd(HayesChannel * channel,
+		ModemRequest * request)
 {
-	char * ret;
 	char const * number = request->call.number;
 	const char cmd[] = "AT+CUSD=1,";
-	size_t len;
 
 	if(request->call.number == NULL || request->call.number[0] == '\0')
 		return NULL;
-	len = sizeof(cmd) + strlen(number) + 2;
-	if((ret = malloc(len)) == NULL)
-		return NULL;
 	/* XXX may also require setting dcs */
-	snprintf(ret, len, "%s\"%s\"", cmd, number);
-	return ret;
+	return hayeschannel_attention_format(channel, "%s\"%s\"", cmd, number);
 }
 
-static char * _request_attention_call_hangup(Hayes * hayes,
+static char const * _request_attention_call_hangup(Hayes * hayes,
 		HayesChannel * channel)
 {
 	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_CONNECTION];
@@ -1449,12 +2118,12 @@ static char * _request_attention_call_hangup(Hayes * hayes,
 	event = &channel->events[MODEM_EVENT_TYPE_CALL];
 	if(event->call.direction == MODEM_CALL_DIRECTION_INCOMING
 			&& event->call.status == MODEM_CALL_STATUS_RINGING)
-		return strdup("ATH");
+		return "ATH";
 	/* force all calls to terminate */
-	return strdup("AT+CHUP");
+	return "AT+CHUP";
 }
 
-static char * _request_attention_connectivity(Hayes * hayes,
+static char const * _request_attention_connectivity(Hayes * hayes,
 		HayesChannel * channel, unsigned int enabled)
 {
 	_hayes_request_type(hayes, channel, enabled
@@ -1463,106 +2132,86 @@ static char * _request_attention_connectivity(Hayes * hayes,
 	return NULL;
 }
 
-static char * _request_attention_contact_delete(HayesChannel * channel,
+static char const * _request_attention_contact_delete(HayesChannel * channel,
 		unsigned int id)
 {
 	char const cmd[] = "AT+CPBW=";
-	char buf[32];
 
 	/* FIXME store in the command itself */
 	channel->events[MODEM_EVENT_TYPE_CONTACT_DELETED].contact_deleted.id
 		= id;
-	snprintf(buf, sizeof(buf), "%s%u%s", cmd, id, ",");
-	return strdup(buf);
+	return hayeschannel_attention_format(channel, "%s%u%s", cmd, id, ",");
 }
 
-static char * _request_attention_contact_edit(unsigned int id,
-		char const * name, char const * number)
+static char const * _request_attention_contact_edit(HayesChannel * channel,
+		unsigned int id, char const * name, char const * number)
 {
 	char const cmd[] = "AT+CPBW=";
-	char buf[128];
+	char const * ret;
 	char * p;
 
 	if(!hayescommon_number_is_valid(number)
 			|| name == NULL || strlen(name) == 0)
 		/* XXX report error */
 		return NULL;
-	if((p = g_convert(name, -1, "ISO-8859-1", "UTF-8", NULL, NULL, NULL))
-			!= NULL)
-	{
-		_hayes_convert_iso_string_to_gsm(p);
+	if((p = hayesgsm_from_utf8(name, strlen(name), NULL)) != NULL)
 		name = p;
-	}
-	if(snprintf(buf, sizeof(buf), "%s%u%s\"%s\"%s%u%s\"%s\"", cmd, id, ",",
-				(number[0] == '+') ? &number[1] : number, ",",
-				(number[0] == '+') ? 145 : 129, ",", name)
-			>= (int)sizeof(buf))
-	{
-		g_free(p);
-		/* XXX report error */
-		return NULL;
-	}
-	g_free(p);
-	return strdup(buf);
+	/* XXX report errors */
+	ret = hayeschannel_attention_format(channel, "%s%u%s\"%s\"%s%u%s\"%s\"",
+			cmd, id, ",", (number[0] == '+') ? &number[1] : number,
+			",", (number[0] == '+') ? 145 : 129, ",", name);
+	free(p);
+	return ret;
 }
 
-static char * _request_attention_contact_list(ModemRequest * request)
+static char const * _request_attention_contact_list(HayesChannel * channel,
+		ModemRequest * request)
 {
 	HayesRequestContactList * list = request->plugin.data;
 	const char cmd[] = "AT+CPBR=";
-	char buf[32];
 
 	if(list->to < list->from)
 		list->to = list->from;
-	snprintf(buf, sizeof(buf), "%s%u,%u", cmd, list->from, list->to);
-	return strdup(buf);
+	return hayeschannel_attention_format(channel, "%s%u,%u", cmd,
+			list->from, list->to);
 }
 
-static char * _request_attention_contact_new(char const * name,
-		char const * number)
+static char const * _request_attention_contact_new(HayesChannel * channel,
+		char const * name, char const * number)
 {
 	char const cmd[] = "AT+CPBW=";
-	char buf[128];
+	char const * ret;
 	char * p;
 
 	if(!hayescommon_number_is_valid(number)
 			|| name == NULL || strlen(name) == 0)
 		/* XXX report error */
 		return NULL;
-	if((p = g_convert(name, -1, "ISO-8859-1", "UTF-8", NULL, NULL, NULL))
-			!= NULL)
-	{
-		_hayes_convert_iso_string_to_gsm(p);
+	if((p = hayesgsm_from_utf8(name, strlen(name), NULL)) != NULL)
 		name = p;
-	}
-	if(snprintf(buf, sizeof(buf), "%s%s\"%s\"%s%u%s\"%s\"", cmd, ",",
-				(number[0] == '+') ? &number[1] : number, ",",
-				(number[0] == '+') ? 145 : 129, ",", name)
-			>= (int)sizeof(buf))
-	{
-		g_free(p);
-		/* XXX report error */
-		return NULL;
-	}
-	g_free(p);
-	return strdup(buf);
+	/* XXX report errors */
+	ret = hayeschannel_attention_format(channel, "%s%s\"%s\"%s%u%s\"%s\"",
+			cmd, ",", (number[0] == '+') ? &number[1] : number,
+			",", (number[0] == '+') ? 145 : 129, ",", name);
+	free(p);
+	return ret;
 }
 
-static char * _request_attention_dtmf_send(ModemRequest * request)
+static char const * _request_attention_dtmf_send(HayesChannel * channel,
+		ModemRequest * request)
 {
 	const char cmd[] = "AT+VTS=";
-	char buf[32];
 	unsigned int dtmf = request->dtmf_send.dtmf;
 
 	if((dtmf < '0' || dtmf > '9') && (dtmf < 'A' || dtmf > 'D')
 			&& dtmf != '*' && dtmf != '#')
 		return NULL;
-	snprintf(buf, sizeof(buf), "%s%c", cmd, dtmf);
-	return strdup(buf);
+	return hayeschannel_attention_format(channel, "%s%c", cmd, dtmf);
 }
 
-static char * _request_attention_gprs(Hayes * hayes, HayesChannel * channel,
-		char const * username, char const * password)
+static char const * _request_attention_gprs(Hayes * hayes,
+		HayesChannel * channel, char const * username,
+		char const * password)
 {
 	free(channel->gprs_username);
 	channel->gprs_username = (username != NULL) ? strdup(username) : NULL;
@@ -1575,115 +2224,176 @@ static char * _request_attention_gprs(Hayes * hayes, HayesChannel * channel,
 	return NULL; /* we don't need to issue any command */
 }
 
-static char * _request_attention_message(unsigned int id)
+static char const * _request_attention_message(HayesChannel * channel,
+		unsigned int id)
 {
 	char const cmd[] = "AT+CMGR=";
-	char buf[32];
 
 	/* FIXME force the message format to be in PDU mode? */
-	snprintf(buf, sizeof(buf), "%s%u", cmd, id);
-	return strdup(buf);
+	return hayeschannel_attention_format(channel, "%s%u", cmd, id);
 }
 
-static char * _request_attention_message_delete(HayesChannel * channel,
+static char const * _request_attention_message_delete(HayesChannel * channel,
 		unsigned int id)
 {
 	char const cmd[] = "AT+CMGD=";
-	char buf[32];
+	HayesConcatMessage * message;
+	size_t i;
 
+	/* delete the other parts of the message first */
+	if((message = _hayes_message_parts(channel, id)) != NULL)
+	{
+		for(i = 0; i < message->ids_cnt; i++)
+			if(message->ids[i] != id)
+				_message_delete_part(channel, message->ids[i]);
+		channel->message_parts = g_slist_remove(channel->message_parts,
+				message);
+		hayesconcatmessage_delete(message);
+	}
 	/* FIXME store in the command itself */
 	channel->events[MODEM_EVENT_TYPE_MESSAGE_DELETED].message_deleted.id
 		= id;
-	snprintf(buf, sizeof(buf), "%s%u", cmd, id);
-	return strdup(buf);
+	return hayeschannel_attention_format(channel, "%s%u", cmd, id);
 }
 
-static char * _request_attention_message_list(Hayes * hayes,
-		HayesChannel * channel)
+static void _message_delete_part(HayesChannel * channel, unsigned int id)
 {
-	ModemRequest request;
-	HayesRequestMessageData * data;
+	Hayes * hayes = channel->hayes;
+	char const cmd[] = "AT+CMGD=";
+	char const * attention;
+	HayesCommand * command;
 
-	memset(&request, 0, sizeof(request));
-	/* request received unread messages */
-	request.type = HAYES_REQUEST_MESSAGE_LIST_INBOX_UNREAD;
-	if((data = malloc(sizeof(*data))) != NULL)
+	if((attention = hayeschannel_attention_format(channel, "%s%u", cmd,
+					id)) == NULL
+			|| (command = hayes_command_new(attention)) == NULL)
+		return;
+	hayes_command_set_callback(command, _on_request_generic, channel);
+	hayes_command_set_priority(command, _request_priority(
+				MODEM_REQUEST_MESSAGE_DELETE));
+	if(_hayes_queue_command(hayes, channel, command) != 0)
+		hayes_command_delete(command);
+}
+
+static char const * _request_attention_message_send(Hayes * hayes,
+		HayesChannel * channel, char const * number,
+		ModemMessageEncoding encoding, size_t length,
+		char const * content, void ** data)
+{
+	char const * ret = NULL;
+	char ** pdus;
+	HayesCommand ** parts;
+	size_t count;
+	size_t n = 0;
+	size_t i = 0;
+
+	if(_hayes_request_type(hayes, channel, HAYES_REQUEST_MESSAGE_FORMAT_PDU)
+			!= 0 || (pdus = _hayes_message_to_pdus(channel, number,
+					encoding, length, content, &count))
+			== NULL)
 	{
-		data->id = 0;
-		data->folder = MODEM_MESSAGE_FOLDER_INBOX;
-		data->status = MODEM_MESSAGE_STATUS_UNREAD;
+		_message_send_error(hayes, channel);
+		return NULL;
 	}
-	if(_hayes_request_channel(hayes, channel, &request, data) != 0)
-		free(data);
-	/* request received read messages */
-	request.type = HAYES_REQUEST_MESSAGE_LIST_INBOX_READ;
-	if((data = malloc(sizeof(*data))) != NULL)
+	/* prepare every part before queueing any of them */
+	if((parts = malloc(sizeof(*parts) * count)) != NULL)
+		for(; n + 1 < count; n++)
+			if((parts[n] = _message_send_part(channel, pdus[n]))
+					== NULL)
+				break;
+	/* the last part is queued as the request itself */
+	if(parts != NULL && n + 1 == count
+			&& (ret = _message_send_attention(channel, pdus[n]))
+			!= NULL
+			/* keep the link open between the parts */
+			&& (count == 1 || _hayes_request_type(hayes, channel,
+					HAYES_REQUEST_MESSAGE_MORE_ENABLE)
+				== 0))
+		/* queue the parts back-to-back */
+		for(; i + 1 < count; i++)
+			if(_hayes_queue_command(hayes, channel, parts[i]) != 0)
+				break;
+	if(ret == NULL || (i == 0 && count > 1))
 	{
-		data->id = 0;
-		data->folder = MODEM_MESSAGE_FOLDER_INBOX;
-		data->status = MODEM_MESSAGE_STATUS_READ;
+		/* nothing was queued */
+		for(i = 0; i < n; i++)
+		{
+			hayes_command_set_data(parts[i], NULL);
+			hayes_command_delete(parts[i]);
+		}
+		for(i = 0; i < count; i++)
+			free(pdus[i]);
+		free(parts);
+		free(pdus);
+		_message_send_error(hayes, channel);
+		return NULL;
 	}
-	if(_hayes_request_channel(hayes, channel, &request, data) != 0)
-		free(data);
-	/* request sent unread messages */
-	request.type = HAYES_REQUEST_MESSAGE_LIST_SENT_UNREAD;
-	if((data = malloc(sizeof(*data))) != NULL)
+	if(i + 1 < count)
 	{
-		data->id = 0;
-		data->folder = MODEM_MESSAGE_FOLDER_OUTBOX;
-		data->status = MODEM_MESSAGE_STATUS_UNREAD;
+		/* drop what was queued already along with the last part */
+		for(n = 0; n < i; n++)
+			if(hayes_command_get_status(parts[n]) == HCS_QUEUED)
+			{
+				free(hayes_command_get_data(parts[n]));
+				hayes_command_set_data(parts[n], NULL);
+			}
+		free(pdus[count - 1]);
+		pdus[count - 1] = NULL;
 	}
-	if(_hayes_request_channel(hayes, channel, &request, data) != 0)
-		free(data);
-	/* request sent read messages */
-	request.type = HAYES_REQUEST_MESSAGE_LIST_SENT_READ;
-	if((data = malloc(sizeof(*data))) != NULL)
+	for(; i + 1 < count; i++)
 	{
-		data->id = 0;
-		data->folder = MODEM_MESSAGE_FOLDER_OUTBOX;
-		data->status = MODEM_MESSAGE_STATUS_READ;
+		hayes_command_set_data(parts[i], NULL);
+		hayes_command_delete(parts[i]);
+		free(pdus[i]);
 	}
-	if(_hayes_request_channel(hayes, channel, &request, data) != 0)
-		free(data);
-	return NULL;
+	*data = pdus[count - 1];
+	free(parts);
+	free(pdus);
+	return ret;
 }
 
-static char * _request_attention_message_send(Hayes * hayes,
-		HayesChannel * channel, char const * number,
-		ModemMessageEncoding encoding, size_t length,
-		char const * content, void ** data)
+static char const * _message_send_attention(HayesChannel * channel,
+		char const * pdu)
 {
-	char * ret;
 	char const cmd[] = "AT+CMGS=";
-	char * pdu;
 	size_t pdulen;
-	size_t len;
 
-	if(_hayes_request_type(hayes, channel, HAYES_REQUEST_MESSAGE_FORMAT_PDU)
-			!= 0)
-		return NULL;
-	if((pdu = _hayes_message_to_pdu(channel, number, encoding, length,
-					content)) == NULL)
-		return NULL;
-	len = sizeof(cmd) + 11;
-	if((ret = malloc(len)) == NULL)
-	{
-		free(pdu);
-		return NULL;
-	}
 	pdulen = strlen(pdu);
 	if(hayeschannel_has_quirks(channel, HAYES_QUIRK_WANT_SMSC_IN_PDU))
 		pdulen -= 2;
-	snprintf(ret, len, "%s%zu", cmd, pdulen / 2);
-	*data = pdu;
-	return ret;
+	return hayeschannel_attention_format(channel, "%s%zu", cmd,
+			pdulen / 2);
+}
+
+static void _message_send_error(Hayes * hayes, HayesChannel * channel)
+{
+	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_MESSAGE_SENT];
+
+	event->message_sent.error = "Could not send message";
+	event->message_sent.id = 0;
+	hayes->helper->event(hayes->helper->modem, event);
 }
 
-static char * _request_attention_password_set(Hayes * hayes, char const * name,
+static HayesCommand * _message_send_part(HayesChannel * channel, char * pdu)
+{
+	HayesCommand * command;
+	char const * attention;
+
+	if((attention = _message_send_attention(channel, pdu)) == NULL
+			|| (command = hayes_command_new(attention)) == NULL)
+		return NULL;
+	hayes_command_set_callback(command, _on_request_message_send_part,
+			channel);
+	hayes_command_set_priority(command, _request_priority(
+				MODEM_REQUEST_MESSAGE_SEND));
+	hayes_command_set_data(command, pdu);
+	return command;
+}
+
+static char const * _request_attention_password_set(Hayes * hayes,
+		HayesChannel * channel, char const * name,
 		char const * oldpassword, char const * newpassword)
 {
-	char * ret;
-	size_t len;
+	char const * ret;
 	char const cpwd[] = "AT+CPWD=";
 	char const * n;
 
@@ -1693,25 +2403,18 @@ static char * _request_attention_password_set(Hayes * hayes, char const * name,
 		n = "SC";
 	else
 		return NULL;
-	len = sizeof(cpwd) + strlen(n) + 2 + strlen(oldpassword) + 3
-		+ strlen(newpassword) + 3;
-	if((ret = malloc(len)) == NULL)
-	{
+	if((ret = hayeschannel_attention_format(channel,
+					"%s\"%s\",\"%s\",\"%s\"", cpwd, n,
+					oldpassword, newpassword)) == NULL)
 		hayes->helper->error(NULL, strerror(errno), 1);
-		return NULL;
-	}
-	snprintf(ret, len, "%s\"%s\",\"%s\",\"%s\"", cpwd, n, oldpassword,
-			newpassword);
 	return ret;
 }
 
-static char * _request_attention_registration(Hayes * hayes,
+static char const * _request_attention_registration(Hayes * hayes,
 		HayesChannel * channel, ModemRegistrationMode mode,
 		char const * _operator)
 {
 	char const cops[] = "AT+COPS=";
-	size_t len = sizeof(cops) + 5;
-	char * p;
 
 	switch(mode)
 	{
@@ -1726,63 +2429,50 @@ static char * _request_attention_registration(Hayes * hayes,
 		case MODEM_REGISTRATION_MODE_MANUAL:
 			if(_operator == NULL)
 				return NULL;
-			len += strlen(_operator);
-			if((p = malloc(len)) == NULL)
-				return NULL;
-			snprintf(p, len, "%s=1,0,%s", cops, _operator);
-			return p;
+			return hayeschannel_attention_format(channel,
+					"%s=1,0,%s", cops, _operator);
 		case MODEM_REGISTRATION_MODE_UNKNOWN:
 			break;
 	}
 	return NULL;
 }
 
-static char * _request_attention_sim_pin(Hayes * hayes, HayesChannel * channel,
-		char const * password)
+static char const * _request_attention_sim_pin(Hayes * hayes,
+		HayesChannel * channel, char const * password)
 {
-	char * ret;
+	char const * ret;
 	const char cmd[] = "AT+CPIN=";
-	size_t len;
 	char const * format;
 
 	if(password == NULL)
 		return NULL;
-	len = sizeof(cmd) + strlen(password) + 2;
-	if((ret = malloc(len)) == NULL)
-	{
-		hayes->helper->error(NULL, strerror(errno), 1);
-		return NULL;
-	}
 	format = hayeschannel_has_quirks(channel, HAYES_QUIRK_CPIN_NO_QUOTES)
 		? "%s%s" : "%s\"%s\"";
-	snprintf(ret, len, format, cmd, password);
+	if((ret = hayeschannel_attention_format(channel, format, cmd,
+					password)) == NULL)
+		hayes->helper->error(NULL, strerror(errno), 1);
 	return ret;
 }
 
-static char * _request_attention_sim_puk(Hayes * hayes, HayesChannel * channel,
-		char const * password)
+static char const * _request_attention_sim_puk(Hayes * hayes,
+		HayesChannel * channel, char const * password)
 {
-	char * ret;
+	char const * ret;
 	const char cmd[] = "AT+CPIN=";
-	size_t len;
 	char const * format;
 
 	if(password == NULL)
 		return NULL;
-	len = sizeof(cmd) + strlen(password) + 3;
-	if((ret = malloc(len)) == NULL)
-	{
-		hayes->helper->error(NULL, strerror(errno), 1);
-		return NULL;
-	}
 	format = hayeschannel_has_quirks(channel, HAYES_QUIRK_CPIN_NO_QUOTES)
 		? "%s%s," : "%s\"%s\",";
-	snprintf(ret, len, format, cmd, password);
+	if((ret = hayeschannel_attention_format(channel, format, cmd,
+					password)) == NULL)
+		hayes->helper->error(NULL, strerror(errno), 1);
 	return ret;
 }
 
-static char * _request_attention_unsupported(Hayes * hayes,
-		ModemRequest * request)
+static char const * _request_attention_unsupported(Hayes * hayes,
+		HayesChannel * channel, ModemRequest * request)
 {
 	HayesRequest * hrequest = request->unsupported.request;
 	(void) hayes;
@@ -1794,13 +2484,13 @@ static char * _request_attention_unsupported(Hayes * hayes,
 	switch(request->unsupported.request_type)
 	{
 		case HAYES_REQUEST_COMMAND_QUEUE:
-			return strdup(hrequest->command_queue.command);
+			return hayeschannel_attention_format(channel, "%s",
+					hrequest->command_queue.command);
 		default:
 			return NULL;
 	}
 }
 
-
 /* hayes_request_type */
 static int _hayes_request_type(Hayes * hayes, HayesChannel * channel,
 		ModemRequestType type)
@@ -1849,6 +2539,88 @@ static gboolean _on_channel_authenticate(gpointer data)
 }
 
 
+/* on_channel_cmux */
+static gboolean _on_channel_cmux(gpointer data)
+{
+	HayesChannel * channel = data;
+	Hayes * hayes = channel->hayes;
+	int fd;
+
+	channel->source = 0;
+	if(channel->channel == NULL)
+		return FALSE;
+	/* the multiplexer takes the serial port over */
+	fd = g_io_channel_unix_get_fd(channel->channel);
+	hayeschannel_queue_flush(channel);
+	g_io_channel_unref(channel->channel);
+	channel->channel = NULL;
+	if((hayes->cmux = hayescmux_new(fd, _on_cmux_channel, hayes)) == NULL)
+	{
+		hayes->helper->error(NULL, strerror(errno), 1);
+		close(fd);
+		if(hayes->retry > 0)
+			channel->source = g_timeout_add(hayes->retry,
+					_on_channel_reset, channel);
+	}
+	return FALSE;
+}
+
+
+/* on_cmux_channel */
+static void _on_cmux_channel(void * data, unsigned int dlci, int fd)
+{
+	Hayes * hayes = data;
+	HayesChannel * channel;
+	GError * error = NULL;
+
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s(%u, %d)\n", __func__, dlci, fd);
+#endif
+	switch(dlci)
+	{
+		case HAYESCMUX_DLCI_DATA:
+			channel = &hayes->data;
+			break;
+		case HAYESCMUX_DLCI_UNSOLLICITED:
+			channel = &hayes->unsollicited;
+			break;
+		default:
+			channel = &hayes->channel;
+			break;
+	}
+	if(fd < 0)
+	{
+		hayes->helper->error(NULL, "Multiplexed channel closed", 1);
+		if(channel != &hayes->channel)
+			/* the control channel takes over */
+			_stop_channel(hayes, channel);
+		else if(hayes->retry > 0)
+		{
+			/* the multiplexer cannot be deleted from here */
+			hayescommon_source_reset(&channel->source);
+			channel->source = g_idle_add(_on_channel_reset,
+					channel);
+		}
+		return;
+	}
+	channel->channel = g_io_channel_unix_new(fd);
+	if(g_io_channel_set_encoding(channel->channel, NULL, &error)
+			!= G_IO_STATUS_NORMAL)
+	{
+		hayes->helper->error(hayes->helper->modem, error->message, 1);
+		g_error_free(error);
+	}
+	g_io_channel_set_buffered(channel->channel, FALSE);
+	channel->rd_source = g_io_add_watch(channel->channel, G_IO_IN,
+			_on_watch_can_read, channel);
+	if(channel->wr_buf_cnt > 0 && channel->wr_source == 0)
+		channel->wr_source = g_io_add_watch(channel->channel, G_IO_OUT,
+				_on_watch_can_write, channel);
+	hayescommon_source_reset(&channel->source);
+	channel->source = g_idle_add(_on_reset_settle2, channel);
+}
+
+
 /* on_channel_reset */
 static int _reset_open(Hayes * hayes);
 static int _reset_configure(Hayes * hayes, char const * device, int fd);
@@ -1864,6 +2636,8 @@ static gboolean _on_channel_reset(gpointer data)
 	GError * error = NULL;
 	int fd;
 	char const * logfile;
+	char const * p;
+	size_t logsize = 0;
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s()\n", __func__);
@@ -1883,14 +2657,16 @@ static gboolean _on_channel_reset(gpointer data)
 		return FALSE;
 	}
 	event->status.status = MODEM_STATUS_UNKNOWN;
+	hayes->started = g_get_monotonic_time();
+	hayes->ready = 0;
 	/* logging */
 	logfile = helper->config_get(helper->modem, "logfile");
 	if(logfile != NULL)
 	{
-		if((channel->fp = fopen(logfile, "w")) == NULL)
+		if((p = helper->config_get(helper->modem, "logsize")) != NULL)
+			logsize = strtoul(p, NULL, 10) * 1024;
+		if((hayes->trace = hayestrace_new(logfile, logsize)) == NULL)
 			hayes->helper->error(NULL, strerror(errno), 1);
-		else
-			setvbuf(channel->fp, NULL, _IONBF, BUFSIZ);
 	}
 	channel->channel = g_io_channel_unix_new(fd);
 	if(g_io_channel_set_encoding(channel->channel, NULL, &error)
@@ -2044,8 +2820,20 @@ static gboolean _on_channel_timeout(gpointer data)
 	fprintf(stderr, "DEBUG: %s()\n", __func__);
 #endif
 	channel->timeout = 0;
-	if(channel->queue == NULL || (command = channel->queue->data) == NULL)
+	if((command = hayeschannel_queue_get_current(channel)) == NULL)
 		return FALSE;
+	/* an answer may still come: it must not complete the next command */
+	hayescommon_source_reset(&channel->timeout_late);
+	if(channel->mode != HAYESCHANNEL_MODE_INIT)
+		channel->timeout_late = g_timeout_add(
+				hayes_command_get_timeout(command),
+				_on_channel_timeout_late, channel);
+	if(hayes_command_get_next(command) != NULL)
+	{
+		/* the modem may not support batches */
+		_parse_do_batch_split(hayes, channel);
+		return FALSE;
+	}
 	hayes_command_set_status(command, HCS_TIMEOUT);
 	hayeschannel_queue_pop(channel);
 	_hayes_queue_push(hayes, channel);
@@ -2053,6 +2841,29 @@ static gboolean _on_channel_timeout(gpointer data)
 }
 
 
+/* on_channel_timeout_late */
+static gboolean _on_channel_timeout_late(gpointer data)
+{
+	HayesChannel * channel = data;
+
+	/* the command timed out was not answered after all */
+	channel->timeout_late = 0;
+	_hayes_queue_push(channel->hayes, channel);
+	return FALSE;
+}
+
+
+/* on_message_expire */
+static gboolean _on_message_expire(gpointer data)
+{
+	HayesChannel * channel = data;
+
+	channel->message_source = 0;
+	_hayes_message_expire(channel, time(NULL));
+	return FALSE;
+}
+
+
 /* on_queue_timeout */
 static gboolean _on_queue_timeout(gpointer data)
 {
@@ -2080,6 +2891,7 @@ static gboolean _on_queue_timeout(gpointer data)
 
 /* on_reset_settle */
 static void _reset_settle_command(HayesChannel * channel, char const * string);
+static void _reset_settle_ready(Hayes * hayes, HayesChannel * channel);
 static HayesCommandStatus _on_reset_settle_callback(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel);
 
@@ -2104,21 +2916,29 @@ static gboolean _on_reset_settle2(gpointer data)
 
 static void _reset_settle_command(HayesChannel * channel, char const * string)
 {
-	const unsigned int timeout = 500;
 	Hayes * hayes = channel->hayes;
 	HayesCommand * command;
+	unsigned int timeout;
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s(\"%s\")\n", __func__, string);
 #endif
-	if((command = hayes_command_new(string)) == NULL)
+	/* the probes are constant */
+	if((command = hayes_command_new_static(string)) == NULL)
 	{
 		hayes->helper->error(hayes->helper->modem, error_get(NULL), 1);
 		return;
 	}
 	hayes_command_set_callback(command, _on_reset_settle_callback, channel);
 	hayes_command_set_priority(command, HCP_IMMEDIATE);
+	/* some modems are slow to answer but the probing must remain quick */
+	if(hayes->settle.name[0] == '\0')
+		hayeslatency_set_name(&hayes->settle, string);
+	timeout = hayeslatency_get_timeout(&hayes->settle,
+			HAYES_SETTLE_TIMEOUT, HAYES_SETTLE_TIMEOUT,
+			HAYES_SETTLE_TIMEOUT * 4);
 	hayes_command_set_timeout(command, timeout);
+	hayes_command_set_latency(command, &hayes->settle);
 	if(_hayes_queue_command(hayes, channel, command) != 0)
 	{
 		hayes->helper->error(hayes->helper->modem, error_get(NULL), 1);
@@ -2126,10 +2946,23 @@ static void _reset_settle_command(HayesChannel * channel, char const * string)
 	}
 }
 
+static void _reset_settle_ready(Hayes * hayes, HayesChannel * channel)
+{
+	_hayes_set_mode(hayes, channel, HAYESCHANNEL_MODE_COMMAND);
+	_hayes_request_type(hayes, channel, HAYES_REQUEST_LOCAL_ECHO_DISABLE);
+	_hayes_request_type(hayes, channel, HAYES_REQUEST_VERBOSE_ENABLE);
+	_hayes_request_type(hayes, channel, HAYES_REQUEST_VENDOR);
+	_hayes_request_type(hayes, channel, HAYES_REQUEST_MODEL);
+	_hayes_request_type(hayes, channel, HAYES_REQUEST_EXTENDED_ERRORS);
+	_hayes_request_type(hayes, channel, HAYES_REQUEST_FUNCTIONAL);
+}
+
 static HayesCommandStatus _on_reset_settle_callback(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel)
 {
 	Hayes * hayes = channel->hayes;
+	ModemPluginHelper * helper = hayes->helper;
+	char const * p;
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s(%s (%u))\n", __func__,
@@ -2145,20 +2978,21 @@ static HayesCommandStatus _on_reset_settle_callback(HayesCommand * command,
 		case HCS_ACTIVE: /* give it another chance */
 			break;
 		case HCS_SUCCESS: /* we can initialize */
-			_hayes_set_mode(hayes, channel,
-					HAYESCHANNEL_MODE_COMMAND);
-			_hayes_request_type(hayes, channel,
-					HAYES_REQUEST_LOCAL_ECHO_DISABLE);
-			_hayes_request_type(hayes, channel,
-					HAYES_REQUEST_VERBOSE_ENABLE);
-			_hayes_request_type(hayes, channel,
-					HAYES_REQUEST_VENDOR);
-			_hayes_request_type(hayes, channel,
-					HAYES_REQUEST_MODEL);
-			_hayes_request_type(hayes, channel,
-					HAYES_REQUEST_EXTENDED_ERRORS);
-			_hayes_request_type(hayes, channel,
-					HAYES_REQUEST_FUNCTIONAL);
+			if(channel != &hayes->channel)
+			{
+				/* another multiplexed channel */
+				_hayes_set_mode(hayes, channel,
+						HAYESCHANNEL_MODE_COMMAND);
+				break;
+			}
+			if(hayes->cmux == NULL && (p = helper->config_get(
+							helper->modem, "cmux"))
+					!= NULL && strtoul(p, NULL, 10) != 0)
+				/* multiplex the serial port first */
+				_hayes_request_type(hayes, channel,
+						HAYES_REQUEST_CMUX);
+			else
+				_reset_settle_ready(hayes, channel);
 			break;
 		case HCS_TIMEOUT: /* try again */
 		case HCS_ERROR:
@@ -2179,23 +3013,20 @@ static gboolean _on_watch_can_read(GIOChannel * source, GIOCondition condition,
 	HayesChannel * channel = data;
 	Hayes * hayes = channel->hayes;
 	ModemPluginHelper * helper = hayes->helper;
-	const int inc = 256;
 	gsize cnt = 0;
 	GError * error = NULL;
 	GIOStatus status;
-	char * p;
+	char * buf;
+	size_t size;
 
 	if(condition != G_IO_IN || source != channel->channel)
 		return FALSE; /* should not happen */
-	if((p = realloc(channel->rd_buf, channel->rd_buf_cnt + inc)) == NULL)
-		return TRUE; /* XXX retries immediately (delay?) */
-	channel->rd_buf = p;
-	status = g_io_channel_read_chars(source,
-			&channel->rd_buf[channel->rd_buf_cnt], inc, &cnt,
-			&error);
-	_hayes_log(hayes, channel, "MODEM: ",
-			&channel->rd_buf[channel->rd_buf_cnt], cnt);
-	channel->rd_buf_cnt += cnt;
+	if((buf = hayeschannel_read_buffer(channel, &size)) == NULL
+			|| size == 0)
+		return TRUE; /* should not happen */
+	status = g_io_channel_read_chars(source, buf, size, &cnt, &error);
+	_hayes_log(hayes, channel, HAYESTRACE_DIRECTION_MODEM, buf, cnt);
+	hayeschannel_read_commit(channel, cnt);
 	switch(status)
 	{
 		case G_IO_STATUS_NORMAL:
@@ -2221,61 +3052,8 @@ static gboolean _on_watch_can_read(GIOChannel * source, GIOCondition condition,
 			_hayes_parse_pdu(hayes, channel);
 			break;
 		case HAYESCHANNEL_MODE_DATA:
-			if(channel->wr_ppp_channel == NULL
-					|| channel->wr_ppp_source != 0)
-				break;
-			channel->wr_ppp_source = g_io_add_watch(
-					channel->wr_ppp_channel, G_IO_OUT,
-					_on_watch_can_write_ppp, channel);
-			break;
-	}
-	return TRUE;
-}
-
-
-/* on_watch_can_read_ppp */
-static gboolean _on_watch_can_read_ppp(GIOChannel * source,
-		GIOCondition condition, gpointer data)
-{
-	HayesChannel * channel = data;
-	Hayes * hayes = channel->hayes;
-	ModemPluginHelper * helper = hayes->helper;
-	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_CONNECTION];
-	const int inc = 256;
-	gsize cnt = 0;
-	GError * error = NULL;
-	GIOStatus status;
-	char * p;
-
-	if(condition != G_IO_IN || source != channel->rd_ppp_channel)
-		return FALSE; /* should not happen */
-	if((p = realloc(channel->wr_buf, channel->wr_buf_cnt + inc)) == NULL)
-		return TRUE; /* XXX retries immediately (delay?) */
-	channel->wr_buf = p;
-	status = g_io_channel_read_chars(source,
-			&channel->wr_buf[channel->wr_buf_cnt], inc, &cnt,
-			&error);
-	channel->wr_buf_cnt += cnt;
-	event->connection.out += cnt;
-	switch(status)
-	{
-		case G_IO_STATUS_NORMAL:
-			break;
-		case G_IO_STATUS_ERROR:
-			helper->error(helper->modem, error->message, 1);
-			g_error_free(error);
-			/* fallthrough */
-		case G_IO_STATUS_EOF:
-		default:
-			channel->rd_ppp_source = 0;
-			event->connection.connected = 0;
-			helper->event(helper->modem, event);
-			_hayes_set_mode(hayes, channel, HAYESCHANNEL_MODE_INIT);
-			return FALSE;
+			break; /* handled by the pump */
 	}
-	if(channel->channel != NULL && channel->wr_source == 0)
-		channel->wr_source = g_io_add_watch(channel->channel, G_IO_OUT,
-				_on_watch_can_write, channel);
 	return TRUE;
 }
 
@@ -2285,8 +3063,7 @@ static gboolean _on_watch_can_write(GIOChannel * source, GIOCondition condition,
 		gpointer data)
 {
 	HayesChannel * channel = data;
-	HayesCommand * command = (channel->queue) != NULL
-		? channel->queue->data : NULL;
+	HayesCommand * command = hayeschannel_queue_get_current(channel);
 	Hayes * hayes = channel->hayes;
 	ModemPluginHelper * helper = hayes->helper;
 	gsize cnt = 0;
@@ -2298,7 +3075,8 @@ static gboolean _on_watch_can_write(GIOChannel * source, GIOCondition condition,
 		return FALSE; /* should not happen */
 	status = g_io_channel_write_chars(source, channel->wr_buf,
 			channel->wr_buf_cnt, &cnt, &error);
-	_hayes_log(hayes, channel, "PHONE: ", channel->wr_buf, cnt);
+	_hayes_log(hayes, channel, HAYESTRACE_DIRECTION_PHONE,
+			channel->wr_buf, cnt);
 	if(cnt != 0) /* some data may have been written anyway */
 	{
 		channel->wr_buf_cnt -= cnt;
@@ -2320,70 +3098,152 @@ static gboolean _on_watch_can_write(GIOChannel * source, GIOCondition condition,
 			g_error_free(error);
 			/* fallthrough */
 		case G_IO_STATUS_EOF:
-		default: /* should not happen */
-			channel->wr_source = 0;
-			if(hayes->retry > 0)
-				_hayes_reset(hayes);
-			return FALSE;
-	}
-	if(channel->wr_buf_cnt > 0) /* there is more data to write */
-		return TRUE;
-	channel->wr_source = 0;
-	if(command != NULL)
-		hayes_command_set_status(command, HCS_ACTIVE);
-	return FALSE;
-}
-
-
-/* on_watch_can_write_ppp */
-static gboolean _on_watch_can_write_ppp(GIOChannel * source,
-		GIOCondition condition, gpointer data)
-{
-	HayesChannel * channel = data;
-	Hayes * hayes = channel->hayes;
-	ModemPluginHelper * helper = hayes->helper;
-	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_CONNECTION];
-	gsize cnt = 0;
-	GError * error = NULL;
-	GIOStatus status;
-	char * p;
-
-	if(condition != G_IO_OUT || source != channel->wr_ppp_channel)
-		return FALSE; /* should not happen */
-	status = g_io_channel_write_chars(source, channel->rd_buf,
-			channel->rd_buf_cnt, &cnt, &error);
-	event->connection.in += cnt;
-	if(cnt != 0) /* some data may have been written anyway */
-	{
-		channel->rd_buf_cnt -= cnt;
-		memmove(channel->rd_buf, &channel->rd_buf[cnt],
-				channel->rd_buf_cnt);
-		if((p = realloc(channel->rd_buf, channel->rd_buf_cnt)) != NULL)
-			/* we can ignore errors... */
-			channel->rd_buf = p;
-		else if(channel->rd_buf_cnt == 0)
-			/* ...except when it's not one */
-			channel->rd_buf = NULL;
-	}
-	switch(status)
-	{
-		case G_IO_STATUS_NORMAL:
-			break;
-		case G_IO_STATUS_ERROR:
-			helper->error(helper->modem, error->message, 1);
-			g_error_free(error);
-			/* fallthrough */
-		case G_IO_STATUS_EOF:
-		default:
-			channel->wr_ppp_source = 0;
-			event->connection.connected = 0;
-			helper->event(helper->modem, event);
-			_hayes_set_mode(hayes, channel, HAYESCHANNEL_MODE_INIT);
+		default: /* should not happen */
+			channel->wr_source = 0;
+			if(hayes->retry > 0)
+				_hayes_reset(hayes);
 			return FALSE;
 	}
-	if(channel->rd_buf_cnt > 0) /* there is more data to write */
+	if(channel->wr_buf_cnt > 0) /* there is more data to write */
+		return TRUE;
+	channel->wr_source = 0;
+	/* the command may have been sent as a batch */
+	for(; command != NULL; command = hayes_command_get_next(command))
+		hayes_command_set_status(command, HCS_ACTIVE);
+	return FALSE;
+}
+
+
+/* on_watch_pump_read */
+static gboolean _pump_read_splice(HayesChannelPump * pump);
+static gboolean _pump_close(HayesChannelPump * pump, guint * source,
+		char const * error);
+
+static gboolean _on_watch_pump_read(GIOChannel * source, GIOCondition condition,
+		gpointer data)
+{
+	HayesChannelPump * pump = data;
+	HayesChannel * channel = pump->channel;
+	size_t end = pump->pos + pump->cnt;
+	ssize_t cnt;
+	(void) condition;
+
+	if(source != pump->from)
+		return FALSE; /* should not happen */
+	if(pump->splice && pump->cnt == 0)
+		return _pump_read_splice(pump);
+	if(end == sizeof(pump->buf))
+	{
+		/* resume once the buffer is drained */
+		pump->rd_source = 0;
+		return FALSE;
+	}
+	if((cnt = read(g_io_channel_unix_get_fd(source), &pump->buf[end],
+					sizeof(pump->buf) - end)) < 0)
+	{
+		if(errno == EAGAIN || errno == EINTR)
+			return TRUE;
+		return _pump_close(pump, &pump->rd_source, strerror(errno));
+	}
+	else if(cnt == 0)
+		return _pump_close(pump, &pump->rd_source, NULL);
+	if(source == channel->channel)
+		_hayes_log(channel->hayes, channel,
+				HAYESTRACE_DIRECTION_MODEM, &pump->buf[end],
+				cnt);
+	pump->cnt += cnt;
+	if(pump->wr_source == 0)
+		pump->wr_source = g_io_add_watch(pump->to, G_IO_OUT,
+				_on_watch_pump_write, pump);
+	return TRUE;
+}
+
+static gboolean _pump_read_splice(HayesChannelPump * pump)
+{
+#ifdef SPLICE_F_MOVE
+	ssize_t cnt;
+
+	/* move the data directly between the file descriptors */
+	if((cnt = splice(g_io_channel_unix_get_fd(pump->from), NULL,
+					g_io_channel_unix_get_fd(pump->to), NULL,
+					sizeof(pump->buf),
+					SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) > 0)
+	{
+		*pump->counter += cnt;
+		return TRUE;
+	}
+	else if(cnt == 0)
+		return _pump_close(pump, &pump->rd_source, NULL);
+	else if(errno == EINTR)
 		return TRUE;
-	channel->wr_ppp_source = 0;
+	else if(errno == EAGAIN)
+	{
+		/* the destination may be full: wait until it is not */
+		pump->rd_source = 0;
+		if(pump->wr_source == 0)
+			pump->wr_source = g_io_add_watch(pump->to, G_IO_OUT,
+					_on_watch_pump_write, pump);
+		return FALSE;
+	}
+#endif
+	/* not supported between these file descriptors: copy instead */
+	pump->splice = 0;
+	return TRUE;
+}
+
+static gboolean _pump_close(HayesChannelPump * pump, guint * source,
+		char const * error)
+{
+	HayesChannel * channel = pump->channel;
+	Hayes * hayes = channel->hayes;
+	ModemPluginHelper * helper = hayes->helper;
+	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_CONNECTION];
+
+	if(error != NULL)
+		helper->error(helper->modem, error, 1);
+	*source = 0;
+	event->connection.connected = 0;
+	helper->event(helper->modem, event);
+	_hayes_set_mode(hayes, channel, HAYESCHANNEL_MODE_INIT);
+	return FALSE;
+}
+
+
+/* on_watch_pump_write */
+static gboolean _on_watch_pump_write(GIOChannel * source,
+		GIOCondition condition, gpointer data)
+{
+	HayesChannelPump * pump = data;
+	HayesChannel * channel = pump->channel;
+	ssize_t cnt;
+
+	if(condition != G_IO_OUT || source != pump->to)
+		return FALSE; /* should not happen */
+	if(pump->cnt > 0)
+	{
+		if((cnt = write(g_io_channel_unix_get_fd(source),
+						&pump->buf[pump->pos],
+						pump->cnt)) < 0)
+		{
+			if(errno == EAGAIN || errno == EINTR)
+				return TRUE;
+			return _pump_close(pump, &pump->wr_source,
+					strerror(errno));
+		}
+		if(source == channel->channel)
+			_hayes_log(channel->hayes, channel,
+					HAYESTRACE_DIRECTION_PHONE,
+					&pump->buf[pump->pos], cnt);
+		*pump->counter += cnt;
+		pump->pos += cnt;
+		if((pump->cnt -= cnt) > 0) /* there is more data to write */
+			return TRUE;
+		pump->pos = 0;
+	}
+	/* the buffer is drained: resume reading */
+	pump->wr_source = 0;
+	if(pump->rd_source == 0)
+		pump->rd_source = _pump_watch_read(pump);
 	return FALSE;
 }
 
@@ -2514,6 +3374,31 @@ static HayesCommandStatus _on_request_call_status(HayesCommand * command,
 }
 
 
+/* on_request_cmux */
+static HayesCommandStatus _on_request_cmux(HayesCommand * command,
+		HayesCommandStatus status, HayesChannel * channel)
+{
+	Hayes * hayes = channel->hayes;
+
+	switch((status = _on_request_generic(command, status, channel)))
+	{
+		case HCS_SUCCESS:
+			/* switch once the answer is fully processed */
+			hayescommon_source_reset(&channel->source);
+			channel->source = g_idle_add(_on_channel_cmux, channel);
+			break;
+		case HCS_ERROR:
+		case HCS_TIMEOUT:
+			/* carry on without multiplexing */
+			_reset_settle_ready(hayes, channel);
+			break;
+		default:
+			break;
+	}
+	return status;
+}
+
+
 /* on_request_contact_delete */
 static HayesCommandStatus _on_request_contact_delete(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel)
@@ -2543,6 +3428,60 @@ static HayesCommandStatus _on_request_contact_list(HayesCommand * command,
 }
 
 
+/* on_request_contact_list_window */
+static HayesCommandStatus _on_request_contact_list_window(
+		HayesCommand * command, HayesCommandStatus status,
+		HayesChannel * channel)
+{
+	Hayes * hayes = channel->hayes;
+	unsigned int from;
+	unsigned int to;
+	unsigned int window;
+	gint64 elapsed;
+
+	if(status == HCS_ACTIVE && hayes_command_get_answer(command) == NULL)
+		/* the window was just sent */
+		channel->contact_sent = g_get_monotonic_time();
+	switch((status = _on_request_generic(command, status, channel)))
+	{
+		case HCS_ERROR:
+		case HCS_SUCCESS:
+		case HCS_TIMEOUT:
+			break;
+		default:
+			return status;
+	}
+	if(channel->contact_pending > 0)
+		channel->contact_pending--;
+	if(sscanf(hayes_command_get_attention(command), "AT+CPBR=%u,%u",
+				&from, &to) != 2 || to < from)
+		return status;
+	if(status == HCS_TIMEOUT)
+	{
+		/* read this window again, by halves, and shrink the next */
+		channel->contact_window = max(1, channel->contact_window / 2);
+		if(from < to)
+		{
+			window = from + (to - from) / 2;
+			_contact_list_window(hayes, channel, from, window);
+			_contact_list_window(hayes, channel, window + 1, to);
+		}
+		_hayes_contact_list(hayes, channel);
+		return status;
+	}
+	/* size the next windows after the time taken by this one */
+	elapsed = g_get_monotonic_time() - channel->contact_sent;
+	elapsed = max(elapsed, 1);
+	window = min((HAYES_CONTACT_LIST_LATENCY * 1000 * (gint64)(to - from
+					+ 1)) / elapsed,
+			HAYES_CONTACT_LIST_WINDOW_MAX);
+	channel->contact_window = max(1, (channel->contact_window + window)
+			/ 2);
+	_hayes_contact_list(hayes, channel);
+	return status;
+}
+
+
 /* on_request_functional */
 static HayesCommandStatus _on_request_functional(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel)
@@ -2677,16 +3616,13 @@ static HayesCommandStatus _on_request_message_delete(HayesCommand * command,
 static HayesCommandStatus _on_request_message_list(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel)
 {
-	HayesRequestMessageData * data;
+	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_MESSAGE];
 
 	if((status = _on_request_generic(command, status, channel))
 			== HCS_SUCCESS
 			|| status == HCS_ERROR || status == HCS_TIMEOUT)
-		if((data = hayes_command_get_data(command)) != NULL)
-		{
-			free(data);
-			hayes_command_set_data(command, NULL);
-		}
+		/* forget about an entry left without its PDU */
+		event->message.length = 0;
 	return status;
 }
 
@@ -2697,24 +3633,50 @@ static HayesCommandStatus _on_request_message_send(HayesCommand * command,
 {
 	Hayes * hayes = channel->hayes;
 	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_MESSAGE_SENT];
-	char * pdu;
 
-	if((pdu = hayes_command_get_data(command)) != NULL
-			&& (status = _on_request_generic(command, status,
-					channel)) == HCS_ACTIVE)
+	/* only the last part of a message reports its outcome */
+	status = _on_request_message_send_part(command, status, channel);
+	if(status == HCS_SUCCESS)
+		/* the identifier was obtained from +CMGS */
+		hayes->helper->event(hayes->helper->modem, event);
+	else if(status == HCS_ERROR || status == HCS_TIMEOUT)
+	{
+		/* whichever part failed */
+		channel->message_failed = 0;
+		_message_send_error(hayes, channel);
+	}
+	return status;
+}
+
+
+/* on_request_message_send_part */
+static HayesCommandStatus _on_request_message_send_part(
+		HayesCommand * command, HayesCommandStatus status,
+		HayesChannel * channel)
+{
+	Hayes * hayes = channel->hayes;
+	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_MESSAGE_SENT];
+	char * pdu = hayes_command_get_data(command);
+
+	/* do not send the parts left of a message which failed */
+	if(status == HCS_PENDING && (channel->message_failed || pdu == NULL))
+		status = HCS_ERROR;
+	else if((status = _on_request_generic(command, status, channel))
+			== HCS_ACTIVE && pdu != NULL)
+	{
+		event->message_sent.error = NULL;
+		event->message_sent.id = 0;
 		_hayes_set_mode(hayes, channel, HAYESCHANNEL_MODE_PDU);
+	}
 	if(status == HCS_SUCCESS || status == HCS_ERROR
 			|| status == HCS_TIMEOUT)
 	{
 		free(pdu);
 		hayes_command_set_data(command, NULL);
 	}
-	if(status == HCS_ERROR)
-	{
-		event->message_sent.error = "Could not send message";
-		event->message_sent.id = 0;
-		hayes->helper->event(hayes->helper->modem, event);
-	}
+	if(status == HCS_ERROR || status == HCS_TIMEOUT)
+		/* until the last part */
+		channel->message_failed = 1;
 	return status;
 }
 
@@ -2874,8 +3836,7 @@ static HayesCommandStatus _on_request_unsupported(HayesCommand * command,
 static void _on_code_call_error(HayesChannel * channel, char const * answer)
 {
 	Hayes * hayes = channel->hayes;
-	HayesCommand * command = (channel->queue != NULL)
-		? channel->queue->data : NULL;
+	HayesCommand * command = hayeschannel_queue_get_current(channel);
 	(void) answer;
 
 	if(command != NULL)
@@ -3090,8 +4051,7 @@ static void _on_code_cme_error(HayesChannel * channel, char const * answer)
 	Hayes * hayes = channel->hayes;
 	ModemPluginHelper * helper = hayes->helper;
 	/* XXX ugly */
-	HayesCommand * command = (channel->queue != NULL)
-		? channel->queue->data : NULL;
+	HayesCommand * command = hayeschannel_queue_get_current(channel);
 	unsigned int u;
 	ModemEvent * event;
 
@@ -3209,62 +4169,96 @@ static void _cme_error_registration(HayesChannel * channel, char const * error)
 
 
 /* on_code_cmgl */
+static void _cmgl_status(unsigned int stat, ModemMessageFolder * folder,
+		ModemMessageStatus * status);
+static void _cmgr_concat(HayesChannel * channel, ModemEvent * event,
+		HayesMessagePart * part, char * content);
+static void _cmgr_message(HayesChannel * channel, ModemEvent * event,
+		char const * number, HayesMessagePart * part, char * content);
+static char * _cmgr_pdu_parse(char const * pdu, time_t * timestamp,
+		char * number, ModemMessageEncoding * encoding,
+		size_t * length, HayesMessagePart * part);
+static char * _cmgr_pdu_parse_encoding_data(char const * pdu, size_t len,
+		size_t i, size_t hdr, ModemMessageEncoding * encoding,
+		size_t * length);
+static char * _cmgr_pdu_parse_encoding_default(char const * pdu, size_t len,
+		size_t i, size_t hdr, size_t datal,
+		ModemMessageEncoding * encoding, size_t * length);
+static void _cmgr_pdu_parse_header(char const * pdu, size_t len, size_t i,
+		size_t hdr, HayesMessagePart * part);
+static void _cmgr_pdu_parse_number(unsigned int type, char const * number,
+		size_t length, char * buf);
+static time_t _cmgr_pdu_parse_timestamp(char const * timestamp);
+
 static void _on_code_cmgl(HayesChannel * channel, char const * answer)
 {
-	Hayes * hayes = channel->hayes;
-	/* XXX ugly */
-	HayesCommand * command = (channel->queue != NULL)
-		? channel->queue->data : NULL;
-	ModemRequest request;
+	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_MESSAGE];
+	char number[32];
 	unsigned int id;
+	unsigned int stat;
 	unsigned int u;
-	HayesRequestMessageData * data;
-	ModemMessageFolder folder = MODEM_MESSAGE_FOLDER_UNKNOWN;
-	ModemMessageStatus status = MODEM_MESSAGE_STATUS_READ;
+	unsigned int length;
+	char * p;
+	HayesMessagePart part;
 
-	/* XXX we could already be reading the message at this point */
-	if(sscanf(answer, "%u,%u,%u,%u", &id, &u, &u, &u) != 4
-			&& sscanf(answer, "%u,%u,,%u", &id, &u, &u) != 3)
-		/* XXX we may be stuck in PDU mode at this point */
-		return;
-	request.type = MODEM_REQUEST_MESSAGE;
-	request.message.id = id;
-	if(command != NULL && (data = hayes_command_get_data(command)) != NULL)
+	/* header of the next message */
+	if(sscanf(answer, "%u,%u,%u,%u", &id, &stat, &u, &length) == 4
+			|| sscanf(answer, "%u,%u,,%u", &id, &stat, &length)
+			== 3)
 	{
-		folder = data->folder;
-		status = data->status;
+		event->message.id = id;
+		_cmgl_status(stat, &event->message.folder,
+				&event->message.status);
+		event->message.length = length;
+		return; /* we need to wait for the next line */
 	}
-	if((data = malloc(sizeof(*data))) != NULL)
+	/* XXX we may be stuck in text mode at this point */
+	if(event->message.length == 0)
+		return;
+	/* decode the message right away instead of reading it again */
+	p = _cmgr_pdu_parse(answer, &event->message.date, number,
+			&event->message.encoding, &event->message.length,
+			&part);
+	if(p != NULL)
+		_cmgr_message(channel, event, number, &part, p);
+	event->message.length = 0;
+}
+
+static void _cmgl_status(unsigned int stat, ModemMessageFolder * folder,
+		ModemMessageStatus * status)
+{
+	switch(stat)
 	{
-		data->id = id;
-		data->folder = folder;
-		data->status = status;
+		case 0: /* REC UNREAD */
+			*folder = MODEM_MESSAGE_FOLDER_INBOX;
+			*status = MODEM_MESSAGE_STATUS_UNREAD;
+			break;
+		case 1: /* REC READ */
+			*folder = MODEM_MESSAGE_FOLDER_INBOX;
+			*status = MODEM_MESSAGE_STATUS_READ;
+			break;
+		case 2: /* STO UNSENT */
+			*folder = MODEM_MESSAGE_FOLDER_OUTBOX;
+			*status = MODEM_MESSAGE_STATUS_UNREAD;
+			break;
+		case 3: /* STO SENT */
+			*folder = MODEM_MESSAGE_FOLDER_OUTBOX;
+			*status = MODEM_MESSAGE_STATUS_READ;
+			break;
+		default:
+			*folder = MODEM_MESSAGE_FOLDER_UNKNOWN;
+			*status = MODEM_MESSAGE_STATUS_READ;
+			break;
 	}
-	if(_hayes_request_channel(hayes, channel, &request, data) != 0)
-		free(data);
 }
 
 
 /* on_code_cmgr */
-static char * _cmgr_pdu_parse(char const * pdu, time_t * timestamp,
-		char * number, ModemMessageEncoding * encoding,
-		size_t * length);
-static char * _cmgr_pdu_parse_encoding_data(char const * pdu, size_t len,
-		size_t i, size_t hdr, ModemMessageEncoding * encoding,
-		size_t * length);
-static char * _cmgr_pdu_parse_encoding_default(char const * pdu, size_t len,
-                size_t i, size_t hdr, ModemMessageEncoding * encoding,
-		size_t * length);
-static void _cmgr_pdu_parse_number(unsigned int type, char const * number,
-		size_t length, char * buf);
-static time_t _cmgr_pdu_parse_timestamp(char const * timestamp);
-
 static void _on_code_cmgr(HayesChannel * channel, char const * answer)
 {
 	Hayes * hayes = channel->hayes;
 	/* XXX ugly */
-	HayesCommand * command = (channel->queue != NULL)
-		? channel->queue->data : NULL;
+	HayesCommand * command = hayeschannel_queue_get_current(channel);
 	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_MESSAGE];
 	char buf[32];
 	char number[32];
@@ -3275,6 +4269,7 @@ static void _on_code_cmgr(HayesChannel * channel, char const * answer)
 	unsigned int length;
 	char * p;
 	HayesRequestMessageData * data;
+	HayesMessagePart part;
 
 	/* text mode support */
 	if(sscanf(answer, "\"%31[^\"]\",\"%31[^\"]\",,\"%31[^\"]\"", buf,
@@ -3296,7 +4291,11 @@ static void _on_code_cmgr(HayesChannel * channel, char const * answer)
 	/* PDU mode support */
 	if(sscanf(answer, "%u,%u,%u", &mbox, &alpha, &length) == 3
 			|| sscanf(answer, "%u,,%u", &mbox, &length) == 2)
+	{
+		/* tell the content apart from text mode */
+		event->message.length = length;
 		return; /* we need to wait for the next line */
+	}
 	/* message content */
 	if(event->message.length == 0) /* XXX assumes this is text mode */
 	{
@@ -3315,22 +4314,78 @@ static void _on_code_cmgr(HayesChannel * channel, char const * answer)
 	}
 	if((p = _cmgr_pdu_parse(answer, &event->message.date, number,
 					&event->message.encoding,
-					&event->message.length)) == NULL)
+					&event->message.length, &part)) == NULL)
 		return;
 	/* FIXME guarantee this would not happen */
 	if(command == NULL || (data = hayes_command_get_data(command)) == NULL)
+	{
+		free(p);
 		return;
+	}
 	event->message.id = data->id;
 	event->message.folder = data->folder;
 	event->message.status = data->status;
+	_cmgr_message(channel, event, number, &part, p);
+}
+
+static void _cmgr_concat(HayesChannel * channel, ModemEvent * event,
+		HayesMessagePart * part, char * content)
+{
+	HayesConcatMessage * message;
+	time_t now = time(NULL);
+
+	if(channel->message_concat == NULL
+			&& (channel->message_concat = hayesconcat_new())
+			== NULL)
+	{
+		free(content);
+		return;
+	}
+	if((message = malloc(sizeof(*message))) == NULL)
+	{
+		free(content);
+		return;
+	}
+	message->id = event->message.id;
+	message->date = event->message.date;
+	message->folder = event->message.folder;
+	message->status = event->message.status;
+	message->encoding = event->message.encoding;
+	snprintf(message->number, sizeof(message->number), "%s",
+			event->message.number);
+	message->content = content;
+	message->length = event->message.length;
+	message->ids = NULL;
+	message->ids_cnt = 0;
+	/* report the message once complete */
+	if((message = hayesconcat_add(channel->message_concat, message,
+					part->reference, part->sequence,
+					part->count, now)) != NULL)
+		_hayes_message_report(channel, message);
+	/* give up on the others after a while */
+	_hayes_message_expire(channel, now);
+}
+
+static void _cmgr_message(HayesChannel * channel, ModemEvent * event,
+		char const * number, HayesMessagePart * part, char * content)
+{
+	Hayes * hayes = channel->hayes;
+
 	event->message.number = number; /* XXX */
-	event->message.content = p;
-	hayes->helper->event(hayes->helper->modem, event);
-	free(p);
+	event->message.content = content;
+	if(part->count > 1)
+		/* takes ownership of the content */
+		_cmgr_concat(channel, event, part, content);
+	else
+	{
+		hayes->helper->event(hayes->helper->modem, event);
+		free(content);
+	}
 }
 
 static char * _cmgr_pdu_parse(char const * pdu, time_t * timestamp,
-		char * number, ModemMessageEncoding * encoding, size_t * length)
+		char * number, ModemMessageEncoding * encoding, size_t * length,
+		HayesMessagePart * part)
 {
 	size_t len;
 	unsigned int smscl;
@@ -3397,9 +4452,11 @@ static char * _cmgr_pdu_parse(char const * pdu, time_t * timestamp,
 		return NULL;
 	if(hdr != 0 && sscanf(&pdu[i], "%02X", &hdr) != 1)
 		return NULL;
+	if(part != NULL)
+		_cmgr_pdu_parse_header(pdu, len, i, hdr, part);
 	if(dcs == 0x00)
 		return _cmgr_pdu_parse_encoding_default(pdu, len, i, hdr,
-				encoding, length);
+				datal, encoding, length);
 	if(dcs == 0x04)
 		return _cmgr_pdu_parse_encoding_data(pdu, len, i, hdr,
 				encoding, length);
@@ -3412,87 +4469,74 @@ static char * _cmgr_pdu_parse_encoding_data(char const * pdu, size_t len,
 		size_t * length)
 {
 	unsigned char * p;
-	size_t j;
-	unsigned int u;
+	size_t size;
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s()\n", __func__);
 #endif
-	if((p = malloc(len - i + 1)) == NULL) /* XXX 2 times big enough? */
-		return NULL;
 	/* FIXME actually parse the header */
 	if(hdr != 0)
 		i += 2 + (hdr * 2);
-	for(j = 0; i + 1 < len; i+=2)
+	size = (i < len) ? (len - i) / 2 : 0;
+	if((p = malloc(size + 1)) == NULL)
+		return NULL;
+	if(hayespdu_hex_decode(p, &pdu[i], size) != size)
 	{
-		if(sscanf(&pdu[i], "%02X", &u) != 1)
-		{
-			free(p);
-			return NULL;
-		}
-		p[j++] = u;
+		free(p);
+		return NULL;
 	}
 	*encoding = MODEM_MESSAGE_ENCODING_DATA;
-	*length = j;
-	p[j] = '\0';
+	*length = size;
+	p[size] = '\0';
 	return (char *)p;
 }
 
 static char * _cmgr_pdu_parse_encoding_default(char const * pdu, size_t len,
-                size_t i, size_t hdr, ModemMessageEncoding * encoding,
-		size_t * length)
+		size_t i, size_t hdr, size_t datal,
+		ModemMessageEncoding * encoding, size_t * length)
 {
 	unsigned char * p;
-	size_t j;
-	unsigned char rest;
-	int shift = 0;
-	char const * q;
-	unsigned int u;
-	unsigned char byte;
+	size_t size;
+	size_t skip = 0;
 	char * r;
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s(%zu, %zu)\n", __func__, i, hdr);
 #endif
-	if((p = malloc(len - i + 1)) == NULL)
+	size = (len - i) / 2;
+	if((p = malloc(size + (size * 8 / 7) + 1)) == NULL)
 		return NULL;
+	/* FIXME report invalid characters as an error instead? */
+	size = hayespdu_hex_decode(p, &pdu[i], size);
+	datal = min(datal, size * 8 / 7);
+	hayespdu_septets_unpack((char *)&p[size], p, datal);
+	/* skip the header and its fill bits */
+	/* FIXME actually parse the header */
 	if(hdr != 0)
-	{
-		/* FIXME actually parse the header */
-		i += 2 + (hdr * 2);
-		shift = (hdr + 1) % 7;
-	}
-	p[0] = '\0';
-	for(j = 0, rest = 0; i + 1 < len; i+=2)
-	{
-		q = &pdu[i];
-		if(sscanf(q, "%02X", &u) != 1)
-			break; /* FIXME report an error instead? */
-		byte = u;
-		p[j] = (((byte << (shift + 1)) >> (shift + 1)) << shift) & 0x7f;
-		p[j] |= rest;
-		p[j] = _hayes_convert_gsm_to_iso(p[j]);
-		/* ignore the first character if there is a header */
-		if(hdr == 0 || j != 0)
-			j++;
-		rest = (byte >> (7 - shift)) & 0x7f;
-		if(++shift == 7)
-		{
-			shift = 0;
-			p[j++] = rest;
-			rest = 0;
-		}
-	}
+		skip = min(datal, ((hdr + 1) * 8 + 6) / 7);
 	*encoding = MODEM_MESSAGE_ENCODING_UTF8;
-	if((r = g_convert((char *)p, j, "UTF-8", "ISO-8859-1", NULL, NULL,
-					NULL)) != NULL)
+	r = hayesgsm_to_utf8((char *)&p[size + skip], datal - skip, length);
+	free(p);
+	return r;
+}
+static void _cmgr_pdu_parse_header(char const * pdu, size_t len, size_t i,
+		size_t hdr, HayesMessagePart * part)
+{
+	unsigned char buf[255];
+
+	part->reference = 0;
+	part->sequence = 1;
+	part->count = 1;
+	if(hdr == 0 || i + 2 > len)
+		return;
+	hdr = hayespdu_hex_decode(buf, &pdu[i + 2], min(hdr,
+				(len - i - 2) / 2));
+	if(hayespdu_header_concatenated(buf, hdr, &part->reference,
+				&part->sequence, &part->count) != 0)
 	{
-		free(p);
-		p = (unsigned char *)r;
-		j = strlen(r);
+		part->sequence = 1;
+		part->count = 1;
 	}
-	*length = j;
-	return (char *)p;
 }
 
 
@@ -3573,15 +4617,14 @@ static time_t _cmgr_pdu_parse_timestamp(char const * timestamp)
 /* on_code_cmgs */
 static void _on_code_cmgs(HayesChannel * channel, char const * answer)
 {
-	Hayes * hayes = channel->hayes;
 	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_MESSAGE_SENT];
 	unsigned int u;
 
 	if(sscanf(answer, "%u", &u) != 1)
 		return;
+	/* reported once the command completes */
 	event->message_sent.error = NULL;
 	event->message_sent.id = u;
-	hayes->helper->event(hayes->helper->modem, event);
 }
 
 
@@ -3590,8 +4633,7 @@ static void _on_code_cms_error(HayesChannel * channel, char const * answer)
 {
 	const guint timeout = 5000;
 	Hayes * hayes = channel->hayes;
-	HayesCommand * command = (channel->queue != NULL)
-		? channel->queue->data : NULL;
+	HayesCommand * command = hayeschannel_queue_get_current(channel);
 	unsigned int u;
 	HayesCommand * p;
 
@@ -3674,8 +4716,7 @@ static void _on_code_connect(HayesChannel * channel, char const * answer)
 	Hayes * hayes = channel->hayes;
 	ModemPluginHelper * helper = hayes->helper;
 	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_CONNECTION];
-	HayesCommand * command = (channel->queue != NULL)
-		? channel->queue->data : NULL;
+	HayesCommand * command = hayeschannel_queue_get_current(channel);
 	char * argv[] = { "/usr/sbin/" PROGNAME_PPPD, PROGNAME_PPPD,
 		"call", "phone", "user", "", "password", "", NULL };
 	char const * p;
@@ -3700,12 +4741,12 @@ static void _on_code_connect(HayesChannel * channel, char const * answer)
 		}
 		argv[1] = basename(argv[0]);
 	}
-	/* username */
-	if(channel->gprs_username != NULL)
-		argv[5] = channel->gprs_username;
+	/* username (kept on the control channel) */
+	if(hayes->channel.gprs_username != NULL)
+		argv[5] = hayes->channel.gprs_username;
 	/* password */
-	if(channel->gprs_password != NULL)
-		argv[7] = channel->gprs_password;
+	if(hayes->channel.gprs_password != NULL)
+		argv[7] = hayes->channel.gprs_password;
 	res = g_spawn_async_with_pipes(NULL, argv, NULL, flags, NULL, NULL,
 			NULL, &wfd, &rfd, NULL, &error);
 	if(p != NULL)
@@ -3726,8 +4767,6 @@ static void _on_code_connect(HayesChannel * channel, char const * answer)
 		error = NULL;
 	}
 	g_io_channel_set_buffered(channel->rd_ppp_channel, FALSE);
-	channel->rd_ppp_source = g_io_add_watch(channel->rd_ppp_channel,
-			G_IO_IN, _on_watch_can_read_ppp, channel);
 	channel->wr_ppp_channel = g_io_channel_unix_new(wfd);
 	if(g_io_channel_set_encoding(channel->wr_ppp_channel, NULL, &error)
 			!= G_IO_STATUS_NORMAL)
@@ -3736,8 +4775,12 @@ static void _on_code_connect(HayesChannel * channel, char const * answer)
 		g_error_free(error);
 	}
 	g_io_channel_set_buffered(channel->wr_ppp_channel, FALSE);
-	channel->wr_ppp_source = 0;
 	event->connection.connected = 1;
+	if(_hayes_pump_start(hayes, channel) != 0)
+	{
+		_hayes_reset(hayes);
+		return;
+	}
 	event->connection.in = 0;
 	event->connection.out = 0;
 	hayes->helper->event(hayes->helper->modem, event);
@@ -3864,23 +4907,20 @@ static void _on_code_cpas(HayesChannel * channel, char const * answer)
 static void _on_code_cpbr(HayesChannel * channel, char const * answer)
 {
 	Hayes * hayes = channel->hayes;
-	ModemRequest request;
-	HayesRequestContactList list;
 	ModemEvent * event = &channel->events[MODEM_EVENT_TYPE_CONTACT];
+	char * number = channel->contact_number;
 	unsigned int u;
 	unsigned int v;
-	char number[32];
-	char name[32];
-	char * p;
+	char name[HAYESCHANNEL_CONTACT_NAME_SIZE];
 
 	if(sscanf(answer, "(%u-%u)", &u, &v) == 2)
 	{
-		memset(&request, 0, sizeof(request));
-		request.type = HAYES_REQUEST_CONTACT_LIST;
-		list.from = u;
-		list.to = v;
-		request.plugin.data = &list;
-		_hayes_request(hayes, &request);
+		/* read the phonebook a window at a time */
+		channel->contact_next = u;
+		channel->contact_last = v;
+		if(channel->contact_window == 0)
+			channel->contact_window = HAYES_CONTACT_LIST_WINDOW;
+		_hayes_contact_list(hayes, channel);
 		return;
 	}
 	if(sscanf(answer, "%u,\"%31[^\"]\",%u,\"%31[^\"]\"",
@@ -3892,26 +4932,15 @@ static void _on_code_cpbr(HayesChannel * channel, char const * answer)
 			if(number[0] == '+')
 				break;
 			/* prefix the number with a "+" */
-			memmove(&number[1], number, sizeof(number) - 1);
+			memmove(&number[1], number,
+					HAYESCHANNEL_CONTACT_NUMBER_SIZE - 1);
 			number[0] = '+';
 			break;
 	}
-	number[sizeof(number) - 1] = '\0';
-	free(channel->contact_number);
-	channel->contact_number = strdup(number);
-	event->contact.number = channel->contact_number;
-	name[sizeof(name) - 1] = '\0';
-#if 1 /* FIXME is it really always in GSM? */
-	_hayes_convert_gsm_string_to_iso(name);
-#endif
-	if((p = g_convert(name, -1, "UTF-8", "ISO-8859-1", NULL, NULL, NULL))
-			                        != NULL)
-	{
-		snprintf(name, sizeof(name), "%s", p);
-		g_free(p);
-	}
-	free(channel->contact_name);
-	channel->contact_name = strdup(name);
+	number[HAYESCHANNEL_CONTACT_NUMBER_SIZE - 1] = '\0';
+	event->contact.number = number;
+	/* FIXME is it really always in GSM? */
+	hayesgsm_to_utf8_buffer(name, strlen(name), channel->contact_name);
 	event->contact.name = channel->contact_name;
 	event->contact.status = MODEM_CONTACT_STATUS_OFFLINE;
 	/* send event */
@@ -4009,6 +5038,16 @@ static void _on_code_creg(HayesChannel * channel, char const * answer)
 	switch((event->registration.status = u[1]))
 	{
 		case MODEM_REGISTRATION_STATUS_REGISTERED:
+			if(hayes->ready == 0)
+			{
+				hayes->ready = g_get_monotonic_time()
+					- hayes->started;
+#ifdef DEBUG
+				fprintf(stderr, "DEBUG: %s() ready in %lldus\n",
+						__func__,
+						(long long)hayes->ready);
+#endif
+			}
 			/* refresh registration data */
 			_hayes_request_type(hayes, channel,
 					HAYES_REQUEST_OPERATOR);
@@ -4091,8 +5130,7 @@ static void _on_code_cusd(HayesChannel * channel, char const * answer)
 static void _on_code_ext_error(HayesChannel * channel, char const * answer)
 {
 	/* XXX ugly */
-	HayesCommand * command = (channel->queue != NULL)
-		? channel->queue->data : NULL;
+	HayesCommand * command = hayeschannel_queue_get_current(channel);
 	unsigned int u;
 
 	if(command != NULL)
@@ -4109,6 +5147,31 @@ static void _on_code_ext_error(HayesChannel * channel, char const * answer)
 
 
 /* helpers */
+/* is_action_command */
+static int _is_action_command(char const * attention)
+{
+	/* extended commands answering without a prefix (eg AT+CGMI) */
+	return attention[0] == '+' && strchr(attention, '=') == NULL
+		&& strchr(attention, '?') == NULL;
+}
+
+
+/* is_final_result */
+static int _is_final_result(char const * answer)
+{
+	char const * results[] = { "OK", "ERROR", "BUSY", "NO ANSWER",
+		"NO CARRIER", "NO DIALTONE" };
+	size_t i;
+
+	for(i = 0; i < sizeof(results) / sizeof(*results); i++)
+		if(strcmp(answer, results[i]) == 0)
+			return 1;
+	return strncmp(answer, "CONNECT", 7) == 0
+		|| strncmp(answer, "+CME ERROR:", 11) == 0
+		|| strncmp(answer, "+CMS ERROR:", 11) == 0;
+}
+
+
 /* is_ussd_code */
 static int _is_ussd_code(char const * number)
 {
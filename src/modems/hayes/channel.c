@@ -25,17 +25,25 @@
 
 
 
+#include <stdarg.h>
 #include <stdlib.h>
-#ifdef DEBUG
-# include <stdio.h>
-#endif
+#include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include "command.h"
 #include "common.h"
+#include "concat.h"
 #include "channel.h"
 
 
 /* HayesChannel */
+/* private */
+/* types */
+/* the queues are indexed by priority: fail to build if they do not match */
+typedef char HayesChannelQueueCount[(HAYESCHANNEL_QUEUE_COUNT == HCP_COUNT)
+	? 1 : -1];
+
+
 /* public */
 /* functions */
 /* hayeschannel_init */
@@ -55,7 +63,13 @@ void hayeschannel_init(HayesChannel * channel, ModemPlugin * modem)
 /* hayeschannel_destroy */
 void hayeschannel_destroy(HayesChannel * channel)
 {
-	(void) channel;
+	if(channel->message_concat != NULL)
+		hayesconcat_delete(channel->message_concat);
+	channel->message_concat = NULL;
+	g_slist_foreach(channel->message_parts,
+			(GFunc)hayesconcatmessage_delete, NULL);
+	g_slist_free(channel->message_parts);
+	channel->message_parts = NULL;
 }
 
 
@@ -82,7 +96,96 @@ void hayeschannel_set_quirks(HayesChannel * channel, unsigned int quirks)
 
 
 /* useful */
+/* attentions */
+/* hayeschannel_attention_format */
+char const * hayeschannel_attention_format(HayesChannel * channel,
+		char const * format, ...)
+{
+	va_list ap;
+	int len;
+
+	/* the result is only valid until the next request is formatted */
+	va_start(ap, format);
+	len = vsnprintf(channel->attention, sizeof(channel->attention), format,
+			ap);
+	va_end(ap);
+	if(len < 0 || (size_t)len >= sizeof(channel->attention))
+	{
+		errno = ERANGE;
+		return NULL;
+	}
+	return channel->attention;
+}
+
+
+/* read buffer */
+/* hayeschannel_read_buffer */
+char * hayeschannel_read_buffer(HayesChannel * channel, size_t * size)
+{
+	size_t end = channel->rd_buf_pos + channel->rd_buf_cnt;
+
+	/* always keep room for a terminating NUL character */
+	if(channel->rd_buf_pos > 0 && sizeof(channel->rd_buf) - end - 1
+			< sizeof(channel->rd_buf) / 4)
+	{
+		/* only the beginning of a line is left: move it back */
+		memmove(channel->rd_buf, &channel->rd_buf[channel->rd_buf_pos],
+				channel->rd_buf_cnt);
+		channel->rd_buf_pos = 0;
+		end = channel->rd_buf_cnt;
+	}
+	*size = sizeof(channel->rd_buf) - end - 1;
+	return &channel->rd_buf[end];
+}
+
+
+/* hayeschannel_read_data */
+char * hayeschannel_read_data(HayesChannel * channel)
+{
+	return &channel->rd_buf[channel->rd_buf_pos];
+}
+
+
+/* hayeschannel_read_commit */
+void hayeschannel_read_commit(HayesChannel * channel, size_t size)
+{
+	channel->rd_buf_cnt += size;
+	channel->rd_buf[channel->rd_buf_pos + channel->rd_buf_cnt] = '\0';
+}
+
+
+/* hayeschannel_read_consume */
+void hayeschannel_read_consume(HayesChannel * channel, size_t size)
+{
+	if(size >= channel->rd_buf_cnt)
+	{
+		/* rewind the buffer whenever possible */
+		channel->rd_buf_pos = 0;
+		channel->rd_buf_cnt = 0;
+		return;
+	}
+	channel->rd_buf_pos += size;
+	channel->rd_buf_cnt -= size;
+}
+
+
 /* queue management */
+/* hayeschannel_queue_append */
+void hayeschannel_queue_append(HayesChannel * channel, HayesCommand * command)
+{
+	HayesCommandPriority priority = hayes_command_get_priority(command);
+
+	if(priority > HCP_LAST)
+		priority = HCP_LAST;
+	hayes_command_set_next(command, NULL);
+	if(channel->queue[priority].tail == NULL)
+		channel->queue[priority].head = command;
+	else
+		hayes_command_set_next(channel->queue[priority].tail, command);
+	channel->queue[priority].tail = command;
+}
+
+
 /* hayeschannel_queue_data */
 int hayeschannel_queue_data(HayesChannel * channel, char const * buf,
 		size_t size)
@@ -99,49 +202,196 @@ int hayeschannel_queue_data(HayesChannel * channel, char const * buf,
 
 
 /* hayeschannel_queue_flush */
+static void _queue_delete(HayesCommand * command);
+
 void hayeschannel_queue_flush(HayesChannel * channel)
 {
+	size_t i;
+	HayesCommand * command;
+	HayesCommand * next;
+
 	g_slist_foreach(channel->queue_timeout, (GFunc)hayes_command_delete,
 			NULL);
 	g_slist_free(channel->queue_timeout);
 	channel->queue_timeout = NULL;
-	g_slist_foreach(channel->queue, (GFunc)hayes_command_delete, NULL);
-	g_slist_free(channel->queue);
-	channel->queue = NULL;
-	free(channel->rd_buf);
-	channel->rd_buf = NULL;
+	_queue_delete(channel->queue_current);
+	channel->queue_current = NULL;
+	for(i = 0; i < HCP_COUNT; i++)
+	{
+		for(command = channel->queue[i].head; command != NULL;
+				command = next)
+		{
+			next = hayes_command_get_next(command);
+			hayes_command_delete(command);
+		}
+		channel->queue[i].head = NULL;
+		channel->queue[i].tail = NULL;
+	}
+	channel->message_failed = 0;
+	channel->rd_buf_pos = 0;
 	channel->rd_buf_cnt = 0;
 	hayescommon_source_reset(&channel->rd_source);
 	free(channel->wr_buf);
 	channel->wr_buf = NULL;
 	channel->wr_buf_cnt = 0;
 	hayescommon_source_reset(&channel->wr_source);
-	hayescommon_source_reset(&channel->rd_ppp_source);
-	hayescommon_source_reset(&channel->wr_ppp_source);
+	hayescommon_source_reset(&channel->ppp_in.rd_source);
+	hayescommon_source_reset(&channel->ppp_in.wr_source);
+	channel->ppp_in.cnt = 0;
+	hayescommon_source_reset(&channel->ppp_out.rd_source);
+	hayescommon_source_reset(&channel->ppp_out.wr_source);
+	channel->ppp_out.cnt = 0;
 	channel->authenticate_count = 0;
 	hayescommon_source_reset(&channel->authenticate_source);
 	hayescommon_source_reset(&channel->timeout);
+	hayescommon_source_reset(&channel->timeout_late);
 }
 
 
-/* hayeschannel_queue_pop */
-int hayeschannel_queue_pop(HayesChannel * channel)
+static void _queue_delete(HayesCommand * command)
+{
+	HayesCommand * next;
+
+	/* the command in progress may be a batch */
+	for(; command != NULL; command = next)
+	{
+		next = hayes_command_get_next(command);
+		hayes_command_delete(command);
+	}
+}
+
+
+/* hayeschannel_queue_get_current */
+HayesCommand * hayeschannel_queue_get_current(HayesChannel * channel)
+{
+	return channel->queue_current;
+}
+
+
+/* hayeschannel_queue_join */
+HayesCommand * hayeschannel_queue_join(HayesChannel * channel)
 {
+	int i;
 	HayesCommand * command;
+	HayesCommand * last;
 
+	if((last = channel->queue_current) == NULL)
+		return NULL;
+	for(i = HCP_LAST; i >= 0; i--)
+		if((command = channel->queue[i].head) != NULL)
+		{
+			if((channel->queue[i].head = hayes_command_get_next(
+							command)) == NULL)
+				channel->queue[i].tail = NULL;
+			hayes_command_set_next(command, NULL);
+			/* append to the command in progress */
+			while(hayes_command_get_next(last) != NULL)
+				last = hayes_command_get_next(last);
+			hayes_command_set_next(last, command);
+			return command;
+		}
+	return NULL;
+}
+
+
+/* hayeschannel_queue_next */
+HayesCommand * hayeschannel_queue_next(HayesChannel * channel)
+{
+	int i;
+	HayesCommand * command;
+
+	/* never preempt the command in progress */
+	if(channel->queue_current != NULL)
+		return channel->queue_current;
+	for(i = HCP_LAST; i >= 0; i--)
+		if((command = channel->queue[i].head) != NULL)
+		{
+			if((channel->queue[i].head = hayes_command_get_next(
+							command)) == NULL)
+				channel->queue[i].tail = NULL;
+			hayes_command_set_next(command, NULL);
+			channel->queue_current = command;
+			return command;
+		}
+	return NULL;
+}
+
+
+/* hayeschannel_queue_peek */
+HayesCommand * hayeschannel_queue_peek(HayesChannel * channel)
+{
+	int i;
+
+	for(i = HCP_LAST; i >= 0; i--)
+		if(channel->queue[i].head != NULL)
+			return channel->queue[i].head;
+	return NULL;
+}
+
+
+/* hayeschannel_queue_pop */
+int hayeschannel_queue_pop(HayesChannel * channel)
+{
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s()\n", __func__);
 #endif
 	hayescommon_source_reset(&channel->timeout);
-	if(channel->queue == NULL) /* nothing to send */
+	if(channel->queue_current == NULL) /* nothing to send */
 		return 0;
-	command = channel->queue->data; /* XXX assumes it's valid */
-	hayes_command_delete(command);
-	channel->queue = g_slist_remove(channel->queue, command);
+	_queue_delete(channel->queue_current);
+	channel->queue_current = NULL;
 	return 0;
 }
 
 
+/* hayeschannel_queue_split */
+int hayeschannel_queue_split(HayesChannel * channel, HayesCommand * command)
+{
+	HayesCommand * copy;
+	HayesCommand * first[HCP_COUNT];
+	HayesCommand * last[HCP_COUNT];
+	HayesCommandPriority priority;
+	size_t i;
+	int ret = 0;
+
+	memset(first, 0, sizeof(first));
+	memset(last, 0, sizeof(last));
+	/* copy the rest of the batch in progress, not batched anymore */
+	for(; command != NULL; command = hayes_command_get_next(command))
+	{
+		if((copy = hayes_command_new_copy(command)) == NULL
+				|| hayes_command_set_status(copy, HCS_QUEUED)
+				!= HCS_QUEUED)
+		{
+			if(copy != NULL)
+				hayes_command_delete(copy);
+			ret = -1;
+			continue;
+		}
+		hayes_command_set_data(copy, hayes_command_get_data(command));
+		hayes_command_set_data(command, NULL);
+		if((priority = hayes_command_get_priority(copy)) > HCP_LAST)
+			priority = HCP_LAST;
+		if(last[priority] == NULL)
+			first[priority] = copy;
+		else
+			hayes_command_set_next(last[priority], copy);
+		last[priority] = copy;
+	}
+	/* and re-queue them first, in the same order */
+	for(i = 0; i < HCP_COUNT; i++)
+	{
+		if(first[i] == NULL)
+			continue;
+		hayes_command_set_next(last[i], channel->queue[i].head);
+		if(channel->queue[i].head == NULL)
+			channel->queue[i].tail = last[i];
+		channel->queue[i].head = first[i];
+	}
+	return ret;
+}
+
+
 /* hayeschannel_stop */
 static void _stop_giochannel(GIOChannel * channel);
 static void _stop_string(char ** string);
@@ -151,22 +401,20 @@ void hayeschannel_stop(HayesChannel * channel)
 	size_t i;
 
 	/* close everything opened */
-	if(channel->fp != NULL)
-		fclose(channel->fp);
-	channel->fp = NULL;
 	hayeschannel_queue_flush(channel);
 	_stop_giochannel(channel->channel);
 	channel->channel = NULL;
-	_stop_giochannel(channel->rd_ppp_channel);
-	channel->rd_ppp_channel = NULL;
-	_stop_giochannel(channel->wr_ppp_channel);
-	channel->wr_ppp_channel = NULL;
+	hayeschannel_stop_ppp(channel);
 	/* remove internal data */
 	_stop_string(&channel->authentication_name);
 	_stop_string(&channel->authentication_error);
 	_stop_string(&channel->call_number);
-	_stop_string(&channel->contact_name);
-	_stop_string(&channel->contact_number);
+	channel->contact_name[0] = '\0';
+	channel->contact_number[0] = '\0';
+	channel->contact_next = 0;
+	channel->contact_last = 0;
+	channel->contact_window = 0;
+	channel->contact_pending = 0;
 	_stop_string(&channel->gprs_username);
 	_stop_string(&channel->gprs_password);
 	_stop_string(&channel->message_number);
@@ -183,6 +431,7 @@ void hayeschannel_stop(HayesChannel * channel)
 		channel->events[i].type = i;
 	/* reset mode */
 	channel->mode = HAYESCHANNEL_MODE_INIT;
+	channel->queue_batch_disabled = 0;
 }
 
 static void _stop_giochannel(GIOChannel * channel)
@@ -203,3 +452,13 @@ static void _stop_string(char ** string)
 	free(*string);
 	*string = NULL;
 }
+
+
+/* hayeschannel_stop_ppp */
+void hayeschannel_stop_ppp(HayesChannel * channel)
+{
+	_stop_giochannel(channel->rd_ppp_channel);
+	channel->rd_ppp_channel = NULL;
+	_stop_giochannel(channel->wr_ppp_channel);
+	channel->wr_ppp_channel = NULL;
+}
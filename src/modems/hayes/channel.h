@@ -36,6 +36,15 @@
 
 /* HayesChannel */
 /* public */
+/* constants */
+# define HAYESCHANNEL_ATTENTION_SIZE	512
+# define HAYESCHANNEL_CONTACT_NAME_SIZE	32 /* in septets */
+# define HAYESCHANNEL_CONTACT_NUMBER_SIZE	32
+# define HAYESCHANNEL_PUMP_SIZE		16384
+# define HAYESCHANNEL_QUEUE_COUNT	4 /* HCP_COUNT, checked in channel.c */
+# define HAYESCHANNEL_READ_SIZE		4096
+
+
 /* types */
 typedef enum _HayesChannelMode
 {
@@ -45,6 +54,22 @@ typedef enum _HayesChannelMode
 	HAYESCHANNEL_MODE_PDU
 } HayesChannelMode;
 
+typedef struct _HayesChannelPump
+{
+	struct _HayesChannel * channel;
+
+	GIOChannel * from;
+	GIOChannel * to;
+	guint rd_source;
+	guint wr_source;
+	int splice;
+	size_t * counter;
+
+	char buf[HAYESCHANNEL_PUMP_SIZE];
+	size_t pos;
+	size_t cnt;
+} HayesChannelPump;
+
 typedef struct _HayesChannel
 {
 	ModemPlugin * hayes;
@@ -53,36 +78,58 @@ typedef struct _HayesChannel
 
 	guint source;
 	guint timeout;
+	guint timeout_late;	/* a command timed out may still be answered */
 	guint authenticate_count;
 	guint authenticate_source;
 
 	GIOChannel * channel;
-	char * rd_buf;
+	char rd_buf[HAYESCHANNEL_READ_SIZE];
+	size_t rd_buf_pos;
 	size_t rd_buf_cnt;
 	guint rd_source;
 	char * wr_buf;
 	size_t wr_buf_cnt;
 	guint wr_source;
 	GIOChannel * rd_ppp_channel;
-	guint rd_ppp_source;
 	GIOChannel * wr_ppp_channel;
-	guint wr_ppp_source;
 
-	/* logging */
-	FILE * fp;
+	/* data mode */
+	HayesChannelPump ppp_in;
+	HayesChannelPump ppp_out;
 
 	/* queue */
 	HayesChannelMode mode;
-	GSList * queue;
+	struct _HayesCommand * queue_current;
+	struct
+	{
+		struct _HayesCommand * head;
+		struct _HayesCommand * tail;
+	} queue[HAYESCHANNEL_QUEUE_COUNT];
 	GSList * queue_timeout;
+	int queue_batch_disabled;
+	char attention[HAYESCHANNEL_ATTENTION_SIZE]; /* scratch for requests */
+
+	/* contacts */
+	unsigned int contact_next;
+	unsigned int contact_last;
+	unsigned int contact_window;
+	unsigned int contact_pending;
+	gint64 contact_sent;
+
+	/* messages */
+	struct _HayesConcat * message_concat;
+	GSList * message_parts;	/* of the messages reported in parts */
+	guint message_source;
+	unsigned int message_reference;
+	int message_failed;	/* drop the parts left until the last one */
 
 	/* events */
 	ModemEvent events[MODEM_EVENT_TYPE_COUNT];
 	char * authentication_name;
 	char * authentication_error;
 	char * call_number;
-	char * contact_name;
-	char * contact_number;
+	char contact_name[HAYESCHANNEL_CONTACT_NAME_SIZE * 3 + 1];
+	char contact_number[HAYESCHANNEL_CONTACT_NUMBER_SIZE];
 	char * gprs_username;
 	char * gprs_password;
 	char * message_number;
@@ -108,12 +155,31 @@ int hayeschannel_is_started(HayesChannel * channel);
 void hayeschannel_set_quirks(HayesChannel * channel, unsigned int quirks);
 
 /* useful */
+/* attentions */
+char const * hayeschannel_attention_format(HayesChannel * channel,
+		char const * format, ...);
+
+/* read buffer */
+char * hayeschannel_read_buffer(HayesChannel * channel, size_t * size);
+char * hayeschannel_read_data(HayesChannel * channel);
+void hayeschannel_read_commit(HayesChannel * channel, size_t size);
+void hayeschannel_read_consume(HayesChannel * channel, size_t size);
+
 /* queue management */
+void hayeschannel_queue_append(HayesChannel * channel,
+		struct _HayesCommand * command);
 int hayeschannel_queue_data(HayesChannel * channel, char const * buf,
 		size_t size);
 void hayeschannel_queue_flush(HayesChannel * channel);
+struct _HayesCommand * hayeschannel_queue_get_current(HayesChannel * channel);
+struct _HayesCommand * hayeschannel_queue_join(HayesChannel * channel);
+struct _HayesCommand * hayeschannel_queue_next(HayesChannel * channel);
+struct _HayesCommand * hayeschannel_queue_peek(HayesChannel * channel);
 int hayeschannel_queue_pop(HayesChannel * channel);
+int hayeschannel_queue_split(HayesChannel * channel,
+		struct _HayesCommand * command);
 
 void hayeschannel_stop(HayesChannel * channel);
+void hayeschannel_stop_ppp(HayesChannel * channel);
 
 #endif /* PHONE_MODEM_HAYES_CHANNEL_H */
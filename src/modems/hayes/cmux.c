@@ -0,0 +1,877 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#ifdef DEBUG
+# include <stdio.h>
+#endif
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include "common.h"
+#include "cmux.h"
+
+/* constants */
+#define HAYESCMUX_EA		0x01
+#define HAYESCMUX_FCS_GOOD	0xcf
+#define HAYESCMUX_FLAG		0xf9
+#define HAYESCMUX_RETRIES	3
+#define HAYESCMUX_TIMEOUT	1000	/* in milliseconds */
+
+
+/* HayesCMUX */
+/* private */
+/* types */
+typedef enum _HayesCMUXDecoderState
+{
+	HCMUXDS_FLAG = 0,
+	HCMUXDS_ADDRESS,
+	HCMUXDS_CONTROL,
+	HCMUXDS_LENGTH,
+	HCMUXDS_LENGTH2,
+	HCMUXDS_DATA,
+	HCMUXDS_FCS,
+	HCMUXDS_END
+} HayesCMUXDecoderState;
+
+typedef struct _HayesCMUXLink
+{
+	HayesCMUX * cmux;
+	unsigned int dlci;
+	int open;			/* -1 if closed */
+
+	/* our end of the channel */
+	GIOChannel * channel;
+	guint rd_source;
+	guint wr_source;
+
+	/* received from the modem */
+	char buf[HAYESCMUX_BUFFER_SIZE];
+	size_t pos;
+	size_t cnt;
+} HayesCMUXLink;
+
+struct _HayesCMUX
+{
+	HayesCMUXCallback callback;
+	void * data;
+
+	/* serial port */
+	GIOChannel * channel;
+	guint rd_source;
+	guint wr_source;
+	guint source;
+	unsigned int retries;
+
+	/* from the modem */
+	HayesCMUXDecoder decoder;
+	HayesCMUXFrame * pending;
+	char rd_buf[HAYESCMUX_BUFFER_SIZE];
+	size_t rd_pos;
+	size_t rd_cnt;
+
+	/* to the modem */
+	char wr_buf[HAYESCMUX_BUFFER_SIZE];
+	size_t wr_pos;
+	size_t wr_cnt;
+
+	HayesCMUXLink links[HAYESCMUX_DLCI_COUNT];
+};
+
+
+/* variables */
+/* reversed CRC-8 with the polynomial x^8 + x^2 + x + 1 */
+static const unsigned char _hayescmux_fcs[256] =
+{
+	0x00, 0x91, 0xe3, 0x72, 0x07, 0x96, 0xe4, 0x75,
+	0x0e, 0x9f, 0xed, 0x7c, 0x09, 0x98, 0xea, 0x7b,
+	0x1c, 0x8d, 0xff, 0x6e, 0x1b, 0x8a, 0xf8, 0x69,
+	0x12, 0x83, 0xf1, 0x60, 0x15, 0x84, 0xf6, 0x67,
+	0x38, 0xa9, 0xdb, 0x4a, 0x3f, 0xae, 0xdc, 0x4d,
+	0x36, 0xa7, 0xd5, 0x44, 0x31, 0xa0, 0xd2, 0x43,
+	0x24, 0xb5, 0xc7, 0x56, 0x23, 0xb2, 0xc0, 0x51,
+	0x2a, 0xbb, 0xc9, 0x58, 0x2d, 0xbc, 0xce, 0x5f,
+	0x70, 0xe1, 0x93, 0x02, 0x77, 0xe6, 0x94, 0x05,
+	0x7e, 0xef, 0x9d, 0x0c, 0x79, 0xe8, 0x9a, 0x0b,
+	0x6c, 0xfd, 0x8f, 0x1e, 0x6b, 0xfa, 0x88, 0x19,
+	0x62, 0xf3, 0x81, 0x10, 0x65, 0xf4, 0x86, 0x17,
+	0x48, 0xd9, 0xab, 0x3a, 0x4f, 0xde, 0xac, 0x3d,
+	0x46, 0xd7, 0xa5, 0x34, 0x41, 0xd0, 0xa2, 0x33,
+	0x54, 0xc5, 0xb7, 0x26, 0x53, 0xc2, 0xb0, 0x21,
+	0x5a, 0xcb, 0xb9, 0x28, 0x5d, 0xcc, 0xbe, 0x2f,
+	0xe0, 0x71, 0x03, 0x92, 0xe7, 0x76, 0x04, 0x95,
+	0xee, 0x7f, 0x0d, 0x9c, 0xe9, 0x78, 0x0a, 0x9b,
+	0xfc, 0x6d, 0x1f, 0x8e, 0xfb, 0x6a, 0x18, 0x89,
+	0xf2, 0x63, 0x11, 0x80, 0xf5, 0x64, 0x16, 0x87,
+	0xd8, 0x49, 0x3b, 0xaa, 0xdf, 0x4e, 0x3c, 0xad,
+	0xd6, 0x47, 0x35, 0xa4, 0xd1, 0x40, 0x32, 0xa3,
+	0xc4, 0x55, 0x27, 0xb6, 0xc3, 0x52, 0x20, 0xb1,
+	0xca, 0x5b, 0x29, 0xb8, 0xcd, 0x5c, 0x2e, 0xbf,
+	0x90, 0x01, 0x73, 0xe2, 0x97, 0x06, 0x74, 0xe5,
+	0x9e, 0x0f, 0x7d, 0xec, 0x99, 0x08, 0x7a, 0xeb,
+	0x8c, 0x1d, 0x6f, 0xfe, 0x8b, 0x1a, 0x68, 0xf9,
+	0x82, 0x13, 0x61, 0xf0, 0x85, 0x14, 0x66, 0xf7,
+	0xa8, 0x39, 0x4b, 0xda, 0xaf, 0x3e, 0x4c, 0xdd,
+	0xa6, 0x37, 0x45, 0xd4, 0xa1, 0x30, 0x42, 0xd3,
+	0xb4, 0x25, 0x57, 0xc6, 0xb3, 0x22, 0x50, 0xc1,
+	0xba, 0x2b, 0x59, 0xc8, 0xbd, 0x2c, 0x5e, 0xcf
+};
+
+
+/* prototypes */
+static unsigned char _hayescmux_fcs_block(unsigned char fcs,
+		unsigned char const * buf, size_t size);
+
+static int _hayescmux_connect(HayesCMUX * cmux);
+static void _hayescmux_close(HayesCMUX * cmux, HayesCMUXLink * link);
+static void _hayescmux_error(HayesCMUX * cmux, unsigned int dlci);
+static int _hayescmux_frame(HayesCMUX * cmux, HayesCMUXFrame * frame);
+static int _hayescmux_message(HayesCMUX * cmux, HayesCMUXFrame * frame);
+static void _hayescmux_open(HayesCMUX * cmux, HayesCMUXLink * link);
+static int _hayescmux_process(HayesCMUX * cmux);
+static void _hayescmux_resume(HayesCMUX * cmux);
+static int _hayescmux_send(HayesCMUX * cmux, unsigned int dlci,
+		unsigned char control, char const * data, size_t length);
+static int _hayescmux_signals(HayesCMUX * cmux, unsigned int dlci,
+		unsigned char signals);
+static size_t _hayescmux_space(HayesCMUX * cmux);
+
+/* callbacks */
+static gboolean _hayescmux_on_can_read(GIOChannel * source,
+		GIOCondition condition, gpointer data);
+static gboolean _hayescmux_on_can_write(GIOChannel * source,
+		GIOCondition condition, gpointer data);
+static gboolean _hayescmux_on_link_read(GIOChannel * source,
+		GIOCondition condition, gpointer data);
+static gboolean _hayescmux_on_link_write(GIOChannel * source,
+		GIOCondition condition, gpointer data);
+static gboolean _hayescmux_on_timeout(gpointer data);
+
+
+/* public */
+/* functions */
+/* hayescmux_new */
+static GIOChannel * _new_channel(int fd);
+
+HayesCMUX * hayescmux_new(int fd, HayesCMUXCallback callback, void * data)
+{
+	HayesCMUX * cmux;
+	int fl;
+	size_t i;
+
+	if((fl = fcntl(fd, F_GETFL, 0)) == -1
+			|| ((fl | O_NONBLOCK) != fl
+				&& fcntl(fd, F_SETFL, fl | O_NONBLOCK) == -1))
+		return NULL;
+	if((cmux = malloc(sizeof(*cmux))) == NULL)
+		return NULL;
+	memset(cmux, 0, sizeof(*cmux));
+	cmux->callback = callback;
+	cmux->data = data;
+	hayescmux_decoder_init(&cmux->decoder);
+	for(i = 0; i < HAYESCMUX_DLCI_COUNT; i++)
+	{
+		cmux->links[i].cmux = cmux;
+		cmux->links[i].dlci = i;
+	}
+	cmux->channel = _new_channel(fd);
+	cmux->rd_source = g_io_add_watch(cmux->channel, G_IO_IN,
+			_hayescmux_on_can_read, cmux);
+	if(_hayescmux_connect(cmux) != 0)
+	{
+		/* the file descriptor still belongs to the caller */
+		hayescommon_source_reset(&cmux->rd_source);
+		g_io_channel_unref(cmux->channel);
+		free(cmux);
+		return NULL;
+	}
+	return cmux;
+}
+
+static GIOChannel * _new_channel(int fd)
+{
+	GIOChannel * channel;
+
+	channel = g_io_channel_unix_new(fd);
+	g_io_channel_set_encoding(channel, NULL, NULL);
+	g_io_channel_set_buffered(channel, FALSE);
+	return channel;
+}
+
+
+/* hayescmux_delete */
+void hayescmux_delete(HayesCMUX * cmux)
+{
+	const char cld[] = { HAYESCMUX_MESSAGE_CLD | HAYESCMUX_MESSAGE_CR,
+		HAYESCMUX_EA };
+	const int open = cmux->links[HAYESCMUX_DLCI_CONTROL].open;
+	size_t i;
+	ssize_t cnt;
+
+	hayescommon_source_reset(&cmux->source);
+	hayescommon_source_reset(&cmux->rd_source);
+	hayescommon_source_reset(&cmux->wr_source);
+	for(i = HAYESCMUX_DLCI_COUNT; i-- > 0;)
+		_hayescmux_close(cmux, &cmux->links[i]);
+	/* try to return the modem to the command mode */
+	if(open > 0 && _hayescmux_send(cmux, HAYESCMUX_DLCI_CONTROL,
+				HAYESCMUX_FRAME_UIH, cld, sizeof(cld)) == 0)
+	{
+		hayescommon_source_reset(&cmux->wr_source);
+		while(cmux->wr_cnt > 0 && (cnt = write(
+						g_io_channel_unix_get_fd(
+							cmux->channel),
+						&cmux->wr_buf[cmux->wr_pos],
+						cmux->wr_cnt)) > 0)
+		{
+			cmux->wr_pos += cnt;
+			cmux->wr_cnt -= cnt;
+		}
+	}
+	g_io_channel_shutdown(cmux->channel, TRUE, NULL);
+	g_io_channel_unref(cmux->channel);
+	free(cmux);
+}
+
+
+/* useful */
+/* hayescmux_hangup */
+int hayescmux_hangup(HayesCMUX * cmux, unsigned int dlci)
+{
+	const unsigned char on = HAYESCMUX_EA | HAYESCMUX_SIGNAL_RTC
+		| HAYESCMUX_SIGNAL_RTR;
+
+	if(dlci == HAYESCMUX_DLCI_CONTROL || dlci >= HAYESCMUX_DLCI_COUNT
+			|| cmux->links[dlci].open <= 0)
+		return -1;
+	/* toggle the virtual DTR line, as with AT&D2 */
+	if(_hayescmux_signals(cmux, dlci, HAYESCMUX_EA) != 0
+			|| _hayescmux_signals(cmux, dlci, on) != 0)
+		return -1;
+	return 0;
+}
+
+
+/* framing */
+/* hayescmux_encode */
+size_t hayescmux_encode(char * buf, size_t size, unsigned int dlci,
+		unsigned int cr, unsigned char control, char const * data,
+		size_t length)
+{
+	unsigned char * p = (unsigned char *)buf;
+	const size_t header = (length > 127) ? 4 : 3;
+	unsigned char fcs;
+
+	if(length > 0x7fff || size < header + length + 3)
+		return 0;
+	p[0] = HAYESCMUX_FLAG;
+	p[1] = (dlci << 2) | (cr ? 0x02 : 0x00) | HAYESCMUX_EA;
+	p[2] = control;
+	if(length > 127)
+	{
+		p[3] = (length << 1) & 0xfe;
+		p[4] = length >> 7;
+	}
+	else
+		p[3] = (length << 1) | HAYESCMUX_EA;
+	fcs = _hayescmux_fcs_block(0xff, &p[1], header);
+	memcpy(&p[header + 1], data, length);
+	/* only UIH frames leave the information field out */
+	if((control & ~HAYESCMUX_FRAME_PF) != HAYESCMUX_FRAME_UIH)
+		fcs = _hayescmux_fcs_block(fcs, &p[header + 1], length);
+	p[header + 1 + length] = 0xff - fcs;
+	p[header + 2 + length] = HAYESCMUX_FLAG;
+	return header + length + 3;
+}
+
+
+/* hayescmux_decoder_init */
+void hayescmux_decoder_init(HayesCMUXDecoder * decoder)
+{
+	decoder->state = HCMUXDS_FLAG;
+	decoder->fcs = 0xff;
+	decoder->count = 0;
+	decoder->frame.length = 0;
+}
+
+
+/* hayescmux_decode */
+static HayesCMUXDecoderState _decode_data(HayesCMUXDecoder * decoder);
+
+size_t hayescmux_decode(HayesCMUXDecoder * decoder, char const * buf,
+		size_t size, HayesCMUXFrame ** frame)
+{
+	HayesCMUXFrame * f = &decoder->frame;
+	unsigned char c;
+	size_t i;
+	size_t n;
+
+	*frame = NULL;
+	for(i = 0; i < size; i++)
+	{
+		c = buf[i];
+		switch(decoder->state)
+		{
+			case HCMUXDS_FLAG:
+				if(c == HAYESCMUX_FLAG)
+					decoder->state = HCMUXDS_ADDRESS;
+				break;
+			case HCMUXDS_ADDRESS:
+				if(c == HAYESCMUX_FLAG)
+					break; /* consecutive flags */
+				if((c & HAYESCMUX_EA) == 0)
+				{
+					decoder->state = HCMUXDS_FLAG;
+					break;
+				}
+				f->dlci = c >> 2;
+				f->cr = (c >> 1) & 0x1;
+				decoder->fcs = _hayescmux_fcs[0xff ^ c];
+				decoder->state = HCMUXDS_CONTROL;
+				break;
+			case HCMUXDS_CONTROL:
+				f->control = c;
+				decoder->fcs = _hayescmux_fcs[decoder->fcs ^ c];
+				decoder->state = HCMUXDS_LENGTH;
+				break;
+			case HCMUXDS_LENGTH:
+				decoder->fcs = _hayescmux_fcs[decoder->fcs ^ c];
+				f->length = c >> 1;
+				decoder->state = (c & HAYESCMUX_EA)
+					? _decode_data(decoder)
+					: HCMUXDS_LENGTH2;
+				break;
+			case HCMUXDS_LENGTH2:
+				decoder->fcs = _hayescmux_fcs[decoder->fcs ^ c];
+				f->length |= (size_t)c << 7;
+				decoder->state = _decode_data(decoder);
+				break;
+			case HCMUXDS_DATA:
+				/* copy as much information as possible */
+				n = f->length - decoder->count;
+				if(n > size - i)
+					n = size - i;
+				memcpy(&f->data[decoder->count], &buf[i], n);
+				decoder->count += n;
+				i += n - 1;
+				if(decoder->count == f->length)
+					decoder->state = HCMUXDS_FCS;
+				break;
+			case HCMUXDS_FCS:
+				if((f->control & ~HAYESCMUX_FRAME_PF)
+						!= HAYESCMUX_FRAME_UIH)
+					decoder->fcs = _hayescmux_fcs_block(
+						decoder->fcs, (unsigned char *)
+						f->data, f->length);
+				decoder->fcs = _hayescmux_fcs[decoder->fcs ^ c];
+				decoder->state = (decoder->fcs
+						== HAYESCMUX_FCS_GOOD)
+					? HCMUXDS_END : HCMUXDS_FLAG;
+				break;
+			case HCMUXDS_END:
+				if(c != HAYESCMUX_FLAG)
+				{
+					decoder->state = HCMUXDS_FLAG;
+					break;
+				}
+				/* the closing flag may open the next frame */
+				decoder->state = HCMUXDS_ADDRESS;
+				*frame = f;
+				return i + 1;
+		}
+	}
+	return size;
+}
+
+static HayesCMUXDecoderState _decode_data(HayesCMUXDecoder * decoder)
+{
+	if(decoder->frame.length > sizeof(decoder->frame.data))
+		return HCMUXDS_FLAG; /* drop the frame */
+	decoder->count = 0;
+	return (decoder->frame.length > 0) ? HCMUXDS_DATA : HCMUXDS_FCS;
+}
+
+
+/* private */
+/* functions */
+/* hayescmux_fcs_block */
+static unsigned char _hayescmux_fcs_block(unsigned char fcs,
+		unsigned char const * buf, size_t size)
+{
+	size_t i;
+
+	for(i = 0; i < size; i++)
+		fcs = _hayescmux_fcs[fcs ^ buf[i]];
+	return fcs;
+}
+
+
+/* hayescmux_connect */
+static int _hayescmux_connect(HayesCMUX * cmux)
+{
+	size_t i;
+	int ret = 0;
+
+	/* the control channel has to be established first */
+	if(cmux->links[HAYESCMUX_DLCI_CONTROL].open == 0)
+		ret = _hayescmux_send(cmux, HAYESCMUX_DLCI_CONTROL,
+				HAYESCMUX_FRAME_SABM | HAYESCMUX_FRAME_PF,
+				NULL, 0);
+	else
+		for(i = HAYESCMUX_DLCI_CONTROL + 1; i < HAYESCMUX_DLCI_COUNT;
+				i++)
+			if(cmux->links[i].open == 0)
+				ret |= _hayescmux_send(cmux, i,
+						HAYESCMUX_FRAME_SABM
+						| HAYESCMUX_FRAME_PF, NULL, 0);
+	if(ret == 0 && cmux->source == 0)
+		cmux->source = g_timeout_add(HAYESCMUX_TIMEOUT,
+				_hayescmux_on_timeout, cmux);
+	return ret;
+}
+
+
+/* hayescmux_close */
+static void _hayescmux_close(HayesCMUX * cmux, HayesCMUXLink * link)
+{
+	(void) cmux;
+
+	link->open = -1;
+	hayescommon_source_reset(&link->rd_source);
+	hayescommon_source_reset(&link->wr_source);
+	link->pos = 0;
+	link->cnt = 0;
+	if(link->channel == NULL)
+		return;
+	g_io_channel_shutdown(link->channel, TRUE, NULL);
+	g_io_channel_unref(link->channel);
+	link->channel = NULL;
+}
+
+
+/* hayescmux_error */
+static void _hayescmux_error(HayesCMUX * cmux, unsigned int dlci)
+{
+	size_t i;
+
+	if(dlci == HAYESCMUX_DLCI_CONTROL)
+		/* every channel goes down with the control channel */
+		for(i = HAYESCMUX_DLCI_COUNT; i-- > 0;)
+			_hayescmux_close(cmux, &cmux->links[i]);
+	else
+		_hayescmux_close(cmux, &cmux->links[dlci]);
+	cmux->callback(cmux->data, dlci, -1);
+}
+
+
+/* hayescmux_frame */
+static int _frame_deliver(HayesCMUXLink * link, char const * data,
+		size_t length);
+
+static int _hayescmux_frame(HayesCMUX * cmux, HayesCMUXFrame * frame)
+{
+	HayesCMUXLink * link;
+
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s() dlci=%u control=0x%02x length=%zu\n",
+			__func__, frame->dlci, frame->control, frame->length);
+#endif
+	if(frame->dlci >= HAYESCMUX_DLCI_COUNT)
+		return 0; /* not ours */
+	link = &cmux->links[frame->dlci];
+	switch(frame->control & ~HAYESCMUX_FRAME_PF)
+	{
+		case HAYESCMUX_FRAME_UA:
+			if(link->open == 0)
+				_hayescmux_open(cmux, link);
+			break;
+		case HAYESCMUX_FRAME_DISC:
+			_hayescmux_send(cmux, frame->dlci, HAYESCMUX_FRAME_UA
+					| HAYESCMUX_FRAME_PF, NULL, 0);
+			/* fallthrough */
+		case HAYESCMUX_FRAME_DM:
+			_hayescmux_error(cmux, frame->dlci);
+			break;
+		case HAYESCMUX_FRAME_SABM:
+			/* we are the initiator */
+			_hayescmux_send(cmux, frame->dlci, HAYESCMUX_FRAME_DM
+					| HAYESCMUX_FRAME_PF, NULL, 0);
+			break;
+		case HAYESCMUX_FRAME_UIH:
+			if(frame->dlci == HAYESCMUX_DLCI_CONTROL)
+				return _hayescmux_message(cmux, frame);
+			if(link->channel == NULL)
+				break; /* drop the data */
+			return _frame_deliver(link, frame->data,
+					frame->length);
+	}
+	return 0;
+}
+
+static int _frame_deliver(HayesCMUXLink * link, char const * data,
+		size_t length)
+{
+	int fd = g_io_channel_unix_get_fd(link->channel);
+	ssize_t cnt = 0;
+
+	if(sizeof(link->buf) - link->pos - link->cnt < length)
+	{
+		if(sizeof(link->buf) - link->cnt < length)
+			return -1; /* wait until the buffer is drained */
+		memmove(link->buf, &link->buf[link->pos], link->cnt);
+		link->pos = 0;
+	}
+	/* avoid the copy whenever possible */
+	if(link->cnt == 0 && (cnt = write(fd, data, length)) < 0)
+	{
+		if(errno != EAGAIN && errno != EINTR)
+			return 0; /* drop the data */
+		cnt = 0;
+	}
+	if((size_t)cnt == length)
+		return 0;
+	memcpy(&link->buf[link->pos + link->cnt], &data[cnt], length - cnt);
+	link->cnt += length - cnt;
+	if(link->wr_source == 0)
+		link->wr_source = g_io_add_watch(link->channel, G_IO_OUT,
+				_hayescmux_on_link_write, link);
+	return 0;
+}
+
+
+/* hayescmux_message */
+static int _hayescmux_message(HayesCMUX * cmux, HayesCMUXFrame * frame)
+{
+	unsigned char type;
+
+	if(frame->length < 2)
+		return 0;
+	type = frame->data[0];
+	if((type & HAYESCMUX_MESSAGE_CR) == 0)
+		return 0; /* a response to one of our commands */
+	/* acknowledge every command as is */
+	frame->data[0] = type & ~HAYESCMUX_MESSAGE_CR;
+	_hayescmux_send(cmux, HAYESCMUX_DLCI_CONTROL, HAYESCMUX_FRAME_UIH,
+			frame->data, frame->length);
+	if((type & ~HAYESCMUX_MESSAGE_CR) == HAYESCMUX_MESSAGE_CLD)
+		_hayescmux_error(cmux, HAYESCMUX_DLCI_CONTROL);
+	return 0;
+}
+
+
+/* hayescmux_open */
+static void _hayescmux_open(HayesCMUX * cmux, HayesCMUXLink * link)
+{
+	const unsigned char on = HAYESCMUX_EA | HAYESCMUX_SIGNAL_RTC
+		| HAYESCMUX_SIGNAL_RTR;
+	int fds[2];
+	size_t i;
+
+	link->open = 1;
+	if(link->dlci == HAYESCMUX_DLCI_CONTROL)
+	{
+		cmux->retries = 0;
+		hayescommon_source_reset(&cmux->source);
+		_hayescmux_connect(cmux);
+		return;
+	}
+	for(i = 0; i < HAYESCMUX_DLCI_COUNT; i++)
+		if(cmux->links[i].open == 0)
+			break;
+	if(i == HAYESCMUX_DLCI_COUNT)
+		hayescommon_source_reset(&cmux->source);
+	/* the other end behaves like a dedicated serial port */
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+	{
+		_hayescmux_error(cmux, link->dlci);
+		return;
+	}
+	fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+	link->channel = _new_channel(fds[0]);
+	link->rd_source = g_io_add_watch(link->channel, G_IO_IN,
+			_hayescmux_on_link_read, link);
+	_hayescmux_signals(cmux, link->dlci, on);
+	cmux->callback(cmux->data, link->dlci, fds[1]);
+}
+
+
+/* hayescmux_process */
+static int _hayescmux_process(HayesCMUX * cmux)
+{
+	HayesCMUXFrame * frame;
+	size_t cnt;
+
+	while(cmux->pending != NULL || cmux->rd_cnt > 0)
+	{
+		if((frame = cmux->pending) == NULL)
+		{
+			cnt = hayescmux_decode(&cmux->decoder,
+					&cmux->rd_buf[cmux->rd_pos],
+					cmux->rd_cnt, &frame);
+			cmux->rd_pos += cnt;
+			cmux->rd_cnt -= cnt;
+			if(frame == NULL)
+				continue;
+		}
+		/* keep the frame until the channel can take it */
+		if(_hayescmux_frame(cmux, frame) != 0)
+		{
+			cmux->pending = frame;
+			return -1;
+		}
+		cmux->pending = NULL;
+	}
+	cmux->rd_pos = 0;
+	return 0;
+}
+
+
+/* hayescmux_resume */
+static void _hayescmux_resume(HayesCMUX * cmux)
+{
+	size_t i;
+	HayesCMUXLink * link;
+
+	if(_hayescmux_space(cmux) < HAYESCMUX_FRAME_SIZE
+			+ HAYESCMUX_FRAME_OVERHEAD)
+		return;
+	for(i = HAYESCMUX_DLCI_CONTROL + 1; i < HAYESCMUX_DLCI_COUNT; i++)
+	{
+		link = &cmux->links[i];
+		if(link->channel != NULL && link->rd_source == 0)
+			link->rd_source = g_io_add_watch(link->channel,
+					G_IO_IN, _hayescmux_on_link_read, link);
+	}
+}
+
+
+/* hayescmux_send */
+static int _hayescmux_send(HayesCMUX * cmux, unsigned int dlci,
+		unsigned char control, char const * data, size_t length)
+{
+	unsigned int cr;
+	size_t cnt;
+
+	/* everything but the responses are commands from our side */
+	switch(control & ~HAYESCMUX_FRAME_PF)
+	{
+		case HAYESCMUX_FRAME_DM:
+		case HAYESCMUX_FRAME_UA:
+			cr = 0;
+			break;
+		default:
+			cr = 1;
+			break;
+	}
+	if(_hayescmux_space(cmux) < length + HAYESCMUX_FRAME_OVERHEAD)
+		return -1;
+	if((cnt = hayescmux_encode(&cmux->wr_buf[cmux->wr_pos + cmux->wr_cnt],
+					sizeof(cmux->wr_buf) - cmux->wr_pos
+					- cmux->wr_cnt, dlci, cr, control,
+					data, length)) == 0)
+		return -1;
+	cmux->wr_cnt += cnt;
+	if(cmux->wr_source == 0)
+		cmux->wr_source = g_io_add_watch(cmux->channel, G_IO_OUT,
+				_hayescmux_on_can_write, cmux);
+	return 0;
+}
+
+
+/* hayescmux_signals */
+static int _hayescmux_signals(HayesCMUX * cmux, unsigned int dlci,
+		unsigned char signals)
+{
+	char msc[4];
+
+	msc[0] = HAYESCMUX_MESSAGE_MSC | HAYESCMUX_MESSAGE_CR;
+	msc[1] = (2 << 1) | HAYESCMUX_EA;
+	msc[2] = (dlci << 2) | 0x02 | HAYESCMUX_EA;
+	msc[3] = signals;
+	return _hayescmux_send(cmux, HAYESCMUX_DLCI_CONTROL,
+			HAYESCMUX_FRAME_UIH, msc, sizeof(msc));
+}
+
+
+/* hayescmux_space */
+static size_t _hayescmux_space(HayesCMUX * cmux)
+{
+	/* move the pending frames back to the beginning of the buffer */
+	if(cmux->wr_pos > 0)
+	{
+		memmove(cmux->wr_buf, &cmux->wr_buf[cmux->wr_pos],
+				cmux->wr_cnt);
+		cmux->wr_pos = 0;
+	}
+	return sizeof(cmux->wr_buf) - cmux->wr_cnt;
+}
+
+
+/* callbacks */
+/* hayescmux_on_can_read */
+static gboolean _hayescmux_on_can_read(GIOChannel * source,
+		GIOCondition condition, gpointer data)
+{
+	HayesCMUX * cmux = data;
+	ssize_t cnt;
+	(void) condition;
+
+	if((cnt = read(g_io_channel_unix_get_fd(source), cmux->rd_buf,
+					sizeof(cmux->rd_buf))) < 0
+			&& (errno == EAGAIN || errno == EINTR))
+		return TRUE;
+	if(cnt <= 0)
+	{
+		cmux->rd_source = 0;
+		_hayescmux_error(cmux, HAYESCMUX_DLCI_CONTROL);
+		return FALSE;
+	}
+	cmux->rd_pos = 0;
+	cmux->rd_cnt = cnt;
+	if(_hayescmux_process(cmux) == 0)
+		return TRUE;
+	/* resume once the channel is drained */
+	cmux->rd_source = 0;
+	return FALSE;
+}
+
+
+/* hayescmux_on_can_write */
+static gboolean _hayescmux_on_can_write(GIOChannel * source,
+		GIOCondition condition, gpointer data)
+{
+	HayesCMUX * cmux = data;
+	ssize_t cnt;
+	(void) condition;
+
+	if((cnt = write(g_io_channel_unix_get_fd(source),
+					&cmux->wr_buf[cmux->wr_pos],
+					cmux->wr_cnt)) < 0)
+	{
+		if(errno == EAGAIN || errno == EINTR)
+			return TRUE;
+		cmux->wr_source = 0;
+		_hayescmux_error(cmux, HAYESCMUX_DLCI_CONTROL);
+		return FALSE;
+	}
+	cmux->wr_pos += cnt;
+	cmux->wr_cnt -= cnt;
+	_hayescmux_resume(cmux);
+	if(cmux->wr_cnt > 0)
+		return TRUE;
+	cmux->wr_pos = 0;
+	cmux->wr_source = 0;
+	return FALSE;
+}
+
+
+/* hayescmux_on_link_read */
+static gboolean _hayescmux_on_link_read(GIOChannel * source,
+		GIOCondition condition, gpointer data)
+{
+	const size_t frame = HAYESCMUX_FRAME_SIZE + HAYESCMUX_FRAME_OVERHEAD;
+	HayesCMUXLink * link = data;
+	HayesCMUX * cmux = link->cmux;
+	char buf[HAYESCMUX_FRAME_SIZE * 8];
+	size_t size;
+	ssize_t cnt;
+	ssize_t i;
+	(void) condition;
+
+	/* only read as much as can be framed right away */
+	if((size = (_hayescmux_space(cmux) / frame) * HAYESCMUX_FRAME_SIZE)
+			> sizeof(buf))
+		size = sizeof(buf);
+	if(size == 0)
+	{
+		/* resume once the serial port is drained */
+		link->rd_source = 0;
+		return FALSE;
+	}
+	if((cnt = read(g_io_channel_unix_get_fd(source), buf, size)) < 0
+			&& (errno == EAGAIN || errno == EINTR))
+		return TRUE;
+	if(cnt <= 0)
+	{
+		/* our side of the channel was closed */
+		link->rd_source = 0;
+		return FALSE;
+	}
+	for(i = 0; i < cnt; i += HAYESCMUX_FRAME_SIZE)
+		_hayescmux_send(cmux, link->dlci, HAYESCMUX_FRAME_UIH, &buf[i],
+				(cnt - i < HAYESCMUX_FRAME_SIZE)
+				? (size_t)(cnt - i) : HAYESCMUX_FRAME_SIZE);
+	return TRUE;
+}
+
+
+/* hayescmux_on_link_write */
+static gboolean _hayescmux_on_link_write(GIOChannel * source,
+		GIOCondition condition, gpointer data)
+{
+	HayesCMUXLink * link = data;
+	HayesCMUX * cmux = link->cmux;
+	ssize_t cnt;
+	(void) condition;
+
+	if((cnt = write(g_io_channel_unix_get_fd(source),
+					&link->buf[link->pos], link->cnt)) < 0)
+	{
+		if(errno == EAGAIN || errno == EINTR)
+			return TRUE;
+		cnt = link->cnt; /* drop the data */
+	}
+	link->pos += cnt;
+	if((link->cnt -= cnt) > 0)
+		return TRUE;
+	link->pos = 0;
+	link->wr_source = 0;
+	/* process the frames left */
+	if(cmux->pending != NULL && _hayescmux_process(cmux) == 0
+			&& cmux->rd_source == 0)
+		cmux->rd_source = g_io_add_watch(cmux->channel, G_IO_IN,
+				_hayescmux_on_can_read, cmux);
+	return FALSE;
+}
+
+
+/* hayescmux_on_timeout */
+static gboolean _hayescmux_on_timeout(gpointer data)
+{
+	HayesCMUX * cmux = data;
+
+	cmux->source = 0;
+	if(cmux->retries++ < HAYESCMUX_RETRIES)
+		_hayescmux_connect(cmux);
+	else
+		_hayescmux_error(cmux, HAYESCMUX_DLCI_CONTROL);
+	return FALSE;
+}
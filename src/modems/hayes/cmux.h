@@ -0,0 +1,113 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#ifndef PHONE_MODEM_HAYES_CMUX_H
+# define PHONE_MODEM_HAYES_CMUX_H
+
+# include <sys/types.h>
+
+
+/* HayesCMUX */
+/* public */
+/* constants */
+# define HAYESCMUX_BUFFER_SIZE		4096
+# define HAYESCMUX_DATA_SIZE		1024	/* largest frame read */
+# define HAYESCMUX_FRAME_SIZE		31	/* default N1 (basic) */
+# define HAYESCMUX_FRAME_OVERHEAD	7	/* flags, header and FCS */
+
+/* frame types */
+# define HAYESCMUX_FRAME_DISC		0x43
+# define HAYESCMUX_FRAME_DM		0x0f
+# define HAYESCMUX_FRAME_SABM		0x2f
+# define HAYESCMUX_FRAME_UA		0x63
+# define HAYESCMUX_FRAME_UIH		0xef
+# define HAYESCMUX_FRAME_PF		0x10	/* poll/final bit */
+
+/* control channel messages */
+# define HAYESCMUX_MESSAGE_CLD		0xc1
+# define HAYESCMUX_MESSAGE_MSC		0xe1
+# define HAYESCMUX_MESSAGE_CR		0x02	/* command */
+
+/* modem status signals */
+# define HAYESCMUX_SIGNAL_FC		0x02
+# define HAYESCMUX_SIGNAL_RTC		0x04	/* DTR or DSR */
+# define HAYESCMUX_SIGNAL_RTR		0x08	/* RTS or CTS */
+# define HAYESCMUX_SIGNAL_IC		0x40	/* RING */
+# define HAYESCMUX_SIGNAL_DV		0x80	/* DCD */
+
+
+/* types */
+typedef struct _HayesCMUX HayesCMUX;
+
+typedef enum _HayesCMUXDLCI
+{
+	HAYESCMUX_DLCI_CONTROL = 0,
+	HAYESCMUX_DLCI_COMMAND,
+	HAYESCMUX_DLCI_DATA,
+	HAYESCMUX_DLCI_UNSOLLICITED
+} HayesCMUXDLCI;
+# define HAYESCMUX_DLCI_LAST	HAYESCMUX_DLCI_UNSOLLICITED
+# define HAYESCMUX_DLCI_COUNT	(HAYESCMUX_DLCI_LAST + 1)
+
+typedef struct _HayesCMUXFrame
+{
+	unsigned int dlci;
+	unsigned int cr;
+	unsigned char control;
+	size_t length;
+	char data[HAYESCMUX_DATA_SIZE];
+} HayesCMUXFrame;
+
+typedef struct _HayesCMUXDecoder
+{
+	unsigned int state;
+	unsigned char fcs;
+	size_t count;
+	HayesCMUXFrame frame;
+} HayesCMUXDecoder;
+
+/* the file descriptor is negative once the channel is closed */
+typedef void (*HayesCMUXCallback)(void * data, unsigned int dlci, int fd);
+
+
+/* functions */
+HayesCMUX * hayescmux_new(int fd, HayesCMUXCallback callback, void * data);
+void hayescmux_delete(HayesCMUX * cmux);
+
+/* useful */
+int hayescmux_hangup(HayesCMUX * cmux, unsigned int dlci);
+
+/* framing */
+size_t hayescmux_encode(char * buf, size_t size, unsigned int dlci,
+		unsigned int cr, unsigned char control, char const * data,
+		size_t length);
+
+void hayescmux_decoder_init(HayesCMUXDecoder * decoder);
+size_t hayescmux_decode(HayesCMUXDecoder * decoder, char const * buf,
+		size_t size, HayesCMUXFrame ** frame);
+
+#endif /* PHONE_MODEM_HAYES_CMUX_H */
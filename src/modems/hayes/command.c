@@ -38,16 +38,26 @@ struct _HayesCommand
 	HayesCommandStatus status;
 
 	/* request */
-	String * attention;
+	char const * attention;
+	String * buffer;	/* owned copy of the attention, if any */
 	unsigned int timeout;
 	HayesCommandCallback callback;
 	HayesChannel * channel;
 
 	/* answer */
+	HayesCommandHandler handler;
 	String * answer;
 
 	/* XXX should be handled a better way */
 	void * data;
+
+	/* queue */
+	int batch;
+	HayesCommand * next;
+
+	/* statistics */
+	HayesLatency * latency;
+	gint64 sent;
 };
 
 
@@ -57,22 +67,16 @@ struct _HayesCommand
 HayesCommand * hayes_command_new(char const * attention)
 {
 	HayesCommand * command;
+	String * buffer;
 
-	if((command = object_new(sizeof(*command))) == NULL)
+	if((buffer = string_new(attention)) == NULL)
 		return NULL;
-	command->priority = HCP_NORMAL;
-	command->status = HCS_UNKNOWN;
-	command->attention = string_new(attention);
-	command->timeout = 30000;
-	command->callback = NULL;
-	command->channel = NULL;
-	command->answer = NULL;
-	command->data = NULL;
-	if(command->attention == NULL)
+	if((command = hayes_command_new_static(buffer)) == NULL)
 	{
-		hayes_command_delete(command);
+		string_delete(buffer);
 		return NULL;
 	}
+	command->buffer = buffer;
 	return command;
 }
 
@@ -82,20 +86,53 @@ HayesCommand * hayes_command_new_copy(HayesCommand const * command)
 {
 	HayesCommand * ret;
 
-	if((ret = hayes_command_new(command->attention)) == NULL)
+	/* interned attentions can be shared */
+	if((ret = (command->buffer != NULL)
+				? hayes_command_new(command->attention)
+				: hayes_command_new_static(command->attention))
+			== NULL)
 		return NULL;
 	ret->priority = command->priority;
 	ret->timeout = command->timeout;
 	ret->callback = command->callback;
 	ret->channel = command->channel;
+	ret->handler = command->handler;
+	ret->latency = command->latency;
 	return ret;
 }
 
 
+/* hayes_command_new_static */
+HayesCommand * hayes_command_new_static(char const * attention)
+{
+	HayesCommand * command;
+
+	if(attention == NULL)
+		return NULL;
+	if((command = object_new(sizeof(*command))) == NULL)
+		return NULL;
+	command->priority = HCP_NORMAL;
+	command->status = HCS_UNKNOWN;
+	command->attention = attention;
+	command->buffer = NULL;
+	command->timeout = 30000;
+	command->callback = NULL;
+	command->channel = NULL;
+	command->handler = NULL;
+	command->answer = NULL;
+	command->data = NULL;
+	command->batch = 0;
+	command->next = NULL;
+	command->latency = NULL;
+	command->sent = 0;
+	return command;
+}
+
+
 /* hayes_command_delete */
 void hayes_command_delete(HayesCommand * command)
 {
-	string_delete(command->attention);
+	string_delete(command->buffer);
 	string_delete(command->answer);
 	object_delete(command);
 }
@@ -116,6 +153,13 @@ char const * hayes_command_get_attention(HayesCommand * command)
 }
 
 
+/* hayes_command_get_batch */
+int hayes_command_get_batch(HayesCommand * command)
+{
+	return command->batch;
+}
+
+
 /* hayes_command_get_data */
 void * hayes_command_get_data(HayesCommand * command)
 {
@@ -123,6 +167,20 @@ void * hayes_command_get_data(HayesCommand * command)
 }
 
 
+/* hayes_command_get_handler */
+HayesCommandHandler hayes_command_get_handler(HayesCommand * command)
+{
+	return command->handler;
+}
+
+
+/* hayes_command_get_next */
+HayesCommand * hayes_command_get_next(HayesCommand * command)
+{
+	return command->next;
+}
+
+
 /* hayes_command_get_priority */
 HayesCommandPriority hayes_command_get_priority(HayesCommand * command)
 {
@@ -153,6 +211,13 @@ int hayes_command_is_complete(HayesCommand * command)
 }
 
 
+/* hayes_command_set_batch */
+void hayes_command_set_batch(HayesCommand * command, int batch)
+{
+	command->batch = batch ? 1 : 0;
+}
+
+
 /* hayes_command_set_callback */
 void hayes_command_set_callback(HayesCommand * command,
 		HayesCommandCallback callback, HayesChannel * channel)
@@ -169,6 +234,28 @@ void hayes_command_set_data(HayesCommand * command, void * data)
 }
 
 
+/* hayes_command_set_handler */
+void hayes_command_set_handler(HayesCommand * command,
+		HayesCommandHandler handler)
+{
+	command->handler = handler;
+}
+
+
+/* hayes_command_set_latency */
+void hayes_command_set_latency(HayesCommand * command, HayesLatency * latency)
+{
+	command->latency = latency;
+}
+
+
+/* hayes_command_set_next */
+void hayes_command_set_next(HayesCommand * command, HayesCommand * next)
+{
+	command->next = next;
+}
+
+
 /* hayes_command_set_priority */
 void hayes_command_set_priority(HayesCommand * command,
 		HayesCommandPriority priority)
@@ -216,10 +303,41 @@ int hayes_command_answer_append(HayesCommand * command,
 
 
 /* hayes_command_callback */
+static void _callback_latency(HayesCommand * command);
+
 HayesCommandStatus hayes_command_callback(HayesCommand * command)
 {
 	if(command->callback != NULL)
 		command->status = command->callback(command, command->status,
 				command->channel);
+	if(command->latency != NULL)
+		_callback_latency(command);
 	return command->status;
 }
+
+static void _callback_latency(HayesCommand * command)
+{
+	switch(command->status)
+	{
+		case HCS_ACTIVE:
+			/* the command was just sent */
+			if(command->sent == 0)
+				command->sent = g_get_monotonic_time();
+			return;
+		case HCS_SUCCESS:
+		case HCS_ERROR:
+			if(command->sent != 0)
+				hayeslatency_record(command->latency,
+						g_get_monotonic_time()
+						- command->sent);
+			break;
+		case HCS_TIMEOUT:
+			if(command->sent != 0)
+				hayeslatency_record_timeout(command->latency);
+			break;
+		default:
+			return;
+	}
+	/* only account for the command once */
+	command->latency = NULL;
+}
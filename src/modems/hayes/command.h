@@ -29,6 +29,7 @@
 # define PHONE_MODEM_HAYES_COMMAND_H
 
 # include "channel.h"
+# include "latency.h"
 
 
 /* HayesCommand */
@@ -41,6 +42,8 @@ typedef enum _HayesCommandPriority
 	HCP_HIGHER,
 	HCP_IMMEDIATE
 } HayesCommandPriority;
+#define HCP_LAST HCP_IMMEDIATE
+#define HCP_COUNT (HCP_LAST + 1)
 
 typedef enum _HayesCommandStatus
 {
@@ -60,23 +63,36 @@ typedef struct _HayesCommand HayesCommand;
 typedef HayesCommandStatus (*HayesCommandCallback)(HayesCommand * command,
 		HayesCommandStatus status, HayesChannel * channel);
 
+typedef void (*HayesCommandHandler)(HayesChannel * channel,
+		char const * answer);
+
 
 /* prototypes */
 HayesCommand * hayes_command_new(char const * attention);
 HayesCommand * hayes_command_new_copy(HayesCommand const * command);
+HayesCommand * hayes_command_new_static(char const * attention);
 void hayes_command_delete(HayesCommand * command);
 
 /* accessors */
 char const * hayes_command_get_answer(HayesCommand * command);
 char const * hayes_command_get_attention(HayesCommand * command);
+int hayes_command_get_batch(HayesCommand * command);
 void * hayes_command_get_data(HayesCommand * command);
+HayesCommandHandler hayes_command_get_handler(HayesCommand * command);
+HayesCommand * hayes_command_get_next(HayesCommand * command);
 HayesCommandPriority hayes_command_get_priority(HayesCommand * command);
 HayesCommandStatus hayes_command_get_status(HayesCommand * command);
 unsigned int hayes_command_get_timeout(HayesCommand * command);
 int hayes_command_is_complete(HayesCommand * command);
+void hayes_command_set_batch(HayesCommand * command, int batch);
 void hayes_command_set_callback(HayesCommand * command,
 		HayesCommandCallback callback, HayesChannel * channel);
 void hayes_command_set_data(HayesCommand * command, void * data);
+void hayes_command_set_handler(HayesCommand * command,
+		HayesCommandHandler handler);
+void hayes_command_set_latency(HayesCommand * command,
+		HayesLatency * latency);
+void hayes_command_set_next(HayesCommand * command, HayesCommand * next);
 void hayes_command_set_priority(HayesCommand * command,
 		HayesCommandPriority priority);
 HayesCommandStatus hayes_command_set_status(HayesCommand * command,
@@ -0,0 +1,286 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "concat.h"
+
+
+/* HayesConcat */
+/* private */
+/* types */
+typedef struct _HayesConcatEntry
+{
+	char number[32];
+	unsigned int reference;
+	unsigned int count;
+	unsigned int received;
+	time_t time;				/* 0 if evicted */
+	HayesConcatMessage ** parts;
+	unsigned int * ids;			/* duplicates included */
+	size_t ids_cnt;
+} HayesConcatEntry;
+
+struct _HayesConcat
+{
+	HayesConcatEntry * entries;
+	size_t entries_cnt;
+};
+
+
+/* prototypes */
+static HayesConcatMessage * _hayesconcat_join(HayesConcat * concat,
+		size_t i);
+
+
+/* public */
+/* functions */
+/* hayesconcat_new */
+HayesConcat * hayesconcat_new(void)
+{
+	HayesConcat * concat;
+
+	if((concat = malloc(sizeof(*concat))) == NULL)
+		return NULL;
+	concat->entries = NULL;
+	concat->entries_cnt = 0;
+	return concat;
+}
+
+
+/* hayesconcat_delete */
+void hayesconcat_delete(HayesConcat * concat)
+{
+	size_t i;
+	unsigned int j;
+
+	for(i = 0; i < concat->entries_cnt; i++)
+	{
+		for(j = 0; j < concat->entries[i].count; j++)
+			hayesconcatmessage_delete(concat->entries[i].parts[j]);
+		free(concat->entries[i].parts);
+		free(concat->entries[i].ids);
+	}
+	free(concat->entries);
+	free(concat);
+}
+
+
+/* accessors */
+/* hayesconcat_get_expiry */
+time_t hayesconcat_get_expiry(HayesConcat * concat)
+{
+	time_t ret = 0;
+	size_t i;
+	time_t t;
+
+	/* the messages evicted are due right away */
+	for(i = 0; i < concat->entries_cnt; i++)
+	{
+		t = (concat->entries[i].time != 0)
+			? concat->entries[i].time + HAYESCONCAT_TIMEOUT : 1;
+		if(ret == 0 || t < ret)
+			ret = t;
+	}
+	return ret;
+}
+
+
+/* useful */
+/* hayesconcat_add */
+static HayesConcatEntry * _add_entry(HayesConcat * concat,
+		HayesConcatMessage * part, unsigned int reference,
+		unsigned int count, time_t now);
+
+HayesConcatMessage * hayesconcat_add(HayesConcat * concat,
+		HayesConcatMessage * part, unsigned int reference,
+		unsigned int sequence, unsigned int count, time_t now)
+{
+	HayesConcatEntry * entry;
+	size_t i;
+	unsigned int * p;
+
+	if(count <= 1)
+		return part;
+	if(sequence == 0 || sequence > count)
+	{
+		hayesconcatmessage_delete(part);
+		return NULL;
+	}
+	for(i = 0; i < concat->entries_cnt; i++)
+	{
+		entry = &concat->entries[i];
+		if(entry->reference == reference && entry->count == count
+				&& entry->time != 0
+				&& strcmp(entry->number, part->number) == 0)
+			break;
+	}
+	if(i == concat->entries_cnt)
+	{
+		if((entry = _add_entry(concat, part, reference, count, now))
+				== NULL)
+			/* deliver this part alone rather than losing it */
+			return part;
+		i = entry - concat->entries;
+	}
+	/* every part must be deleted along with the message */
+	if((p = realloc(entry->ids, sizeof(*p) * (entry->ids_cnt + 1)))
+			!= NULL)
+	{
+		entry->ids = p;
+		entry->ids[entry->ids_cnt++] = part->id;
+	}
+	if(entry->parts[sequence - 1] != NULL)
+	{
+		/* this part was already received */
+		hayesconcatmessage_delete(part);
+		return NULL;
+	}
+	entry->parts[sequence - 1] = part;
+	if(++entry->received < entry->count)
+		return NULL;
+	return _hayesconcat_join(concat, i);
+}
+
+static HayesConcatEntry * _add_entry(HayesConcat * concat,
+		HayesConcatMessage * part, unsigned int reference,
+		unsigned int count, time_t now)
+{
+	HayesConcatEntry * p;
+	size_t i;
+	size_t active;
+	HayesConcatEntry * oldest = NULL;
+
+	/* evict the oldest message if there are too many pending */
+	for(i = 0, active = 0; i < concat->entries_cnt; i++)
+	{
+		if(concat->entries[i].time == 0)
+			continue;
+		active++;
+		if(oldest == NULL || concat->entries[i].time < oldest->time)
+			oldest = &concat->entries[i];
+	}
+	if(active >= HAYESCONCAT_CAPACITY && oldest != NULL)
+		oldest->time = 0;
+	if((p = realloc(concat->entries, sizeof(*p)
+					* (concat->entries_cnt + 1))) == NULL)
+		return NULL;
+	concat->entries = p;
+	p = &concat->entries[concat->entries_cnt];
+	if((p->parts = calloc(count, sizeof(*p->parts))) == NULL)
+		return NULL;
+	strcpy(p->number, part->number);
+	p->reference = reference;
+	p->count = count;
+	p->received = 0;
+	p->time = (now != 0) ? now : 1;
+	p->ids = NULL;
+	p->ids_cnt = 0;
+	concat->entries_cnt++;
+	return p;
+}
+
+
+/* hayesconcat_expire */
+HayesConcatMessage * hayesconcat_expire(HayesConcat * concat, time_t now)
+{
+	size_t i;
+
+	for(i = 0; i < concat->entries_cnt; i++)
+		if(concat->entries[i].time == 0
+				|| now - concat->entries[i].time
+				>= HAYESCONCAT_TIMEOUT)
+			/* deliver the parts received so far */
+			return _hayesconcat_join(concat, i);
+	return NULL;
+}
+
+
+/* HayesConcatMessage */
+/* hayesconcatmessage_delete */
+void hayesconcatmessage_delete(HayesConcatMessage * message)
+{
+	if(message == NULL)
+		return;
+	free(message->content);
+	free(message->ids);
+	free(message);
+}
+
+
+/* private */
+/* functions */
+/* hayesconcat_join */
+static HayesConcatMessage * _hayesconcat_join(HayesConcat * concat, size_t i)
+{
+	HayesConcatEntry * entry = &concat->entries[i];
+	HayesConcatMessage * ret = NULL;
+	HayesConcatMessage * part;
+	size_t length = 0;
+	char * p;
+	unsigned int j;
+
+	for(j = 0; j < entry->count; j++)
+		if((part = entry->parts[j]) != NULL)
+		{
+			if(ret == NULL)
+				ret = part;
+			length += part->length;
+		}
+	/* the first part available carries the details of the message */
+	if(ret != NULL && (p = malloc(length + 1)) != NULL)
+	{
+		for(length = 0, j = 0; j < entry->count; j++)
+			if((part = entry->parts[j]) != NULL)
+			{
+				memcpy(&p[length], part->content,
+						part->length);
+				length += part->length;
+			}
+		p[length] = '\0';
+		free(ret->content);
+		ret->content = p;
+		ret->length = length;
+	}
+	if(ret != NULL)
+	{
+		free(ret->ids);
+		ret->ids = entry->ids;
+		ret->ids_cnt = entry->ids_cnt;
+		entry->ids = NULL;
+	}
+	for(j = 0; j < entry->count; j++)
+		if(entry->parts[j] != ret)
+			hayesconcatmessage_delete(entry->parts[j]);
+	free(entry->parts);
+	free(entry->ids);
+	memmove(entry, &entry[1], sizeof(*entry)
+			* (concat->entries_cnt - i - 1));
+	concat->entries_cnt--;
+	return ret;
+}
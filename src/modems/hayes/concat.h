@@ -0,0 +1,79 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+
+#ifndef PHONE_MODEM_HAYES_CONCAT_H
+# define PHONE_MODEM_HAYES_CONCAT_H
+
+# include <sys/types.h>
+# include <time.h>
+# include <Phone/modem.h>
+
+
+/* HayesConcat */
+/* public */
+/* constants */
+# define HAYESCONCAT_CAPACITY	8	/* messages reassembled at once */
+# define HAYESCONCAT_TIMEOUT	600	/* seconds to wait for missing parts */
+
+
+/* types */
+typedef struct _HayesConcat HayesConcat;
+
+typedef struct _HayesConcatMessage
+{
+	unsigned int id;
+	time_t date;
+	ModemMessageFolder folder;
+	ModemMessageStatus status;
+	ModemMessageEncoding encoding;
+	char number[32];
+	char * content;
+	size_t length;
+	unsigned int * ids;		/* of every part, if in parts */
+	size_t ids_cnt;
+} HayesConcatMessage;
+
+
+/* functions */
+HayesConcat * hayesconcat_new(void);
+void hayesconcat_delete(HayesConcat * concat);
+
+/* accessors */
+time_t hayesconcat_get_expiry(HayesConcat * concat);
+
+/* useful */
+HayesConcatMessage * hayesconcat_add(HayesConcat * concat,
+		HayesConcatMessage * part, unsigned int reference,
+		unsigned int sequence, unsigned int count, time_t now);
+HayesConcatMessage * hayesconcat_expire(HayesConcat * concat, time_t now);
+
+
+/* HayesConcatMessage */
+void hayesconcatmessage_delete(HayesConcatMessage * message);
+
+#endif /* PHONE_MODEM_HAYES_CONCAT_H */
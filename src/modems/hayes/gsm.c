@@ -0,0 +1,295 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <stdlib.h>
+#include "gsm.h"
+
+
+/* HayesGSM */
+/* private */
+/* constants */
+#define HAYESGSM_ESCAPE		0x1b
+#define HAYESGSM_NONE		0xffff
+
+/* GSM 03.38 default alphabet to Unicode */
+static const unsigned short _hayesgsm_to_unicode[128] =
+{
+	0x0040, 0x00a3, 0x0024, 0x00a5, 0x00e8, 0x00e9, 0x00f9, 0x00ec,
+	0x00f2, 0x00c7, 0x000a, 0x00d8, 0x00f8, 0x000d, 0x00c5, 0x00e5,
+	0x0394, 0x005f, 0x03a6, 0x0393, 0x039b, 0x03a9, 0x03a0, 0x03a8,
+	0x03a3, 0x0398, 0x039e, 0x00a0, 0x00c6, 0x00e6, 0x00df, 0x00c9,
+	0x0020, 0x0021, 0x0022, 0x0023, 0x00a4, 0x0025, 0x0026, 0x0027,
+	0x0028, 0x0029, 0x002a, 0x002b, 0x002c, 0x002d, 0x002e, 0x002f,
+	0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+	0x0038, 0x0039, 0x003a, 0x003b, 0x003c, 0x003d, 0x003e, 0x003f,
+	0x00a1, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+	0x0048, 0x0049, 0x004a, 0x004b, 0x004c, 0x004d, 0x004e, 0x004f,
+	0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+	0x0058, 0x0059, 0x005a, 0x00c4, 0x00d6, 0x00d1, 0x00dc, 0x00a7,
+	0x00bf, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+	0x0068, 0x0069, 0x006a, 0x006b, 0x006c, 0x006d, 0x006e, 0x006f,
+	0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+	0x0078, 0x0079, 0x007a, 0x00e4, 0x00f6, 0x00f1, 0x00fc, 0x00e0
+};
+
+/* GSM 03.38 extension table (after an escape) to Unicode, 0 if unassigned */
+static const unsigned short _hayesgsm_ext_to_unicode[128] =
+{
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x000c, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x005e, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x007b, 0x007d, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x005c,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x005b, 0x007e, 0x005d, 0x0000,
+	0x007c, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x20ac, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000
+};
+
+/* ISO-8859-1 to GSM 03.38, with the escape in the high byte if required */
+static const unsigned short _hayesgsm_from_latin1[256] =
+{
+	0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+	0xffff, 0xffff, 0x000a, 0xffff, 0x1b0a, 0x000d, 0xffff, 0xffff,
+	0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+	0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+	0x0020, 0x0021, 0x0022, 0x0023, 0x0002, 0x0025, 0x0026, 0x0027,
+	0x0028, 0x0029, 0x002a, 0x002b, 0x002c, 0x002d, 0x002e, 0x002f,
+	0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+	0x0038, 0x0039, 0x003a, 0x003b, 0x003c, 0x003d, 0x003e, 0x003f,
+	0x0000, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+	0x0048, 0x0049, 0x004a, 0x004b, 0x004c, 0x004d, 0x004e, 0x004f,
+	0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+	0x0058, 0x0059, 0x005a, 0x1b3c, 0x1b2f, 0x1b3e, 0x1b14, 0x0011,
+	0xffff, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+	0x0068, 0x0069, 0x006a, 0x006b, 0x006c, 0x006d, 0x006e, 0x006f,
+	0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+	0x0078, 0x0079, 0x007a, 0x1b28, 0x1b40, 0x1b29, 0x1b3d, 0xffff,
+	0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+	0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+	0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+	0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+	0x0020, 0x0040, 0xffff, 0x0001, 0x0024, 0x0003, 0xffff, 0x005f,
+	0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+	0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+	0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0x0060,
+	0xffff, 0xffff, 0xffff, 0xffff, 0x005b, 0x000e, 0x001c, 0x0009,
+	0xffff, 0x001f, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+	0xffff, 0x005d, 0xffff, 0xffff, 0xffff, 0xffff, 0x005c, 0xffff,
+	0x000b, 0xffff, 0xffff, 0xffff, 0x005e, 0xffff, 0xffff, 0x001e,
+	0x007f, 0xffff, 0xffff, 0xffff, 0x007b, 0x000f, 0x001d, 0xffff,
+	0x0004, 0x0005, 0xffff, 0xffff, 0x0007, 0xffff, 0xffff, 0xffff,
+	0xffff, 0x007d, 0x0008, 0xffff, 0xffff, 0xffff, 0x007c, 0xffff,
+	0x000c, 0x0006, 0xffff, 0xffff, 0x007e, 0xffff, 0xffff, 0xffff
+};
+
+
+/* prototypes */
+static unsigned short _hayesgsm_from_unicode(unsigned long u);
+static size_t _hayesgsm_utf8_decode(unsigned char const * text,
+		size_t length, unsigned long * u);
+static size_t _hayesgsm_utf8_encode(unsigned long u, char * buf);
+
+
+/* public */
+/* functions */
+/* hayesgsm_from_utf8 */
+char * hayesgsm_from_utf8(char const * text, size_t length, size_t * septets)
+{
+	unsigned char const * t = (unsigned char const *)text;
+	char * ret;
+	size_t i;
+	size_t j;
+	unsigned long u;
+	unsigned short c;
+
+	/* every character takes at most two septets */
+	if((ret = malloc((length * 2) + 1)) == NULL)
+		return NULL;
+	for(i = 0, j = 0; i < length;)
+	{
+		i += _hayesgsm_utf8_decode(&t[i], length - i, &u);
+		if((c = _hayesgsm_from_unicode(u)) == HAYESGSM_NONE)
+			c = '?';
+		if(c > 0xff)
+			ret[j++] = HAYESGSM_ESCAPE;
+		ret[j++] = c & 0x7f;
+	}
+	ret[j] = '\0';
+	if(septets != NULL)
+		*septets = j;
+	return ret;
+}
+
+
+/* hayesgsm_to_utf8 */
+char * hayesgsm_to_utf8(char const * gsm, size_t length, size_t * len)
+{
+	char * ret;
+	size_t j;
+
+	/* every septet takes at most three bytes */
+	if((ret = malloc((length * 3) + 1)) == NULL)
+		return NULL;
+	j = hayesgsm_to_utf8_buffer(gsm, length, ret);
+	if(len != NULL)
+		*len = j;
+	return ret;
+}
+
+
+/* hayesgsm_to_utf8_buffer */
+size_t hayesgsm_to_utf8_buffer(char const * gsm, size_t length, char * buf)
+{
+	unsigned char const * g = (unsigned char const *)gsm;
+	size_t i;
+	size_t j;
+	unsigned long u;
+
+	/* buf must hold (length * 3) + 1 bytes */
+	for(i = 0, j = 0; i < length; i++)
+	{
+		if(g[i] == HAYESGSM_ESCAPE && i + 1 < length)
+		{
+			/* fallback to the default alphabet if unassigned */
+			if((u = _hayesgsm_ext_to_unicode[g[++i] & 0x7f]) == 0)
+				u = _hayesgsm_to_unicode[g[i] & 0x7f];
+		}
+		else
+			u = _hayesgsm_to_unicode[g[i] & 0x7f];
+		j += _hayesgsm_utf8_encode(u, &buf[j]);
+	}
+	buf[j] = '\0';
+	return j;
+}
+
+
+/* private */
+/* functions */
+/* hayesgsm_from_unicode */
+static unsigned short _hayesgsm_from_unicode(unsigned long u)
+{
+	if(u < sizeof(_hayesgsm_from_latin1) / sizeof(*_hayesgsm_from_latin1))
+		return _hayesgsm_from_latin1[u];
+	switch(u)
+	{
+		/* greek capital letters */
+		case 0x0393:
+			return 0x13;
+		case 0x0394:
+			return 0x10;
+		case 0x0398:
+			return 0x19;
+		case 0x039b:
+			return 0x14;
+		case 0x039e:
+			return 0x1a;
+		case 0x03a0:
+			return 0x16;
+		case 0x03a3:
+			return 0x18;
+		case 0x03a6:
+			return 0x12;
+		case 0x03a8:
+			return 0x17;
+		case 0x03a9:
+			return 0x15;
+		/* euro sign */
+		case 0x20ac:
+			return (HAYESGSM_ESCAPE << 8) | 0x65;
+	}
+	return HAYESGSM_NONE;
+}
+
+
+/* hayesgsm_utf8_decode */
+static size_t _hayesgsm_utf8_decode(unsigned char const * text,
+		size_t length, unsigned long * u)
+{
+	size_t len;
+	size_t i;
+
+	if(text[0] < 0x80)
+	{
+		*u = text[0];
+		return 1;
+	}
+	else if((text[0] & 0xe0) == 0xc0)
+	{
+		*u = text[0] & 0x1f;
+		len = 2;
+	}
+	else if((text[0] & 0xf0) == 0xe0)
+	{
+		*u = text[0] & 0x0f;
+		len = 3;
+	}
+	else if((text[0] & 0xf8) == 0xf0)
+	{
+		*u = text[0] & 0x07;
+		len = 4;
+	}
+	else
+		len = 0;
+	for(i = 1; i < len && i < length && (text[i] & 0xc0) == 0x80; i++)
+		*u = (*u << 6) | (text[i] & 0x3f);
+	if(len == 0 || i != len)
+	{
+		/* invalid UTF-8: assume ISO-8859-1 instead */
+		*u = text[0];
+		return 1;
+	}
+	return len;
+}
+
+
+/* hayesgsm_utf8_encode */
+static size_t _hayesgsm_utf8_encode(unsigned long u, char * buf)
+{
+	if(u < 0x80)
+	{
+		buf[0] = u;
+		return 1;
+	}
+	if(u < 0x800)
+	{
+		buf[0] = 0xc0 | (u >> 6);
+		buf[1] = 0x80 | (u & 0x3f);
+		return 2;
+	}
+	buf[0] = 0xe0 | (u >> 12);
+	buf[1] = 0x80 | ((u >> 6) & 0x3f);
+	buf[2] = 0x80 | (u & 0x3f);
+	return 3;
+}
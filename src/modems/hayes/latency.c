@@ -0,0 +1,173 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include "latency.h"
+
+/* constants */
+#define HAYESLATENCY_BACKOFF	4	/* doublings after consecutive timeouts */
+#define HAYESLATENCY_FACTOR	4	/* timeout, relative to the 99th pct */
+
+
+/* HayesLatency */
+/* private */
+/* prototypes */
+static unsigned int _hayeslatency_bucket(gint64 elapsed);
+static gint64 _hayeslatency_bucket_max(unsigned int bucket);
+
+
+/* public */
+/* functions */
+/* hayeslatency_init */
+void hayeslatency_init(HayesLatency * latency)
+{
+	memset(latency, 0, sizeof(*latency));
+}
+
+
+/* accessors */
+/* hayeslatency_get_percentile */
+gint64 hayeslatency_get_percentile(HayesLatency * latency,
+		unsigned int percent)
+{
+	unsigned int rank;
+	unsigned int cnt = 0;
+	unsigned int i;
+
+	if(latency->count == 0)
+		return 0;
+	rank = (latency->count * percent + 99) / 100;
+	for(i = 0; i < HAYESLATENCY_BUCKETS - 1; i++)
+		if((cnt += latency->buckets[i]) >= rank)
+			break;
+	/* the upper bound of the bucket, as precise as the maximum */
+	return MIN(_hayeslatency_bucket_max(i), latency->max);
+}
+
+
+/* hayeslatency_get_timeout */
+unsigned int hayeslatency_get_timeout(HayesLatency * latency,
+		unsigned int timeout, unsigned int floor, unsigned int ceiling)
+{
+	gint64 t;
+
+	if(latency->count >= HAYESLATENCY_SAMPLES)
+	{
+		t = hayeslatency_get_percentile(latency, 99)
+			* HAYESLATENCY_FACTOR / 1000;
+		timeout = MIN(t, ceiling);
+	}
+	/* the modem may be slower than observed so far */
+	timeout <<= MIN(latency->backoff, HAYESLATENCY_BACKOFF);
+	latency->timeout = CLAMP(timeout, floor, ceiling);
+	return latency->timeout;
+}
+
+
+/* hayeslatency_set_name */
+void hayeslatency_set_name(HayesLatency * latency, char const * attention)
+{
+	size_t len = 0;
+
+	/* keep the name of the command, never its arguments (eg numbers) */
+	if(strncmp(attention, "AT", 2) == 0)
+		len = 2;
+	if(attention[len] == '+')
+		for(len++; isalnum((unsigned char)attention[len]); len++);
+	else
+	{
+		/* basic commands are a single letter */
+		if(attention[len] == '&')
+			len++;
+		if(isalpha((unsigned char)attention[len]))
+			len++;
+	}
+	/* queries are told apart */
+	if(attention[len] == '?')
+		len++;
+	snprintf(latency->name, sizeof(latency->name), "%.*s", (int)len,
+			attention);
+}
+
+
+/* useful */
+/* hayeslatency_record */
+void hayeslatency_record(HayesLatency * latency, gint64 elapsed)
+{
+	unsigned int i;
+
+	if(elapsed < 0)
+		elapsed = 0;
+	/* decay the histogram to follow changes over time */
+	if(latency->count >= HAYESLATENCY_WINDOW)
+		for(latency->count = 0, i = 0; i < HAYESLATENCY_BUCKETS; i++)
+			latency->count += (latency->buckets[i] /= 2);
+	latency->buckets[_hayeslatency_bucket(elapsed)]++;
+	latency->count++;
+	latency->max = MAX(latency->max, elapsed);
+	latency->answers++;
+	latency->backoff = 0;
+}
+
+
+/* hayeslatency_record_timeout */
+void hayeslatency_record_timeout(HayesLatency * latency)
+{
+	latency->timeouts++;
+	latency->backoff++;
+}
+
+
+/* private */
+/* functions */
+/* hayeslatency_bucket */
+static unsigned int _hayeslatency_bucket(gint64 elapsed)
+{
+	unsigned int e;
+	unsigned int ret;
+
+	if(elapsed < 4)
+		return elapsed;
+	/* the exponent and the two most significant bits after it */
+	for(e = 2; e < 63 && (elapsed >> (e + 1)) != 0; e++);
+	ret = (e - 1) * 4 + ((elapsed >> (e - 2)) & 0x3);
+	return MIN(ret, HAYESLATENCY_BUCKETS - 1);
+}
+
+
+/* hayeslatency_bucket_max */
+static gint64 _hayeslatency_bucket_max(unsigned int bucket)
+{
+	unsigned int e;
+
+	if(bucket < 4)
+		return bucket;
+	e = bucket / 4 + 1;
+	return ((gint64)(4 + (bucket % 4) + 1) << (e - 2)) - 1;
+}
@@ -0,0 +1,74 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#ifndef PHONE_MODEM_HAYES_LATENCY_H
+# define PHONE_MODEM_HAYES_LATENCY_H
+
+# include <glib.h>
+
+
+/* HayesLatency */
+/* public */
+/* constants */
+# define HAYESLATENCY_BUCKETS	108	/* up to 2^27us, 4 per power of 2 */
+# define HAYESLATENCY_SAMPLES	16	/* before adapting the timeout */
+# define HAYESLATENCY_WINDOW	256	/* samples before decaying */
+
+
+/* types */
+typedef struct _HayesLatency
+{
+	char name[16];
+
+	/* histogram of the answers */
+	unsigned int buckets[HAYESLATENCY_BUCKETS];
+	unsigned int count;
+	gint64 max;
+
+	/* totals */
+	unsigned long answers;
+	unsigned long timeouts;
+	unsigned int backoff;
+	unsigned int timeout;		/* the last one derived, in ms */
+} HayesLatency;
+
+
+/* functions */
+void hayeslatency_init(HayesLatency * latency);
+
+/* accessors */
+gint64 hayeslatency_get_percentile(HayesLatency * latency,
+		unsigned int percent);
+unsigned int hayeslatency_get_timeout(HayesLatency * latency,
+		unsigned int timeout, unsigned int floor, unsigned int ceiling);
+void hayeslatency_set_name(HayesLatency * latency, char const * attention);
+
+/* useful */
+void hayeslatency_record(HayesLatency * latency, gint64 elapsed);
+void hayeslatency_record_timeout(HayesLatency * latency);
+
+#endif /* PHONE_MODEM_HAYES_LATENCY_H */
@@ -25,11 +25,12 @@
 
 
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <glib.h>
 #include "common.h"
+#include "gsm.h"
 #include "pdu.h"
 
 
@@ -42,58 +43,99 @@ static char * _hayespdu_convert_number_to_address(char const * number);
 /* public */
 /* functions */
 /* hayespdu_encode */
-static char * _encode_text_to_data(char const * text, size_t length);
-static char * _encode_text_to_sept(char const * text, size_t length);
+static char * _encode_part(char const * number, unsigned int flags,
+		int septets, char const * text, size_t length,
+		unsigned char const * header);
+static char * _encode_pdu(char const * number, unsigned int flags,
+		int septets, int udhi, size_t udl, unsigned char const * ud,
+		size_t size);
+static char * _encode_text(ModemMessageEncoding encoding, size_t * length,
+		char const * content, int * septets);
 
 char * hayespdu_encode(char const * number, ModemMessageEncoding encoding,
 		size_t length, char const * content, unsigned int flags)
+{
+	char * ret;
+	char * p;
+	int septets;
+
+	if(!hayescommon_number_is_valid(number))
+		return NULL;
+	if((p = _encode_text(encoding, &length, content, &septets)) == NULL)
+		return NULL;
+	ret = _encode_part(number, flags, septets, p, length, NULL);
+	free(p);
+	return ret;
+}
+
+static char * _encode_part(char const * number, unsigned int flags,
+		int septets, char const * text, size_t length,
+		unsigned char const * header)
+{
+	char * ret;
+	size_t hdr = (header != NULL) ? header[0] + 1 : 0;
+	size_t skip = septets ? (hdr * 8 + 6) / 7 : hdr;
+	char * s;
+	unsigned char * buf;
+	size_t size;
+
+	if(septets)
+	{
+		/* the header and its fill bits are packed as zeroes first */
+		if((s = malloc(skip + length + 1)) == NULL)
+			return NULL;
+		memset(s, 0, skip);
+		memcpy(&s[skip], text, length);
+		size = HAYESPDU_SEPTETS_SIZE(skip + length);
+		if((buf = malloc(size + 1)) != NULL)
+			hayespdu_septets_pack(buf, s, skip + length);
+		free(s);
+	}
+	else
+	{
+		size = hdr + length;
+		if((buf = malloc(size + 1)) != NULL)
+			memcpy(&buf[hdr], text, length);
+	}
+	if(buf == NULL)
+		return NULL;
+	if(hdr != 0)
+		memcpy(buf, header, hdr);
+	ret = _encode_pdu(number, flags, septets, hdr != 0, skip + length, buf,
+			size);
+	free(buf);
+	return ret;
+}
+
+static char * _encode_pdu(char const * number, unsigned int flags,
+		int septets, int udhi, size_t udl, unsigned char const * ud,
+		size_t size)
 {
 	char * ret = NULL;
 	char * addr;
 	char * data;
-	char * p = NULL;
 	size_t len;
 	char const * smsc = "";
-	char const prefix[] = "1100";
+	char prefix[] = "X100";
 	char const pid[] = "00";
 	char dcs[] = "0X";
 	char const vp[] = "AA";
 
-	if(!hayescommon_number_is_valid(number))
+	prefix[0] = udhi ? '5' : '1';
+	dcs[1] = septets ? '0' : '4';
+	if((data = malloc((size * 2) + 1)) == NULL)
 		return NULL;
-	switch(encoding)
-	{
-		case MODEM_MESSAGE_ENCODING_UTF8:
-			/* FIXME really support UTF-8 when necessary */
-			p = g_convert(content, length, "ISO-8859-1", "UTF-8",
-					NULL, NULL, NULL);
-			if(p == NULL)
-				return NULL;
-			content = p;
-			length = strlen(content);
-			/* fallthrough */
-		case MODEM_MESSAGE_ENCODING_ASCII:
-			dcs[1] = '0';
-			data = _encode_text_to_sept(content, length);
-			break;
-		case MODEM_MESSAGE_ENCODING_DATA:
-			dcs[1] = '4';
-			data = _encode_text_to_data(content, length);
-			break;
-		default:
-			return NULL;
-	}
+	hayespdu_hex_encode(data, ud, size);
 	addr = _hayespdu_convert_number_to_address(number);
 	len = 2 + sizeof(prefix) + 2 + strlen((addr != NULL) ? addr : "")
-		+ sizeof(pid) + sizeof(dcs) + sizeof(vp) + 2
-		+ strlen((data != NULL) ? data : "");
+		+ sizeof(pid) + sizeof(dcs) + sizeof(vp) + 2 + strlen(data);
 	if(addr != NULL && (ret = malloc(len)) != NULL)
 	{
 		if(flags & HAYESPDU_FLAG_WANT_SMSC)
 			smsc = "00";
 		if(snprintf(ret, len, "%s%s%02zX%s%s%s%s%02zX%s", smsc, prefix,
 					strlen(number), addr, pid, dcs, vp,
-					length, data) >= (int)len)
+					udl, data) >= (int)len)
 		{
 			free(ret);
 			ret = NULL;
@@ -101,62 +143,281 @@ char * hayespdu_encode(char const * number, ModemMessageEncoding encoding,
 	}
 	free(data);
 	free(addr);
-	free(p);
 	return ret;
 }
 
-static char * _encode_text_to_data(char const * text, size_t length)
+static char * _encode_text(ModemMessageEncoding encoding, size_t * length,
+		char const * content, int * septets)
 {
-	char const tab[16] = "0123456789ABCDEF";
-	char * buf;
-	size_t i;
+	char * ret;
 
-	if((buf = malloc((length * 2) + 1)) == NULL)
-		return NULL;
-	for(i = 0; i < length; i++)
+	switch(encoding)
 	{
-		buf[(i * 2) + 1] = tab[text[i] & 0x0f];
-		buf[i * 2] = tab[((text[i] & 0xf0) >> 4) & 0x0f];
+		case MODEM_MESSAGE_ENCODING_ASCII:
+		case MODEM_MESSAGE_ENCODING_UTF8:
+			/* FIXME use UCS-2 when necessary */
+			*septets = 1;
+			return hayesgsm_from_utf8(content, *length, length);
+		case MODEM_MESSAGE_ENCODING_DATA:
+			*septets = 0;
+			if((ret = malloc(*length + 1)) == NULL)
+				return NULL;
+			memcpy(ret, content, *length);
+			return ret;
+		default:
+			return NULL;
 	}
-	buf[i * 2] = '\0';
-	return buf;
 }
 
-/* this function is heavily inspired from gsmd, (c) 2007 OpenMoko, Inc. */
-static char * _encode_text_to_sept(char const * text, size_t length)
+
+/* hayespdu_encode_concatenated */
+static size_t _concatenated_split(char const * text, size_t length,
+		size_t max, int septets);
+
+char ** hayespdu_encode_concatenated(char const * number,
+		ModemMessageEncoding encoding, size_t length,
+		char const * content, unsigned int flags,
+		unsigned int reference, size_t * count)
 {
-	char const tab[16] = "0123456789ABCDEF";
-	unsigned char const * t = (unsigned char const *)text;
-	char * buf;
+	char ** ret;
 	char * p;
+	int septets;
+	size_t max;
+	size_t parts;
 	size_t i;
-	unsigned char ch1;
-	unsigned char ch2;
-	int shift = 0;
+	size_t n;
+	size_t pos;
+	unsigned char header[6] = { 5, 0x00, 3, 0, 0, 0 };
 
-	if((buf = malloc((length * 2) + 1)) == NULL)
+	if(!hayescommon_number_is_valid(number))
+		return NULL;
+	if((p = _encode_text(encoding, &length, content, &septets)) == NULL)
+		return NULL;
+	/* count the parts */
+	if(length <= (septets ? HAYESPDU_SEPTETS_MAX : HAYESPDU_OCTETS_MAX))
+		parts = 1;
+	else
+	{
+		max = septets ? HAYESPDU_SEPTETS_MAX - 7
+			: HAYESPDU_OCTETS_MAX - sizeof(header);
+		for(parts = 0, pos = 0; pos < length; parts++)
+			pos += _concatenated_split(&p[pos], length - pos, max,
+					septets);
+	}
+	if(parts > HAYESPDU_PARTS_MAX
+			|| (ret = malloc(sizeof(*ret) * (parts + 1))) == NULL)
+	{
+		free(p);
 		return NULL;
-	p = buf;
-	for(i = 0; i < length; i++)
+	}
+	if(parts == 1)
+		ret[0] = _encode_part(number, flags, septets, p, length, NULL);
+	else
 	{
-		ch1 = t[i] & 0x7f;
-		ch1 = (ch1 >> shift);
-		ch2 = t[i + 1] & 0x7f;
-		ch2 = ch2 << (7 - shift);
-		ch1 = ch1 | ch2;
-		*(p++) = tab[(ch1 & 0xf0) >> 4];
-		*(p++) = tab[ch1 & 0x0f];
-		if(++shift == 7)
+		header[3] = reference & 0xff;
+		header[4] = parts;
+		for(i = 0, pos = 0; i < parts; i++, pos += n)
 		{
-			shift = 0;
-			i++;
+			n = _concatenated_split(&p[pos], length - pos, max,
+					septets);
+			header[5] = i + 1;
+			if((ret[i] = _encode_part(number, flags, septets,
+							&p[pos], n, header))
+					== NULL)
+				break;
 		}
 	}
-	*p = '\0';
-	return buf;
+	free(p);
+	if(ret[0] == NULL || (parts > 1 && i != parts))
+	{
+		for(i = 0; i < parts && ret[i] != NULL; i++)
+			free(ret[i]);
+		free(ret);
+		return NULL;
+	}
+	ret[parts] = NULL;
+	*count = parts;
+	return ret;
+}
+
+static size_t _concatenated_split(char const * text, size_t length,
+		size_t max, int septets)
+{
+	size_t i;
+
+	if(length <= max)
+		return length;
+	if(!septets)
+		return max;
+	/* do not split the escape sequences */
+	for(i = 0; i < max; i++)
+		if(text[i] == HAYESPDU_SEPTET_ESCAPE)
+			i++;
+	return (i > max) ? max - 1 : max;
+}
+
+
+/* hayespdu_septets_pack */
+/* eight septets fit exactly in seven octets, packed from the least significant
+ * bit: they are assembled in a 64-bit word and stored at once */
+static void _septets_store(unsigned char * buf, uint64_t w, size_t size);
+
+size_t hayespdu_septets_pack(unsigned char * buf, char const * septets,
+		size_t count)
+{
+	unsigned char const * s = (unsigned char const *)septets;
+	size_t ret = HAYESPDU_SEPTETS_SIZE(count);
+	uint64_t w;
+	size_t i;
+
+	for(; count >= 8; count -= 8, s += 8, buf += 7)
+	{
+		w = (uint64_t)(s[0] & 0x7f)
+			| (uint64_t)(s[1] & 0x7f) << 7
+			| (uint64_t)(s[2] & 0x7f) << 14
+			| (uint64_t)(s[3] & 0x7f) << 21
+			| (uint64_t)(s[4] & 0x7f) << 28
+			| (uint64_t)(s[5] & 0x7f) << 35
+			| (uint64_t)(s[6] & 0x7f) << 42
+			| (uint64_t)(s[7] & 0x7f) << 49;
+		_septets_store(buf, w, 7);
+	}
+	for(w = 0, i = 0; i < count; i++)
+		w |= (uint64_t)(s[i] & 0x7f) << (i * 7);
+	_septets_store(buf, w, HAYESPDU_SEPTETS_SIZE(count));
+	return ret;
+}
+
+static void _septets_store(unsigned char * buf, uint64_t w, size_t size)
+{
+	size_t i;
+
+	for(i = 0; i < size; i++)
+		buf[i] = (w >> (i * 8)) & 0xff;
+}
+
+
+/* hayespdu_septets_unpack */
+static uint64_t _septets_load(unsigned char const * buf, size_t size);
+
+size_t hayespdu_septets_unpack(char * septets, unsigned char const * buf,
+		size_t count)
+{
+	size_t ret = count;
+	uint64_t w;
+	size_t i;
+
+	for(; count >= 8; count -= 8, septets += 8, buf += 7)
+	{
+		w = _septets_load(buf, 7);
+		septets[0] = w & 0x7f;
+		septets[1] = (w >> 7) & 0x7f;
+		septets[2] = (w >> 14) & 0x7f;
+		septets[3] = (w >> 21) & 0x7f;
+		septets[4] = (w >> 28) & 0x7f;
+		septets[5] = (w >> 35) & 0x7f;
+		septets[6] = (w >> 42) & 0x7f;
+		septets[7] = (w >> 49) & 0x7f;
+	}
+	w = _septets_load(buf, HAYESPDU_SEPTETS_SIZE(count));
+	for(i = 0; i < count; i++)
+		septets[i] = (w >> (i * 7)) & 0x7f;
+	return ret;
+}
+
+static uint64_t _septets_load(unsigned char const * buf, size_t size)
+{
+	uint64_t w = 0;
+	size_t i;
+
+	for(i = 0; i < size; i++)
+		w |= (uint64_t)buf[i] << (i * 8);
+	return w;
+}
+
+
+/* hayespdu_hex_encode */
+void hayespdu_hex_encode(char * hex, unsigned char const * buf, size_t size)
+{
+	char const tab[16] = "0123456789ABCDEF";
+	size_t i;
+
+	for(i = 0; i < size; i++)
+	{
+		hex[i * 2] = tab[buf[i] >> 4];
+		hex[(i * 2) + 1] = tab[buf[i] & 0x0f];
+	}
+	hex[i * 2] = '\0';
 }
 
 
+/* hayespdu_hex_decode */
+size_t hayespdu_hex_decode(unsigned char * buf, char const * hex,
+		size_t size)
+{
+	/* nibble values plus one, zero for invalid characters */
+	static const unsigned char tab[256] =
+	{
+		['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+		['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+		['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15,
+		['F'] = 16,
+		['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15,
+		['f'] = 16
+	};
+	unsigned char const * h = (unsigned char const *)hex;
+	unsigned char hi;
+	unsigned char lo;
+	size_t i;
+
+	/* stops on the first invalid character, including the terminator */
+	for(i = 0; i < size; i++, h += 2)
+	{
+		if((hi = tab[h[0]]) == 0 || (lo = tab[h[1]]) == 0)
+			break;
+		buf[i] = ((hi - 1) << 4) | (lo - 1);
+	}
+	return i;
+}
+
+
+
+/* hayespdu_header_concatenated */
+int hayespdu_header_concatenated(unsigned char const * header, size_t size,
+		unsigned int * reference, unsigned int * sequence,
+		unsigned int * count)
+{
+	size_t i;
+	size_t len;
+
+	/* look for the concatenation information element */
+	for(i = 0; i + 2 <= size; i += 2 + len)
+	{
+		if(i + 2 + (len = header[i + 1]) > size)
+			break;
+		if(header[i] == 0x00 && len == 3)
+		{
+			/* 8-bit reference number */
+			*reference = header[i + 2];
+			*count = header[i + 3];
+			*sequence = header[i + 4];
+		}
+		else if(header[i] == 0x08 && len == 4)
+		{
+			/* 16-bit reference number */
+			*reference = (header[i + 2] << 8) | header[i + 3];
+			*count = header[i + 4];
+			*sequence = header[i + 5];
+		}
+		else
+			continue;
+		if(*count == 0 || *sequence == 0 || *sequence > *count)
+			return -1;
+		return 0;
+	}
+	return -1;
+}
+
 /* private */
 /* functions */
 /* hayespdu_convert_number_to_address */
@@ -33,6 +33,17 @@
 
 /* HayesPDU */
 /* public */
+/* constants */
+/* user data in a single message */
+# define HAYESPDU_OCTETS_MAX		140
+# define HAYESPDU_SEPTETS_MAX		160
+# define HAYESPDU_PARTS_MAX		255
+# define HAYESPDU_SEPTET_ESCAPE		0x1b
+
+/* octets needed to pack a given number of septets */
+# define HAYESPDU_SEPTETS_SIZE(count)	((((count) * 7) + 7) / 8)
+
+
 /* types */
 typedef enum _HayesPDUFlag
 {
@@ -43,5 +54,25 @@ typedef enum _HayesPDUFlag
 /* functions */
 char * hayespdu_encode(char const * number, ModemMessageEncoding encoding,
 		size_t length, char const * content, unsigned int flags);
+char ** hayespdu_encode_concatenated(char const * number,
+		ModemMessageEncoding encoding, size_t length,
+		char const * content, unsigned int flags,
+		unsigned int reference, size_t * count);
+
+/* headers */
+int hayespdu_header_concatenated(unsigned char const * header, size_t size,
+		unsigned int * reference, unsigned int * sequence,
+		unsigned int * count);
+
+/* septets */
+size_t hayespdu_septets_pack(unsigned char * buf, char const * septets,
+		size_t count);
+size_t hayespdu_septets_unpack(char * septets, unsigned char const * buf,
+		size_t count);
+
+/* hexadecimal */
+void hayespdu_hex_encode(char * hex, unsigned char const * buf, size_t size);
+size_t hayespdu_hex_decode(unsigned char * buf, char const * hex,
+		size_t size);
 
 #endif /* PHONE_MODEM_HAYES_PDU_H */
@@ -44,7 +44,8 @@ static HayesQuirks _hayes_quirks[] =
 	{ "Nokia", "Nokia N9",
 		HAYES_QUIRK_WANT_SMSC_IN_PDU				},
 	{ "Sierra Wireless Inc.", "Sierra Wireless EM7345 4G LTE",
-		HAYES_QUIRK_WANT_SMSC_IN_PDU				},
+		HAYES_QUIRK_WANT_SMSC_IN_PDU
+			| HAYES_QUIRK_BATCH				},
 	{ "Openmoko", "\"Neo1973 Embedded GSM Modem\"",
 		HAYES_QUIRK_WANT_SMSC_IN_PDU
 			| HAYES_QUIRK_CONNECTED_LINE_DISABLED
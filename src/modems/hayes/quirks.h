@@ -39,7 +39,8 @@ typedef enum _HayesQuirk
 	HAYES_QUIRK_CPIN_SLOW			= 0x04,
 	HAYES_QUIRK_CONNECTED_LINE_DISABLED	= 0x08,
 	HAYES_QUIRK_WANT_SMSC_IN_PDU		= 0x10,
-	HAYES_QUIRK_REPEAT_ON_UNKNOWN_ERROR	= 0x20
+	HAYES_QUIRK_REPEAT_ON_UNKNOWN_ERROR	= 0x20,
+	HAYES_QUIRK_BATCH			= 0x40
 } HayesQuirk;
 
 typedef const struct _HayesQuirks
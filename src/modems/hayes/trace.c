@@ -0,0 +1,458 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "trace.h"
+
+/* constants */
+#define HAYESTRACE_DELAY	100	/* longest time before writing, in ms */
+
+
+/* HayesTrace */
+/* private */
+/* types */
+struct _HayesTrace
+{
+	/* file */
+	char * filename;
+	char * rotated;
+	size_t rotate;
+	size_t written;
+	FILE * fp;
+
+	/* writer thread */
+	GThread * thread;
+	GMutex mutex;
+	GCond cond;
+	gint running;
+	gint waiting;
+
+	/* ring buffer, only written to from the main loop */
+	gint head;
+	gint tail;
+	guint32 dropped;
+	char ring[HAYESTRACE_RING_SIZE];
+};
+
+
+/* prototypes */
+static int _hayestrace_dropped(HayesTrace * trace, gint64 timestamp,
+		unsigned int channel);
+static int _hayestrace_open(HayesTrace * trace);
+static int _hayestrace_push(HayesTrace * trace, gint64 timestamp,
+		HayesTraceDirection direction, unsigned int channel,
+		char const * buf, size_t size);
+static size_t _hayestrace_drain(HayesTrace * trace);
+
+/* encoding */
+static guint32 _hayestrace_decode32(unsigned char const * buf);
+static guint64 _hayestrace_decode64(unsigned char const * buf);
+static void _hayestrace_encode32(unsigned char * buf, guint32 u);
+static void _hayestrace_encode64(unsigned char * buf, guint64 u);
+
+/* callbacks */
+static gpointer _hayestrace_on_thread(gpointer data);
+
+
+/* public */
+/* functions */
+/* hayestrace_new */
+HayesTrace * hayestrace_new(char const * filename, size_t rotate)
+{
+	HayesTrace * trace;
+	size_t len = strlen(filename) + 3;
+
+	if((trace = malloc(sizeof(*trace))) == NULL)
+		return NULL;
+	memset(trace, 0, sizeof(*trace));
+	trace->rotate = rotate;
+	if((trace->filename = strdup(filename)) == NULL
+			|| (trace->rotated = malloc(len)) == NULL)
+	{
+		hayestrace_delete(trace);
+		return NULL;
+	}
+	snprintf(trace->rotated, len, "%s.1", filename);
+	if(_hayestrace_open(trace) != 0)
+	{
+		hayestrace_delete(trace);
+		return NULL;
+	}
+	g_mutex_init(&trace->mutex);
+	g_cond_init(&trace->cond);
+	g_atomic_int_set(&trace->running, 1);
+	if((trace->thread = g_thread_try_new("trace", _hayestrace_on_thread,
+					trace, NULL)) == NULL)
+	{
+		errno = EAGAIN;
+		hayestrace_delete(trace);
+		return NULL;
+	}
+	return trace;
+}
+
+
+/* hayestrace_delete */
+void hayestrace_delete(HayesTrace * trace)
+{
+	if(trace->thread != NULL)
+	{
+		/* the writer thread drains the ring buffer before leaving */
+		g_mutex_lock(&trace->mutex);
+		g_atomic_int_set(&trace->running, 0);
+		g_cond_signal(&trace->cond);
+		g_mutex_unlock(&trace->mutex);
+		g_thread_join(trace->thread);
+		g_cond_clear(&trace->cond);
+		g_mutex_clear(&trace->mutex);
+		/* report the last records lost, if any */
+		if(_hayestrace_dropped(trace, g_get_monotonic_time(), 0) == 0)
+			_hayestrace_drain(trace);
+	}
+	if(trace->fp != NULL)
+		fclose(trace->fp);
+	free(trace->rotated);
+	free(trace->filename);
+	free(trace);
+}
+
+
+/* useful */
+/* hayestrace_record */
+int hayestrace_record(HayesTrace * trace, HayesTraceDirection direction,
+		unsigned int channel, char const * buf, size_t size)
+{
+	gint64 timestamp = g_get_monotonic_time();
+
+	/* report the records lost first */
+	if(_hayestrace_dropped(trace, timestamp, channel) != 0
+			|| _hayestrace_push(trace, timestamp, direction,
+				channel, buf, size) != 0)
+	{
+		trace->dropped++;
+		return -1;
+	}
+	return 0;
+}
+
+
+/* decoding */
+/* hayestrace_read_header */
+int hayestrace_read_header(FILE * fp, HayesTraceHeader * header)
+{
+	unsigned char buf[HAYESTRACE_HEADER_SIZE];
+
+	if(fread(buf, sizeof(buf), 1, fp) != 1)
+	{
+		if(!ferror(fp))
+			errno = EINVAL;
+		return -1;
+	}
+	if(memcmp(buf, HAYESTRACE_MAGIC, sizeof(HAYESTRACE_MAGIC)) != 0
+			|| (header->version = _hayestrace_decode32(&buf[8]))
+			!= HAYESTRACE_VERSION)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	header->realtime = _hayestrace_decode64(&buf[16]);
+	header->monotonic = _hayestrace_decode64(&buf[24]);
+	return 0;
+}
+
+
+/* hayestrace_read_record */
+int hayestrace_read_record(FILE * fp, HayesTraceRecord * record,
+		char ** buf, size_t * size)
+{
+	unsigned char header[HAYESTRACE_RECORD_SIZE];
+	size_t cnt;
+	char * p;
+
+	if((cnt = fread(header, 1, sizeof(header), fp)) == 0 && feof(fp))
+		return 1;
+	if(cnt != sizeof(header))
+	{
+		if(!ferror(fp))
+			errno = EINVAL;
+		return -1;
+	}
+	record->timestamp = _hayestrace_decode64(header);
+	record->size = _hayestrace_decode32(&header[8]);
+	record->direction = header[12];
+	record->channel = header[13];
+	if(record->size + 1 > *size)
+	{
+		if((p = realloc(*buf, record->size + 1)) == NULL)
+			return -1;
+		*buf = p;
+		*size = record->size + 1;
+	}
+	if(record->size > 0 && fread(*buf, record->size, 1, fp) != 1)
+	{
+		if(!ferror(fp))
+			errno = EINVAL;
+		return -1;
+	}
+	(*buf)[record->size] = '\0';
+	return 0;
+}
+
+
+/* private */
+/* functions */
+/* hayestrace_dropped */
+static int _hayestrace_dropped(HayesTrace * trace, gint64 timestamp,
+		unsigned int channel)
+{
+	unsigned char buf[4];
+
+	if(trace->dropped == 0)
+		return 0;
+	_hayestrace_encode32(buf, trace->dropped);
+	if(_hayestrace_push(trace, timestamp, HAYESTRACE_DIRECTION_DROPPED,
+				channel, (char const *)buf, sizeof(buf)) != 0)
+		return -1;
+	trace->dropped = 0;
+	return 0;
+}
+
+
+/* hayestrace_open */
+static int _hayestrace_open(HayesTrace * trace)
+{
+	unsigned char buf[HAYESTRACE_HEADER_SIZE];
+
+	memset(buf, 0, sizeof(buf));
+	memcpy(buf, HAYESTRACE_MAGIC, sizeof(HAYESTRACE_MAGIC));
+	_hayestrace_encode32(&buf[8], HAYESTRACE_VERSION);
+	_hayestrace_encode64(&buf[16], g_get_real_time());
+	_hayestrace_encode64(&buf[24], g_get_monotonic_time());
+	if((trace->fp = fopen(trace->filename, "w")) == NULL)
+		return -1;
+	if(fwrite(buf, sizeof(buf), 1, trace->fp) != 1)
+	{
+		fclose(trace->fp);
+		trace->fp = NULL;
+		return -1;
+	}
+	trace->written = sizeof(buf);
+	return 0;
+}
+
+
+/* hayestrace_push */
+static size_t _push_copy(HayesTrace * trace, size_t head, char const * buf,
+		size_t size);
+
+static int _hayestrace_push(HayesTrace * trace, gint64 timestamp,
+		HayesTraceDirection direction, unsigned int channel,
+		char const * buf, size_t size)
+{
+	const size_t mask = sizeof(trace->ring) - 1;
+	size_t head = g_atomic_int_get(&trace->head);
+	size_t tail = g_atomic_int_get(&trace->tail);
+	size_t used = (head - tail) & mask;
+	unsigned char header[HAYESTRACE_RECORD_SIZE];
+
+	/* one byte is always kept free */
+	if(sizeof(header) + size > mask - used)
+		return -1;
+	_hayestrace_encode64(header, timestamp);
+	_hayestrace_encode32(&header[8], size);
+	header[12] = direction;
+	header[13] = channel;
+	header[14] = 0;
+	header[15] = 0;
+	head = _push_copy(trace, head, (char const *)header, sizeof(header));
+	head = _push_copy(trace, head, buf, size);
+	/* publish the record */
+	g_atomic_int_set(&trace->head, head);
+	/* wake the writer up early only when filling up */
+	if((used += sizeof(header) + size) >= sizeof(trace->ring) / 4
+			&& g_atomic_int_get(&trace->waiting))
+	{
+		g_mutex_lock(&trace->mutex);
+		g_cond_signal(&trace->cond);
+		g_mutex_unlock(&trace->mutex);
+	}
+	return 0;
+}
+
+static size_t _push_copy(HayesTrace * trace, size_t head, char const * buf,
+		size_t size)
+{
+	size_t cnt = sizeof(trace->ring) - head;
+
+	if(cnt > size)
+		cnt = size;
+	memcpy(&trace->ring[head], buf, cnt);
+	memcpy(trace->ring, &buf[cnt], size - cnt);
+	return (head + size) & (sizeof(trace->ring) - 1);
+}
+
+
+/* hayestrace_drain */
+static void _drain_copy(HayesTrace * trace, size_t tail, char * buf,
+		size_t size);
+static void _drain_rotate(HayesTrace * trace);
+static void _drain_write(HayesTrace * trace, size_t tail, size_t size);
+
+static size_t _hayestrace_drain(HayesTrace * trace)
+{
+	const size_t mask = sizeof(trace->ring) - 1;
+	size_t head = g_atomic_int_get(&trace->head);
+	size_t tail = g_atomic_int_get(&trace->tail);
+	unsigned char header[HAYESTRACE_RECORD_SIZE];
+	size_t size;
+	size_t ret = 0;
+
+	while(tail != head)
+	{
+		_drain_copy(trace, tail, (char *)header, sizeof(header));
+		size = sizeof(header) + _hayestrace_decode32(&header[8]);
+		/* rotate between records only */
+		if(trace->rotate > 0 && trace->written > HAYESTRACE_HEADER_SIZE
+				&& trace->written + size > trace->rotate)
+			_drain_rotate(trace);
+		_drain_write(trace, tail, size);
+		tail = (tail + size) & mask;
+		/* release the space as soon as possible */
+		g_atomic_int_set(&trace->tail, tail);
+		ret += size;
+	}
+	if(ret > 0 && trace->fp != NULL && fflush(trace->fp) != 0)
+	{
+		fclose(trace->fp);
+		trace->fp = NULL;
+	}
+	return ret;
+}
+
+static void _drain_copy(HayesTrace * trace, size_t tail, char * buf,
+		size_t size)
+{
+	size_t cnt = sizeof(trace->ring) - tail;
+
+	if(cnt > size)
+		cnt = size;
+	memcpy(buf, &trace->ring[tail], cnt);
+	memcpy(&buf[cnt], trace->ring, size - cnt);
+}
+
+static void _drain_rotate(HayesTrace * trace)
+{
+	if(trace->fp != NULL)
+		fclose(trace->fp);
+	trace->fp = NULL;
+	/* keep the previous file only */
+	if(rename(trace->filename, trace->rotated) == 0)
+		_hayestrace_open(trace);
+}
+
+static void _drain_write(HayesTrace * trace, size_t tail, size_t size)
+{
+	size_t cnt = sizeof(trace->ring) - tail;
+
+	if(trace->fp == NULL)
+		return; /* the record is lost */
+	if(cnt > size)
+		cnt = size;
+	if(fwrite(&trace->ring[tail], 1, cnt, trace->fp) != cnt
+			|| fwrite(trace->ring, 1, size - cnt, trace->fp)
+			!= size - cnt)
+	{
+		fclose(trace->fp);
+		trace->fp = NULL;
+		return;
+	}
+	trace->written += size;
+}
+
+
+/* encoding */
+/* hayestrace_decode32 */
+static guint32 _hayestrace_decode32(unsigned char const * buf)
+{
+	return buf[0] | (buf[1] << 8) | (buf[2] << 16)
+		| ((guint32)buf[3] << 24);
+}
+
+
+/* hayestrace_decode64 */
+static guint64 _hayestrace_decode64(unsigned char const * buf)
+{
+	return _hayestrace_decode32(buf)
+		| ((guint64)_hayestrace_decode32(&buf[4]) << 32);
+}
+
+
+/* hayestrace_encode32 */
+static void _hayestrace_encode32(unsigned char * buf, guint32 u)
+{
+	buf[0] = u & 0xff;
+	buf[1] = (u >> 8) & 0xff;
+	buf[2] = (u >> 16) & 0xff;
+	buf[3] = (u >> 24) & 0xff;
+}
+
+
+/* hayestrace_encode64 */
+static void _hayestrace_encode64(unsigned char * buf, guint64 u)
+{
+	_hayestrace_encode32(buf, u & 0xffffffff);
+	_hayestrace_encode32(&buf[4], u >> 32);
+}
+
+
+/* callbacks */
+/* hayestrace_on_thread */
+static gpointer _hayestrace_on_thread(gpointer data)
+{
+	HayesTrace * trace = data;
+	int running;
+
+	do
+	{
+		/* anything recorded until stopped gets written */
+		running = g_atomic_int_get(&trace->running);
+		if(_hayestrace_drain(trace) > 0 || !running)
+			continue;
+		g_mutex_lock(&trace->mutex);
+		g_atomic_int_set(&trace->waiting, 1);
+		if(g_atomic_int_get(&trace->running))
+			g_cond_wait_until(&trace->cond, &trace->mutex,
+					g_get_monotonic_time()
+					+ HAYESTRACE_DELAY * 1000);
+		g_atomic_int_set(&trace->waiting, 0);
+		g_mutex_unlock(&trace->mutex);
+	}
+	while(running);
+	return NULL;
+}
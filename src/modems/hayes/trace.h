@@ -0,0 +1,85 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#ifndef PHONE_MODEM_HAYES_TRACE_H
+# define PHONE_MODEM_HAYES_TRACE_H
+
+# include <sys/types.h>
+# include <stdio.h>
+# include <glib.h>
+
+
+/* HayesTrace */
+/* public */
+/* constants */
+# define HAYESTRACE_MAGIC		"PHTRACE"
+# define HAYESTRACE_VERSION		1
+# define HAYESTRACE_HEADER_SIZE		32	/* at the start of every file */
+# define HAYESTRACE_RECORD_SIZE		16	/* before the data recorded */
+# define HAYESTRACE_RING_SIZE		262144	/* must be a power of 2 */
+
+
+/* types */
+typedef struct _HayesTrace HayesTrace;
+
+typedef enum _HayesTraceDirection
+{
+	HAYESTRACE_DIRECTION_PHONE = 0,	/* written to the modem */
+	HAYESTRACE_DIRECTION_MODEM,	/* read from the modem */
+	HAYESTRACE_DIRECTION_DROPPED	/* records lost, as a 32-bit count */
+} HayesTraceDirection;
+
+typedef struct _HayesTraceHeader
+{
+	unsigned int version;
+	gint64 realtime;		/* when the file was opened */
+	gint64 monotonic;
+} HayesTraceHeader;
+
+typedef struct _HayesTraceRecord
+{
+	gint64 timestamp;		/* monotonic, in microseconds */
+	HayesTraceDirection direction;
+	unsigned int channel;
+	size_t size;
+} HayesTraceRecord;
+
+
+/* functions */
+HayesTrace * hayestrace_new(char const * filename, size_t rotate);
+void hayestrace_delete(HayesTrace * trace);
+
+/* useful */
+int hayestrace_record(HayesTrace * trace, HayesTraceDirection direction,
+		unsigned int channel, char const * buf, size_t size);
+
+/* decoding */
+int hayestrace_read_header(FILE * fp, HayesTraceHeader * header);
+int hayestrace_read_record(FILE * fp, HayesTraceRecord * record,
+		char ** buf, size_t * size);
+
+#endif /* PHONE_MODEM_HAYES_TRACE_H */
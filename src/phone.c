@@ -36,6 +36,7 @@ static char const _license[] =
 #include <dirent.h>
 #include <ctype.h>
 #include <string.h>
+#include <unistd.h>
 #include <time.h>
 #include <libgen.h>
 #include <errno.h>
@@ -77,6 +78,16 @@ typedef enum _PhoneAttachmentColumn
 #define PHONE_ATTACHMENT_COLUMN_LAST PHONE_ATTACHMENT_COLUMN_ICON
 #define PHONE_ATTACHMENT_COLUMN_COUNT (PHONE_ATTACHMENT_COLUMN_LAST + 1)
 
+typedef struct _PhoneBatch
+{
+	GtkListStore * store;
+	GtkWidget ** view;		/* a tree view, or a notebook of them */
+	guint source;
+	gint64 last;
+	gint column;
+	GtkSortType order;
+} PhoneBatch;
+
 typedef enum _PhoneContactColumn
 {
 	PHONE_CONTACT_COLUMN_ID = 0,
@@ -157,12 +168,19 @@ typedef enum _PhoneTrack
 #define PHONE_TRACK_LAST	PHONE_TRACK_SIGNAL_LEVEL
 #define PHONE_TRACK_COUNT	(PHONE_TRACK_LAST + 1)
 
+struct _PhoneConfigSection
+{
+	String * name;
+};
+
 struct _Phone
 {
 	char * name;
 	Modem * modem;
 	guint source;
 	Config * config;
+	guint config_source;
+	GHashTable * config_sections;
 
 	/* tracking */
 	guint tr_source;
@@ -205,6 +223,8 @@ struct _Phone
 	/* contacts */
 	GtkWidget * co_window;
 	GtkListStore * co_store;
+	GHashTable * co_rows;
+	PhoneBatch co_batch;
 	GtkWidget * co_view;
 	GdkPixbuf * co_status[MODEM_CONTACT_STATUS_COUNT];
 	/* dialog */
@@ -225,6 +245,8 @@ struct _Phone
 	/* messages */
 	GtkWidget * me_window;
 	GtkListStore * me_store;
+	GHashTable * me_rows;
+	PhoneBatch me_batch;
 	GtkWidget * me_view;
 	GtkWidget * me_progress;
 
@@ -273,6 +295,8 @@ struct _Phone
 
 
 /* constants */
+#define PHONE_BATCH_DELAY	100	/* in milliseconds */
+#define PHONE_CONFIG_DELAY	500	/* in milliseconds */
 #define PHONE_CONFIG_FILE	".phone"
 
 
@@ -291,19 +315,31 @@ static gboolean _phone_plugin_is_enabled(Phone * phone, char const * plugin);
 /* useful */
 static void _phone_about(Phone * phone);
 
+static void _phone_batch_update(PhoneBatch * batch);
+
 static int _phone_call_number(Phone * phone, char const * number);
 
 static void _phone_config_foreach(Phone * phone, char const * section,
 		PhoneConfigForeachCallback callback, void * priv);
 static char * _phone_config_filename(void);
+static int _phone_config_flush(Phone * phone);
 static char const * _phone_config_get(Phone * phone, char const * section,
 		char const * variable);
 static int _phone_config_save(Phone * phone);
+static PhoneConfigSection * _phone_config_section(Phone * phone,
+		char const * section);
+static void _phone_config_section_delete(gpointer data);
+static char const * _phone_config_section_get(Phone * phone,
+		PhoneConfigSection * section, char const * variable);
+static int _phone_config_section_set(Phone * phone,
+		PhoneConfigSection * section, char const * variable,
+		char const * value);
 static int _phone_config_set(Phone * phone, char const * section,
 		char const * variable, char const * value);
 static int _phone_config_set_type(Phone * phone, char const * type,
 		char const * section, char const * variable,
 		char const * value);
+static int _phone_config_write(Phone * phone);
 
 static GtkWidget * _phone_create_button(char const * icon, char const * label,
 		gboolean mnemonic);
@@ -379,6 +415,8 @@ static int _phone_on_message(void * data, uint32_t value1, uint32_t value2,
 		uint32_t value3);
 static gboolean _phone_on_read_event_after(GtkWidget * widget, GdkEvent * event,
 		gpointer data);
+static gboolean _phone_timeout_batch(gpointer data);
+static gboolean _phone_timeout_config(gpointer data);
 static gboolean _phone_timeout_track(gpointer data);
 
 
@@ -451,9 +489,14 @@ Phone * phone_new(char const * plugin, int retry)
 	}
 	phone->name = strdup(plugin);
 	phone->modem = modem_new(phone->config, plugin, retry);
+	phone->config_sections = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, _phone_config_section_delete);
 	phone->helper.config_foreach = _phone_config_foreach;
 	phone->helper.config_get = _phone_config_get;
 	phone->helper.config_set = _phone_config_set;
+	phone->helper.config_section = _phone_config_section;
+	phone->helper.config_section_get = _phone_config_section_get;
+	phone->helper.config_section_set = _phone_config_section_set;
 	phone->helper.confirm = _phone_helper_confirm;
 	phone->helper.error = phone_error;
 	phone->helper.about_dialog = _phone_about;
@@ -470,6 +513,11 @@ Phone * phone_new(char const * plugin, int retry)
 	phone->co_store = gtk_list_store_new(PHONE_CONTACT_COLUMN_COUNT,
 			G_TYPE_UINT, G_TYPE_UINT, GDK_TYPE_PIXBUF,
 			G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
+	/* persistent iterators of the contacts, by index */
+	phone->co_rows = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, g_free);
+	phone->co_batch.store = phone->co_store;
+	phone->co_batch.view = &phone->co_view;
 	icontheme = gtk_icon_theme_get_default();
 	phone->co_status[MODEM_CONTACT_STATUS_AWAY]
 		= gtk_icon_theme_load_icon(icontheme, "user-away", 24,
@@ -495,6 +543,11 @@ Phone * phone_new(char const * plugin, int retry)
 			G_TYPE_STRING);
 	gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(phone->me_store),
 			PHONE_MESSAGE_COLUMN_DATE, GTK_SORT_DESCENDING);
+	/* persistent iterators of the messages, by index */
+	phone->me_rows = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, g_free);
+	phone->me_batch.store = phone->me_store;
+	phone->me_batch.view = &phone->me_view;
 	phone->pl_store = gtk_list_store_new(PHONE_PLUGINS_COLUMN_COUNT,
 			G_TYPE_POINTER, G_TYPE_BOOLEAN, G_TYPE_STRING,
 			GDK_TYPE_PIXBUF, G_TYPE_STRING);
@@ -623,11 +676,24 @@ void phone_delete(Phone * phone)
 	free(phone->name);
 	phone_unload_all(phone);
 	if(phone->config != NULL)
+	{
+		_phone_config_flush(phone);
 		config_delete(phone->config);
+	}
+	if(phone->config_sections != NULL)
+		g_hash_table_destroy(phone->config_sections);
 	if(phone->source != 0)
 		g_source_remove(phone->source);
 	if(phone->tr_source != 0)
 		g_source_remove(phone->tr_source);
+	if(phone->co_batch.source != 0)
+		g_source_remove(phone->co_batch.source);
+	if(phone->co_rows != NULL)
+		g_hash_table_destroy(phone->co_rows);
+	if(phone->me_batch.source != 0)
+		g_source_remove(phone->me_batch.source);
+	if(phone->me_rows != NULL)
+		g_hash_table_destroy(phone->me_rows);
 	pango_font_description_free(phone->bold);
 	if(phone->modem != NULL)
 		modem_delete(phone->modem);
@@ -842,6 +908,7 @@ void phone_contacts_delete_selected(Phone * phone)
 			!= 0)
 		return;
 	gtk_list_store_remove(phone->co_store, &iter); /* XXX it may fail */
+	g_hash_table_remove(phone->co_rows, GUINT_TO_POINTER(id));
 	modem_request_type(phone->modem, MODEM_REQUEST_CONTACT_DELETE, id);
 }
 
@@ -882,26 +949,26 @@ void phone_contacts_set(Phone * phone, unsigned int index,
 		ModemContactStatus status, char const * name,
 		char const * number)
 {
-	GtkTreeModel * model = GTK_TREE_MODEL(phone->co_store);
 	GtkTreeIter iter;
-	gboolean valid;
-	unsigned int id;
+	GtkTreeIter * row;
 	gchar * p;
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s(%u, \"%s\", \"%s\")\n", __func__, index,
 			name, number);
 #endif
-	valid = gtk_tree_model_get_iter_first(model, &iter);
-	for(; valid == TRUE; valid = gtk_tree_model_iter_next(model, &iter))
+	_phone_batch_update(&phone->co_batch);
+	if((row = g_hash_table_lookup(phone->co_rows, GUINT_TO_POINTER(index)))
+			!= NULL)
+		iter = *row;
+	else
 	{
-		gtk_tree_model_get(model, &iter, PHONE_CONTACT_COLUMN_ID, &id,
-				-1);
-		if(id == index)
-			break;
-	}
-	if(valid != TRUE)
 		gtk_list_store_append(phone->co_store, &iter);
+		row = g_new(GtkTreeIter, 1);
+		*row = iter;
+		g_hash_table_insert(phone->co_rows, GUINT_TO_POINTER(index),
+				row);
+	}
 	p = g_strdup_printf("%s\n%s", name, number);
 	gtk_list_store_set(phone->co_store, &iter,
 			PHONE_CONTACT_COLUMN_ID, index,
@@ -1072,6 +1139,7 @@ int phone_event(Phone * phone, PhoneEvent * event)
 					MODEM_EVENT_TYPE_AUTHENTICATION);
 			break;
 		case PHONE_EVENT_TYPE_QUIT:
+			_phone_config_flush(phone);
 			if(ret == 0)
 				gtk_main_quit();
 			break;
@@ -1084,6 +1152,7 @@ int phone_event(Phone * phone, PhoneEvent * event)
 				ret = _event_type_starting(phone);
 			break;
 		case PHONE_EVENT_TYPE_STOPPING:
+			_phone_config_flush(phone);
 			if(ret == 0 && phone->modem != NULL
 					&& (ret = modem_stop(phone->modem))
 					== 0)
@@ -1480,10 +1549,8 @@ void phone_messages_set(Phone * phone, unsigned int index, char const * number,
 		time_t date, ModemMessageFolder folder,
 		ModemMessageStatus status, size_t length, char const * content)
 {
-	GtkTreeModel * model = GTK_TREE_MODEL(phone->me_store);
 	GtkTreeIter iter;
-	gboolean valid;
-	unsigned int id;
+	GtkTreeIter * row;
 	char const * summary;
 	char * p;
 	char nd[32];
@@ -1495,16 +1562,18 @@ void phone_messages_set(Phone * phone, unsigned int index, char const * number,
 	fprintf(stderr, "DEBUG: %s(%u, \"%s\", \"%s\")\n", __func__, index,
 			number, content);
 #endif
-	valid = gtk_tree_model_get_iter_first(model, &iter);
-	for(; valid == TRUE; valid = gtk_tree_model_iter_next(model, &iter))
+	_phone_batch_update(&phone->me_batch);
+	if((row = g_hash_table_lookup(phone->me_rows, GUINT_TO_POINTER(index)))
+			!= NULL)
+		iter = *row;
+	else
 	{
-		gtk_tree_model_get(model, &iter, PHONE_MESSAGE_COLUMN_ID, &id,
-				-1);
-		if(id == index)
-			break;
-	}
-	if(valid != TRUE)
 		gtk_list_store_append(phone->me_store, &iter);
+		row = g_new(GtkTreeIter, 1);
+		*row = iter;
+		g_hash_table_insert(phone->me_rows, GUINT_TO_POINTER(index),
+				row);
+	}
 	if(number == NULL)
 		number = "";
 	if(content == NULL)
@@ -3808,6 +3877,79 @@ static void _phone_about(Phone * phone)
 }
 
 
+/* phone_batch_update */
+static void _batch_update_views(GtkWidget * view, gboolean attach);
+
+static void _phone_batch_update(PhoneBatch * batch)
+{
+	GtkTreeSortable * sortable = GTK_TREE_SORTABLE(batch->store);
+	gint64 now = g_get_monotonic_time();
+
+	if(batch->source != 0)
+		/* the batch goes on */
+		g_source_remove(batch->source);
+	else if(now - batch->last < PHONE_BATCH_DELAY * 1000)
+	{
+		/* updates come in a row: detach the sort and the views */
+		if(gtk_tree_sortable_get_sort_column_id(sortable,
+					&batch->column, &batch->order) == TRUE)
+			gtk_tree_sortable_set_sort_column_id(sortable,
+					GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID,
+					GTK_SORT_ASCENDING);
+		else
+			batch->column
+				= GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID;
+		_batch_update_views(*batch->view, FALSE);
+	}
+	else
+	{
+		/* update single rows directly */
+		batch->last = now;
+		return;
+	}
+	batch->last = now;
+	/* reattach everything once the updates stop */
+	batch->source = g_timeout_add(PHONE_BATCH_DELAY, _phone_timeout_batch,
+			batch);
+}
+
+static void _batch_update_views(GtkWidget * view, gboolean attach)
+{
+	GtkTreeModel * model;
+	gint i;
+
+	if(view == NULL)
+		return;
+	if(GTK_IS_NOTEBOOK(view))
+	{
+		for(i = 0; i < gtk_notebook_get_n_pages(GTK_NOTEBOOK(view));
+				i++)
+			_batch_update_views(gtk_bin_get_child(GTK_BIN(
+							gtk_notebook_get_nth_page(
+								GTK_NOTEBOOK(
+									view),
+								i))),
+					attach);
+		return;
+	}
+	if(attach)
+	{
+		if((model = g_object_get_data(G_OBJECT(view), "batch")) == NULL)
+			return;
+		gtk_tree_view_set_model(GTK_TREE_VIEW(view), model);
+		g_object_set_data(G_OBJECT(view), "batch", NULL);
+		g_object_unref(model);
+	}
+	else if((model = gtk_tree_view_get_model(GTK_TREE_VIEW(view)))
+			!= NULL)
+	{
+		g_object_ref(model);
+		g_object_set_data(G_OBJECT(view), "batch", model);
+		gtk_tree_view_set_model(GTK_TREE_VIEW(view), NULL);
+	}
+}
+
+
 /* phone_call_number */
 static int _phone_call_number(Phone * phone, char const * number)
 {
@@ -3839,6 +3981,17 @@ static char * _phone_config_filename(void)
 }
 
 
+/* phone_config_flush */
+static int _phone_config_flush(Phone * phone)
+{
+	if(phone->config_source == 0)
+		return 0; /* nothing to save */
+	g_source_remove(phone->config_source);
+	phone->config_source = 0;
+	return _phone_config_write(phone);
+}
+
+
 /* phone_config_foreach */
 static void _config_foreach_section(Config const * config,
 		String const * section, String const * variable,
@@ -3889,18 +4042,70 @@ static char const * _phone_config_get(Phone * phone, char const * section,
 /* phone_config_save */
 static int _phone_config_save(Phone * phone)
 {
-	int ret = 0;
-	char * filename;
+	/* write the changes once they are over */
+	if(phone->config_source == 0)
+		phone->config_source = g_timeout_add(PHONE_CONFIG_DELAY,
+				_phone_timeout_config, phone);
+	return 0;
+}
 
-	if((filename = _phone_config_filename()) == NULL)
-		return -1; /* XXX warn the user */
-	if(config_save(phone->config, filename) != 0)
-		ret = -phone_error(phone, error_get(NULL), 1);
-	free(filename);
+
+/* phone_config_section */
+static PhoneConfigSection * _phone_config_section(Phone * phone,
+		char const * section)
+{
+	PhoneConfigSection * ret;
+
+	if(section == NULL)
+		return NULL;
+	/* every section is only resolved once */
+	if((ret = g_hash_table_lookup(phone->config_sections, section)) != NULL)
+		return ret;
+	if((ret = object_new(sizeof(*ret))) == NULL)
+		return NULL;
+	if((ret->name = string_new_append("plugin::", section, NULL)) == NULL)
+	{
+		object_delete(ret);
+		return NULL;
+	}
+	g_hash_table_insert(phone->config_sections, g_strdup(section), ret);
 	return ret;
 }
 
 
+/* phone_config_section_delete */
+static void _phone_config_section_delete(gpointer data)
+{
+	PhoneConfigSection * section = data;
+
+	string_delete(section->name);
+	object_delete(section);
+}
+
+
+/* phone_config_section_get */
+static char const * _phone_config_section_get(Phone * phone,
+		PhoneConfigSection * section, char const * variable)
+{
+	if(section == NULL)
+		return NULL;
+	return config_get(phone->config, section->name, variable);
+}
+
+
+/* phone_config_section_set */
+static int _phone_config_section_set(Phone * phone,
+		PhoneConfigSection * section, char const * variable,
+		char const * value)
+{
+	if(section == NULL)
+		return -1;
+	if(config_set(phone->config, section->name, variable, value) != 0)
+		return -1;
+	return _phone_config_save(phone);
+}
+
+
 /* phone_config_set */
 static int _phone_config_set(Phone * phone, char const * section,
 		char const * variable, char const * value)
@@ -3930,6 +4135,37 @@ static int _phone_config_set_type(Phone * phone, char const * type,
 }
 
 
+/* phone_config_write */
+static int _phone_config_write(Phone * phone)
+{
+	int ret = 0;
+	char * filename;
+	String * tmp;
+	int fd;
+
+	if((filename = _phone_config_filename()) == NULL)
+		return -1; /* XXX warn the user */
+	/* replace the file at once, never leaving it truncated */
+	if((tmp = string_new_append(filename, ".XXXXXX", NULL)) == NULL)
+		ret = -phone_error(phone, error_get(NULL), 1);
+	else if((fd = mkstemp(tmp)) < 0)
+		ret = -phone_error(phone, strerror(errno), 1);
+	else
+	{
+		if(config_save(phone->config, tmp) != 0)
+			ret = -phone_error(phone, error_get(NULL), 1);
+		else if(fsync(fd) != 0 || rename(tmp, filename) != 0)
+			ret = -phone_error(phone, strerror(errno), 1);
+		close(fd);
+		if(ret != 0)
+			unlink(tmp);
+	}
+	string_delete(tmp);
+	free(filename);
+	return ret;
+}
+
+
 /* phone_create_button */
 static GtkWidget * _phone_create_button(char const * icon, char const * label,
 		gboolean mnemonic)
@@ -4688,6 +4924,11 @@ static void _phone_modem_event(void * priv, ModemEvent * event)
 				phone_info(phone, _("Model information"),
 						event->model.serial);
 			break;
+		case MODEM_EVENT_TYPE_STATISTICS:
+			if(event->statistics.commands != NULL)
+				phone_info(phone, _("Modem statistics"),
+						event->statistics.commands);
+			break;
 		case MODEM_EVENT_TYPE_NOTIFICATION:
 			_modem_event_notification(phone, event);
 			break;
@@ -4835,21 +5076,15 @@ static void _modem_event_message(Phone * phone, ModemEvent * event)
 
 static void _modem_event_message_deleted(Phone * phone, ModemEvent * event)
 {
-	GtkTreeModel * model = GTK_TREE_MODEL(phone->me_store);
+	gpointer key = GUINT_TO_POINTER(event->message_deleted.id);
 	GtkTreeIter iter;
-	gboolean valid;
-	unsigned int id;
+	GtkTreeIter * row;
 
-	for(valid = gtk_tree_model_get_iter_first(model, &iter); valid == TRUE;
-			valid = gtk_tree_model_iter_next(model, &iter))
+	if((row = g_hash_table_lookup(phone->me_rows, key)) != NULL)
 	{
-		gtk_tree_model_get(model, &iter, PHONE_MESSAGE_COLUMN_ID, &id,
-				-1);
-		if(id == event->message_deleted.id)
-		{
-			gtk_list_store_remove(phone->me_store, &iter);
-			break;
-		}
+		iter = *row;
+		gtk_list_store_remove(phone->me_store, &iter);
+		g_hash_table_remove(phone->me_rows, key);
 	}
 	_phone_track(phone, PHONE_TRACK_MESSAGE_DELETED, FALSE);
 	phone->me_progress = _phone_progress_delete(phone->me_progress);
@@ -5000,6 +5235,10 @@ static int _message_show(Phone * phone, PhoneMessageShow what, gboolean show)
 		case PHONE_MESSAGE_SHOW_WRITE:
 			phone_show_write(phone, show, NULL, NULL);
 			break;
+		case PHONE_MESSAGE_SHOW_STATISTICS:
+			/* the modem reports them asynchronously */
+			_phone_trigger(phone, MODEM_EVENT_TYPE_STATISTICS);
+			break;
 	}
 	return 0;
 }
@@ -5040,6 +5279,37 @@ static gboolean _phone_on_read_event_after(GtkWidget * widget, GdkEvent * event,
 }
 
 
+/* phone_timeout_batch */
+static gboolean _phone_timeout_batch(gpointer data)
+{
+	PhoneBatch * batch = data;
+	GtkTreeSortable * sortable = GTK_TREE_SORTABLE(batch->store);
+	gint column;
+	GtkSortType order;
+
+	batch->source = 0;
+	/* sort once, unless the sort was changed meanwhile */
+	gtk_tree_sortable_get_sort_column_id(sortable, &column, &order);
+	if(batch->column != GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID
+			&& column == GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID)
+		gtk_tree_sortable_set_sort_column_id(sortable, batch->column,
+				batch->order);
+	_batch_update_views(*batch->view, TRUE);
+	return FALSE;
+}
+
+
+/* phone_timeout_config */
+static gboolean _phone_timeout_config(gpointer data)
+{
+	Phone * phone = data;
+
+	phone->config_source = 0;
+	_phone_config_write(phone);
+	return FALSE;
+}
+
+
 /* phone_timeout_track */
 static gboolean _phone_timeout_track(gpointer data)
 {
@@ -58,6 +58,7 @@ static int _usage(void)
 "       phonectl -L\n"
 "       phonectl -M\n"
 "       phonectl -S\n"
+"       phonectl -T\n"
 "       phonectl -W\n"
 "       phonectl -r\n"
 "       phonectl -s\n"
@@ -66,6 +67,7 @@ static int _usage(void)
 "  -L	Open the phone log window\n"
 "  -M	Open the messages window\n"
 "  -S	Display or change settings\n"
+"  -T	Display the latency of the modem commands\n"
 "  -W	Write a new message\n"
 "  -r	Resume telephony operation\n"
 "  -s	Suspend telephony operation\n"), stderr);
@@ -86,7 +88,7 @@ int main(int argc, char * argv[])
 	bindtextdomain(PACKAGE, LOCALEDIR);
 	textdomain(PACKAGE);
 	gtk_init(&argc, &argv);
-	while((o = getopt(argc, argv, "CDLMSWrs")) != -1)
+	while((o = getopt(argc, argv, "CDLMSTWrs")) != -1)
 		switch(o)
 		{
 			case 'C':
@@ -114,6 +116,11 @@ int main(int argc, char * argv[])
 					return _usage();
 				action = PHONE_MESSAGE_SHOW_SETTINGS;
 				break;
+			case 'T':
+				if(action != -1)
+					return _usage();
+				action = PHONE_MESSAGE_SHOW_STATISTICS;
+				break;
 			case 'W':
 				if(action != -1)
 					return _usage();
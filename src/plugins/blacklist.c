@@ -36,21 +36,65 @@
 /* Blacklist */
 /* private */
 /* types */
+typedef struct _BlacklistRule
+{
+	String * pattern;
+	String * reason;
+} BlacklistRule;
+
+typedef struct _BlacklistEntry
+{
+	BlacklistRule * rule;
+	int digits;			/* digits left to match, -1 for any */
+} BlacklistEntry;
+
+typedef struct _BlacklistNode
+{
+	struct _BlacklistNode * children[11];	/* '0' to '9' then '+' */
+	GSList * entries;
+} BlacklistNode;
+
 typedef struct _PhonePlugin
 {
 	PhonePluginHelper * helper;
+	PhoneConfigSection * config;
+
+	/* numbering plan */
+	String * country_code;
+	String * international_prefix;
+	String * trunk_prefix;
+
+	/* rules */
+	GHashTable * rules;
+	BlacklistNode * trie;
+
+	/* widgets */
 	GtkWidget * window;
 	GtkListStore * store;
 	GtkWidget * view;
 } Blacklist;
 
 
+/* constants */
+#define BLACKLIST_NUMBER_SIZE	32
+#define BLACKLIST_WILDCARDS_MAX	3
+
+
 /* prototypes */
 static Blacklist * _blacklist_init(PhonePluginHelper * helper);
 static void _blacklist_destroy(Blacklist * blacklist);
 static int _blacklist_event(Blacklist * blacklist, PhoneEvent * event);
 static void _blacklist_settings(Blacklist * blacklist);
 
+static BlacklistRule * _blacklist_match(Blacklist * blacklist,
+		char const * number);
+static int _blacklist_normalize(Blacklist * blacklist, char const * number,
+		gboolean wildcards, char * buf, size_t size);
+static gboolean _blacklist_is_plan(char const * variable);
+static void _blacklist_plan(Blacklist * blacklist);
+static int _blacklist_rule_set(Blacklist * blacklist, char const * pattern,
+		char const * reason);
+
 
 /* public */
 /* variables */
@@ -69,8 +113,10 @@ PhonePluginDefinition plugin =
 /* private */
 /* functions */
 /* blacklist_init */
+static String * _init_option(Blacklist * blacklist, char const * variable);
 static void _init_foreach(char const * variable, char const * value,
 		void * priv);
+static void _init_rule_delete(gpointer data);
 
 static Blacklist * _blacklist_init(PhonePluginHelper * helper)
 {
@@ -79,6 +125,14 @@ static Blacklist * _blacklist_init(PhonePluginHelper * helper)
 	if((blacklist = object_new(sizeof(*blacklist))) == NULL)
 		return NULL;
 	blacklist->helper = helper;
+	blacklist->config = helper->config_section(helper->phone, "blacklist");
+	blacklist->country_code = NULL;
+	blacklist->international_prefix = NULL;
+	blacklist->trunk_prefix = NULL;
+	blacklist->rules = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+			_init_rule_delete);
+	blacklist->trie = NULL;
+	_blacklist_plan(blacklist);
 	blacklist->window = NULL;
 	blacklist->store = gtk_list_store_new(2, G_TYPE_STRING, G_TYPE_STRING);
 	helper->config_foreach(helper->phone, "blacklist", _init_foreach,
@@ -86,31 +140,74 @@ static Blacklist * _blacklist_init(PhonePluginHelper * helper)
 	return blacklist;
 }
 
+static String * _init_option(Blacklist * blacklist, char const * variable)
+{
+	PhonePluginHelper * helper = blacklist->helper;
+	char const * p;
+
+	if((p = helper->config_section_get(helper->phone, blacklist->config,
+					variable)) == NULL || *p == '\0')
+		return NULL;
+	return string_new(p);
+}
+
 static void _init_foreach(char const * variable, char const * value,
 		void * priv)
 {
 	Blacklist * blacklist = priv;
 	GtkTreeIter iter;
 
+	if(_blacklist_is_plan(variable))
+		return;
+	_blacklist_rule_set(blacklist, variable, value);
 	gtk_list_store_append(blacklist->store, &iter);
 	gtk_list_store_set(blacklist->store, &iter, 0, variable, 1, value, -1);
 }
 
+static void _init_rule_delete(gpointer data)
+{
+	BlacklistRule * rule = data;
+
+	string_delete(rule->pattern);
+	string_delete(rule->reason);
+	object_delete(rule);
+}
+
 
 /* blacklist_destroy */
+static void _destroy_trie(BlacklistNode * node);
+
 static void _blacklist_destroy(Blacklist * blacklist)
 {
 	if(blacklist->window != NULL)
 		gtk_widget_destroy(blacklist->window);
+	_destroy_trie(blacklist->trie);
+	g_hash_table_destroy(blacklist->rules);
+	string_delete(blacklist->country_code);
+	string_delete(blacklist->international_prefix);
+	string_delete(blacklist->trunk_prefix);
 	object_delete(blacklist);
 }
 
+static void _destroy_trie(BlacklistNode * node)
+{
+	size_t i;
+
+	if(node == NULL)
+		return;
+	for(i = 0; i < sizeof(node->children) / sizeof(*node->children); i++)
+		_destroy_trie(node->children[i]);
+	g_slist_free_full(node->entries, g_free);
+	object_delete(node);
+}
+
 
 /* blacklist_event */
 static int _blacklist_event(Blacklist * blacklist, PhoneEvent * event)
 {
 	PhonePluginHelper * helper = blacklist->helper;
 	char const * number = NULL;
+	BlacklistRule * rule;
 	char const * reason;
 
 	switch(event->type)
@@ -126,7 +223,12 @@ static int _blacklist_event(Blacklist * blacklist, PhoneEvent * event)
 	}
 	if(number == NULL)
 		return 0;
-	reason = helper->config_get(helper->phone, "blacklist", number);
+	if((rule = _blacklist_match(blacklist, number)) != NULL)
+		reason = rule->reason;
+	else
+		/* numbers outside of the numbering plan */
+		reason = helper->config_section_get(helper->phone,
+				blacklist->config, number);
 	if(reason == NULL)
 		return 0;
 	return helper->error(helper->phone, reason, 1);
@@ -232,7 +334,9 @@ static void _on_settings_delete(gpointer data)
 			-1);
 	if(number == NULL)
 		return;
-	helper->config_set(helper->phone, "blacklist", number, NULL);
+	if(helper->config_section_set(helper->phone, blacklist->config, number,
+				NULL) == 0)
+		_blacklist_rule_set(blacklist, number, NULL);
 	gtk_list_store_remove(blacklist->store, &iter);
 	g_free(number);
 }
@@ -262,11 +366,19 @@ static void _on_settings_number_edited(GtkCellRenderer * renderer, gchar * arg1,
 	if(number == NULL)
 		return;
 	/* FIXME check that there are no duplicates */
-	reason = helper->config_get(helper->phone, "blacklist", number);
-	if(helper->config_set(helper->phone, "blacklist", arg2, reason) == 0
-			&& helper->config_set(helper->phone, "blacklist",
-				number, NULL) == 0)
+	reason = helper->config_section_get(helper->phone, blacklist->config,
+			number);
+	if(helper->config_section_set(helper->phone, blacklist->config, arg2,
+					reason) == 0
+			&& helper->config_section_set(helper->phone,
+				blacklist->config, number, NULL) == 0)
+	{
+		_blacklist_rule_set(blacklist, number, NULL);
+		_blacklist_rule_set(blacklist, arg2, helper->config_section_get(
+					helper->phone, blacklist->config,
+					arg2));
 		gtk_list_store_set(blacklist->store, &iter, 0, arg2, -1);
+	}
 	g_free(number);
 }
 
@@ -284,7 +396,348 @@ static void _on_settings_reason_edited(GtkCellRenderer * renderer, gchar * arg1,
 		gtk_tree_model_get(model, &iter, 0, &number, -1);
 	if(number == NULL)
 		return;
-	if(helper->config_set(helper->phone, "blacklist", number, arg2) == 0)
+	if(helper->config_section_set(helper->phone, blacklist->config, number,
+					arg2) == 0)
+	{
+		_blacklist_rule_set(blacklist, number, arg2);
 		gtk_list_store_set(blacklist->store, &iter, 1, arg2, -1);
+	}
 	g_free(number);
 }
+
+
+/* blacklist_match */
+static size_t _match_index(char c);
+
+static BlacklistRule * _blacklist_match(Blacklist * blacklist,
+		char const * number)
+{
+	BlacklistRule * ret = NULL;
+	char buf[BLACKLIST_NUMBER_SIZE];
+	BlacklistNode * node;
+	GSList * l;
+	BlacklistEntry * entry;
+	BlacklistEntry * any;
+	size_t len;
+	size_t i;
+
+	if(_blacklist_normalize(blacklist, number, FALSE, buf, sizeof(buf))
+			!= 0)
+		return NULL;
+	len = strlen(buf);
+	/* the deepest rule wins, then those matching the length exactly */
+	for(i = 0, node = blacklist->trie; node != NULL;
+			node = node->children[_match_index(buf[i++])])
+	{
+		for(l = node->entries, any = NULL; l != NULL; l = l->next)
+		{
+			entry = l->data;
+			if(entry->digits == (int)(len - i))
+				break;
+			if(entry->digits < 0 && any == NULL)
+				any = entry;
+		}
+		if(l != NULL)
+			ret = entry->rule;
+		else if(any != NULL)
+			ret = any->rule;
+		if(i == len)
+			break;
+	}
+	return ret;
+}
+
+static size_t _match_index(char c)
+{
+	return (c == '+') ? 10 : (size_t)(c - '0');
+}
+
+
+/* blacklist_normalize */
+static int _blacklist_normalize(Blacklist * blacklist, char const * number,
+		gboolean wildcards, char * buf, size_t size)
+{
+	char digits[BLACKLIST_NUMBER_SIZE];
+	size_t i;
+	size_t len;
+	char const * p = digits;
+	char const * prefix = "";
+
+	/* only keep the digits */
+	for(i = 0; *number != '\0'; number++)
+	{
+		if(strchr(" ()-.", *number) != NULL)
+			continue;
+		if(i + 1 == sizeof(digits))
+			return -1;
+		if((*number >= '0' && *number <= '9')
+				|| (*number == '+' && i == 0)
+				|| (wildcards && *number == '?')
+				|| (wildcards && *number == '*'
+					&& number[1] == '\0'))
+			digits[i++] = *number;
+		else
+			return -1;
+	}
+	digits[i] = '\0';
+	/* use the international format whenever possible */
+	if(digits[0] == '+')
+		p = &digits[1];
+	else if(blacklist->international_prefix != NULL
+			&& strncmp(digits, blacklist->international_prefix,
+				len = string_get_length(
+					blacklist->international_prefix)) == 0)
+		p = &digits[len];
+	else if(blacklist->country_code != NULL
+			&& blacklist->trunk_prefix != NULL
+			&& strncmp(digits, blacklist->trunk_prefix,
+				len = string_get_length(
+					blacklist->trunk_prefix)) == 0)
+	{
+		prefix = blacklist->country_code;
+		p = &digits[len];
+	}
+	else
+		return (snprintf(buf, size, "%s", digits) < (int)size) ? 0 : -1;
+	return (snprintf(buf, size, "+%s%s", prefix, p) < (int)size) ? 0 : -1;
+}
+
+
+/* blacklist_rule_set */
+static int _rule_set_apply(Blacklist * blacklist, BlacklistRule * rule,
+		gboolean insert);
+static int _rule_set_range(Blacklist * blacklist, BlacklistRule * rule,
+		gboolean insert, char * key, size_t pos, char const * from,
+		char const * to);
+static int _rule_set_trie(BlacklistNode ** node, char const * key, int digits,
+		BlacklistRule * rule, gboolean insert);
+
+static int _blacklist_rule_set(Blacklist * blacklist, char const * pattern,
+		char const * reason)
+{
+	BlacklistRule * rule;
+	String * p;
+
+	/* the numbering plan was changed instead */
+	if(_blacklist_is_plan(pattern))
+	{
+		_blacklist_plan(blacklist);
+		return 0;
+	}
+	if((rule = g_hash_table_lookup(blacklist->rules, pattern)) != NULL)
+	{
+		if(reason == NULL)
+		{
+			_rule_set_apply(blacklist, rule, FALSE);
+			g_hash_table_remove(blacklist->rules, pattern);
+		}
+		else if((p = string_new(reason)) == NULL)
+			return -1;
+		else
+		{
+			string_delete(rule->reason);
+			rule->reason = p;
+		}
+		return 0;
+	}
+	if(reason == NULL)
+		return 0;
+	if((rule = object_new(sizeof(*rule))) == NULL)
+		return -1;
+	rule->pattern = string_new(pattern);
+	rule->reason = string_new(reason);
+	if(rule->pattern == NULL || rule->reason == NULL
+			|| _rule_set_apply(blacklist, rule, TRUE) != 0)
+	{
+		/* matched literally through the configuration instead */
+		_rule_set_apply(blacklist, rule, FALSE);
+		string_delete(rule->pattern);
+		string_delete(rule->reason);
+		object_delete(rule);
+		return -1;
+	}
+	g_hash_table_insert(blacklist->rules, rule->pattern, rule);
+	return 0;
+}
+
+static int _rule_set_apply(Blacklist * blacklist, BlacklistRule * rule,
+		gboolean insert)
+{
+	char buf[BLACKLIST_NUMBER_SIZE];
+	char from[BLACKLIST_NUMBER_SIZE];
+	char to[BLACKLIST_NUMBER_SIZE];
+	char * p;
+	size_t len;
+	size_t i;
+	int digits = 0;
+	size_t wildcards = 0;
+
+	if(rule->pattern == NULL)
+		return -1;
+	/* ranges, as "from..to" with numbers of the same length */
+	if((p = strstr(rule->pattern, "..")) != NULL)
+	{
+		if((len = p - rule->pattern) >= sizeof(buf))
+			return -1;
+		memcpy(buf, rule->pattern, len);
+		buf[len] = '\0';
+		if(_blacklist_normalize(blacklist, buf, FALSE, from,
+					sizeof(from)) != 0
+				|| _blacklist_normalize(blacklist, &p[2], FALSE,
+					to, sizeof(to)) != 0
+				|| (len = strlen(from)) != strlen(to)
+				|| (from[0] == '+') != (to[0] == '+')
+				|| strcmp(from, to) > 0)
+			return -1;
+		i = (from[0] == '+') ? 1 : 0;
+		memcpy(buf, from, i);
+		return _rule_set_range(blacklist, rule, insert, buf, i,
+				&from[i], &to[i]);
+	}
+	if(_blacklist_normalize(blacklist, rule->pattern, TRUE, buf,
+				sizeof(buf)) != 0)
+		return -1;
+	len = strlen(buf);
+	/* prefixes, as "prefix*" */
+	if(len > 0 && buf[len - 1] == '*')
+	{
+		digits = -1;
+		buf[--len] = '\0';
+	}
+	/* numbers of a given length, as "prefix??" */
+	else
+		for(; len > 0 && buf[len - 1] == '?'; digits++)
+			buf[--len] = '\0';
+	/* wildcards, as "pre?ix" */
+	for(i = 0; i < len; i++)
+		if(buf[i] == '?' && ++wildcards > BLACKLIST_WILDCARDS_MAX)
+			return -1;
+	return _rule_set_trie(&blacklist->trie, buf, digits, rule, insert);
+}
+
+static int _rule_set_range(Blacklist * blacklist, BlacklistRule * rule,
+		gboolean insert, char * key, size_t pos, char const * from,
+		char const * to)
+{
+	int ret = 0;
+	char const nines[] = "9999999999999999999999999999999";
+	char const zeros[] = "0000000000000000000000000000000";
+	size_t len = strlen(from);
+	char c;
+
+	/* cover the range with as few prefixes as possible */
+	if(len == 0 || (strspn(from, "0") == len && strspn(to, "9") == len))
+	{
+		key[pos] = '\0';
+		return _rule_set_trie(&blacklist->trie, key, len, rule, insert);
+	}
+	key[pos] = from[0];
+	if(from[0] == to[0])
+		return _rule_set_range(blacklist, rule, insert, key, pos + 1,
+				&from[1], &to[1]);
+	ret |= _rule_set_range(blacklist, rule, insert, key, pos + 1,
+			&from[1], &nines[sizeof(nines) - len]);
+	for(c = from[0] + 1; c < to[0]; c++)
+	{
+		key[pos] = c;
+		key[pos + 1] = '\0';
+		ret |= _rule_set_trie(&blacklist->trie, key, len - 1, rule,
+				insert);
+	}
+	key[pos] = to[0];
+	ret |= _rule_set_range(blacklist, rule, insert, key, pos + 1,
+			&zeros[sizeof(zeros) - len], &to[1]);
+	return ret;
+}
+
+static int _rule_set_trie(BlacklistNode ** node, char const * key, int digits,
+		BlacklistRule * rule, gboolean insert)
+{
+	int ret = 0;
+	BlacklistNode * n;
+	BlacklistEntry * entry;
+	GSList * l;
+	size_t i;
+
+	if((n = *node) == NULL)
+	{
+		if(insert == FALSE)
+			return 0;
+		if((n = object_new(sizeof(*n))) == NULL)
+			return -1;
+		memset(n, 0, sizeof(*n));
+		*node = n;
+	}
+	if(*key == '?')
+		for(i = 0; i < 10; i++)
+			ret |= _rule_set_trie(&n->children[i], &key[1], digits,
+					rule, insert);
+	else if(*key != '\0')
+		ret = _rule_set_trie(&n->children[_match_index(*key)], &key[1],
+				digits, rule, insert);
+	else if(insert)
+	{
+		entry = g_new(BlacklistEntry, 1);
+		entry->rule = rule;
+		entry->digits = digits;
+		n->entries = g_slist_prepend(n->entries, entry);
+	}
+	else
+		for(l = n->entries; l != NULL; l = l->next)
+			if((entry = l->data)->rule == rule
+					&& entry->digits == digits)
+			{
+				n->entries = g_slist_delete_link(n->entries, l);
+				g_free(entry);
+				break;
+			}
+	if(insert)
+		return ret;
+	/* remove the nodes left unused */
+	if(n->entries != NULL)
+		return ret;
+	for(i = 0; i < sizeof(n->children) / sizeof(*n->children); i++)
+		if(n->children[i] != NULL)
+			return ret;
+	object_delete(n);
+	*node = NULL;
+	return ret;
+}
+
+
+/* blacklist_is_plan */
+static gboolean _blacklist_is_plan(char const * variable)
+{
+	return (strcmp(variable, "country_code") == 0
+			|| strcmp(variable, "international_prefix") == 0
+			|| strcmp(variable, "trunk_prefix") == 0) ? TRUE : FALSE;
+}
+
+
+/* blacklist_plan */
+static void _plan_foreach(gpointer key, gpointer value, gpointer data);
+
+static void _blacklist_plan(Blacklist * blacklist)
+{
+	string_delete(blacklist->country_code);
+	blacklist->country_code = _init_option(blacklist, "country_code");
+	string_delete(blacklist->international_prefix);
+	blacklist->international_prefix = _init_option(blacklist,
+			"international_prefix");
+	string_delete(blacklist->trunk_prefix);
+	blacklist->trunk_prefix = _init_option(blacklist, "trunk_prefix");
+	/* the rules are normalized as per the numbering plan */
+	_destroy_trie(blacklist->trie);
+	blacklist->trie = NULL;
+	g_hash_table_foreach(blacklist->rules, _plan_foreach, blacklist);
+}
+
+static void _plan_foreach(gpointer key, gpointer value, gpointer data)
+{
+	Blacklist * blacklist = data;
+	BlacklistRule * rule = value;
+	(void) key;
+
+	/* rules not applying anymore are still matched literally */
+	_rule_set_apply(blacklist, rule, TRUE);
+}
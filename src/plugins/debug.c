@@ -96,6 +96,7 @@ static struct
 	{ "Message list",	MODEM_EVENT_TYPE_MESSAGE	},
 	{ "Model",		MODEM_EVENT_TYPE_MODEL		},
 	{ "Registration",	MODEM_EVENT_TYPE_REGISTRATION	},
+	{ "Statistics",		MODEM_EVENT_TYPE_STATISTICS	},
 	{ "Status",		MODEM_EVENT_TYPE_STATUS		},
 	{ NULL,			0				}
 };
@@ -114,6 +115,7 @@ static DebugModemEvent _debug_modem_events[] =
 	{ MODEM_EVENT_TYPE_MESSAGE_SENT,	"MESSAGE_SENT"		},
 	{ MODEM_EVENT_TYPE_MODEL,		"MODEL"			},
 	{ MODEM_EVENT_TYPE_REGISTRATION,	"REGISTRATION"		},
+	{ MODEM_EVENT_TYPE_STATISTICS,		"STATISTICS"		},
 	{ MODEM_EVENT_TYPE_STATUS,		"STATUS"		},
 	{ 0,					NULL			},
 };
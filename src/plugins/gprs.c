@@ -54,6 +54,7 @@
 typedef struct _PhonePlugin
 {
 	PhonePluginHelper * helper;
+	PhoneConfigSection * config;
 	guint source;
 	gboolean roaming;
 	gboolean connected;
@@ -149,6 +150,7 @@ static GPRS * _gprs_init(PhonePluginHelper * helper)
 	if((gprs = object_new(sizeof(*gprs))) == NULL)
 		return NULL;
 	gprs->helper = helper;
+	gprs->config = helper->config_section(helper->phone, "gprs");
 	gprs->source = 0;
 	gprs->roaming = FALSE;
 	gprs->connected = FALSE;
@@ -174,7 +176,8 @@ static GPRS * _gprs_init(PhonePluginHelper * helper)
 				_gprs_on_activate), gprs);
 	g_signal_connect(gprs->icon, "popup-menu", G_CALLBACK(
 				_gprs_on_popup_menu), gprs);
-	active = ((p = helper->config_get(helper->phone, "gprs", "systray"))
+	active = ((p = helper->config_section_get(helper->phone, gprs->config,
+					"systray"))
 			!= NULL && strtoul(p, NULL, 10) != 0) ? TRUE : FALSE;
 	gtk_status_icon_set_visible(gprs->icon, active);
 #endif
@@ -272,12 +275,12 @@ static void _gprs_event_modem_operator(GPRS * gprs, char const * _operator)
 				== NULL || strlen(p) == 0)
 			&& ((p = gtk_entry_get_text(GTK_ENTRY(gprs->password)))
 				== NULL || strlen(p) == 0)
-			&& helper->config_get(helper->phone, "gprs", "apn")
-			== NULL
-			&& helper->config_get(helper->phone, "gprs", "username")
-			== NULL
-			&& helper->config_get(helper->phone, "gprs", "password")
-			== NULL)
+			&& helper->config_section_get(helper->phone,
+				gprs->config, "apn") == NULL
+			&& helper->config_section_get(helper->phone,
+				gprs->config, "username") == NULL
+			&& helper->config_section_get(helper->phone,
+				gprs->config, "password") == NULL)
 		_gprs_load_defaults(gprs);
 }
 
@@ -520,17 +523,18 @@ static void _settings_on_apply(gpointer data)
 	char const * p;
 
 	active = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(gprs->attach));
-	helper->config_set(helper->phone, "gprs", "attach", active ? "1" : "0");
+	helper->config_section_set(helper->phone, gprs->config, "attach",
+			active ? "1" : "0");
 	p = gtk_entry_get_text(GTK_ENTRY(gprs->apn));
-	helper->config_set(helper->phone, "gprs", "apn", p);
+	helper->config_section_set(helper->phone, gprs->config, "apn", p);
 	p = gtk_entry_get_text(GTK_ENTRY(gprs->username));
-	helper->config_set(helper->phone, "gprs", "username", p);
+	helper->config_section_set(helper->phone, gprs->config, "username", p);
 	p = gtk_entry_get_text(GTK_ENTRY(gprs->password));
-	helper->config_set(helper->phone, "gprs", "password", p);
+	helper->config_section_set(helper->phone, gprs->config, "password", p);
 #if GTK_CHECK_VERSION(2, 10, 0)
 	active = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(gprs->systray));
-	helper->config_set(helper->phone, "gprs", "systray", active
-			? "1" : "0");
+	helper->config_section_set(helper->phone, gprs->config, "systray",
+			active ? "1" : "0");
 	gtk_status_icon_set_visible(gprs->icon, active);
 #endif
 	_gprs_access_point(gprs);
@@ -546,20 +550,25 @@ static void _settings_on_cancel(gpointer data)
 	gboolean active;
 
 	gtk_widget_hide(gprs->window);
-	active = ((p = helper->config_get(helper->phone, "gprs", "attach"))
+	active = ((p = helper->config_section_get(helper->phone, gprs->config,
+					"attach"))
 			!= NULL && strtoul(p, NULL, 10) != 0) ? TRUE : FALSE;
 	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(gprs->attach), active);
-	if((p = helper->config_get(helper->phone, "gprs", "apn")) == NULL)
+	if((p = helper->config_section_get(helper->phone, gprs->config,
+					"apn")) == NULL)
 		p = "";
 	gtk_entry_set_text(GTK_ENTRY(gprs->apn), p);
-	if((p = helper->config_get(helper->phone, "gprs", "username")) == NULL)
+	if((p = helper->config_section_get(helper->phone, gprs->config,
+					"username")) == NULL)
 		p = "";
 	gtk_entry_set_text(GTK_ENTRY(gprs->username), p);
-	if((p = helper->config_get(helper->phone, "gprs", "password")) == NULL)
+	if((p = helper->config_section_get(helper->phone, gprs->config,
+					"password")) == NULL)
 		p = "";
 	gtk_entry_set_text(GTK_ENTRY(gprs->password), p);
 #if GTK_CHECK_VERSION(2, 10, 0)
-	active = ((p = helper->config_get(helper->phone, "gprs", "systray"))
+	active = ((p = helper->config_section_get(helper->phone, gprs->config,
+					"systray"))
 			!= NULL && strtoul(p, NULL, 10) != 0) ? TRUE : FALSE;
 	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(gprs->systray), active);
 #endif
@@ -693,7 +702,8 @@ static int _gprs_access_point(GPRS * gprs)
 	char const * p;
 	ModemRequest request;
 
-	if((p = helper->config_get(helper->phone, "gprs", "apn")) == NULL)
+	if((p = helper->config_section_get(helper->phone, gprs->config,
+					"apn")) == NULL)
 		return 0;
 	memset(&request, 0, sizeof(request));
 	request.type = MODEM_REQUEST_AUTHENTICATE;
@@ -704,9 +714,9 @@ static int _gprs_access_point(GPRS * gprs)
 	ret |= helper->request(helper->phone, &request);
 	/* set the credentials */
 	request.authenticate.name = "GPRS";
-	p = helper->config_get(helper->phone, "gprs", "username");
+	p = helper->config_section_get(helper->phone, gprs->config, "username");
 	request.authenticate.username = p;
-	p = helper->config_get(helper->phone, "gprs", "password");
+	p = helper->config_section_get(helper->phone, gprs->config, "password");
 	request.authenticate.password = p;
 	ret |= helper->request(helper->phone, &request);
 	return ret;
@@ -761,10 +771,12 @@ static void _gprs_counters_load(GPRS * gprs)
 	char const * p;
 
 	gprs->glin = 0;
-	if((p = helper->config_get(helper->phone, "gprs", "in")) != NULL)
+	if((p = helper->config_section_get(helper->phone, gprs->config,
+					"in")) != NULL)
 		gprs->glin = strtol(p, NULL, 10);
 	gprs->glout = 0;
-	if((p = helper->config_get(helper->phone, "gprs", "out")) != NULL)
+	if((p = helper->config_section_get(helper->phone, gprs->config,
+					"out")) != NULL)
 		gprs->glout = strtol(p, NULL, 10);
 }
 
@@ -776,9 +788,9 @@ static void _gprs_counters_save(GPRS * gprs)
 	char buf[16];
 
 	snprintf(buf, sizeof(buf), "%lu", gprs->glin);
-	helper->config_set(helper->phone, "gprs", "in", buf);
+	helper->config_section_set(helper->phone, gprs->config, "in", buf);
 	snprintf(buf, sizeof(buf), "%lu", gprs->glout);
-	helper->config_set(helper->phone, "gprs", "out", buf);
+	helper->config_section_set(helper->phone, gprs->config, "out", buf);
 }
 
 
@@ -61,6 +61,7 @@
 typedef struct _PhonePlugin
 {
 	PhonePluginHelper * helper;
+	PhoneConfigSection * config;
 
 	GtkWidget * window;
 	GtkWidget * deepsleep;
@@ -122,6 +123,7 @@ static Openmoko * _openmoko_init(PhonePluginHelper * helper)
 	if((openmoko = object_new(sizeof(*openmoko))) == NULL)
 		return NULL;
 	openmoko->helper = helper;
+	openmoko->config = helper->config_section(helper->phone, "openmoko");
 	openmoko->window = NULL;
 	_openmoko_mixer_open(openmoko);
 	_openmoko_power(openmoko, TRUE);
@@ -348,7 +350,8 @@ static void _openmoko_deepsleep(Openmoko * openmoko)
 	char const * cmd = "AT%SLEEP=4"; /* allow deep sleep */
 	char const * p;
 
-	if((p = helper->config_get(helper->phone, "openmoko", "deepsleep"))
+	if((p = helper->config_section_get(helper->phone, openmoko->config,
+					"deepsleep"))
 			!= NULL && strtoul(p, NULL, 10) != 0)
 		cmd = "AT%SLEEP=2"; /* prevent deep sleep */
 	/* XXX this may reset the hardware modem */
@@ -458,8 +461,9 @@ static int _openmoko_mixer_open(Openmoko * openmoko)
 	openmoko->mixer_elem = NULL;
 	openmoko->mixer_elem_headphone = NULL;
 	openmoko->mixer_elem_speaker = NULL;
-	if((audio_device = helper->config_get(helper->phone, "openmoko",
-					"audio_device")) == NULL)
+	if((audio_device = helper->config_section_get(helper->phone,
+					openmoko->config, "audio_device"))
+			== NULL)
 		audio_device = "hw:0";
 	if(snd_mixer_open(&openmoko->mixer, 0) != 0)
 	{
@@ -635,8 +639,8 @@ static void _settings_on_apply(gpointer data)
 	/* deepsleep */
 	value = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(
 				openmoko->deepsleep));
-	openmoko->helper->config_set(openmoko->helper->phone, "openmoko",
-			"deepsleep", value ? "1" : "0");
+	openmoko->helper->config_section_set(openmoko->helper->phone,
+			openmoko->config, "deepsleep", value ? "1" : "0");
 	_openmoko_deepsleep(openmoko);
 	/* hardware */
 	value = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(
@@ -665,8 +669,8 @@ static void _settings_on_cancel(gpointer data)
 
 	gtk_widget_hide(openmoko->window);
 	/* deepsleep */
-	if((p = openmoko->helper->config_get(openmoko->helper->phone,
-					"openmoko", "deepsleep")) != NULL
+	if((p = openmoko->helper->config_section_get(openmoko->helper->phone,
+					openmoko->config, "deepsleep")) != NULL
 			&& strtoul(p, NULL, 10) != 0)
 		gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(
 					openmoko->deepsleep), TRUE);
@@ -29,6 +29,8 @@
 
 #ifndef __APPLE__
 # include <sys/ioctl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
 # include <sys/soundcard.h>
 #endif
 #include <fcntl.h>
@@ -57,13 +59,42 @@
 /* OSS */
 /* private */
 /* types */
+typedef struct _OSSSample
+{
+	char * name;
+
+	/* format */
+	int format;
+	int channels;
+	int rate;
+	uint32_t bytes;				/* per second */
+
+	/* data */
+	void * map;
+	size_t map_size;
+	uint8_t const * data;
+	size_t size;
+} OSSSample;
+
 typedef struct _PhonePlugin
 {
 	PhonePluginHelper * helper;
+	PhoneConfigSection * config;
 	GtkWidget * window;
 	GtkWidget * sound;
 	GtkWidget * mixer;
 	int fd;
+
+	/* samples */
+	OSSSample * samples;
+	size_t samples_cnt;
+
+	/* playback */
+	OSSSample const * play_sample;
+	size_t play_pos;
+	int play_fd;
+	GIOChannel * play_channel;
+	guint play_source;
 } OSS;
 
 #pragma pack(1)
@@ -91,11 +122,38 @@ typedef struct _WaveFormat
 #define IBM_FORMAT_ADPCM	0x0103
 
 
+/* constants */
+#ifndef __APPLE__
+static char const _oss_samples_path[] = DATADIR "/sounds/" PACKAGE;
+
+/* the samples played by the dialer and the profiles */
+static char const * _oss_samples_preload[] =
+{
+	"0", "1", "2", "3", "4", "5", "6", "7", "8", "9",
+	"a", "b", "c", "d", "hash", "star",
+	"busy", "keytone", "ringback", "ringtone"
+};
+#endif
+
+
 /* prototypes */
 static OSS * _oss_init(PhonePluginHelper * helper);
 static void _oss_destroy(OSS * oss);
 static int _oss_event(OSS * oss, PhoneEvent * event);
 static int _oss_open(OSS * oss);
+#ifndef __APPLE__
+static int _oss_play_start(OSS * oss, OSSSample const * sample, int fd);
+static void _oss_play_stop(OSS * oss);
+static OSSSample * _oss_sample_add(OSS * oss, char const * path,
+		char const * name);
+static void _oss_sample_close(OSSSample * sample);
+static OSSSample * _oss_sample_find(OSS * oss, char const * name);
+static void _oss_sample_flush(OSS * oss);
+static OSSSample * _oss_sample_get(OSS * oss, char const * name);
+static int _oss_sample_open(OSSSample * sample, char const * path,
+		char const * name);
+static void _oss_sample_preload(OSS * oss, char const * path);
+#endif
 static void _oss_settings(OSS * oss);
 
 
@@ -123,9 +181,19 @@ static OSS * _oss_init(PhonePluginHelper * helper)
 	if((oss = object_new(sizeof(*oss))) == NULL)
 		return NULL;
 	oss->helper = helper;
+	oss->config = helper->config_section(helper->phone, "oss");
 	oss->window = NULL;
 	oss->fd = -1;
+	oss->samples = NULL;
+	oss->samples_cnt = 0;
+	oss->play_sample = NULL;
+	oss->play_fd = -1;
+	oss->play_channel = NULL;
+	oss->play_source = 0;
 	_oss_open(oss);
+#ifndef __APPLE__
+	_oss_sample_preload(oss, _oss_samples_path);
+#endif
 	return oss;
 }
 
@@ -133,6 +201,10 @@ static OSS * _oss_init(PhonePluginHelper * helper)
 /* oss_destroy */
 static void _oss_destroy(OSS * oss)
 {
+#ifndef __APPLE__
+	_oss_play_stop(oss);
+	_oss_sample_flush(oss);
+#endif
 	if(oss->fd >= 0)
 		close(oss->fd);
 	if(oss->window != NULL)
@@ -144,15 +216,9 @@ static void _oss_destroy(OSS * oss)
 /* oss_event */
 #ifndef __APPLE__
 static int _event_audio_play(OSS * oss, char const * sample);
-static int _event_audio_play_chunk(OSS * oss, FILE * fp);
-static int _event_audio_play_chunk_riff(OSS * oss, FILE * fp, RIFFChunk * rc);
-static int _event_audio_play_chunk_wave(OSS * oss, FILE * fp, RIFFChunk * rc);
 static int _event_audio_play_close(OSS * oss, int fd, int ret);
-static int _event_audio_play_file(OSS * oss, char const * filename);
-static int _event_audio_play_open(OSS * oss, char const * device, FILE * fp,
-		WaveFormat * wf, RIFFChunk * rc);
-static int _event_audio_play_write(OSS * oss, RIFFChunk * rc, RIFFChunk * rc2,
-		FILE * fp, int fd);
+static int _event_audio_play_open(OSS * oss, char const * device,
+		OSSSample const * sample);
 static int _event_volume_get(OSS * oss, gdouble * level);
 static int _event_volume_set(OSS * oss, gdouble level);
 #endif
@@ -166,6 +232,9 @@ static int _oss_event(OSS * oss, PhoneEvent * event)
 			/* XXX ignore errors */
 			_event_audio_play(oss, event->audio_play.sample);
 			return 0;
+		case PHONE_EVENT_TYPE_AUDIO_STOP:
+			_oss_play_stop(oss);
+			return 0;
 		case PHONE_EVENT_TYPE_VOLUME_GET:
 			/* XXX ignore errors */
 			_event_volume_get(oss, &event->volume_get.level);
@@ -184,157 +253,20 @@ static int _oss_event(OSS * oss, PhoneEvent * event)
 #ifndef __APPLE__
 static int _event_audio_play(OSS * oss, char const * sample)
 {
-	const char path[] = DATADIR "/sounds/" PACKAGE;
-	const char ext[] = ".wav";
-	String * s;
-	char buf[128];
-
-	if((s = string_new_append(path, "/", sample, ext, NULL)) == NULL)
-		return -oss->helper->error(NULL, error_get(NULL), 1);
-	/* play the audio file */
-	if(_event_audio_play_file(oss, s) != 0)
-	{
-		snprintf(buf, sizeof(buf), "%s: %s", s, strerror(errno));
-		oss->helper->error(NULL, buf, 1);
-		string_delete(s);
-		return -1;
-	}
-	string_delete(s);
-	return 0;
-}
-
-static int _event_audio_play_chunk(OSS * oss, FILE * fp)
-{
-	RIFFChunk rc;
-
-	if(fread(&rc, sizeof(rc.ckID) + sizeof(rc.ckSize), 1, fp) != 1)
-		return -1;
-#if 0 /* FIXME for big endian */
-	rc.ckSize = (rc.ckSize & 0xff000000) >> 24
-		| (rc.ckSize & 0xff0000) >> 8
-		| (rc.ckSize & 0xff00) << 8;
-	| (rc.ckSize & 0xff) << 24;
-#endif
-#ifdef DEBUG
-	fprintf(stderr, "DEBUG: chunk \"%c%c%c%c\"\n", rc.ckID[0],
-			rc.ckID[1], rc.ckID[2], rc.ckID[3]);
-#endif
-	if(strncmp(rc.ckID, "RIFF", 4) == 0)
-	{
-		if(_event_audio_play_chunk_riff(oss, fp, &rc) != 0)
-			return -1;
-	}
-	if(fseek(fp, rc.ckSize, SEEK_CUR) != 0)
-		return -1;
-	/* FIXME implement the padding byte */
-	return 0;
-}
-
-static int _event_audio_play_chunk_riff(OSS * oss, FILE * fp, RIFFChunk * rc)
-{
-	char riffid[4];
-	const char wave[4] = "WAVE";
-
-#ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s()\n", __func__);
-#endif
-	if(rc->ckSize < sizeof(riffid))
-		return -1;
-	if(fread(&riffid, sizeof(riffid), 1, fp) != 1)
-		return -oss->helper->error(NULL, strerror(errno), 1);
-	rc->ckSize -= sizeof(riffid);
-	if(strncmp(riffid, wave, sizeof(wave)) == 0)
-		return _event_audio_play_chunk_wave(oss, fp, rc);
-	/* skip the rest of the chunk */
-	if(fseek(fp, rc->ckSize, SEEK_CUR) != 0)
-		return -1;
-	rc->ckSize = 0;
-	return 0;
-}
-
-static int _event_audio_play_chunk_wave(OSS * oss, FILE * fp, RIFFChunk * rc)
-{
-	RIFFChunk rc2;
+	OSSSample const * s;
 	char const * dev;
-	const char data[4] = "data";
-	const char fmt[4] = "fmt ";
-	WaveFormat wf;
-	int fd = -1;
-
-	while(rc->ckSize > 0)
-	{
-		/* read the current WAVE chunk */
-		if(rc->ckSize < sizeof(rc2))
-			return -_event_audio_play_close(oss, fd, 1);
-		if(fread(&rc2, sizeof(rc2), 1, fp) != 1)
-		{
-			oss->helper->error(NULL, strerror(errno), 1);
-			return -_event_audio_play_close(oss, fd, 1);
-		}
-#if 0 /* FIXME for big endian */
-		/* FIXME implement */
-#endif
-		rc->ckSize -= sizeof(rc2);
-		/* interpret the WAVE chunk */
-#ifdef DEBUG
-		fprintf(stderr, "DEBUG: wave chunk \"%c%c%c%c\"\n", rc2.ckID[0],
-				rc2.ckID[1], rc2.ckID[2], rc2.ckID[3]);
-#endif
-		if(strncmp(rc2.ckID, fmt, sizeof(fmt)) == 0)
-		{
-			if(fd >= 0)
-				return -_event_audio_play_close(oss, fd, 1);
-			if(rc->ckSize < sizeof(wf)
-					|| rc2.ckSize < sizeof(wf)
-					|| fread(&wf, sizeof(wf), 1, fp) != 1)
-				return -1;
-#if 0 /* FIXME for big endian */
-			/* FIXME implement */
-#endif
-			rc->ckSize -= sizeof(wf);
-			rc2.ckSize -= sizeof(wf);
-#ifdef DEBUG
-			fprintf(stderr, "DEBUG: format 0x%04x, %u channels\n",
-					wf.wFormatTag, wf.wChannels);
-			fprintf(stderr, "DEBUG: %u %u\n", rc->ckSize, rc2.ckSize);
-#endif
-			dev = oss->helper->config_get(oss->helper->phone, "oss",
-					"device");
-			if((fd = _event_audio_play_open(oss, dev, fp, &wf,
-							&rc2)) < 0)
-				return -1;
-		}
-		else if(strncmp(rc2.ckID, data, sizeof(data)) == 0)
-		{
-#if 0 /* FIXME for big endian */
-			/* FIXME implement */
-#endif
-			if(fd < 0)
-				return -1;
-			if(_event_audio_play_write(oss, rc, &rc2, fp, fd) != 0)
-				return -_event_audio_play_close(oss, fd, 1);
-		}
-		/* skip the rest of the chunk */
-		if(fseek(fp, rc2.ckSize, SEEK_CUR) != 0)
-			return -_event_audio_play_close(oss, fd, 1);
-		rc->ckSize -= rc2.ckSize;
-		rc2.ckSize = 0;
-	}
-	return _event_audio_play_close(oss, fd, 0);
-}
-
-static int _event_audio_play_file(OSS * oss, char const * filename)
-{
-	FILE * fp;
+	int fd;
 
-	/* open the audio file */
-	if((fp = fopen(filename, "rb")) == NULL)
-		return -1;
-	/* go through every chunk */
-	while(_event_audio_play_chunk(oss, fp) == 0);
-	if(fclose(fp) != 0)
+	/* new samples interrupt the current one */
+	_oss_play_stop(oss);
+	if((s = _oss_sample_get(oss, sample)) == NULL)
+		return -oss->helper->error(NULL, error_get(NULL), 1);
+	dev = oss->helper->config_section_get(oss->helper->phone, oss->config,
+			"device");
+	if((fd = _event_audio_play_open(oss, dev, s)) < 0)
 		return -1;
-	return 0;
+	/* the sample is played asynchronously */
+	return _oss_play_start(oss, s, fd);
 }
 
 static int _event_audio_play_close(OSS * oss, int fd, int ret)
@@ -344,8 +276,8 @@ static int _event_audio_play_close(OSS * oss, int fd, int ret)
 	return ret;
 }
 
-static int _event_audio_play_open(OSS * oss, char const * device, FILE * fp,
-		WaveFormat * wf, RIFFChunk * rc)
+static int _event_audio_play_open(OSS * oss, char const * device,
+		OSSSample const * sample)
 {
 #ifdef __NetBSD__
 	const char devdsp[] = "/dev/sound";
@@ -353,36 +285,13 @@ static int _event_audio_play_open(OSS * oss, char const * device, FILE * fp,
 	const char devdsp[] = "/dev/dsp";
 #endif
 	int fd;
-	int format;
-	int channels;
-	int samplerate;
+	int format = sample->format;
+	int channels = sample->channels;
+	int samplerate = sample->rate;
 	char buf[128];
-	uint16_t bps;
 
 	device = (device != NULL) ? device : devdsp;
-	switch(wf->wFormatTag)
-	{
-		case WAVE_FORMAT_PCM:
-			if(rc == NULL || rc->ckSize < sizeof(bps)
-					|| fread(&bps, sizeof(bps), 1, fp) != 1)
-				return -oss->helper->error(NULL,
-						"Invalid WAVE file", 1);
-			rc->ckSize -= sizeof(bps);
-			/* FIXME for big endian */
-#ifdef DEBUG
-			fprintf(stderr, "DEBUG: %s() %u\n", __func__, bps);
-#endif
-			/* FIXME may be wrong */
-			format = (bps == 8) ? AFMT_U8
-				: ((bps == 16) ? AFMT_S16_LE : AFMT_U8);
-			break;
-		default:
-			return -oss->helper->error(NULL,
-					"Unsupported WAVE format", 1);
-	}
-	channels = wf->wChannels;
-	samplerate = wf->dwSamplesPerSec;
-	if((fd = open(device, O_WRONLY)) < 0)
+	if((fd = open(device, O_WRONLY | O_NONBLOCK)) < 0)
 	{
 		snprintf(buf, sizeof(buf), "%s: %s", device, strerror(errno));
 		return -oss->helper->error(NULL, buf, 1);
@@ -398,26 +307,6 @@ static int _event_audio_play_open(OSS * oss, char const * device, FILE * fp,
 	return fd;
 }
 
-static int _event_audio_play_write(OSS * oss, RIFFChunk * rc, RIFFChunk * rc2,
-		FILE * fp, int fd)
-{
-	uint8_t u8[4096];
-	size_t s;
-	ssize_t ss;
-
-	for(; (s = min(sizeof(u8), rc2->ckSize)) > 0;
-			rc->ckSize -= s, rc2->ckSize -= s)
-	{
-		if((s = fread(&u8, sizeof(*u8), s, fp)) == 0)
-			return -1;
-		if((ss = write(fd, &u8, s)) < 0)
-			return -oss->helper->error(NULL, strerror(errno), 1);
-		else if((size_t)ss != s) /* XXX */
-			return -1;
-	}
-	return 0;
-}
-
 static int _event_volume_get(OSS * oss, gdouble * level)
 {
 	int v;
@@ -463,8 +352,8 @@ static int _oss_open(OSS * oss)
 
 	if(oss->fd >= 0 && close(oss->fd) != 0)
 		oss->helper->error(NULL, strerror(errno), 1);
-	if((p = oss->helper->config_get(oss->helper->phone, "oss", "mixer"))
-			== NULL)
+	if((p = oss->helper->config_section_get(oss->helper->phone, oss->config,
+					"mixer")) == NULL)
 		p = "/dev/mixer";
 	if((oss->fd = open(p, O_RDWR)) < 0)
 	{
@@ -475,6 +364,280 @@ static int _oss_open(OSS * oss)
 }
 
 
+#ifndef __APPLE__
+/* oss_play_start */
+static gboolean _play_on_drained(gpointer data);
+static gboolean _play_on_write(GIOChannel * source, GIOCondition condition,
+		gpointer data);
+
+static int _oss_play_start(OSS * oss, OSSSample const * sample, int fd)
+{
+	oss->play_sample = sample;
+	oss->play_pos = 0;
+	oss->play_fd = fd;
+	oss->play_channel = g_io_channel_unix_new(fd);
+	g_io_channel_set_encoding(oss->play_channel, NULL, NULL);
+	g_io_channel_set_buffered(oss->play_channel, FALSE);
+	oss->play_source = g_io_add_watch(oss->play_channel,
+			G_IO_OUT | G_IO_ERR | G_IO_HUP, _play_on_write, oss);
+	return 0;
+}
+
+static gboolean _play_on_drained(gpointer data)
+{
+	OSS * oss = data;
+
+	oss->play_source = 0;
+	_oss_play_stop(oss);
+	return FALSE;
+}
+
+static gboolean _play_on_write(GIOChannel * source, GIOCondition condition,
+		gpointer data)
+{
+	OSS * oss = data;
+	OSSSample const * sample = oss->play_sample;
+	ssize_t ss;
+	int delay = 0;
+	(void) source;
+
+	if(condition != G_IO_OUT)
+	{
+		oss->play_source = 0;
+		_oss_play_stop(oss);
+		return FALSE;
+	}
+	if(oss->play_pos == sample->size)
+	{
+		/* let the device play what is left before closing */
+		if(ioctl(oss->play_fd, SNDCTL_DSP_GETODELAY, &delay) < 0)
+			delay = 0;
+		oss->play_source = g_timeout_add((sample->bytes != 0)
+				? (guint64)delay * 1000 / sample->bytes : 0,
+				_play_on_drained, oss);
+		return FALSE;
+	}
+	if((ss = write(oss->play_fd, &sample->data[oss->play_pos],
+					sample->size - oss->play_pos)) < 0)
+	{
+		if(errno == EAGAIN || errno == EINTR)
+			return TRUE;
+		oss->helper->error(NULL, strerror(errno), 1);
+		oss->play_source = 0;
+		_oss_play_stop(oss);
+		return FALSE;
+	}
+	oss->play_pos += ss;
+	return TRUE;
+}
+
+
+/* oss_play_stop */
+static void _oss_play_stop(OSS * oss)
+{
+	if(oss->play_source != 0)
+		g_source_remove(oss->play_source);
+	oss->play_source = 0;
+	if(oss->play_channel != NULL)
+		g_io_channel_unref(oss->play_channel);
+	oss->play_channel = NULL;
+	if(oss->play_fd >= 0)
+	{
+		/* discard what was not played yet */
+		ioctl(oss->play_fd, SNDCTL_DSP_RESET, NULL);
+		_event_audio_play_close(oss, oss->play_fd, 0);
+	}
+	oss->play_fd = -1;
+	oss->play_sample = NULL;
+}
+
+
+/* oss_sample_add */
+static OSSSample * _oss_sample_add(OSS * oss, char const * path,
+		char const * name)
+{
+	OSSSample * p;
+
+	if((p = realloc(oss->samples, sizeof(*p) * (oss->samples_cnt + 1)))
+			== NULL)
+	{
+		error_set_code(1, "%s", strerror(errno));
+		return NULL;
+	}
+	oss->samples = p;
+	p = &oss->samples[oss->samples_cnt];
+	if(_oss_sample_open(p, path, name) != 0)
+		return NULL;
+	oss->samples_cnt++;
+	return p;
+}
+
+
+/* oss_sample_close */
+static void _oss_sample_close(OSSSample * sample)
+{
+	if(sample->map != NULL)
+		munmap(sample->map, sample->map_size);
+	string_delete(sample->name);
+}
+
+
+/* oss_sample_find */
+static OSSSample * _oss_sample_find(OSS * oss, char const * name)
+{
+	size_t i;
+
+	for(i = 0; i < oss->samples_cnt; i++)
+		if(strcmp(oss->samples[i].name, name) == 0)
+			return &oss->samples[i];
+	return NULL;
+}
+
+
+/* oss_sample_flush */
+static void _oss_sample_flush(OSS * oss)
+{
+	size_t i;
+
+	for(i = 0; i < oss->samples_cnt; i++)
+		_oss_sample_close(&oss->samples[i]);
+	free(oss->samples);
+	oss->samples = NULL;
+	oss->samples_cnt = 0;
+}
+
+
+/* oss_sample_get */
+static OSSSample * _oss_sample_get(OSS * oss, char const * name)
+{
+	OSSSample * sample;
+
+	if((sample = _oss_sample_find(oss, name)) != NULL)
+		return sample;
+	/* the sample was not preloaded */
+	return _oss_sample_add(oss, _oss_samples_path, name);
+}
+
+
+/* oss_sample_open */
+static int _open_parse(OSSSample * sample, uint8_t const * buf, size_t size);
+
+static int _oss_sample_open(OSSSample * sample, char const * path,
+		char const * name)
+{
+	String * filename;
+	int fd;
+	struct stat st;
+	int res;
+
+	memset(sample, 0, sizeof(*sample));
+	if((filename = string_new_append(path, "/", name, ".wav", NULL))
+			== NULL)
+		return -1;
+	if((fd = open(filename, O_RDONLY)) < 0 || fstat(fd, &st) != 0)
+	{
+		res = -error_set_code(1, "%s: %s", filename, strerror(errno));
+		if(fd >= 0)
+			close(fd);
+		string_delete(filename);
+		return res;
+	}
+	sample->map_size = st.st_size;
+	if((sample->map = mmap(NULL, sample->map_size, PROT_READ, MAP_PRIVATE,
+					fd, 0)) == MAP_FAILED)
+	{
+		sample->map = NULL;
+		res = -error_set_code(1, "%s: %s", filename, strerror(errno));
+		close(fd);
+		string_delete(filename);
+		return res;
+	}
+	close(fd);
+	if(_open_parse(sample, sample->map, sample->map_size) != 0
+			|| (sample->name = string_new(name)) == NULL)
+	{
+		res = -error_set_code(1, "%s: %s", filename,
+				"Invalid WAVE file");
+		_oss_sample_close(sample);
+		string_delete(filename);
+		return res;
+	}
+	string_delete(filename);
+	/* fault the data in now rather than on the first key press */
+	posix_madvise(sample->map, sample->map_size, POSIX_MADV_WILLNEED);
+	return 0;
+}
+
+static int _open_parse(OSSSample * sample, uint8_t const * buf, size_t size)
+{
+	RIFFChunk rc;
+	WaveFormat wf;
+	uint16_t bps;
+	size_t pos;
+	int format = 0;
+
+	/* FIXME for big endian */
+	if(size < sizeof(rc) + 4)
+		return -1;
+	memcpy(&rc, buf, sizeof(rc));
+	if(strncmp(rc.ckID, "RIFF", 4) != 0
+			|| memcmp(&buf[sizeof(rc)], "WAVE", 4) != 0)
+		return -1;
+	size = min(size, sizeof(rc) + rc.ckSize);
+	for(pos = sizeof(rc) + 4; pos + sizeof(rc) <= size;
+			/* chunks are padded to an even size */
+			pos += rc.ckSize + (rc.ckSize & 0x1))
+	{
+		memcpy(&rc, &buf[pos], sizeof(rc));
+		pos += sizeof(rc);
+		if(rc.ckSize > size - pos)
+			return -1;
+#ifdef DEBUG
+		fprintf(stderr, "DEBUG: wave chunk \"%c%c%c%c\"\n", rc.ckID[0],
+				rc.ckID[1], rc.ckID[2], rc.ckID[3]);
+#endif
+		if(strncmp(rc.ckID, "fmt ", 4) == 0)
+		{
+			if(rc.ckSize < sizeof(wf) + sizeof(bps))
+				return -1;
+			memcpy(&wf, &buf[pos], sizeof(wf));
+			memcpy(&bps, &buf[pos + sizeof(wf)], sizeof(bps));
+			if(wf.wFormatTag != WAVE_FORMAT_PCM)
+				return -1;
+			/* FIXME may be wrong */
+			sample->format = (bps == 16) ? AFMT_S16_LE : AFMT_U8;
+			sample->channels = wf.wChannels;
+			sample->rate = wf.dwSamplesPerSec;
+			sample->bytes = wf.dwAvgBytesPerSec;
+			format = 1;
+		}
+		else if(strncmp(rc.ckID, "data", 4) == 0)
+		{
+			if(format == 0)
+				return -1;
+			sample->data = &buf[pos];
+			sample->size = rc.ckSize;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+
+/* oss_sample_preload */
+static void _oss_sample_preload(OSS * oss, char const * path)
+{
+	size_t i;
+
+	/* XXX ignore errors, missing samples are looked up again later */
+	for(i = 0; i < sizeof(_oss_samples_preload)
+			/ sizeof(*_oss_samples_preload); i++)
+		if(_oss_sample_find(oss, _oss_samples_preload[i]) == NULL)
+			_oss_sample_add(oss, path, _oss_samples_preload[i]);
+}
+#endif
+
+
 /* oss_settings */
 static void _on_settings_cancel(gpointer data);
 static gboolean _on_settings_closex(gpointer data);
@@ -561,12 +724,12 @@ static void _on_settings_cancel(gpointer data)
 	char const * p;
 
 	gtk_widget_hide(oss->window);
-	if((p = oss->helper->config_get(oss->helper->phone, "oss", "device"))
-			== NULL)
+	if((p = oss->helper->config_section_get(oss->helper->phone, oss->config,
+					"device")) == NULL)
 		p = devdsp;
 	gtk_file_chooser_set_filename(GTK_FILE_CHOOSER(oss->sound), p);
-	if((p = oss->helper->config_get(oss->helper->phone, "oss", "mixer"))
-			== NULL)
+	if((p = oss->helper->config_section_get(oss->helper->phone, oss->config,
+					"mixer")) == NULL)
 		p = "/dev/mixer";
 	gtk_file_chooser_set_filename(GTK_FILE_CHOOSER(oss->mixer), p);
 }
@@ -587,9 +750,11 @@ static void _on_settings_ok(gpointer data)
 	gtk_widget_hide(oss->window);
 	if((p = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(oss->sound)))
 			!= NULL)
-		oss->helper->config_set(oss->helper->phone, "oss", "device", p);
+		oss->helper->config_section_set(oss->helper->phone, oss->config,
+				"device", p);
 	if((p = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(oss->mixer)))
 			!= NULL)
-		oss->helper->config_set(oss->helper->phone, "oss", "mixer", p);
+		oss->helper->config_section_set(oss->helper->phone, oss->config,
+				"mixer", p);
 	_oss_open(oss);
 }
@@ -74,6 +74,7 @@ typedef enum _PanelSignal
 typedef struct _PhonePlugin
 {
 	PhonePluginHelper * helper;
+	PhoneConfigSection * config;
 
 #if defined(GDK_WINDOWING_X11)
 	guint timeout;
@@ -151,6 +152,7 @@ static Panel * _panel_init(PhonePluginHelper * helper)
 	if((panel = object_new(sizeof(*panel))) == NULL)
 		return NULL;
 	panel->helper = helper;
+	panel->config = helper->config_section(helper->phone, "panel");
 	panel->timeout = 0;
 	bold = pango_font_description_new();
 	pango_font_description_set_weight(bold, PANGO_WEIGHT_BOLD);
@@ -170,7 +172,8 @@ static Panel * _panel_init(PhonePluginHelper * helper)
 	panel->battery_image = gtk_image_new();
 	gtk_box_pack_start(GTK_BOX(panel->hbox), panel->battery_image, FALSE,
 			TRUE, 0);
-	if((p = helper->config_get(helper->phone, "panel", "battery")) == NULL
+	if((p = helper->config_section_get(helper->phone, panel->config,
+					"battery")) == NULL
 			|| strtol(p, NULL, 10) == 0)
 		gtk_widget_set_no_show_all(panel->battery_image, TRUE);
 	else if(_on_battery_timeout(panel) == TRUE)
@@ -183,7 +186,8 @@ static Panel * _panel_init(PhonePluginHelper * helper)
 			TRUE, 0);
 	/* operator */
 	panel->operator = gtk_label_new(NULL);
-	if((p = helper->config_get(helper->phone, "panel", "truncate")) != NULL
+	if((p = helper->config_section_get(helper->phone, panel->config,
+					"truncate")) != NULL
 			&& strtol(p, NULL, 10) != 0)
 		gtk_label_set_ellipsize(GTK_LABEL(panel->operator),
 				PANGO_ELLIPSIZE_END);
@@ -598,10 +602,12 @@ static void _on_settings_cancel(gpointer data)
 	char const * p;
 	gboolean active;
 
-	active = ((p = helper->config_get(helper->phone, "panel", "battery"))
+	active = ((p = helper->config_section_get(helper->phone, panel->config,
+					"battery"))
 			!= NULL && strtoul(p, NULL, 10) != 0) ? TRUE : FALSE;
 	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(panel->battery), active);
-	active = ((p = helper->config_get(helper->phone, "panel", "truncate"))
+	active = ((p = helper->config_section_get(helper->phone, panel->config,
+					"truncate"))
 			!= NULL && strtoul(p, NULL, 10) != 0) ? TRUE : FALSE;
 	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(panel->truncate),
 			active);
@@ -641,14 +647,14 @@ static void _on_settings_ok(gpointer data)
 		panel->battery_timeout = 0;
 	}
 	gtk_widget_set_no_show_all(panel->battery_image, !value);
-	helper->config_set(helper->phone, "panel", "battery", value
-			? "1" : "0");
+	helper->config_section_set(helper->phone, panel->config, "battery",
+			value ? "1" : "0");
 	/* truncate */
 	value = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(
 				panel->truncate));
 	gtk_label_set_ellipsize(GTK_LABEL(panel->operator), value
 			? PANGO_ELLIPSIZE_END : PANGO_ELLIPSIZE_NONE);
-	helper->config_set(helper->phone, "panel", "truncate", value
-			? "1" : "0");
+	helper->config_section_set(helper->phone, panel->config, "truncate",
+			value ? "1" : "0");
 }
 #endif
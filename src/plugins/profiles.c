@@ -91,6 +91,7 @@ typedef struct _ProfileDefinition
 typedef struct _PhonePlugin
 {
 	PhonePluginHelper * helper;
+	PhoneConfigSection * config;
 
 	guint source;
 
@@ -174,6 +175,7 @@ static Profiles * _profiles_init(PhonePluginHelper * helper)
 	if((profiles = object_new(sizeof(*profiles))) == NULL)
 		return NULL;
 	profiles->helper = helper;
+	profiles->config = helper->config_section(helper->phone, "profiles");
 	profiles->source = 0;
 	profiles->profiles = _profiles_definitions;
 	profiles->profiles_cnt = sizeof(_profiles_definitions)
@@ -619,8 +621,8 @@ static int _profiles_load(Profiles * profiles)
 
 	theme = gtk_icon_theme_get_default();
 	/* profiles */
-	if((p = helper->config_get(helper->phone, "profiles", "default"))
-			== NULL)
+	if((p = helper->config_section_get(helper->phone, profiles->config,
+					"default")) == NULL)
 		p = profiles->profiles[0].name;
 	gtk_list_store_clear(profiles->pr_store);
 	for(i = 0; i < profiles->profiles_cnt; i++)
@@ -711,7 +713,8 @@ static int _profiles_save(Profiles * profiles)
 	PhonePluginHelper * helper = profiles->helper;
 
 	/* default profile */
-	ret |= helper->config_set(helper->phone, "profiles", "default",
+	ret |= helper->config_section_set(helper->phone, profiles->config,
+			"default",
 			profiles->profiles[profiles->profiles_cur].name);
 	/* online */
 	ret |= helper->config_set(helper->phone, NULL, "online",
@@ -25,6 +25,7 @@
 
 
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -48,13 +49,21 @@ typedef enum _SMSCryptColumn
 #define SMSCC_LAST SMSCC_SECRET_PLACEHOLDER
 #define SMSCC_COUNT (SMSCC_LAST + 1)
 
+typedef enum _SMSCryptDirection
+{
+	SMSCD_DECRYPT = 0,
+	SMSCD_ENCRYPT
+} SMSCryptDirection;
+
 typedef struct _PhonePlugin
 {
 	PhonePluginHelper * helper;
+	PhoneConfigSection * config;
 
 	/* internal */
-	unsigned char buf[20];
+	unsigned char buf[SHA_DIGEST_LENGTH];
 	size_t len;
+	GHashTable * keys;
 	/* widgets */
 	GtkWidget * window;
 	GtkListStore * store;
@@ -62,12 +71,19 @@ typedef struct _PhonePlugin
 } SMSCrypt;
 
 
+/* constants */
+#define SMSCRYPT_KEYS_MAX	64
+
+
 /* prototypes */
+static void _smscrypt_cipher(SMSCrypt * smscrypt, SMSCryptDirection direction,
+		char * buf, size_t len);
 static void _smscrypt_clear(SMSCrypt * smscrypt);
 static gboolean _smscrypt_confirm(SMSCrypt * smscrypt, char const * message);
 static SMSCrypt * _smscrypt_init(PhonePluginHelper * helper);
 static void _smscrypt_destroy(SMSCrypt * smscrypt);
 static int _smscrypt_event(SMSCrypt * smscrypt, PhoneEvent * event);
+static void _smscrypt_key_delete(gpointer data);
 static int _smscrypt_secret(SMSCrypt * smscrypt, char const * number);
 static void _smscrypt_settings(SMSCrypt * smscrypt);
 
@@ -88,6 +104,52 @@ PhonePluginDefinition plugin =
 
 /* private */
 /* functions */
+/* smscrypt_cipher */
+/* the message is processed in blocks of SHA_DIGEST_LENGTH bytes: each block is
+ * XOR'ed with the key, and the key for the next block is the SHA-1 digest of
+ * the encrypted block */
+static void _cipher_xor(unsigned char * buf, unsigned char const * key);
+
+static void _smscrypt_cipher(SMSCrypt * smscrypt, SMSCryptDirection direction,
+		char * buf, size_t len)
+{
+	unsigned char * p = (unsigned char *)buf;
+	unsigned char next[SHA_DIGEST_LENGTH];
+	size_t i;
+
+	for(; len >= smscrypt->len; p += smscrypt->len, len -= smscrypt->len)
+		if(direction == SMSCD_ENCRYPT)
+		{
+			_cipher_xor(p, smscrypt->buf);
+			SHA1(p, smscrypt->len, smscrypt->buf);
+		}
+		else
+		{
+			SHA1(p, smscrypt->len, next);
+			_cipher_xor(p, smscrypt->buf);
+			memcpy(smscrypt->buf, next, sizeof(next));
+		}
+	/* the last block is incomplete */
+	for(i = 0; i < len; i++)
+		p[i] ^= smscrypt->buf[i];
+	memset(next, 0, sizeof(next));
+}
+
+static void _cipher_xor(unsigned char * buf, unsigned char const * key)
+{
+	uint32_t b[SHA_DIGEST_LENGTH / sizeof(uint32_t)];
+	uint32_t k[SHA_DIGEST_LENGTH / sizeof(uint32_t)];
+	size_t i;
+
+	/* let the compiler pick the widest loads and stores available */
+	memcpy(b, buf, sizeof(b));
+	memcpy(k, key, sizeof(k));
+	for(i = 0; i < sizeof(b) / sizeof(*b); i++)
+		b[i] ^= k[i];
+	memcpy(buf, b, sizeof(b));
+}
+
+
 /* smscrypt_clear */
 static void _smscrypt_clear(SMSCrypt * smscrypt)
 {
@@ -134,7 +196,10 @@ static SMSCrypt * _smscrypt_init(PhonePluginHelper * helper)
 	if((smscrypt = object_new(sizeof(*smscrypt))) == NULL)
 		return NULL;
 	smscrypt->helper = helper;
+	smscrypt->config = helper->config_section(helper->phone, "smscrypt");
 	smscrypt->len = sizeof(smscrypt->buf);
+	smscrypt->keys = g_hash_table_new_full(g_str_hash, g_str_equal, free,
+			_smscrypt_key_delete);
 	smscrypt->window = NULL;
 	smscrypt->store = gtk_list_store_new(SMSCC_COUNT, G_TYPE_STRING,
 			G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
@@ -160,6 +225,8 @@ static void _smscrypt_destroy(SMSCrypt * smscrypt)
 {
 	if(smscrypt->window != NULL)
 		gtk_widget_destroy(smscrypt->window);
+	g_hash_table_destroy(smscrypt->keys);
+	_smscrypt_clear(smscrypt);
 	object_delete(smscrypt);
 }
 
@@ -215,9 +282,6 @@ static int _smscrypt_event_sms_receiving(SMSCrypt * smscrypt,
 	PhonePluginHelper * helper = smscrypt->helper;
 	char const * error = "There is no known secret for this number."
 		" The message could not be decrypted.";
-	size_t i;
-	size_t j = 0;
-	SHA_CTX sha1;
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s(%u, buf, %lu)\n", __func__, *encoding,
@@ -227,17 +291,7 @@ static int _smscrypt_event_sms_receiving(SMSCrypt * smscrypt,
 		return 0; /* not for us */
 	if(_smscrypt_secret(smscrypt, number) != 0)
 		return helper->error(helper->phone, error, 1);
-	for(i = 0; i < *len; i++)
-	{
-		buf[i] ^= smscrypt->buf[j];
-		smscrypt->buf[j++] ^= buf[i];
-		if(j != smscrypt->len)
-			continue;
-		SHA1_Init(&sha1);
-		SHA1_Update(&sha1, smscrypt->buf, smscrypt->len);
-		SHA1_Final(smscrypt->buf, &sha1);
-		j = 0;
-	}
+	_smscrypt_cipher(smscrypt, SMSCD_DECRYPT, buf, *len);
 	*encoding = PHONE_ENCODING_UTF8;
 	_smscrypt_clear(smscrypt);
 	return 0;
@@ -249,9 +303,6 @@ static int _smscrypt_event_sms_sending(SMSCrypt * smscrypt,
 {
 	char const * confirm = "There is no secret defined for this number."
 		" The message will be sent unencrypted.\nContinue?";
-	size_t i;
-	size_t j = 0;
-	SHA_CTX sha1;
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s(\"%s\", %u, buf, %lu)\n", __func__, number,
@@ -261,41 +312,57 @@ static int _smscrypt_event_sms_sending(SMSCrypt * smscrypt,
 		return 0; /* not for us */
 	if(_smscrypt_secret(smscrypt, number) != 0)
 		return (_smscrypt_confirm(smscrypt, confirm) == TRUE) ? 0 : 1;
-	*encoding = PHONE_ENCODING_DATA;
-	for(i = 0; i < *len; i++)
-	{
-		buf[i] ^= smscrypt->buf[j];
-		smscrypt->buf[j++] = buf[i];
-		if(j != smscrypt->len)
-			continue;
-		SHA1_Init(&sha1);
-		SHA1_Update(&sha1, smscrypt->buf, smscrypt->len);
-		SHA1_Final(smscrypt->buf, &sha1);
-		j = 0;
-	}
+	_smscrypt_cipher(smscrypt, SMSCD_ENCRYPT, buf, *len);
 	*encoding = PHONE_ENCODING_DATA;
 	_smscrypt_clear(smscrypt);
 	return 0;
 }
 
 
+/* smscrypt_key_delete */
+static void _smscrypt_key_delete(gpointer data)
+{
+	memset(data, 0, SHA_DIGEST_LENGTH);
+	free(data);
+}
+
+
 /* smscrypt_secret */
+/* the digests of the secrets are cached per number, until the settings change */
 static int _smscrypt_secret(SMSCrypt * smscrypt, char const * number)
 {
 	PhonePluginHelper * helper = smscrypt->helper;
 	char const * secret = NULL;
-	SHA_CTX sha1;
+	unsigned char * key;
+	char * p;
 
-	if(number != NULL)
-		secret = helper->config_get(helper->phone, "smscrypt", number);
+	if(number == NULL)
+		number = "";
+	if((key = g_hash_table_lookup(smscrypt->keys, number)) != NULL)
+	{
+		memcpy(smscrypt->buf, key, smscrypt->len);
+		return 0;
+	}
+	if(number[0] != '\0')
+		secret = helper->config_section_get(helper->phone,
+				smscrypt->config, number);
 	if(secret == NULL)
-		secret = helper->config_get(helper->phone, "smscrypt",
-				"secret");
+		secret = helper->config_section_get(helper->phone,
+				smscrypt->config, "secret");
 	if(secret == NULL)
 		return 1;
-	SHA1_Init(&sha1);
-	SHA1_Update(&sha1, (unsigned char const *)secret, strlen(secret));
-	SHA1_Final(smscrypt->buf, &sha1);
+	SHA1((unsigned char const *)secret, strlen(secret), smscrypt->buf);
+	if(g_hash_table_size(smscrypt->keys) >= SMSCRYPT_KEYS_MAX)
+		g_hash_table_remove_all(smscrypt->keys);
+	if((key = malloc(SHA_DIGEST_LENGTH)) == NULL)
+		return 0;
+	if((p = strdup(number)) == NULL)
+	{
+		free(key);
+		return 0;
+	}
+	memcpy(key, smscrypt->buf, SHA_DIGEST_LENGTH);
+	g_hash_table_insert(smscrypt->keys, p, key);
 	return 0;
 }
 
@@ -401,7 +468,9 @@ static void _on_settings_delete(gpointer data)
 			SMSCC_NUMBER, &number, -1);
 	if(number == NULL)
 		return;
-	helper->config_set(helper->phone, "smscrypt", number, NULL);
+	helper->config_section_set(helper->phone, smscrypt->config, number,
+			NULL);
+	g_hash_table_remove_all(smscrypt->keys);
 	gtk_list_store_remove(smscrypt->store, &iter);
 	g_free(number);
 }
@@ -432,13 +501,16 @@ static void _on_settings_number_edited(GtkCellRenderer * renderer, gchar * arg1,
 	if(number == NULL)
 		return;
 	/* FIXME check that there are no duplicates */
-	secret = helper->config_get(helper->phone, "smscrypt", number);
+	secret = helper->config_section_get(helper->phone, smscrypt->config,
+			number);
 	/* XXX report errors */
-	if(helper->config_set(helper->phone, "smscrypt", arg2, secret) == 0
-			&& helper->config_set(helper->phone, "smscrypt", number,
-				NULL) == 0)
+	if(helper->config_section_set(helper->phone, smscrypt->config, arg2,
+					secret) == 0
+			&& helper->config_section_set(helper->phone,
+				smscrypt->config, number, NULL) == 0)
 		gtk_list_store_set(smscrypt->store, &iter,
 				SMSCC_NUMBER, arg2, -1);
+	g_hash_table_remove_all(smscrypt->keys);
 	g_free(number);
 }
 
@@ -456,8 +528,11 @@ static void _on_settings_secret_edited(GtkCellRenderer * renderer, gchar * arg1,
 	if(number == NULL)
 		return;
 	/* XXX report errors */
-	if(helper->config_set(helper->phone, "smscrypt", number, arg2) == 0)
+	if(helper->config_section_set(helper->phone, smscrypt->config, number,
+					arg2) == 0)
 		gtk_list_store_set(smscrypt->store, &iter, SMSCC_SECRET, arg2,
 				-1);
+	/* the default secret may apply to any number */
+	g_hash_table_remove_all(smscrypt->keys);
 	g_free(number);
 }
@@ -37,6 +37,7 @@
 # include <linux/videodev2.h>
 #endif
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #include <stdlib.h>
 #ifdef DEBUG
@@ -47,6 +48,8 @@
 #include <System.h>
 #include <Desktop.h>
 #include "Phone.h"
+#include "video/scale.h"
+#include "video/yuv.h"
 
 
 /* Video */
@@ -61,6 +64,7 @@ typedef struct _VideoBuffer
 typedef struct _PhonePlugin
 {
 	PhonePluginHelper * helper;
+	PhoneConfigSection * config;
 
 	String * device;
 	gboolean hflip;
@@ -75,22 +79,31 @@ typedef struct _PhonePlugin
 	struct v4l2_format format;
 #endif
 
-	/* I/O channel */
-	GIOChannel * channel;
+	/* capture thread */
+	GThread * thread;
+	gint running;
+	GMutex mutex;
+	String * thread_error;
 
 	/* input data */
-	/* XXX for mmap() */
 	VideoBuffer * buffers;
 	size_t buffers_cnt;
 	char * raw_buffer;
 	size_t raw_buffer_cnt;
 
 	/* RGB data */
-	unsigned char * rgb_buffer;
+	unsigned char * rgb_back;	/* written by the capture thread */
+	unsigned char * rgb_ready;	/* the newest frame, not displayed yet */
+	unsigned char * rgb_buffer;	/* the frame being displayed */
 	size_t rgb_buffer_cnt;
+	gboolean ready;
+	guint ready_source;
 
-	/* decoding */
-	int yuv_amp;
+	/* statistics */
+	unsigned long captured;
+	unsigned long converted;
+	unsigned long dropped;
+	unsigned long displayed;
 
 	/* widgets */
 	GtkWidget * window;
@@ -100,6 +113,7 @@ typedef struct _PhonePlugin
 	GtkWidget * area;
 	GtkAllocation area_allocation;
 	GdkPixbuf * pixbuf;
+	VideoScale * scale;
 #if !GTK_CHECK_VERSION(3, 0, 0)
 	GdkPixmap * pixmap;
 #endif
@@ -118,16 +132,15 @@ static int _video_ioctl(VideoPhonePlugin * video, unsigned long request,
 		void * data);
 #endif
 
+static void _video_close(VideoPhonePlugin * video);
 static void _video_start(VideoPhonePlugin * video);
 static void _video_stop(VideoPhonePlugin * video);
 
-/* callbacks */
 #ifndef __APPLE__
-static gboolean _video_on_can_mmap(GIOChannel * channel, GIOCondition condition,
-		gpointer data);
-static gboolean _video_on_can_read(GIOChannel * channel, GIOCondition condition,
-		gpointer data);
+static gpointer _video_thread(gpointer data);
 #endif
+
+/* callbacks */
 #if GTK_CHECK_VERSION(3, 0, 0)
 static gboolean _video_on_drawing_area_draw(GtkWidget * widget, cairo_t * cr,
 		gpointer data);
@@ -151,6 +164,8 @@ static gboolean _video_on_refresh(gpointer data);
 #else
 # define VIDEO_DEVICE	"/dev/video0"
 #endif
+#define VIDEO_BUFFERS		4
+#define VIDEO_POLL_TIMEOUT	100
 
 
 /* public */
@@ -181,16 +196,17 @@ static VideoPhonePlugin * _video_init(PhonePluginHelper * helper)
 	if((video = object_new(sizeof(*video))) == NULL)
 		return NULL;
 	video->helper = helper;
-	if((device = helper->config_get(helper->phone, "video", "device"))
-			== NULL)
+	video->config = helper->config_section(helper->phone, "video");
+	if((device = helper->config_section_get(helper->phone, video->config,
+					"device")) == NULL)
 		device = VIDEO_DEVICE;
-	p = helper->config_get(helper->phone, "video", "hflip");
+	p = helper->config_section_get(helper->phone, video->config, "hflip");
 	video->hflip = (p != NULL && p[0] != '\0' && strtol(p, NULL, 10) > 0)
 		? TRUE : FALSE;
-	p = helper->config_get(helper->phone, "video", "vflip");
+	p = helper->config_section_get(helper->phone, video->config, "vflip");
 	video->vflip = (p != NULL && p[0] != '\0' && strtol(p, NULL, 10) > 0)
 		? TRUE : FALSE;
-	p = helper->config_get(helper->phone, "video", "ratio");
+	p = helper->config_section_get(helper->phone, video->config, "ratio");
 	video->ratio = (p == NULL || p[0] == '\0' || strtol(p, NULL, 10) != 0)
 		? TRUE : FALSE;
 	video->interp = GDK_INTERP_BILINEAR;
@@ -199,14 +215,24 @@ static VideoPhonePlugin * _video_init(PhonePluginHelper * helper)
 #ifndef __APPLE__
 	memset(&video->cap, 0, sizeof(video->cap));
 #endif
-	video->channel = NULL;
+	video->thread = NULL;
+	video->running = 0;
+	g_mutex_init(&video->mutex);
+	video->thread_error = NULL;
 	video->buffers = NULL;
 	video->buffers_cnt = 0;
 	video->raw_buffer = NULL;
 	video->raw_buffer_cnt = 0;
+	video->rgb_back = NULL;
+	video->rgb_ready = NULL;
 	video->rgb_buffer = NULL;
 	video->rgb_buffer_cnt = 0;
-	video->yuv_amp = 255;
+	video->ready = FALSE;
+	video->ready_source = 0;
+	video->captured = 0;
+	video->converted = 0;
+	video->dropped = 0;
+	video->displayed = 0;
 	video->window = NULL;
 #if !GTK_CHECK_VERSION(3, 0, 0)
 	video->gc = NULL;
@@ -231,6 +257,7 @@ static VideoPhonePlugin * _video_init(PhonePluginHelper * helper)
 				_init_on_closex), video);
 	video->area = gtk_drawing_area_new();
 	video->pixbuf = NULL;
+	video->scale = NULL;
 #if !GTK_CHECK_VERSION(3, 0, 0)
 	video->pixmap = NULL;
 #endif
@@ -264,33 +291,24 @@ static gboolean _init_on_closex(gpointer data)
 /* video_destroy */
 static void _video_destroy(VideoPhonePlugin * video)
 {
-	size_t i;
-
 	_video_stop(video);
-	if(video->channel != NULL)
-	{
-		/* XXX we ignore errors at this point */
-		g_io_channel_shutdown(video->channel, TRUE, NULL);
-		g_io_channel_unref(video->channel);
-	}
 #if !GTK_CHECK_VERSION(3, 0, 0)
 	if(video->pixmap != NULL)
 		g_object_unref(video->pixmap);
 	if(video->gc != NULL)
 		g_object_unref(video->gc);
 #endif
+	if(video->scale != NULL)
+		videoscale_delete(video->scale);
+	if(video->pixbuf != NULL)
+		g_object_unref(video->pixbuf);
 	if(video->window != NULL)
 		gtk_widget_destroy(video->window);
-	if(video->fd >= 0)
-		close(video->fd);
-	if((char *)video->rgb_buffer != video->raw_buffer)
-		free(video->rgb_buffer);
-	for(i = 0; i < video->buffers_cnt; i++)
-		if(video->buffers[i].start != MAP_FAILED)
-			munmap(video->buffers[i].start,
-					video->buffers[i].length);
-	free(video->buffers);
+	free(video->rgb_back);
+	free(video->rgb_ready);
+	free(video->rgb_buffer);
 	free(video->raw_buffer);
+	g_mutex_clear(&video->mutex);
 	string_delete(video->device);
 	object_delete(video);
 }
@@ -321,10 +339,34 @@ static int _video_ioctl(VideoPhonePlugin * video, unsigned long request,
 #endif
 
 
+/* video_close */
+static void _video_close(VideoPhonePlugin * video)
+{
+#ifndef __APPLE__
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	size_t i;
+
+	if(video->buffers != NULL)
+		/* XXX we ignore errors at this point */
+		_video_ioctl(video, VIDIOC_STREAMOFF, &type);
+	for(i = 0; i < video->buffers_cnt; i++)
+		if(video->buffers[i].start != MAP_FAILED)
+			munmap(video->buffers[i].start,
+					video->buffers[i].length);
+	free(video->buffers);
+	video->buffers = NULL;
+	video->buffers_cnt = 0;
+#endif
+	if(video->fd >= 0)
+		close(video->fd);
+	video->fd = -1;
+}
+
+
 /* video_start */
 static void _video_start(VideoPhonePlugin * video)
 {
-	if(video->source != 0)
+	if(video->source != 0 || video->thread != NULL)
 		return;
 	video->source = g_idle_add(_video_on_open, video);
 }
@@ -336,76 +378,180 @@ static void _video_stop(VideoPhonePlugin * video)
 	if(video->source != 0)
 		g_source_remove(video->source);
 	video->source = 0;
+	if(video->thread != NULL)
+	{
+		/* the thread notices within VIDEO_POLL_TIMEOUT */
+		g_atomic_int_set(&video->running, 0);
+		g_thread_join(video->thread);
+		video->thread = NULL;
+#ifdef DEBUG
+		fprintf(stderr, "DEBUG: %s() %lu captured, %lu converted,"
+				" %lu dropped, %lu displayed\n", __func__,
+				video->captured, video->converted,
+				video->dropped, video->displayed);
+#endif
+	}
+	/* the capture thread is gone, no need to lock anymore */
+	if(video->ready_source != 0)
+		g_source_remove(video->ready_source);
+	video->ready_source = 0;
+	video->ready = FALSE;
+	string_delete(video->thread_error);
+	video->thread_error = NULL;
+	_video_close(video);
 }
 
 
-/* callbacks */
 #ifndef __APPLE__
-/* video_on_can_mmap */
-static gboolean _video_on_can_mmap(GIOChannel * channel, GIOCondition condition,
-		gpointer data)
+/* video_thread */
+/* captures and converts the frames away from the main loop: only the newest
+ * frame is ever converted, and handed over to _video_on_refresh() */
+static int _thread_error(VideoPhonePlugin * video, char const * message);
+static int _thread_mmap(VideoPhonePlugin * video);
+static void _thread_present(VideoPhonePlugin * video, unsigned long captured,
+		unsigned long dropped, gboolean frame);
+static int _thread_read(VideoPhonePlugin * video);
+static int _refresh_convert(VideoPhonePlugin * video, char const * raw,
+		size_t raw_cnt, unsigned char * rgb);
+
+static gpointer _video_thread(gpointer data)
 {
 	VideoPhonePlugin * video = data;
-	PhonePluginHelper * helper = video->helper;
+	struct pollfd pfd;
+	int res;
+
+	pfd.fd = video->fd;
+	pfd.events = POLLIN;
+	while(g_atomic_int_get(&video->running))
+	{
+		pfd.revents = 0;
+		if((res = poll(&pfd, 1, VIDEO_POLL_TIMEOUT)) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			_thread_error(video, strerror(errno));
+			break;
+		}
+		if(res == 0)
+			continue;
+		if(video->buffers != NULL)
+			res = _thread_mmap(video);
+		else
+			res = _thread_read(video);
+		if(res != 0)
+			break;
+	}
+	return NULL;
+}
+
+static int _thread_error(VideoPhonePlugin * video, char const * message)
+{
+	g_mutex_lock(&video->mutex);
+	if(video->thread_error == NULL)
+		video->thread_error = string_new_append(video->device, ": ",
+				message, NULL);
+	if(video->ready_source == 0)
+		video->ready_source = g_idle_add(_video_on_refresh, video);
+	g_mutex_unlock(&video->mutex);
+	return -1;
+}
+
+static int _thread_mmap(VideoPhonePlugin * video)
+{
 	struct v4l2_buffer buf;
+	struct v4l2_buffer newest;
+	gboolean found = FALSE;
+	unsigned long captured = 0;
+	unsigned long dropped = 0;
+	int res;
 
-	if(channel != video->channel || condition != G_IO_IN)
-		return FALSE;
-	if(_video_ioctl(video, VIDIOC_DQBUF, &buf) == -1)
+	/* dequeue every frame available and keep only the newest */
+	for(;;)
 	{
-		helper->error(helper->phone, "Could not save picture", 1);
-		return FALSE;
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		if(_video_ioctl(video, VIDIOC_DQBUF, &buf) == -1)
+		{
+			if(errno == EAGAIN)
+				break;
+			return _thread_error(video, strerror(errno));
+		}
+		captured++;
+		if(found)
+		{
+			/* this frame is stale already */
+			dropped++;
+			if(_video_ioctl(video, VIDIOC_QBUF, &newest) == -1)
+				return _thread_error(video, strerror(errno));
+		}
+		newest = buf;
+		found = TRUE;
 	}
-	video->raw_buffer = video->buffers[buf.index].start;
-	video->raw_buffer_cnt = buf.bytesused;
-# if 0 /* FIXME the raw buffer is not meant to be free()'d */
-	video->source = g_idle_add(_video_on_refresh, video);
-	return FALSE;
-# else
-	_video_on_refresh(video);
-	video->raw_buffer = NULL;
-	video->raw_buffer_cnt = 0;
-	return TRUE;
-# endif
+	if(found == FALSE)
+		return 0;
+	if(newest.index < video->buffers_cnt)
+		res = _refresh_convert(video,
+				video->buffers[newest.index].start,
+				newest.bytesused, video->rgb_back);
+	else
+		res = -1;
+	if(res != 0)
+		dropped++;
+	if(_video_ioctl(video, VIDIOC_QBUF, &newest) == -1)
+		return _thread_error(video, strerror(errno));
+	_thread_present(video, captured, dropped, (res == 0) ? TRUE : FALSE);
+	return 0;
 }
 
+static void _thread_present(VideoPhonePlugin * video, unsigned long captured,
+		unsigned long dropped, gboolean frame)
+{
+	unsigned char * p;
 
-/* video_on_can_read */
-static gboolean _video_on_can_read(GIOChannel * channel, GIOCondition condition,
-		gpointer data)
+	g_mutex_lock(&video->mutex);
+	video->captured += captured;
+	video->dropped += dropped;
+	if(frame)
+	{
+		video->converted++;
+		/* the previous frame was never displayed */
+		if(video->ready)
+			video->dropped++;
+		p = video->rgb_ready;
+		video->rgb_ready = video->rgb_back;
+		video->rgb_back = p;
+		video->ready = TRUE;
+		if(video->ready_source == 0)
+			video->ready_source = g_idle_add(_video_on_refresh,
+					video);
+	}
+	g_mutex_unlock(&video->mutex);
+}
+
+static int _thread_read(VideoPhonePlugin * video)
 {
-	VideoPhonePlugin * video = data;
-	PhonePluginHelper * helper = video->helper;
 	ssize_t s;
+	int res;
 
-# ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s()\n", __func__);
-# endif
-	if(channel != video->channel || condition != G_IO_IN)
-		return FALSE;
-	if((s = read(video->fd, video->raw_buffer, video->raw_buffer_cnt))
-			<= 0)
+	if((s = read(video->fd, video->raw_buffer, video->raw_buffer_cnt)) < 0)
 	{
 		/* this error can be ignored */
 		if(errno == EAGAIN)
-			return TRUE;
-		close(video->fd);
-		video->fd = -1;
-		/* FIXME also free video->buffers */
-		helper->error(helper->phone, strerror(errno), 1);
-		video->source = 0;
-		return FALSE;
+			return 0;
+		return _thread_error(video, strerror(errno));
 	}
-# ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s() %lu %ld\n", __func__,
-			video->raw_buffer_cnt, s);
-# endif
-	video->source = g_idle_add(_video_on_refresh, video);
-	return FALSE;
+	if(s == 0)
+		return _thread_error(video, "End of stream");
+	res = _refresh_convert(video, video->raw_buffer, s, video->rgb_back);
+	_thread_present(video, 1, (res == 0) ? 0 : 1,
+			(res == 0) ? TRUE : FALSE);
+	return 0;
 }
 #endif
 
 
+/* callbacks */
 #if GTK_CHECK_VERSION(3, 0, 0)
 /* video_on_drawing_area_draw */
 static gboolean _video_on_drawing_area_draw(GtkWidget * widget, cairo_t * cr,
@@ -479,10 +625,9 @@ static gboolean _video_on_drawing_area_expose(GtkWidget * widget,
 
 /* video_on_open */
 static int _open_setup(VideoPhonePlugin * video);
-#ifdef NOTYET
-static int _open_setup_mmap(VideoPhonePlugin * video);
-#endif
 #ifndef __APPLE__
+static int _open_setup_frames(VideoPhonePlugin * video);
+static int _open_setup_mmap(VideoPhonePlugin * video);
 static int _open_setup_read(VideoPhonePlugin * video);
 #endif
 
@@ -491,11 +636,14 @@ static gboolean _video_on_open(gpointer data)
 	const int timeout = 10000;
 	VideoPhonePlugin * video = data;
 	PhonePluginHelper * helper = video->helper;
+#ifndef __APPLE__
+	GError * error = NULL;
+#endif
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s() \"%s\"\n", __func__, video->device);
 #endif
-	if((video->fd = open(video->device, O_RDWR)) < 0)
+	if((video->fd = open(video->device, O_RDWR | O_NONBLOCK)) < 0)
 	{
 		error_set_code(1, "%s: %s (%s)", video->device,
 				"Could not open the video capture device",
@@ -507,8 +655,7 @@ static gboolean _video_on_open(gpointer data)
 	if(_open_setup(video) != 0)
 	{
 		helper->error(helper->phone, error_get(NULL), 1);
-		close(video->fd);
-		video->fd = -1;
+		_video_close(video);
 		video->source = g_timeout_add(timeout, _video_on_open, video);
 		return FALSE;
 	}
@@ -519,6 +666,21 @@ static gboolean _video_on_open(gpointer data)
 			video->format.fmt.pix.height);
 #endif
 #ifndef __APPLE__
+	/* start capturing */
+	video->captured = 0;
+	video->converted = 0;
+	video->dropped = 0;
+	video->displayed = 0;
+	g_atomic_int_set(&video->running, 1);
+	if((video->thread = g_thread_try_new("video", _video_thread, video,
+					&error)) == NULL)
+	{
+		error_set_code(1, "%s: %s", video->device, error->message);
+		g_error_free(error);
+		helper->error(helper->phone, error_get(NULL), 1);
+		_video_close(video);
+		return FALSE;
+	}
 	/* FIXME allow the window to be smaller */
 	gtk_widget_set_size_request(video->area, video->format.fmt.pix.width,
 			video->format.fmt.pix.height);
@@ -535,7 +697,6 @@ static int _open_setup(VideoPhonePlugin * video)
 	int ret;
 	struct v4l2_cropcap cropcap;
 	struct v4l2_crop crop;
-	GError * error = NULL;
 
 	/* check for capabilities */
 	if(_video_ioctl(video, VIDIOC_QUERYCAP, &video->cap) == -1)
@@ -568,11 +729,7 @@ static int _open_setup(VideoPhonePlugin * video)
 		return -error_set_code(1, "%s: %s", video->device,
 				"Unsupported video capture type");
 	if((video->cap.capabilities & V4L2_CAP_STREAMING) != 0)
-#ifdef NOTYET
 		ret = _open_setup_mmap(video);
-#else
-		ret = _open_setup_read(video);
-#endif
 	else if((video->cap.capabilities & V4L2_CAP_READWRITE) != 0)
 		ret = _open_setup_read(video);
 	else
@@ -580,31 +737,50 @@ static int _open_setup(VideoPhonePlugin * video)
 				"Unsupported capabilities");
 	if(ret != 0)
 		return ret;
-	/* setup a IO channel */
-	video->channel = g_io_channel_unix_new(video->fd);
-	if(g_io_channel_set_encoding(video->channel, NULL, &error)
-			!= G_IO_STATUS_NORMAL)
+	return _open_setup_frames(video);
+#endif
+}
+
+#ifndef __APPLE__
+static int _open_setup_frames(VideoPhonePlugin * video)
+{
+	size_t cnt;
+	unsigned char ** frames[3];
+	size_t i;
+	unsigned char * p;
+
+	/* FIXME also try to obtain a RGB24 format if possible */
+	/* allocate the rgb buffers: converted, ready and displayed */
+	cnt = video->format.fmt.pix.width * video->format.fmt.pix.height * 3;
+	frames[0] = &video->rgb_back;
+	frames[1] = &video->rgb_ready;
+	frames[2] = &video->rgb_buffer;
+	for(i = 0; i < sizeof(frames) / sizeof(*frames); i++)
 	{
-		error_set_code(1, "%s", error->message);
-		g_error_free(error);
-		return -1;
+		if((p = realloc(*frames[i], cnt)) == NULL)
+			return -error_set_code(1, "%s: %s", video->device,
+					strerror(errno));
+		*frames[i] = p;
 	}
-	g_io_channel_set_buffered(video->channel, FALSE);
-	video->source = g_io_add_watch(video->channel, G_IO_IN,
-			_video_on_can_read, video);
+	video->rgb_buffer_cnt = cnt;
+	memset(video->rgb_buffer, 0, cnt);
+	/* the frames may have a different size */
+	if(video->scale != NULL)
+		videoscale_delete(video->scale);
+	video->scale = NULL;
 	return 0;
-#endif
 }
 
-#ifdef NOTYET
 static int _open_setup_mmap(VideoPhonePlugin * video)
 {
 	struct v4l2_requestbuffers req;
 	size_t i;
 	struct v4l2_buffer buf;
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
 	/* memory mapping support */
-	req.count = 4;
+	memset(&req, 0, sizeof(req));
+	req.count = VIDEO_BUFFERS;
 	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 	req.memory = V4L2_MEMORY_MMAP;
 	if(_video_ioctl(video, VIDIOC_REQBUFS, &req) == -1)
@@ -640,17 +816,28 @@ static int _open_setup_mmap(VideoPhonePlugin * video)
 					"Could not map buffers");
 		video->buffers[i].length = buf.length;
 	}
+	/* queue the buffers and start streaming */
+	for(i = 0; i < video->buffers_cnt; i++)
+	{
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		if(_video_ioctl(video, VIDIOC_QBUF, &buf) == -1)
+			return -error_set_code(1, "%s: %s", video->device,
+					"Could not queue buffers");
+	}
+	if(_video_ioctl(video, VIDIOC_STREAMON, &type) == -1)
+		return -error_set_code(1, "%s: %s (%s)", video->device,
+				"Could not start streaming", strerror(errno));
 	return 0;
 }
-#endif
 
-#ifndef __APPLE__
 static int _open_setup_read(VideoPhonePlugin * video)
 {
 	size_t cnt;
 	char * p;
 
-	/* FIXME also try to obtain a RGB24 format if possible */
 	/* allocate the raw buffer */
 	cnt = video->format.fmt.pix.sizeimage;
 	if((p = realloc(video->raw_buffer, cnt)) == NULL)
@@ -658,13 +845,6 @@ static int _open_setup_read(VideoPhonePlugin * video)
 				strerror(errno));
 	video->raw_buffer = p;
 	video->raw_buffer_cnt = cnt;
-	/* allocate the rgb buffer */
-	cnt = video->format.fmt.pix.width * video->format.fmt.pix.height * 3;
-	if((p = realloc(video->rgb_buffer, cnt)) == NULL)
-		return -error_set_code(1, "%s: %s", video->device,
-				strerror(errno));
-	video->rgb_buffer = (unsigned char *)p;
-	video->rgb_buffer_cnt = cnt;
 	return 0;
 }
 #endif
@@ -672,28 +852,44 @@ static int _open_setup_read(VideoPhonePlugin * video)
 
 /* video_on_refresh */
 #ifndef __APPLE__
-static void _refresh_convert(VideoPhonePlugin * video);
-static void _refresh_convert_yuv(int amp, uint8_t y, uint8_t u, uint8_t v,
-                uint8_t * r, uint8_t * g, uint8_t * b);
-static void _refresh_hflip(VideoPhonePlugin * video, GdkPixbuf ** pixbuf);
-static void _refresh_scale(VideoPhonePlugin * video, GdkPixbuf ** pixbuf);
-static void _refresh_vflip(VideoPhonePlugin * video, GdkPixbuf ** pixbuf);
+static int _refresh_target(VideoPhonePlugin * video);
 
 static gboolean _video_on_refresh(gpointer data)
 {
 	VideoPhonePlugin * video = data;
-	video->source = 0;
+	PhonePluginHelper * helper = video->helper;
+	String * error;
+	unsigned char * p;
 # if !GTK_CHECK_VERSION(3, 0, 0)
 	GtkAllocation * allocation = &video->area_allocation;
-# endif
 	int width = video->format.fmt.pix.width;
 	int height = video->format.fmt.pix.height;
-
-# ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s() 0x%x\n", __func__,
-			video->format.fmt.pix.pixelformat);
 # endif
-	_refresh_convert(video);
+
+	g_mutex_lock(&video->mutex);
+	video->ready_source = 0;
+	if((error = video->thread_error) != NULL)
+	{
+		/* the capture thread gave up */
+		video->thread_error = NULL;
+		g_mutex_unlock(&video->mutex);
+		_video_stop(video);
+		helper->error(helper->phone, error, 1);
+		string_delete(error);
+		return FALSE;
+	}
+	if(video->ready == FALSE)
+	{
+		g_mutex_unlock(&video->mutex);
+		return FALSE;
+	}
+	/* display the newest frame */
+	p = video->rgb_buffer;
+	video->rgb_buffer = video->rgb_ready;
+	video->rgb_ready = p;
+	video->ready = FALSE;
+	g_mutex_unlock(&video->mutex);
+	video->displayed++;
 # if !GTK_CHECK_VERSION(3, 0, 0)
 	if(video->hflip == FALSE
 			&& video->vflip == FALSE
@@ -705,16 +901,12 @@ static gboolean _video_on_refresh(gpointer data)
 				video->rgb_buffer, width * 3);
 	else
 # endif
+	if(_refresh_target(video) == 0)
 	{
-		if(video->pixbuf != NULL)
-			g_object_unref(video->pixbuf);
 		/* render after scaling */
-		video->pixbuf = gdk_pixbuf_new_from_data(video->rgb_buffer,
-				GDK_COLORSPACE_RGB, FALSE, 8, width, height,
-				width * 3, NULL, NULL);
-		_refresh_hflip(video, &video->pixbuf);
-		_refresh_vflip(video, &video->pixbuf);
-		_refresh_scale(video, &video->pixbuf);
+		videoscale_apply(video->scale, video->rgb_buffer,
+				gdk_pixbuf_get_pixels(video->pixbuf),
+				gdk_pixbuf_get_rowstride(video->pixbuf));
 # if !GTK_CHECK_VERSION(3, 0, 0)
 		gdk_pixbuf_render_to_drawable(video->pixbuf, video->pixmap,
 				video->gc, 0, 0, 0, 0, -1, -1,
@@ -723,124 +915,92 @@ static gboolean _video_on_refresh(gpointer data)
 	}
 	/* force a refresh */
 	gtk_widget_queue_draw(video->area);
-	video->source = g_io_add_watch(video->channel, G_IO_IN,
-			(video->buffers != NULL) ? _video_on_can_mmap
-			: _video_on_can_read, video);
 	return FALSE;
 }
 
-static void _refresh_convert(VideoPhonePlugin * video)
+static int _refresh_convert(VideoPhonePlugin * video, char const * raw_buffer,
+		size_t raw_cnt, unsigned char * rgb)
 {
-	size_t i;
-	size_t j;
+	uint8_t const * raw = (uint8_t const *)raw_buffer;
+	size_t width = video->format.fmt.pix.width;
+	size_t height = video->format.fmt.pix.height;
+	size_t stride = video->format.fmt.pix.bytesperline;
+	size_t size;
 
 	switch(video->format.fmt.pix.pixelformat)
 	{
 		case V4L2_PIX_FMT_YUYV:
-			for(i = 0, j = 0; i + 3 < video->raw_buffer_cnt;
-					i += 4, j += 6)
-			{
-				/* pixel 0 */
-				_refresh_convert_yuv(video->yuv_amp,
-						video->raw_buffer[i],
-						video->raw_buffer[i + 1],
-						video->raw_buffer[i + 3],
-						&video->rgb_buffer[j + 2],
-						&video->rgb_buffer[j + 1],
-						&video->rgb_buffer[j]);
-				/* pixel 1 */
-				_refresh_convert_yuv(video->yuv_amp,
-						video->raw_buffer[i + 2],
-						video->raw_buffer[i + 1],
-						video->raw_buffer[i + 3],
-						&video->rgb_buffer[j + 5],
-						&video->rgb_buffer[j + 4],
-						&video->rgb_buffer[j + 3]);
-			}
-			break;
-		default:
+			if(stride == 0)
+				stride = ((width + 1) / 2) * 4;
+			if(raw_cnt < stride * height)
+				break;
+			videoyuv_yuyv_to_rgb(raw, stride, width, height, rgb);
+			return 0;
+		case V4L2_PIX_FMT_NV12:
+			if(stride == 0)
+				stride = width;
+			if(raw_cnt < stride * height
+					+ stride * ((height + 1) / 2))
+				break;
+			videoyuv_nv12_to_rgb(raw, &raw[stride * height], stride,
+					width, height, rgb);
+			return 0;
+		case V4L2_PIX_FMT_YUV420:
+			if(stride == 0)
+				stride = width;
+			size = stride / 2 * ((height + 1) / 2);
+			if(raw_cnt < stride * height + size * 2)
+				break;
+			videoyuv_yuv420_to_rgb(raw, &raw[stride * height],
+					&raw[stride * height + size], stride,
+					width, height, rgb);
+			return 0;
+	}
 #ifdef DEBUG
-			fprintf(stderr, "DEBUG: %s() Unsupported format\n",
-					__func__);
+	fprintf(stderr, "DEBUG: %s() Unsupported format 0x%x\n", __func__,
+			video->format.fmt.pix.pixelformat);
 #endif
-			break;
-	}
-}
-
-static void _refresh_convert_yuv(int amp, uint8_t y, uint8_t u, uint8_t v,
-                uint8_t * r, uint8_t * g, uint8_t * b)
-{
-	double dr;
-	double dg;
-	double db;
-
-	dr = amp * (0.004565 * y + 0.007935 * u - 1.088);
-	dg = amp * (0.004565 * y - 0.001542 * u - 0.003183 * v + 0.531);
-	db = amp * (0.004565 * y + 0.000001 * u + 0.006250 * v - 0.872);
-	*r = (dr < 0) ? 0 : ((dr > 255) ? 255 : dr);
-	*g = (dg < 0) ? 0 : ((dg > 255) ? 255 : dg);
-	*b = (db < 0) ? 0 : ((db > 255) ? 255 : db);
-}
-
-static void _refresh_hflip(VideoPhonePlugin * video, GdkPixbuf ** pixbuf)
-{
-	GdkPixbuf * pixbuf2;
-
-	if(video->hflip == FALSE)
-		return;
-	/* XXX could probably be more efficient */
-	pixbuf2 = gdk_pixbuf_flip(*pixbuf, TRUE);
-	g_object_unref(*pixbuf);
-	*pixbuf = pixbuf2;
+	return -1;
 }
 
-static void _refresh_scale(VideoPhonePlugin * video, GdkPixbuf ** pixbuf)
+static int _refresh_target(VideoPhonePlugin * video)
 {
 	GtkAllocation * allocation = &video->area_allocation;
-	GdkPixbuf * pixbuf2;
-	gdouble scale;
-	gint width;
-	gint height;
-	gint x;
-	gint y;
-
-	if(video->ratio == FALSE)
-		pixbuf2 = gdk_pixbuf_scale_simple(*pixbuf, allocation->width,
-				allocation->height, video->interp);
-	else
+	unsigned int flags = 0;
+
+	/* the target and the transformation are kept across frames */
+	if(video->pixbuf != NULL && video->scale != NULL
+			&& gdk_pixbuf_get_width(video->pixbuf)
+			== allocation->width
+			&& gdk_pixbuf_get_height(video->pixbuf)
+			== allocation->height)
+		return 0;
+	if(video->scale != NULL)
+		videoscale_delete(video->scale);
+	video->scale = NULL;
+	if(video->pixbuf != NULL)
+		g_object_unref(video->pixbuf);
+	if(allocation->width <= 0 || allocation->height <= 0
+			|| (video->pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB,
+					FALSE, 8, allocation->width,
+					allocation->height)) == NULL)
 	{
-		if((pixbuf2 = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8,
-						allocation->width,
-						allocation->height)) == NULL)
-			return;
-		/* XXX could be more efficient */
-		gdk_pixbuf_fill(pixbuf2, 0);
-		scale = (gdouble)allocation->width
-			/ video->format.fmt.pix.width;
-		scale = MIN(scale, (gdouble)allocation->height
-				/ video->format.fmt.pix.height);
-		width = (gdouble)video->format.fmt.pix.width * scale;
-		width = MIN(width, allocation->width);
-		height = (gdouble)video->format.fmt.pix.height * scale;
-		height = MIN(height, allocation->height);
-		x = (allocation->width - width) / 2;
-		y = (allocation->height - height) / 2;
-		gdk_pixbuf_scale(*pixbuf, pixbuf2, x, y, width, height,
-				0.0, 0.0, scale, scale, video->interp);
+		video->pixbuf = NULL;
+		return -1;
 	}
-	g_object_unref(*pixbuf);
-	*pixbuf = pixbuf2;
-}
-
-static void _refresh_vflip(VideoPhonePlugin * video, GdkPixbuf ** pixbuf)
-{
-	GdkPixbuf * pixbuf2;
-
-	if(video->vflip == FALSE)
-		return;
-	/* XXX could probably be more efficient */
-	pixbuf2 = gdk_pixbuf_flip(*pixbuf, FALSE);
-	g_object_unref(*pixbuf);
-	*pixbuf = pixbuf2;
+	if(video->hflip)
+		flags |= VIDEOSCALE_HFLIP;
+	if(video->vflip)
+		flags |= VIDEOSCALE_VFLIP;
+	if(video->ratio)
+		flags |= VIDEOSCALE_RATIO;
+	if(video->interp != GDK_INTERP_NEAREST)
+		flags |= VIDEOSCALE_BILINEAR;
+	if((video->scale = videoscale_new(video->format.fmt.pix.width,
+					video->format.fmt.pix.height,
+					allocation->width, allocation->height,
+					flags)) == NULL)
+		return -1;
+	return 0;
 }
 #endif
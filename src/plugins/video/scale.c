@@ -0,0 +1,230 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "scale.h"
+
+
+/* VideoScale */
+/* private */
+/* types */
+typedef struct _VideoScaleMap
+{
+	size_t from;		/* in bytes for columns, in rows for rows */
+	size_t to;
+	unsigned int weight;		/* of "to", out of 256 */
+} VideoScaleMap;
+
+struct _VideoScale
+{
+	size_t width;
+	size_t height;
+	size_t target_width;
+	size_t target_height;
+	unsigned int flags;
+
+	/* the area drawn to in the target */
+	size_t x;
+	size_t y;
+	size_t w;
+	size_t h;
+
+	VideoScaleMap * columns;
+	VideoScaleMap * rows;
+};
+
+
+/* prototypes */
+static void _videoscale_map(VideoScaleMap * map, size_t size, size_t from,
+		size_t to, size_t unit, int flip, int bilinear);
+
+
+/* public */
+/* functions */
+/* videoscale_new */
+VideoScale * videoscale_new(size_t width, size_t height, size_t target_width,
+		size_t target_height, unsigned int flags)
+{
+	VideoScale * scale;
+
+	if(width == 0 || height == 0 || target_width == 0 || target_height == 0
+			|| (scale = malloc(sizeof(*scale))) == NULL)
+		return NULL;
+	scale->width = width;
+	scale->height = height;
+	scale->target_width = target_width;
+	scale->target_height = target_height;
+	scale->flags = flags;
+	scale->w = target_width;
+	scale->h = target_height;
+	/* keep the aspect ratio */
+	if(flags & VIDEOSCALE_RATIO)
+	{
+		if(width * target_height > target_width * height)
+			scale->h = height * target_width / width;
+		else
+			scale->w = width * target_height / height;
+		scale->w = (scale->w > 0) ? scale->w : 1;
+		scale->h = (scale->h > 0) ? scale->h : 1;
+	}
+	scale->x = (target_width - scale->w) / 2;
+	scale->y = (target_height - scale->h) / 2;
+	scale->columns = malloc(sizeof(*scale->columns) * scale->w);
+	scale->rows = malloc(sizeof(*scale->rows) * scale->h);
+	if(scale->columns == NULL || scale->rows == NULL)
+	{
+		videoscale_delete(scale);
+		return NULL;
+	}
+	_videoscale_map(scale->columns, scale->w, width, scale->w, 3,
+			flags & VIDEOSCALE_HFLIP, flags & VIDEOSCALE_BILINEAR);
+	_videoscale_map(scale->rows, scale->h, height, scale->h, 1,
+			flags & VIDEOSCALE_VFLIP, flags & VIDEOSCALE_BILINEAR);
+	return scale;
+}
+
+
+/* videoscale_delete */
+void videoscale_delete(VideoScale * scale)
+{
+	free(scale->columns);
+	free(scale->rows);
+	free(scale);
+}
+
+
+/* useful */
+/* videoscale_apply */
+static void _apply_row(VideoScale const * scale, uint8_t const * row0,
+		uint8_t const * row1, unsigned int weight, uint8_t * target);
+
+void videoscale_apply(VideoScale const * scale, uint8_t const * rgb,
+		uint8_t * target, size_t stride)
+{
+	size_t i;
+	VideoScaleMap const * row;
+	uint8_t * p;
+
+	for(i = 0; i < scale->target_height; i++, target += stride)
+	{
+		/* letterbox */
+		if(i < scale->y || i >= scale->y + scale->h)
+		{
+			memset(target, 0, scale->target_width * 3);
+			continue;
+		}
+		memset(target, 0, scale->x * 3);
+		p = &target[(scale->x + scale->w) * 3];
+		memset(p, 0, (scale->target_width - scale->x - scale->w) * 3);
+		row = &scale->rows[i - scale->y];
+		_apply_row(scale, &rgb[scale->width * 3 * row->from],
+				&rgb[scale->width * 3 * row->to], row->weight,
+				&target[scale->x * 3]);
+	}
+}
+
+static void _apply_row(VideoScale const * scale, uint8_t const * row0,
+		uint8_t const * row1, unsigned int weight, uint8_t * target)
+{
+	VideoScaleMap const * column;
+	size_t i;
+	size_t j;
+	unsigned int w0;
+	unsigned int w1;
+	unsigned int x0;
+	unsigned int x1;
+
+	/* copy the pixels when neither flipping nor scaling */
+	if(scale->w == scale->width && weight == 0
+			&& (scale->flags & VIDEOSCALE_HFLIP) == 0)
+	{
+		memcpy(target, row0, scale->w * 3);
+		return;
+	}
+	for(i = 0, column = scale->columns; i < scale->w; i++, column++)
+	{
+		w1 = column->weight;
+		w0 = 256 - w1;
+		if(w1 == 0 && weight == 0)
+		{
+			memcpy(target, &row0[column->from], 3);
+			target += 3;
+			continue;
+		}
+		for(j = 0; j < 3; j++)
+		{
+			x0 = row0[column->from + j] * w0
+				+ row0[column->to + j] * w1;
+			x1 = row1[column->from + j] * w0
+				+ row1[column->to + j] * w1;
+			*(target++) = (x0 * (256 - weight) + x1 * weight
+					+ 32768) >> 16;
+		}
+	}
+}
+
+
+/* private */
+/* functions */
+/* videoscale_map */
+static void _videoscale_map(VideoScaleMap * map, size_t size, size_t from,
+		size_t to, size_t unit, int flip, int bilinear)
+{
+	size_t i;
+	size_t j;
+	int64_t pos;
+	size_t p;
+
+	for(i = 0; i < size; i++)
+	{
+		j = flip ? size - 1 - i : i;
+		/* the center of the pixel, in 1/256th of the source */
+		pos = ((int64_t)(2 * j + 1) * from * 256 / (2 * to)) - 128;
+		if(!bilinear || from == to)
+		{
+			p = (2 * j + 1) * from / (2 * to);
+			map[i].from = p * unit;
+			map[i].to = p * unit;
+			map[i].weight = 0;
+			continue;
+		}
+		if(pos < 0)
+			pos = 0;
+		p = pos / 256;
+		if(p + 1 >= from)
+		{
+			map[i].from = (from - 1) * unit;
+			map[i].to = (from - 1) * unit;
+			map[i].weight = 0;
+			continue;
+		}
+		map[i].from = p * unit;
+		map[i].to = (p + 1) * unit;
+		map[i].weight = pos % 256;
+	}
+}
@@ -0,0 +1,59 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#ifndef PHONE_PLUGINS_VIDEO_SCALE_H
+# define PHONE_PLUGINS_VIDEO_SCALE_H
+
+# include <sys/types.h>
+# include <stdint.h>
+
+
+/* VideoScale */
+/* public */
+/* types */
+typedef struct _VideoScale VideoScale;
+
+typedef enum _VideoScaleFlag
+{
+	VIDEOSCALE_HFLIP	= 0x1,
+	VIDEOSCALE_VFLIP	= 0x2,
+	VIDEOSCALE_RATIO	= 0x4,
+	VIDEOSCALE_BILINEAR	= 0x8
+} VideoScaleFlag;
+
+
+/* functions */
+VideoScale * videoscale_new(size_t width, size_t height, size_t target_width,
+		size_t target_height, unsigned int flags);
+void videoscale_delete(VideoScale * scale);
+
+/* useful */
+/* flips, scales and letterboxes a RGB24 frame into the target in one pass */
+void videoscale_apply(VideoScale const * scale, uint8_t const * rgb,
+		uint8_t * target, size_t stride);
+
+#endif /* PHONE_PLUGINS_VIDEO_SCALE_H */
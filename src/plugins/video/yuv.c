@@ -0,0 +1,553 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define VIDEOYUV_SSE2
+# include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define VIDEOYUV_NEON
+# include <arm_neon.h>
+# if defined(__linux__) && defined(__arm__)
+#  include <sys/auxv.h>
+#  include <asm/hwcap.h>
+# endif
+#endif
+#include "yuv.h"
+
+
+/* VideoYUV */
+/* private */
+/* types */
+typedef struct _VideoYUVRows
+{
+	char const * name;
+	int (*supported)(void);
+	void (*yuyv)(uint8_t const * yuyv, size_t width, uint8_t * rgb);
+	void (*nv12)(uint8_t const * y, uint8_t const * uv, size_t width,
+			uint8_t * rgb);
+	void (*yuv420)(uint8_t const * y, uint8_t const * u,
+			uint8_t const * v, size_t width, uint8_t * rgb);
+} VideoYUVRows;
+
+
+/* constants */
+/* BT.601 coefficients for studio swing, as multiplied by 2^14; the
+ * chrominance and (Y - 16) are shifted by 7 bits before the multiplications,
+ * keeping 5 bits of fraction in 16 bits (2.017232 for blue does not fit,
+ * 2 is added separately) */
+#define VIDEOYUV_Y	19077			/* 1.164383 */
+#define VIDEOYUV_RV	26149			/* 1.596027 */
+#define VIDEOYUV_GU	6419			/* 0.391762 */
+#define VIDEOYUV_GV	13320			/* 0.812968 */
+#define VIDEOYUV_BU	282			/* 2.017232 - 2 */
+
+
+/* prototypes */
+static int _videoyuv_scalar_supported(void);
+static void _videoyuv_scalar_yuyv(uint8_t const * yuyv, size_t width,
+		uint8_t * rgb);
+static void _videoyuv_scalar_nv12(uint8_t const * y, uint8_t const * uv,
+		size_t width, uint8_t * rgb);
+static void _videoyuv_scalar_yuv420(uint8_t const * y, uint8_t const * u,
+		uint8_t const * v, size_t width, uint8_t * rgb);
+#ifdef VIDEOYUV_SSE2
+static int _videoyuv_sse2_supported(void);
+static void _videoyuv_sse2_yuyv(uint8_t const * yuyv, size_t width,
+		uint8_t * rgb);
+static void _videoyuv_sse2_nv12(uint8_t const * y, uint8_t const * uv,
+		size_t width, uint8_t * rgb);
+static void _videoyuv_sse2_yuv420(uint8_t const * y, uint8_t const * u,
+		uint8_t const * v, size_t width, uint8_t * rgb);
+#endif
+#ifdef VIDEOYUV_NEON
+static int _videoyuv_neon_supported(void);
+static void _videoyuv_neon_yuyv(uint8_t const * yuyv, size_t width,
+		uint8_t * rgb);
+static void _videoyuv_neon_nv12(uint8_t const * y, uint8_t const * uv,
+		size_t width, uint8_t * rgb);
+static void _videoyuv_neon_yuv420(uint8_t const * y, uint8_t const * u,
+		uint8_t const * v, size_t width, uint8_t * rgb);
+#endif
+
+
+/* variables */
+static const VideoYUVRows _videoyuv_rows[VIDEOYUV_ENGINE_COUNT] =
+{
+	{ "scalar", _videoyuv_scalar_supported, _videoyuv_scalar_yuyv,
+		_videoyuv_scalar_nv12, _videoyuv_scalar_yuv420 },
+#ifdef VIDEOYUV_SSE2
+	{ "SSE2", _videoyuv_sse2_supported, _videoyuv_sse2_yuyv,
+		_videoyuv_sse2_nv12, _videoyuv_sse2_yuv420 },
+#else
+	{ "SSE2", NULL, NULL, NULL, NULL },
+#endif
+#ifdef VIDEOYUV_NEON
+	{ "NEON", _videoyuv_neon_supported, _videoyuv_neon_yuyv,
+		_videoyuv_neon_nv12, _videoyuv_neon_yuv420 }
+#else
+	{ "NEON", NULL, NULL, NULL, NULL }
+#endif
+};
+
+static VideoYUVRows const * _videoyuv = NULL;
+
+
+/* public */
+/* functions */
+/* videoyuv_get_engine */
+static VideoYUVRows const * _videoyuv_get(void);
+
+VideoYUVEngine videoyuv_get_engine(void)
+{
+	return _videoyuv_get() - _videoyuv_rows;
+}
+
+static VideoYUVRows const * _videoyuv_get(void)
+{
+	size_t i;
+
+	if(_videoyuv != NULL)
+		return _videoyuv;
+	/* pick the last engine supported */
+	for(i = VIDEOYUV_ENGINE_COUNT; i-- > 0;)
+		if(_videoyuv_rows[i].supported != NULL
+				&& _videoyuv_rows[i].supported())
+			break;
+	_videoyuv = &_videoyuv_rows[i];
+	return _videoyuv;
+}
+
+
+/* videoyuv_get_engine_name */
+char const * videoyuv_get_engine_name(VideoYUVEngine engine)
+{
+	if(engine > VIDEOYUV_ENGINE_LAST)
+		return NULL;
+	return _videoyuv_rows[engine].name;
+}
+
+
+/* videoyuv_set_engine */
+int videoyuv_set_engine(VideoYUVEngine engine)
+{
+	if(engine > VIDEOYUV_ENGINE_LAST
+			|| _videoyuv_rows[engine].supported == NULL
+			|| !_videoyuv_rows[engine].supported())
+		return -1;
+	_videoyuv = &_videoyuv_rows[engine];
+	return 0;
+}
+
+
+/* videoyuv_yuyv_to_rgb */
+void videoyuv_yuyv_to_rgb(uint8_t const * yuyv, size_t stride, size_t width,
+		size_t height, uint8_t * rgb)
+{
+	VideoYUVRows const * rows = _videoyuv_get();
+	size_t i;
+
+	for(i = 0; i < height; i++)
+		rows->yuyv(&yuyv[stride * i], width, &rgb[width * 3 * i]);
+}
+
+
+/* videoyuv_nv12_to_rgb */
+void videoyuv_nv12_to_rgb(uint8_t const * y, uint8_t const * uv,
+		size_t stride, size_t width, size_t height, uint8_t * rgb)
+{
+	VideoYUVRows const * rows = _videoyuv_get();
+	size_t i;
+
+	for(i = 0; i < height; i++)
+		rows->nv12(&y[stride * i], &uv[stride * (i / 2)], width,
+				&rgb[width * 3 * i]);
+}
+
+
+/* videoyuv_yuv420_to_rgb */
+void videoyuv_yuv420_to_rgb(uint8_t const * y, uint8_t const * u,
+		uint8_t const * v, size_t stride, size_t width, size_t height,
+		uint8_t * rgb)
+{
+	VideoYUVRows const * rows = _videoyuv_get();
+	size_t i;
+
+	for(i = 0; i < height; i++)
+		rows->yuv420(&y[stride * i], &u[stride / 2 * (i / 2)],
+				&v[stride / 2 * (i / 2)], width,
+				&rgb[width * 3 * i]);
+}
+
+
+/* private */
+/* functions */
+/* scalar */
+static int _scalar_mulhi(int a, int k);
+static void _scalar_pixel(uint8_t y, uint8_t u, uint8_t v, uint8_t * rgb);
+
+static int _videoyuv_scalar_supported(void)
+{
+	return 1;
+}
+
+static void _videoyuv_scalar_yuyv(uint8_t const * yuyv, size_t width,
+		uint8_t * rgb)
+{
+	size_t i;
+
+	for(i = 0; i + 1 < width; i += 2, yuyv += 4, rgb += 6)
+	{
+		_scalar_pixel(yuyv[0], yuyv[1], yuyv[3], rgb);
+		_scalar_pixel(yuyv[2], yuyv[1], yuyv[3], &rgb[3]);
+	}
+	if(i < width)
+		_scalar_pixel(yuyv[0], yuyv[1], yuyv[3], rgb);
+}
+
+static void _videoyuv_scalar_nv12(uint8_t const * y, uint8_t const * uv,
+		size_t width, uint8_t * rgb)
+{
+	size_t i;
+
+	for(i = 0; i < width; i++, rgb += 3)
+		_scalar_pixel(y[i], uv[i & ~(size_t)1],
+				uv[(i & ~(size_t)1) + 1], rgb);
+}
+
+static void _videoyuv_scalar_yuv420(uint8_t const * y, uint8_t const * u,
+		uint8_t const * v, size_t width, uint8_t * rgb)
+{
+	size_t i;
+
+	for(i = 0; i < width; i++, rgb += 3)
+		_scalar_pixel(y[i], u[i / 2], v[i / 2], rgb);
+}
+
+static int _scalar_mulhi(int a, int k)
+{
+	/* as the high half of a 16-bit signed multiplication */
+	return (a * k) >> 16;
+}
+
+static void _scalar_pixel(uint8_t y, uint8_t u, uint8_t v, uint8_t * rgb)
+{
+	int c = (y - 16) * 128;
+	int d = (u - 128) * 128;
+	int e = (v - 128) * 128;
+	int x[3];
+	size_t i;
+
+	c = _scalar_mulhi(c, VIDEOYUV_Y);
+	x[0] = c + _scalar_mulhi(e, VIDEOYUV_RV);
+	x[1] = c - _scalar_mulhi(d, VIDEOYUV_GU)
+		- _scalar_mulhi(e, VIDEOYUV_GV);
+	x[2] = c + d / 2 + _scalar_mulhi(d, VIDEOYUV_BU);
+	for(i = 0; i < 3; i++)
+	{
+		x[i] = (x[i] + 16) >> 5;
+		rgb[i] = (x[i] < 0) ? 0 : ((x[i] > 255) ? 255 : x[i]);
+	}
+}
+
+
+#ifdef VIDEOYUV_SSE2
+/* sse2 */
+# define VIDEOYUV_SSE2_TARGET	__attribute__((__target__("sse2")))
+
+static void _sse2_pixels(__m128i y, __m128i u, __m128i v,
+		uint8_t * rgb) VIDEOYUV_SSE2_TARGET;
+static __m128i _sse2_rgb(__m128i c, __m128i d, __m128i e,
+		int channel) VIDEOYUV_SSE2_TARGET;
+
+static int _videoyuv_sse2_supported(void)
+{
+	return __builtin_cpu_supports("sse2");
+}
+
+VIDEOYUV_SSE2_TARGET
+static void _videoyuv_sse2_yuyv(uint8_t const * yuyv, size_t width,
+		uint8_t * rgb)
+{
+	const __m128i mask = _mm_set1_epi16(0x00ff);
+	size_t i;
+	__m128i p0;
+	__m128i p1;
+	__m128i uv;
+
+	for(i = 0; i + 16 <= width; i += 16, yuyv += 32, rgb += 48)
+	{
+		p0 = _mm_loadu_si128((__m128i const *)yuyv);
+		p1 = _mm_loadu_si128((__m128i const *)&yuyv[16]);
+		uv = _mm_packus_epi16(_mm_srli_epi16(p0, 8),
+				_mm_srli_epi16(p1, 8));
+		_sse2_pixels(_mm_packus_epi16(_mm_and_si128(p0, mask),
+					_mm_and_si128(p1, mask)),
+				_mm_packus_epi16(_mm_and_si128(uv, mask),
+					_mm_setzero_si128()),
+				_mm_packus_epi16(_mm_srli_epi16(uv, 8),
+					_mm_setzero_si128()), rgb);
+	}
+	_videoyuv_scalar_yuyv(yuyv, width - i, rgb);
+}
+
+VIDEOYUV_SSE2_TARGET
+static void _videoyuv_sse2_nv12(uint8_t const * y, uint8_t const * uv,
+		size_t width, uint8_t * rgb)
+{
+	const __m128i mask = _mm_set1_epi16(0x00ff);
+	size_t i;
+	__m128i p;
+
+	for(i = 0; i + 16 <= width; i += 16, rgb += 48)
+	{
+		p = _mm_loadu_si128((__m128i const *)&uv[i]);
+		_sse2_pixels(_mm_loadu_si128((__m128i const *)&y[i]),
+				_mm_packus_epi16(_mm_and_si128(p, mask),
+					_mm_setzero_si128()),
+				_mm_packus_epi16(_mm_srli_epi16(p, 8),
+					_mm_setzero_si128()), rgb);
+	}
+	_videoyuv_scalar_nv12(&y[i], &uv[i], width - i, rgb);
+}
+
+VIDEOYUV_SSE2_TARGET
+static void _videoyuv_sse2_yuv420(uint8_t const * y, uint8_t const * u,
+		uint8_t const * v, size_t width, uint8_t * rgb)
+{
+	size_t i;
+
+	for(i = 0; i + 16 <= width; i += 16, rgb += 48)
+		_sse2_pixels(_mm_loadu_si128((__m128i const *)&y[i]),
+				_mm_loadl_epi64((__m128i const *)&u[i / 2]),
+				_mm_loadl_epi64((__m128i const *)&v[i / 2]),
+				rgb);
+	_videoyuv_scalar_yuv420(&y[i], &u[i / 2], &v[i / 2], width - i, rgb);
+}
+
+/* converts 16 pixels from 16 Y and 8 U and V samples */
+VIDEOYUV_SSE2_TARGET
+static void _sse2_pixels(__m128i y, __m128i u, __m128i v,
+		uint8_t * rgb)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c16 = _mm_set1_epi16(16);
+	const __m128i c128 = _mm_set1_epi16(128);
+	__m128i c[2];
+	__m128i d[2];
+	__m128i e[2];
+	uint8_t x[3][16];
+	size_t i;
+
+	u = _mm_unpacklo_epi8(u, u);
+	v = _mm_unpacklo_epi8(v, v);
+	c[0] = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(y, zero), c16),
+			7);
+	c[1] = _mm_slli_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(y, zero), c16),
+			7);
+	d[0] = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(u, zero), c128),
+			7);
+	d[1] = _mm_slli_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(u, zero), c128),
+			7);
+	e[0] = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(v, zero), c128),
+			7);
+	e[1] = _mm_slli_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(v, zero), c128),
+			7);
+	for(i = 0; i < 3; i++)
+		_mm_storeu_si128((__m128i *)x[i], _mm_packus_epi16(
+					_sse2_rgb(c[0], d[0], e[0], i),
+					_sse2_rgb(c[1], d[1], e[1], i)));
+	/* SSE2 cannot shuffle bytes */
+	for(i = 0; i < 16; i++, rgb += 3)
+	{
+		rgb[0] = x[0][i];
+		rgb[1] = x[1][i];
+		rgb[2] = x[2][i];
+	}
+}
+
+VIDEOYUV_SSE2_TARGET
+static __m128i _sse2_rgb(__m128i c, __m128i d, __m128i e, int channel)
+{
+	__m128i x;
+
+	x = _mm_mulhi_epi16(c, _mm_set1_epi16(VIDEOYUV_Y));
+	switch(channel)
+	{
+		case 0:
+			x = _mm_add_epi16(x, _mm_mulhi_epi16(e,
+						_mm_set1_epi16(VIDEOYUV_RV)));
+			break;
+		case 1:
+			x = _mm_sub_epi16(x, _mm_mulhi_epi16(d,
+						_mm_set1_epi16(VIDEOYUV_GU)));
+			x = _mm_sub_epi16(x, _mm_mulhi_epi16(e,
+						_mm_set1_epi16(VIDEOYUV_GV)));
+			break;
+		default:
+			x = _mm_add_epi16(x, _mm_srai_epi16(d, 1));
+			x = _mm_add_epi16(x, _mm_mulhi_epi16(d,
+						_mm_set1_epi16(VIDEOYUV_BU)));
+			break;
+	}
+	return _mm_srai_epi16(_mm_add_epi16(x, _mm_set1_epi16(16)), 5);
+}
+#endif
+
+
+#ifdef VIDEOYUV_NEON
+/* neon */
+static uint8x8x3_t _neon_pixels(uint8x8_t y, uint8x8_t u, uint8x8_t v);
+static int16x8_t _neon_mulhi(int16x8_t a, int16_t k);
+
+static int _videoyuv_neon_supported(void)
+{
+# if defined(__linux__) && defined(__arm__)
+	return (getauxval(AT_HWCAP) & HWCAP_NEON) ? 1 : 0;
+# else
+	return 1;
+# endif
+}
+
+static void _videoyuv_neon_yuyv(uint8_t const * yuyv, size_t width,
+		uint8_t * rgb)
+{
+	size_t i;
+	uint8x8x4_t p;
+	uint8x8x3_t even;
+	uint8x8x3_t odd;
+	uint8x16x3_t x;
+	uint8x8x2_t z;
+	size_t j;
+
+	for(i = 0; i + 16 <= width; i += 16, yuyv += 32, rgb += 48)
+	{
+		/* Y0 U Y1 V */
+		p = vld4_u8(yuyv);
+		even = _neon_pixels(p.val[0], p.val[1], p.val[3]);
+		odd = _neon_pixels(p.val[2], p.val[1], p.val[3]);
+		for(j = 0; j < 3; j++)
+		{
+			z = vzip_u8(even.val[j], odd.val[j]);
+			x.val[j] = vcombine_u8(z.val[0], z.val[1]);
+		}
+		vst3q_u8(rgb, x);
+	}
+	_videoyuv_scalar_yuyv(yuyv, width - i, rgb);
+}
+
+static void _videoyuv_neon_nv12(uint8_t const * y, uint8_t const * uv,
+		size_t width, uint8_t * rgb)
+{
+	size_t i;
+	uint8x8x2_t p;
+	uint8x16_t q;
+	uint8x8x2_t u;
+	uint8x8x2_t v;
+	uint8x8x3_t lo;
+	uint8x8x3_t hi;
+	uint8x16x3_t x;
+	size_t j;
+
+	for(i = 0; i + 16 <= width; i += 16, rgb += 48)
+	{
+		q = vld1q_u8(&y[i]);
+		p = vld2_u8(&uv[i]);
+		u = vzip_u8(p.val[0], p.val[0]);
+		v = vzip_u8(p.val[1], p.val[1]);
+		lo = _neon_pixels(vget_low_u8(q), u.val[0], v.val[0]);
+		hi = _neon_pixels(vget_high_u8(q), u.val[1], v.val[1]);
+		for(j = 0; j < 3; j++)
+			x.val[j] = vcombine_u8(lo.val[j], hi.val[j]);
+		vst3q_u8(rgb, x);
+	}
+	_videoyuv_scalar_nv12(&y[i], &uv[i], width - i, rgb);
+}
+
+static void _videoyuv_neon_yuv420(uint8_t const * y, uint8_t const * u,
+		uint8_t const * v, size_t width, uint8_t * rgb)
+{
+	size_t i;
+	uint8x16_t q;
+	uint8x8x2_t uu;
+	uint8x8x2_t vv;
+	uint8x8x3_t lo;
+	uint8x8x3_t hi;
+	uint8x16x3_t x;
+	size_t j;
+
+	for(i = 0; i + 16 <= width; i += 16, rgb += 48)
+	{
+		q = vld1q_u8(&y[i]);
+		uu = vzip_u8(vld1_u8(&u[i / 2]), vld1_u8(&u[i / 2]));
+		vv = vzip_u8(vld1_u8(&v[i / 2]), vld1_u8(&v[i / 2]));
+		lo = _neon_pixels(vget_low_u8(q), uu.val[0], vv.val[0]);
+		hi = _neon_pixels(vget_high_u8(q), uu.val[1], vv.val[1]);
+		for(j = 0; j < 3; j++)
+			x.val[j] = vcombine_u8(lo.val[j], hi.val[j]);
+		vst3q_u8(rgb, x);
+	}
+	_videoyuv_scalar_yuv420(&y[i], &u[i / 2], &v[i / 2], width - i, rgb);
+}
+
+/* converts 8 pixels with one U and V sample each */
+static uint8x8x3_t _neon_pixels(uint8x8_t y, uint8x8_t u, uint8x8_t v)
+{
+	uint8x8x3_t ret;
+	int16x8_t c;
+	int16x8_t d;
+	int16x8_t e;
+	int16x8_t x;
+
+	c = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y)),
+				vdupq_n_s16(16)), 7);
+	d = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u)),
+				vdupq_n_s16(128)), 7);
+	e = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v)),
+				vdupq_n_s16(128)), 7);
+	c = _neon_mulhi(c, VIDEOYUV_Y);
+	x = vaddq_s16(c, _neon_mulhi(e, VIDEOYUV_RV));
+	ret.val[0] = vqmovun_s16(vshrq_n_s16(vaddq_s16(x, vdupq_n_s16(16)),
+				5));
+	x = vsubq_s16(c, _neon_mulhi(d, VIDEOYUV_GU));
+	x = vsubq_s16(x, _neon_mulhi(e, VIDEOYUV_GV));
+	ret.val[1] = vqmovun_s16(vshrq_n_s16(vaddq_s16(x, vdupq_n_s16(16)),
+				5));
+	x = vaddq_s16(c, vshrq_n_s16(d, 1));
+	x = vaddq_s16(x, _neon_mulhi(d, VIDEOYUV_BU));
+	ret.val[2] = vqmovun_s16(vshrq_n_s16(vaddq_s16(x, vdupq_n_s16(16)),
+				5));
+	return ret;
+}
+
+/* as _mm_mulhi_epi16() */
+static int16x8_t _neon_mulhi(int16x8_t a, int16_t k)
+{
+	return vcombine_s16(vshrn_n_s32(vmull_n_s16(vget_low_s16(a), k), 16),
+			vshrn_n_s32(vmull_n_s16(vget_high_s16(a), k), 16));
+}
+#endif
@@ -0,0 +1,62 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#ifndef PHONE_PLUGINS_VIDEO_YUV_H
+# define PHONE_PLUGINS_VIDEO_YUV_H
+
+# include <sys/types.h>
+# include <stdint.h>
+
+
+/* VideoYUV */
+/* public */
+/* types */
+typedef enum _VideoYUVEngine
+{
+	VIDEOYUV_ENGINE_SCALAR = 0,
+	VIDEOYUV_ENGINE_SSE2,
+	VIDEOYUV_ENGINE_NEON
+} VideoYUVEngine;
+# define VIDEOYUV_ENGINE_LAST	VIDEOYUV_ENGINE_NEON
+# define VIDEOYUV_ENGINE_COUNT	(VIDEOYUV_ENGINE_LAST + 1)
+
+
+/* functions */
+VideoYUVEngine videoyuv_get_engine(void);
+char const * videoyuv_get_engine_name(VideoYUVEngine engine);
+int videoyuv_set_engine(VideoYUVEngine engine);
+
+/* conversions to packed RGB24, with BT.601 coefficients */
+void videoyuv_yuyv_to_rgb(uint8_t const * yuyv, size_t stride, size_t width,
+		size_t height, uint8_t * rgb);
+void videoyuv_nv12_to_rgb(uint8_t const * y, uint8_t const * uv,
+		size_t stride, size_t width, size_t height, uint8_t * rgb);
+void videoyuv_yuv420_to_rgb(uint8_t const * y, uint8_t const * u,
+		uint8_t const * v, size_t stride, size_t width, size_t height,
+		uint8_t * rgb);
+
+#endif /* PHONE_PLUGINS_VIDEO_YUV_H */
@@ -0,0 +1,481 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "../src/plugins/blacklist.c"
+#include "benchmark.c"
+
+#ifndef PROGNAME
+# define PROGNAME "blacklist"
+#endif
+
+
+/* private */
+/* types */
+typedef struct _BlacklistTest
+{
+	char const * number;
+	char const * reason;
+} BlacklistTest;
+
+
+/* constants */
+static const BlacklistTest _blacklist_rules[] =
+{
+	{ "+33899*",		"Premium rate" },
+	{ "0800100000..0800199999", "Range" },
+	{ "+3361?345678",	"Wildcard" },
+	{ "+336123456??",	"Length" },
+	{ "0612345678",		"Exact" },
+	{ "01-23-45-67-89",	"Separators" },
+	{ "anonymous",		"Literal" }
+};
+
+static const BlacklistTest _blacklist_tests[] =
+{
+	{ "0899123456",		"Premium rate" },
+	{ "+33 8 99 00 00 00",	"Premium rate" },
+	{ "0033899",		"Premium rate" },
+	{ "+33898123456",	NULL },
+	{ "0800100000",		"Range" },
+	{ "0800155555",		"Range" },
+	{ "0800199999",		"Range" },
+	{ "0800200000",		NULL },
+	{ "080019999",		NULL },
+	{ "+33800150000",	"Range" },
+	{ "+33617345678",	"Wildcard" },
+	{ "+3361734567",	NULL },
+	{ "+33612345600",	"Length" },
+	{ "+33612345678",	"Exact" },
+	{ "06-12-34-56-78",	"Exact" },
+	{ "+336123456789",	NULL },
+	{ "+33123456789",	"Separators" },
+	{ "anonymous",		"Literal" },
+	{ "112",		NULL }
+};
+
+
+/* variables */
+static char const * _blacklist_country_code = "33";
+static char (*_blacklist_patterns)[BLACKLIST_NUMBER_SIZE];
+static size_t _blacklist_patterns_cnt;
+
+
+/* prototypes */
+static int _blacklist(void);
+static int _blacklist_benchmark(size_t rules, unsigned long calls);
+
+static int _usage(void);
+
+
+/* functions */
+/* blacklist */
+static PhoneConfigSection * _blacklist_config_section(Phone * phone,
+		char const * section);
+static char const * _blacklist_config_section_get(Phone * phone,
+		PhoneConfigSection * section, char const * variable);
+static void _blacklist_config_foreach(Phone * phone, char const * section,
+		PhoneConfigForeachCallback callback, void * priv);
+static int _blacklist_error(Phone * phone, char const * message, int ret);
+static Blacklist * _blacklist_new(void);
+static char const * _blacklist_reason(Blacklist * blacklist,
+		char const * number);
+
+static int _blacklist(void)
+{
+	int ret = 0;
+	Blacklist * blacklist;
+	size_t i;
+	char const * reason;
+
+	if((blacklist = _blacklist_new()) == NULL)
+		return 2;
+	for(i = 0; i < sizeof(_blacklist_tests) / sizeof(*_blacklist_tests);
+			i++)
+	{
+		reason = _blacklist_reason(blacklist,
+				_blacklist_tests[i].number);
+		if(reason == _blacklist_tests[i].reason
+				|| (reason != NULL
+					&& _blacklist_tests[i].reason != NULL
+					&& strcmp(reason,
+						_blacklist_tests[i].reason)
+					== 0))
+			continue;
+		fprintf(stderr, "%s: %s: %s (expected %s)\n", PROGNAME,
+				_blacklist_tests[i].number,
+				(reason != NULL) ? reason : "(null)",
+				(_blacklist_tests[i].reason != NULL)
+				? _blacklist_tests[i].reason : "(null)");
+		ret = 2;
+	}
+	/* changing the settings */
+	_blacklist_rule_set(blacklist, "+33899*", NULL);
+	_blacklist_rule_set(blacklist, "0800100000..0800199999", "Changed");
+	if(_blacklist_reason(blacklist, "0899123456") != NULL
+			|| (reason = _blacklist_reason(blacklist, "0800155555"))
+			== NULL || strcmp(reason, "Changed") != 0)
+	{
+		fprintf(stderr, "%s: %s\n", PROGNAME,
+				"The rules were not updated");
+		ret = 2;
+	}
+	/* changing the numbering plan */
+	_blacklist_country_code = "44";
+	_blacklist_rule_set(blacklist, "country_code", "44");
+	if(_blacklist_reason(blacklist, "+33800155555") != NULL
+			|| _blacklist_reason(blacklist, "+44800155555") == NULL
+			|| _blacklist_reason(blacklist, "0800155555") == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", PROGNAME,
+				"The numbering plan was not updated");
+		ret = 2;
+	}
+	_blacklist_country_code = "33";
+	/* removing every rule */
+	for(i = 0; i < sizeof(_blacklist_rules) / sizeof(*_blacklist_rules);
+			i++)
+		_blacklist_rule_set(blacklist, _blacklist_rules[i].number,
+				NULL);
+	if(blacklist->trie != NULL)
+	{
+		fprintf(stderr, "%s: %s\n", PROGNAME,
+				"The rules were not removed");
+		ret = 2;
+	}
+	_blacklist_destroy(blacklist);
+	return ret;
+}
+
+static PhoneConfigSection * _blacklist_config_section(Phone * phone,
+		char const * section)
+{
+	(void) phone;
+	(void) section;
+
+	return NULL;
+}
+
+static char const * _blacklist_config_section_get(Phone * phone,
+		PhoneConfigSection * section, char const * variable)
+{
+	size_t i;
+	(void) phone;
+	(void) section;
+
+	if(strcmp(variable, "country_code") == 0)
+		return _blacklist_country_code;
+	if(strcmp(variable, "international_prefix") == 0)
+		return "00";
+	if(strcmp(variable, "trunk_prefix") == 0)
+		return "0";
+	for(i = 0; i < sizeof(_blacklist_rules) / sizeof(*_blacklist_rules);
+			i++)
+		if(strcmp(_blacklist_rules[i].number, variable) == 0)
+			return _blacklist_rules[i].reason;
+	return NULL;
+}
+
+static void _blacklist_config_foreach(Phone * phone, char const * section,
+		PhoneConfigForeachCallback callback, void * priv)
+{
+	size_t i;
+	(void) phone;
+	(void) section;
+
+	callback("country_code", "33", priv);
+	for(i = 0; i < sizeof(_blacklist_rules) / sizeof(*_blacklist_rules);
+			i++)
+		callback(_blacklist_rules[i].number, _blacklist_rules[i].reason,
+				priv);
+	for(i = 0; i < _blacklist_patterns_cnt; i++)
+		callback(_blacklist_patterns[i], "Synthetic", priv);
+}
+
+static int _blacklist_error(Phone * phone, char const * message, int ret)
+{
+	(void) phone;
+	(void) message;
+
+	return ret;
+}
+
+static Blacklist * _blacklist_new(void)
+{
+	static PhonePluginHelper helper;
+
+	memset(&helper, 0, sizeof(helper));
+	helper.config_foreach = _blacklist_config_foreach;
+	helper.config_section = _blacklist_config_section;
+	helper.config_section_get = _blacklist_config_section_get;
+	helper.error = _blacklist_error;
+	return _blacklist_init(&helper);
+}
+
+static char const * _blacklist_reason(Blacklist * blacklist,
+		char const * number)
+{
+	BlacklistRule * rule;
+
+	if((rule = _blacklist_match(blacklist, number)) != NULL)
+		return rule->reason;
+	return blacklist->helper->config_section_get(blacklist->helper->phone,
+			blacklist->config, number);
+}
+
+
+/* blacklist_benchmark */
+static void _benchmark_number(unsigned long * seed, char * buf, size_t size,
+		size_t digits);
+static int _benchmark_scan(Blacklist * blacklist, char const * number);
+
+static int _blacklist_benchmark(size_t rules, unsigned long calls)
+{
+	int ret = 0;
+	Blacklist * blacklist;
+	char (*numbers)[BLACKLIST_NUMBER_SIZE];
+	unsigned long seed = 1;
+	size_t i;
+	size_t j;
+	size_t k;
+	char * p;
+	char c;
+	size_t blocked = 0;
+	size_t scans;
+	double t0;
+	double t1;
+	double t2;
+
+	if((_blacklist_patterns = malloc(sizeof(*_blacklist_patterns) * rules))
+			== NULL
+			|| (numbers = malloc(sizeof(*numbers) * calls)) == NULL)
+	{
+		free(_blacklist_patterns);
+		return -_blacklist_error(NULL, strerror(errno), 2);
+	}
+	/* mostly mobile numbers, then premium rates, ranges and wildcards */
+	for(i = 0; i < rules; i++)
+	{
+		p = _blacklist_patterns[i];
+		switch(i % 10)
+		{
+			case 7:
+				_benchmark_number(&seed, p, 9, 8);
+				memcpy(p, "+33899", 6);
+				memcpy(&p[8], "*", 2);
+				break;
+			case 8:
+				_benchmark_number(&seed, p, 7, 6);
+				memcpy(p, "08", 2);
+				memcpy(&p[6], "0000..", 6);
+				memcpy(&p[12], p, 6);
+				memcpy(&p[18], "9999", 5);
+				break;
+			case 9:
+				_benchmark_number(&seed, p, 13, 12);
+				memcpy(p, "+336", 4);
+				p[7] = '?';
+				break;
+			default:
+				_benchmark_number(&seed, p, 13, 12);
+				memcpy(p, "+336", 4);
+				break;
+		}
+	}
+	_blacklist_patterns_cnt = rules;
+	/* half of the calls come from blacklisted numbers, nationally */
+	for(i = 0; i < calls; i++)
+	{
+		p = numbers[i];
+		_benchmark_number(&seed, p, 11, 10);
+		if(i % 2 == 0)
+		{
+			memcpy(p, "06", 2);
+			continue;
+		}
+		for(j = 0, k = 0; _blacklist_patterns[(i * 7919) % rules][j]
+				!= '\0' && k < 10; j++)
+			switch((c = _blacklist_patterns[(i * 7919) % rules][j]))
+			{
+				case '+':
+					p[k++] = '0';
+					j += 2;
+					break;
+				case '?':
+				case '*':
+					k++;
+					break;
+				default:
+					p[k++] = c;
+					break;
+			}
+	}
+	t0 = _benchmark_time();
+	blacklist = _blacklist_new();
+	t1 = _benchmark_time();
+	if(blacklist == NULL)
+	{
+		free(numbers);
+		free(_blacklist_patterns);
+		return 2;
+	}
+	printf("%s: %zu rules compiled in %.3fms\n", PROGNAME, rules,
+			(t1 - t0) * 1000.0);
+	/* screening calls */
+	t0 = _benchmark_time();
+	for(i = 0; i < calls; i++)
+		if(_blacklist_match(blacklist, numbers[i]) != NULL)
+			blocked++;
+	t1 = _benchmark_time();
+	/* the same decisions, going through every rule */
+	scans = (calls < 1000) ? calls : 1000;
+	for(i = 0; i < scans; i++)
+		if((_blacklist_match(blacklist, numbers[i]) != NULL)
+				!= _benchmark_scan(blacklist, numbers[i]))
+		{
+			fprintf(stderr, "%s: %s: %s\n", PROGNAME, numbers[i],
+					"Wrong decision");
+			ret = 2;
+		}
+	t2 = _benchmark_time();
+	printf("%s: %zu/%lu calls blocked\n", PROGNAME, blocked, calls);
+	printf("%s: call screening %.3fus (trie), %.3fus (every rule)\n",
+			PROGNAME, (t1 - t0) * 1000000.0 / calls,
+			(t2 - t1) * 1000000.0 / scans);
+	_blacklist_destroy(blacklist);
+	free(numbers);
+	free(_blacklist_patterns);
+	_blacklist_patterns = NULL;
+	_blacklist_patterns_cnt = 0;
+	return ret;
+}
+
+static void _benchmark_number(unsigned long * seed, char * buf, size_t size,
+		size_t digits)
+{
+	size_t i;
+
+	for(i = 0; i < digits && i + 1 < size; i++)
+	{
+		*seed = *seed * 1103515245 + 12345;
+		buf[i] = '0' + (*seed >> 16) % 10;
+	}
+	buf[i] = '\0';
+}
+
+static int _benchmark_scan(Blacklist * blacklist, char const * number)
+{
+	char buf[BLACKLIST_NUMBER_SIZE];
+	char pattern[BLACKLIST_NUMBER_SIZE];
+	char from[BLACKLIST_NUMBER_SIZE];
+	size_t i;
+	size_t j;
+	char * p;
+
+	if(_blacklist_normalize(blacklist, number, FALSE, buf, sizeof(buf))
+			!= 0)
+		return 0;
+	for(i = 0; i < _blacklist_patterns_cnt; i++)
+	{
+		if((p = strstr(_blacklist_patterns[i], "..")) != NULL)
+		{
+			memcpy(pattern, _blacklist_patterns[i],
+					p - _blacklist_patterns[i]);
+			pattern[p - _blacklist_patterns[i]] = '\0';
+			if(_blacklist_normalize(blacklist, pattern, FALSE, from,
+						sizeof(from)) == 0
+					&& _blacklist_normalize(blacklist,
+						&p[2], FALSE, pattern,
+						sizeof(pattern)) == 0
+					&& strlen(buf) == strlen(from)
+					&& strcmp(buf, from) >= 0
+					&& strcmp(buf, pattern) <= 0)
+				return 1;
+			continue;
+		}
+		if(_blacklist_normalize(blacklist, _blacklist_patterns[i], TRUE,
+					pattern, sizeof(pattern)) != 0)
+			continue;
+		for(j = 0; pattern[j] != '\0' && pattern[j] != '*'; j++)
+			if(buf[j] == '\0' || (pattern[j] != '?'
+						&& pattern[j] != buf[j]))
+				break;
+		if(pattern[j] == '*' || (pattern[j] == '\0'
+					&& buf[j] == '\0'))
+			return 1;
+	}
+	return 0;
+}
+
+
+/* usage */
+static int _usage(void)
+{
+	fputs("Usage: " PROGNAME " [-b rules][-n calls]\n"
+"  -b	Benchmark call screening with this many synthetic rules\n"
+"  -n	Number of calls to screen (default: 100000)\n", stderr);
+	return 1;
+}
+
+
+/* public */
+/* functions */
+/* main */
+int main(int argc, char * argv[])
+{
+	int o;
+	size_t rules = 0;
+	unsigned long calls = 100000;
+	char * p;
+
+	while((o = getopt(argc, argv, "b:n:")) != -1)
+		switch(o)
+		{
+			case 'b':
+				rules = strtoul(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0'
+						|| rules == 0)
+					return _usage();
+				break;
+			case 'n':
+				calls = strtoul(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0'
+						|| calls == 0)
+					return _usage();
+				break;
+			default:
+				return _usage();
+		}
+	if(optind != argc)
+		return _usage();
+	if(rules > 0)
+		return _blacklist_benchmark(rules, calls);
+	return _blacklist();
+}
@@ -0,0 +1,697 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+
+
+#ifdef __linux__
+# define _GNU_SOURCE /* for posix_openpt() */
+#endif
+#include "../src/modems/hayes/channel.c"
+#include "../src/modems/hayes/cmux.c"
+#include "../src/modems/hayes/command.c"
+#include "../src/modems/hayes/common.c"
+#include "../src/modems/hayes/concat.c"
+#include "../src/modems/hayes/gsm.c"
+#include "../src/modems/hayes/latency.c"
+#include "../src/modems/hayes/pdu.c"
+#include "../src/modems/hayes/quirks.c"
+#include "../src/modems/hayes/trace.c"
+#include "../src/modems/hayes.c"
+#include "../config.h"
+
+#ifndef PROGNAME
+# define PROGNAME "cmux"
+#endif
+
+
+/* private */
+/* types */
+struct _Modem
+{
+	Config * config;
+};
+
+typedef struct _CMUXLine
+{
+	char buf[256];
+	size_t cnt;
+	int data;
+} CMUXLine;
+
+typedef struct _CMUX
+{
+	Hayes * hayes;
+
+	/* fake DCE */
+	int fd;
+	int slave;
+	GIOChannel * channel;
+	guint source;
+	char buf[HAYESCMUX_BUFFER_SIZE];
+	size_t buf_cnt;
+	int mux;
+	HayesCMUXDecoder decoder;
+	CMUXLine lines[HAYESCMUX_DLCI_COUNT];
+	char * out;
+	size_t out_cnt;
+	guint out_source;
+
+	/* data call */
+	size_t total;
+	size_t sent;
+	size_t echoed;
+	guint payload;
+
+	/* progress */
+	guint deadline;
+	guint timeout;
+	unsigned int step;
+	unsigned int rings;
+	int signal;
+	int ret;
+} CMUX;
+
+
+/* variables */
+static GMainLoop * _loop;
+static CMUX * _cmux;
+
+
+/* prototypes */
+static int _cmux_frames(void);
+static int _cmux_run(CMUX * cmux, char const * pppd);
+
+static int _pppd(void);
+
+static char const * _cmux_helper_config_get(Modem * modem,
+		char const * variable);
+static int _cmux_helper_error(Modem * modem, char const * message, int ret);
+static void _cmux_helper_event(Modem * modem, ModemEvent * event);
+
+
+/* functions */
+/* cmux_frames */
+static HayesCMUXFrame * _frames_decode(HayesCMUXDecoder * decoder,
+		char const * buf, size_t size);
+static int _frames_check(char const * buf, size_t size, unsigned int dlci,
+		unsigned char control, char const * data, size_t length);
+
+static int _cmux_frames(void)
+{
+	int ret = 0;
+	const char sabm[] = "\xf9\x03\x3f\x01\x1c\xf9";
+	const char ua[] = "\xf9\x03\x73\x01\xd7\xf9";
+	char data[200];
+	char buf[sizeof(data) + HAYESCMUX_FRAME_OVERHEAD];
+	HayesCMUXDecoder decoder;
+	size_t size;
+	size_t i;
+
+	/* reference frames */
+	size = hayescmux_encode(buf, sizeof(buf), HAYESCMUX_DLCI_CONTROL, 1,
+			HAYESCMUX_FRAME_SABM | HAYESCMUX_FRAME_PF, NULL, 0);
+	if(size != sizeof(sabm) - 1 || memcmp(buf, sabm, size) != 0)
+		ret |= error_set_print(PROGNAME, 1, "%s", "SABM: Mismatch");
+	ret |= _frames_check(ua, sizeof(ua) - 1, HAYESCMUX_DLCI_CONTROL,
+			HAYESCMUX_FRAME_UA | HAYESCMUX_FRAME_PF, NULL, 0);
+	/* short and long information fields */
+	for(i = 0; i < sizeof(data); i++)
+		data[i] = i;
+	size = hayescmux_encode(buf, sizeof(buf), HAYESCMUX_DLCI_DATA, 1,
+			HAYESCMUX_FRAME_UIH, data, HAYESCMUX_FRAME_SIZE);
+	ret |= _frames_check(buf, size, HAYESCMUX_DLCI_DATA,
+			HAYESCMUX_FRAME_UIH, data, HAYESCMUX_FRAME_SIZE);
+	size = hayescmux_encode(buf, sizeof(buf), HAYESCMUX_DLCI_DATA, 1,
+			HAYESCMUX_FRAME_UIH, data, sizeof(data));
+	if(size != sizeof(buf))
+		ret |= error_set_print(PROGNAME, 1, "%s",
+				"UIH: Unexpected length");
+	ret |= _frames_check(buf, size, HAYESCMUX_DLCI_DATA,
+			HAYESCMUX_FRAME_UIH, data, sizeof(data));
+	/* the frame is too large for the buffer */
+	if(hayescmux_encode(buf, sizeof(buf) - 1, HAYESCMUX_DLCI_DATA, 1,
+				HAYESCMUX_FRAME_UIH, data, sizeof(data)) != 0)
+		ret |= error_set_print(PROGNAME, 1, "%s",
+				"UIH: Buffer overflow");
+	/* corrupted frames are dropped */
+	memcpy(buf, ua, sizeof(ua) - 1);
+	buf[4] ^= 0x01;
+	hayescmux_decoder_init(&decoder);
+	if(_frames_decode(&decoder, buf, sizeof(ua) - 1) != NULL)
+		ret |= error_set_print(PROGNAME, 1, "%s",
+				"UA: Invalid FCS accepted");
+	return ret;
+}
+
+static HayesCMUXFrame * _frames_decode(HayesCMUXDecoder * decoder,
+		char const * buf, size_t size)
+{
+	HayesCMUXFrame * frame = NULL;
+	size_t i;
+
+	/* one byte at a time, as if read from a slow serial port */
+	for(i = 0; i < size && frame == NULL; i++)
+		hayescmux_decode(decoder, &buf[i], 1, &frame);
+	return frame;
+}
+
+static int _frames_check(char const * buf, size_t size, unsigned int dlci,
+		unsigned char control, char const * data, size_t length)
+{
+	HayesCMUXDecoder decoder;
+	HayesCMUXFrame * frame;
+
+	hayescmux_decoder_init(&decoder);
+	if((frame = _frames_decode(&decoder, buf, size)) == NULL)
+		return error_set_print(PROGNAME, 1, "DLCI %u: %s", dlci,
+				"No frame decoded");
+	if(frame->dlci != dlci || frame->control != control
+			|| frame->length != length
+			|| (length > 0 && memcmp(frame->data, data, length)
+				!= 0))
+		return error_set_print(PROGNAME, 1, "DLCI %u: %s", dlci,
+				"Frame mismatch");
+	return 0;
+}
+
+
+/* cmux_run */
+static gboolean _run_on_dce(GIOChannel * source, GIOCondition condition,
+		gpointer data);
+static void _run_dce_frame(CMUX * cmux, HayesCMUXFrame * frame);
+static void _run_dce_line(CMUX * cmux, unsigned int dlci, char const * line);
+static void _run_dce_send(CMUX * cmux, unsigned int dlci,
+		unsigned char control, char const * buf, size_t size);
+static void _run_dce_write(CMUX * cmux, char const * buf, size_t size);
+static gboolean _run_on_dce_out(GIOChannel * source, GIOCondition condition,
+		gpointer data);
+static gboolean _run_on_deadline(gpointer data);
+static gboolean _run_on_payload(gpointer data);
+static gboolean _run_on_step(gpointer data);
+static HayesCommandStatus _run_on_signal(HayesCommand * command,
+		HayesCommandStatus status, HayesChannel * channel);
+
+static int _cmux_run(CMUX * cmux, char const * pppd)
+{
+	Modem modem;
+	ModemPluginHelper helper;
+	char const * p;
+	unsigned int i;
+
+	/* the fake DCE sits on the master side of a pseudo-terminal */
+	if((cmux->fd = posix_openpt(O_RDWR | O_NOCTTY)) < 0
+			|| grantpt(cmux->fd) != 0
+			|| unlockpt(cmux->fd) != 0
+			|| (p = ptsname(cmux->fd)) == NULL
+			|| (cmux->slave = open(p, O_RDWR | O_NOCTTY)) < 0)
+		return -error_set_print(PROGNAME, 1, "%s", strerror(errno));
+	fcntl(cmux->fd, F_SETFL, fcntl(cmux->fd, F_GETFL) | O_NONBLOCK);
+	hayescmux_decoder_init(&cmux->decoder);
+	cmux->channel = g_io_channel_unix_new(cmux->fd);
+	g_io_channel_set_encoding(cmux->channel, NULL, NULL);
+	g_io_channel_set_buffered(cmux->channel, FALSE);
+	cmux->source = g_io_add_watch(cmux->channel, G_IO_IN, _run_on_dce,
+			cmux);
+	/* the plug-in opens the slave side, multiplexed */
+	if((modem.config = config_new()) == NULL)
+		return -error_print(PROGNAME);
+	config_set(modem.config, NULL, "device", p);
+	config_set(modem.config, NULL, "hwflow", "0");
+	config_set(modem.config, NULL, "cmux", "1");
+	config_set(modem.config, NULL, "pppd", pppd);
+	memset(&helper, 0, sizeof(helper));
+	helper.modem = &modem;
+	helper.config_get = _cmux_helper_config_get;
+	helper.error = _cmux_helper_error;
+	helper.event = _cmux_helper_event;
+	if((cmux->hayes = plugin.init(&helper)) == NULL)
+	{
+		config_delete(modem.config);
+		return -1;
+	}
+	_cmux = cmux;
+	plugin.start(cmux->hayes, 0);
+	cmux->timeout = g_timeout_add(10, _run_on_step, cmux);
+	cmux->deadline = g_timeout_add(10000, _run_on_deadline, cmux);
+	g_main_loop_run(_loop);
+	if(cmux->deadline != 0)
+		g_source_remove(cmux->deadline);
+	if(cmux->timeout != 0)
+		g_source_remove(cmux->timeout);
+	if(cmux->payload != 0)
+		g_source_remove(cmux->payload);
+	plugin.stop(cmux->hayes);
+	plugin.destroy(cmux->hayes);
+	config_delete(modem.config);
+	g_source_remove(cmux->source);
+	if(cmux->out_source != 0)
+		g_source_remove(cmux->out_source);
+	free(cmux->out);
+	g_io_channel_shutdown(cmux->channel, TRUE, NULL);
+	g_io_channel_unref(cmux->channel);
+	close(cmux->slave);
+	for(i = 0; i < HAYESCMUX_DLCI_COUNT; i++)
+		if(cmux->lines[i].data)
+			cmux->ret = -error_set_print(PROGNAME, 1, "DLCI %u: %s",
+					i, "Still in data mode");
+	return cmux->ret;
+}
+
+static gboolean _run_on_dce(GIOChannel * source, GIOCondition condition,
+		gpointer data)
+{
+	CMUX * cmux = data;
+	HayesCMUXFrame * frame;
+	ssize_t cnt;
+	size_t i;
+	char * p;
+	char * q;
+	(void) condition;
+
+	if((cnt = read(g_io_channel_unix_get_fd(source),
+					&cmux->buf[cmux->buf_cnt],
+					sizeof(cmux->buf) - cmux->buf_cnt
+					- 1)) <= 0)
+		return (cnt < 0 && errno == EAGAIN) ? TRUE : FALSE;
+	cmux->buf_cnt += cnt;
+	if(cmux->mux)
+	{
+		for(i = 0; i < cmux->buf_cnt;)
+		{
+			i += hayescmux_decode(&cmux->decoder, &cmux->buf[i],
+					cmux->buf_cnt - i, &frame);
+			if(frame != NULL)
+				_run_dce_frame(cmux, frame);
+		}
+		cmux->buf_cnt = 0;
+		return TRUE;
+	}
+	/* answer every complete command, until multiplexing */
+	cmux->buf[cmux->buf_cnt] = '\0';
+	for(p = cmux->buf; (q = strchr(p, '\r')) != NULL; p = q + 1)
+	{
+		*q = '\0';
+		if(*p == '\n')
+			p++;
+		if(*p != '\0')
+			_run_dce_line(cmux, HAYESCMUX_DLCI_CONTROL, p);
+	}
+	if(cmux->mux)
+		p = &cmux->buf[cmux->buf_cnt];
+	cmux->buf_cnt = strlen(p);
+	memmove(cmux->buf, p, cmux->buf_cnt);
+	return TRUE;
+}
+
+static void _run_dce_frame(CMUX * cmux, HayesCMUXFrame * frame)
+{
+	const unsigned char control = frame->control & ~HAYESCMUX_FRAME_PF;
+	unsigned char * p = (unsigned char *)frame->data;
+	CMUXLine * line;
+	size_t i;
+
+	if(frame->dlci >= HAYESCMUX_DLCI_COUNT)
+	{
+		_run_dce_send(cmux, frame->dlci, HAYESCMUX_FRAME_DM
+				| HAYESCMUX_FRAME_PF, NULL, 0);
+		return;
+	}
+	line = &cmux->lines[frame->dlci];
+	if(control == HAYESCMUX_FRAME_SABM || control == HAYESCMUX_FRAME_DISC)
+	{
+		_run_dce_send(cmux, frame->dlci, HAYESCMUX_FRAME_UA
+				| HAYESCMUX_FRAME_PF, NULL, 0);
+		return;
+	}
+	if(control != HAYESCMUX_FRAME_UIH)
+		return;
+	if(frame->dlci == HAYESCMUX_DLCI_CONTROL)
+	{
+		if(frame->length < 2 || (p[0] & HAYESCMUX_MESSAGE_CR) == 0)
+			return; /* not a command */
+		if((p[0] & ~HAYESCMUX_MESSAGE_CR) == HAYESCMUX_MESSAGE_CLD)
+			cmux->mux = 0;
+		/* dropping the virtual DTR line ends the data mode */
+		else if((p[0] & ~HAYESCMUX_MESSAGE_CR)
+				== HAYESCMUX_MESSAGE_MSC && frame->length >= 4
+				&& (p[2] >> 2) < HAYESCMUX_DLCI_COUNT
+				&& (p[3] & HAYESCMUX_SIGNAL_RTC) == 0)
+			cmux->lines[p[2] >> 2].data = 0;
+		/* acknowledge the command */
+		p[0] &= ~HAYESCMUX_MESSAGE_CR;
+		_run_dce_send(cmux, HAYESCMUX_DLCI_CONTROL,
+				HAYESCMUX_FRAME_UIH, frame->data,
+				frame->length);
+		return;
+	}
+	if(line->data)
+	{
+		/* compare what pppd echoed to what was sent */
+		for(i = 0; i < frame->length; i++)
+			if(cmux->echoed + i >= cmux->sent
+					|| p[i] != (unsigned char)
+					((cmux->echoed + i) * 7))
+			{
+				cmux->ret = -error_set_print(PROGNAME, 1, "%s",
+						"Data corrupted");
+				g_main_loop_quit(_loop);
+				return;
+			}
+		cmux->echoed += frame->length;
+		return;
+	}
+	for(i = 0; i < frame->length; i++)
+		if(p[i] == '\r')
+		{
+			line->buf[line->cnt] = '\0';
+			if(line->cnt > 0)
+				_run_dce_line(cmux, frame->dlci, line->buf);
+			line->cnt = 0;
+		}
+		else if(p[i] != '\n' && line->cnt < sizeof(line->buf) - 1)
+			line->buf[line->cnt++] = p[i];
+}
+
+static void _run_dce_line(CMUX * cmux, unsigned int dlci, char const * line)
+{
+	static char const ok[] = "\r\nOK\r\n";
+	static char const csq[] = "\r\n+CSQ: 20,99\r\n\r\nOK\r\n";
+	static char const connect[] = "\r\nCONNECT\r\n";
+	static char const ring[] = "\r\nRING\r\n";
+
+	if(!cmux->mux)
+	{
+		/* not multiplexed yet */
+		_run_dce_write(cmux, ok, sizeof(ok) - 1);
+		if(strcmp(line, "AT+CMUX=0") == 0)
+			cmux->mux = 1;
+		return;
+	}
+	if(strcmp(line, "AT+CSQ") == 0)
+	{
+		_run_dce_send(cmux, dlci, HAYESCMUX_FRAME_UIH, csq,
+				sizeof(csq) - 1);
+		/* an incoming call, reported on its own channel */
+		_run_dce_send(cmux, HAYESCMUX_DLCI_UNSOLLICITED,
+				HAYESCMUX_FRAME_UIH, ring, sizeof(ring) - 1);
+	}
+	else if(strncmp(line, "AT+CGDATA=", 10) == 0)
+	{
+		_run_dce_send(cmux, dlci, HAYESCMUX_FRAME_UIH, connect,
+				sizeof(connect) - 1);
+		cmux->lines[dlci].data = 1;
+		cmux->payload = g_timeout_add(1, _run_on_payload, cmux);
+	}
+	else
+		_run_dce_send(cmux, dlci, HAYESCMUX_FRAME_UIH, ok,
+				sizeof(ok) - 1);
+}
+
+static void _run_dce_send(CMUX * cmux, unsigned int dlci,
+		unsigned char control, char const * buf, size_t size)
+{
+	char frame[HAYESCMUX_FRAME_SIZE + HAYESCMUX_FRAME_OVERHEAD];
+	const unsigned int cr = (control & ~HAYESCMUX_FRAME_PF)
+		!= HAYESCMUX_FRAME_UIH;
+	size_t len;
+	size_t n;
+
+	do
+	{
+		len = min(size, HAYESCMUX_FRAME_SIZE);
+		if((n = hayescmux_encode(frame, sizeof(frame), dlci, cr,
+						control, buf, len)) == 0)
+			return;
+		_run_dce_write(cmux, frame, n);
+		buf += len;
+		size -= len;
+	}
+	while(size > 0);
+}
+
+static void _run_dce_write(CMUX * cmux, char const * buf, size_t size)
+{
+	char * p;
+
+	if((p = realloc(cmux->out, cmux->out_cnt + size)) == NULL)
+	{
+		error_set_print(PROGNAME, 1, "%s", strerror(errno));
+		return;
+	}
+	cmux->out = p;
+	memcpy(&p[cmux->out_cnt], buf, size);
+	cmux->out_cnt += size;
+	if(cmux->out_source == 0)
+		cmux->out_source = g_io_add_watch(cmux->channel, G_IO_OUT,
+				_run_on_dce_out, cmux);
+}
+
+static gboolean _run_on_dce_out(GIOChannel * source, GIOCondition condition,
+		gpointer data)
+{
+	CMUX * cmux = data;
+	ssize_t cnt;
+	(void) condition;
+
+	while(cmux->out_cnt > 0)
+		if((cnt = write(g_io_channel_unix_get_fd(source), cmux->out,
+						cmux->out_cnt)) > 0)
+		{
+			cmux->out_cnt -= cnt;
+			memmove(cmux->out, &cmux->out[cnt], cmux->out_cnt);
+		}
+		else if(cnt < 0 && (errno == EAGAIN || errno == EINTR))
+			/* wait until the plug-in reads */
+			return TRUE;
+		else
+		{
+			error_set_print(PROGNAME, 1, "%s", strerror(errno));
+			cmux->out_cnt = 0;
+		}
+	cmux->out_source = 0;
+	return FALSE;
+}
+
+static gboolean _run_on_deadline(gpointer data)
+{
+	CMUX * cmux = data;
+
+	cmux->deadline = 0;
+	cmux->ret = -error_set_print(PROGNAME, 1, "Timeout at step %u",
+			cmux->step);
+	g_main_loop_quit(_loop);
+	return FALSE;
+}
+
+static gboolean _run_on_payload(gpointer data)
+{
+	CMUX * cmux = data;
+	char buf[HAYESCMUX_FRAME_SIZE * 16];
+	size_t size;
+	size_t i;
+
+	/* keep the output bounded, pppd echoes it back */
+	if(cmux->sent >= cmux->total)
+	{
+		cmux->payload = 0;
+		return FALSE;
+	}
+	if(cmux->sent - cmux->echoed > sizeof(buf) * 4)
+		return TRUE;
+	size = min(sizeof(buf), cmux->total - cmux->sent);
+	for(i = 0; i < size; i++)
+		buf[i] = (cmux->sent + i) * 7;
+	cmux->sent += size;
+	_run_dce_send(cmux, HAYESCMUX_DLCI_DATA, HAYESCMUX_FRAME_UIH, buf,
+			size);
+	return TRUE;
+}
+
+static gboolean _run_on_step(gpointer data)
+{
+	CMUX * cmux = data;
+	Hayes * hayes = cmux->hayes;
+	ModemRequest request;
+	HayesCommand * command;
+
+	switch(cmux->step)
+	{
+		case 0: /* wait for every channel to be settled */
+			if(hayes->cmux == NULL
+					|| hayes->channel.mode
+					!= HAYESCHANNEL_MODE_COMMAND
+					|| hayes->data.mode
+					!= HAYESCHANNEL_MODE_COMMAND
+					|| hayes->unsollicited.mode
+					!= HAYESCHANNEL_MODE_COMMAND)
+				return TRUE;
+			memset(&request, 0, sizeof(request));
+			request.type = MODEM_REQUEST_CALL;
+			request.call.call_type = MODEM_CALL_TYPE_DATA;
+			if(plugin.request(hayes, &request) != 0)
+				break;
+			cmux->step++;
+			return TRUE;
+		case 1: /* query the signal while connected */
+			if(hayes->data.mode != HAYESCHANNEL_MODE_DATA
+					|| cmux->sent == 0)
+				return TRUE;
+			if((command = hayes_command_new("AT+CSQ")) == NULL)
+				break;
+			hayes_command_set_callback(command, _run_on_signal,
+					&hayes->channel);
+			hayes_command_set_timeout(command, 2000);
+			if(_hayes_queue_command(hayes, &hayes->channel,
+						command) != 0)
+			{
+				hayes_command_delete(command);
+				break;
+			}
+			cmux->step++;
+			return TRUE;
+		case 2: /* hang up once everything went through */
+			if(cmux->echoed < cmux->total || cmux->signal == 0
+					|| cmux->rings == 0)
+				return TRUE;
+			memset(&request, 0, sizeof(request));
+			request.type = MODEM_REQUEST_CALL_HANGUP;
+			if(plugin.request(hayes, &request) != 0)
+				break;
+			cmux->step++;
+			return TRUE;
+		case 3: /* the data channel is usable again */
+			if(hayes->data.mode != HAYESCHANNEL_MODE_COMMAND)
+				return TRUE;
+			printf("%s: %lu bytes echoed, %u ring(s)\n", PROGNAME,
+					(unsigned long)cmux->echoed,
+					cmux->rings);
+			cmux->timeout = 0;
+			g_main_loop_quit(_loop);
+			return FALSE;
+	}
+	cmux->ret = -error_print(PROGNAME);
+	cmux->timeout = 0;
+	g_main_loop_quit(_loop);
+	return FALSE;
+}
+
+static HayesCommandStatus _run_on_signal(HayesCommand * command,
+		HayesCommandStatus status, HayesChannel * channel)
+{
+	CMUX * cmux = _cmux;
+
+	status = _on_request_generic(command, status, channel);
+	if(status == HCS_SUCCESS)
+		cmux->signal = (channel->hayes->data.mode
+				== HAYESCHANNEL_MODE_DATA) ? 1 : -1;
+	else if(status == HCS_ERROR || status == HCS_TIMEOUT)
+		cmux->signal = -1;
+	if(cmux->signal < 0)
+	{
+		cmux->ret = -error_set_print(PROGNAME, 1, "%s",
+				"AT+CSQ: No answer during the data call");
+		g_main_loop_quit(_loop);
+	}
+	return status;
+}
+
+
+/* pppd */
+static int _pppd(void)
+{
+	char buf[BUFSIZ];
+	ssize_t cnt;
+
+	/* echo everything back */
+	while((cnt = read(STDIN_FILENO, buf, sizeof(buf))) > 0)
+		if(write(STDOUT_FILENO, buf, cnt) != cnt)
+			return 2;
+	return (cnt == 0) ? 0 : 2;
+}
+
+
+/* helpers */
+/* cmux_helper_config_get */
+static char const * _cmux_helper_config_get(Modem * modem,
+		char const * variable)
+{
+	return config_get(modem->config, NULL, variable);
+}
+
+
+/* cmux_helper_error */
+static int _cmux_helper_error(Modem * modem, char const * message, int ret)
+{
+	(void) modem;
+
+	fprintf(stderr, "%s: %s\n", PROGNAME, message);
+	return ret;
+}
+
+
+/* cmux_helper_event */
+static void _cmux_helper_event(Modem * modem, ModemEvent * event)
+{
+	(void) modem;
+
+	if(event->type == MODEM_EVENT_TYPE_CALL && _cmux != NULL
+			&& event->call.status == MODEM_CALL_STATUS_RINGING)
+		_cmux->rings++;
+}
+
+
+/* public */
+/* functions */
+/* main */
+int main(int argc, char * argv[])
+{
+	int ret = 0;
+	CMUX cmux;
+	char * pppd;
+
+	/* the plug-in runs this program again instead of pppd */
+	if(argc > 1 && strcmp(argv[1], "call") == 0)
+		return _pppd();
+	if(argc != 1)
+	{
+		fputs("Usage: " PROGNAME "\n", stderr);
+		return 1;
+	}
+	if(_cmux_frames() != 0)
+		ret = 2;
+	if((pppd = realpath(argv[0], NULL)) == NULL)
+		return error_set_print(PROGNAME, 2, "%s: %s", argv[0],
+				strerror(errno));
+	memset(&cmux, 0, sizeof(cmux));
+	cmux.total = 64 * 1024;
+	_loop = g_main_loop_new(NULL, FALSE);
+	if(_cmux_run(&cmux, pppd) != 0)
+		ret = 2;
+	g_main_loop_unref(_loop);
+	free(pppd);
+	return ret;
+}
@@ -0,0 +1,328 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "../src/callbacks.c"
+#include "../src/modem.c"
+#include "../src/phone.c"
+#include "benchmark.c"
+
+#ifndef PROGNAME
+# define PROGNAME "config"
+#endif
+
+
+/* private */
+/* prototypes */
+static int _config(unsigned long keys);
+static int _config_benchmark(unsigned long keys);
+
+static int _usage(void);
+
+
+/* functions */
+/* config */
+static int _config_check(unsigned long keys);
+static void _config_delete(Phone * phone, char * directory);
+static int _config_error(char const * message, int ret);
+static int _config_new(Phone * phone, char * directory);
+static int _config_section(Phone * phone, unsigned long keys);
+
+static int _config(unsigned long keys)
+{
+	int ret = 0;
+	char directory[] = "/tmp/" PROGNAME ".XXXXXX";
+	Phone phone;
+	char * filename;
+	unsigned long i;
+	char variable[32];
+	char value[32];
+
+	if(_config_new(&phone, directory) != 0)
+		return 2;
+	if((filename = _phone_config_filename()) == NULL)
+	{
+		_config_delete(&phone, directory);
+		return -_config_error(strerror(errno), 2);
+	}
+	/* a plug-in changing its settings */
+	for(i = 0; i < keys; i++)
+	{
+		snprintf(variable, sizeof(variable), "key%lu", i);
+		snprintf(value, sizeof(value), "%lu", i);
+		if(phone.helper.config_set(&phone, PROGNAME, variable, value)
+				!= 0)
+			ret = -_config_error(variable, 2);
+	}
+	/* the changes are only written once, later on */
+	if(phone.config_source == 0)
+		ret = -_config_error("No write pending", 2);
+	if(access(filename, F_OK) == 0)
+		ret = -_config_error("Written too early", 2);
+	if(_phone_config_flush(&phone) != 0)
+		ret = 2;
+	if(phone.config_source != 0)
+		ret = -_config_error("Write still pending", 2);
+	if(ret == 0)
+		ret = _config_check(keys);
+	if(ret == 0)
+		ret = _config_section(&phone, keys);
+	free(filename);
+	_config_delete(&phone, directory);
+	return ret;
+}
+
+static int _config_check(unsigned long keys)
+{
+	int ret = 0;
+	Config * config;
+	char * filename;
+	unsigned long i;
+	char variable[32];
+	char value[32];
+	char const * p;
+
+	if((filename = _phone_config_filename()) == NULL)
+		return -_config_error(strerror(errno), 2);
+	if((config = config_new()) == NULL)
+	{
+		free(filename);
+		return -_config_error(error_get(NULL), 2);
+	}
+	if(config_load(config, filename) != 0)
+		ret = -_config_error(error_get(NULL), 2);
+	else
+		for(i = 0; i < keys; i++)
+		{
+			snprintf(variable, sizeof(variable), "key%lu", i);
+			snprintf(value, sizeof(value), "%lu", i);
+			if((p = config_get(config, "plugin::" PROGNAME,
+							variable)) == NULL
+					|| strcmp(p, value) != 0)
+				ret = -_config_error(variable, 2);
+		}
+	config_delete(config);
+	free(filename);
+	return ret;
+}
+
+static void _config_delete(Phone * phone, char * directory)
+{
+	char * filename;
+
+	if(phone->config_source != 0)
+		g_source_remove(phone->config_source);
+	g_hash_table_destroy(phone->config_sections);
+	config_delete(phone->config);
+	if((filename = _phone_config_filename()) != NULL)
+	{
+		unlink(filename);
+		free(filename);
+	}
+	/* fails if a temporary file was left behind */
+	if(rmdir(directory) != 0)
+		_config_error(directory, 2);
+}
+
+static int _config_error(char const * message, int ret)
+{
+	fprintf(stderr, "%s: %s\n", PROGNAME, message);
+	return ret;
+}
+
+static int _config_new(Phone * phone, char * directory)
+{
+	memset(phone, 0, sizeof(*phone));
+	if(mkdtemp(directory) == NULL)
+		return -_config_error(strerror(errno), 2);
+	/* write the configuration there */
+	if(setenv("HOME", directory, 1) != 0)
+	{
+		rmdir(directory);
+		return -_config_error(strerror(errno), 2);
+	}
+	if((phone->config = config_new()) == NULL)
+	{
+		rmdir(directory);
+		return -_config_error(error_get(NULL), 2);
+	}
+	phone->config_sections = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, _phone_config_section_delete);
+	phone->helper.config_get = _phone_config_get;
+	phone->helper.config_set = _phone_config_set;
+	phone->helper.config_section = _phone_config_section;
+	phone->helper.config_section_get = _phone_config_section_get;
+	return 0;
+}
+
+static int _config_section(Phone * phone, unsigned long keys)
+{
+	int ret = 0;
+	PhoneConfigSection * section;
+	unsigned long i;
+	char variable[32];
+
+	/* the section is only resolved once */
+	if((section = phone->helper.config_section(phone, PROGNAME)) == NULL)
+		return -_config_error(PROGNAME, 2);
+	if(phone->helper.config_section(phone, PROGNAME) != section)
+		ret = -_config_error("Section resolved twice", 2);
+	for(i = 0; i < keys; i++)
+	{
+		snprintf(variable, sizeof(variable), "key%lu", i);
+		if(phone->helper.config_section_get(phone, section, variable)
+				!= phone->helper.config_get(phone, PROGNAME,
+					variable))
+			ret = -_config_error(variable, 2);
+	}
+	if(phone->helper.config_section_get(phone, section, "missing")
+			!= NULL)
+		ret = -_config_error("missing", 2);
+	return ret;
+}
+
+
+/* config_benchmark */
+static void _benchmark_section(Phone * phone, char const * variable);
+
+static int _config_benchmark(unsigned long keys)
+{
+	int ret = 0;
+	char directory[] = "/tmp/" PROGNAME ".XXXXXX";
+	Phone phone;
+	unsigned long i;
+	char variable[32];
+	char value[32];
+	double t0;
+	double t1;
+	double t2;
+
+	if(_config_new(&phone, directory) != 0)
+		return 2;
+	/* writing the file after every change, as before */
+	t0 = _benchmark_time();
+	for(i = 0; i < keys; i++)
+	{
+		snprintf(variable, sizeof(variable), "key%lu", i);
+		snprintf(value, sizeof(value), "%lu", i);
+		if(phone.helper.config_set(&phone, PROGNAME, variable, value)
+				!= 0 || _phone_config_flush(&phone) != 0)
+			ret = 2;
+	}
+	t1 = _benchmark_time();
+	/* writing the file once the changes are over */
+	for(i = 0; i < keys; i++)
+	{
+		snprintf(variable, sizeof(variable), "key%lu", i);
+		snprintf(value, sizeof(value), "%lu", i + 1);
+		if(phone.helper.config_set(&phone, PROGNAME, variable, value)
+				!= 0)
+			ret = 2;
+	}
+	if(_phone_config_flush(&phone) != 0)
+		ret = 2;
+	t2 = _benchmark_time();
+	printf("%s: %lu keys set in %.3fms (%lu writes), %.3fms (1 write)\n",
+			PROGNAME, keys, (t1 - t0) * 1000.0, keys,
+			(t2 - t1) * 1000.0);
+	/* looking up a variable, as the plug-ins do on every event */
+	snprintf(variable, sizeof(variable), "key%lu", keys / 2);
+	_benchmark_section(&phone, variable);
+	_config_delete(&phone, directory);
+	return ret;
+}
+
+static void _benchmark_section(Phone * phone, char const * variable)
+{
+	const unsigned long lookups = 1000000;
+	PhoneConfigSection * section;
+	unsigned long i;
+	char const * volatile value;
+	double t0;
+	double t1;
+	double t2;
+
+	t0 = _benchmark_time();
+	for(i = 0; i < lookups; i++)
+		value = phone->helper.config_get(phone, PROGNAME, variable);
+	t1 = _benchmark_time();
+	section = phone->helper.config_section(phone, PROGNAME);
+	for(i = 0; i < lookups; i++)
+		value = phone->helper.config_section_get(phone, section,
+				variable);
+	t2 = _benchmark_time();
+	(void) value;
+	printf("%s: variable looked up in %.1fns (section name),"
+			" %.1fns (section handle)\n", PROGNAME,
+			(t1 - t0) * 1000000000.0 / lookups,
+			(t2 - t1) * 1000000000.0 / lookups);
+}
+
+
+/* usage */
+static int _usage(void)
+{
+	fputs("Usage: " PROGNAME " [-b][-n keys]\n"
+"  -b	Benchmark the configuration writes and lookups\n"
+"  -n	Number of keys set by the plug-in (default: 1000)\n", stderr);
+	return 1;
+}
+
+
+/* public */
+/* functions */
+/* main */
+int main(int argc, char * argv[])
+{
+	int o;
+	int benchmark = 0;
+	unsigned long keys = 1000;
+	char * p;
+
+	while((o = getopt(argc, argv, "bn:")) != -1)
+		switch(o)
+		{
+			case 'b':
+				benchmark = 1;
+				break;
+			case 'n':
+				keys = strtoul(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0'
+						|| keys == 0)
+					return _usage();
+				break;
+			default:
+				return _usage();
+		}
+	if(optind != argc)
+		return _usage();
+	if(benchmark)
+		return _config_benchmark(keys);
+	return _config(keys);
+}
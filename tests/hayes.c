@@ -25,12 +25,21 @@
 
 
 
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
 #include "../src/modems/hayes/channel.c"
+#include "../src/modems/hayes/cmux.c"
 #include "../src/modems/hayes/command.c"
 #include "../src/modems/hayes/common.c"
+#include "../src/modems/hayes/concat.c"
+#include "../src/modems/hayes/gsm.c"
+#include "../src/modems/hayes/latency.c"
 #include "../src/modems/hayes/pdu.c"
 #include "../src/modems/hayes/quirks.c"
+#include "../src/modems/hayes/trace.c"
 #include "../src/modems/hayes.c"
+#include "benchmark.c"
 #include "../config.h"
 
 #ifndef PROGNAME
@@ -48,6 +57,8 @@ struct _Modem
 
 /* prototypes */
 static int _hayes(void);
+static int _hayes_benchmark(unsigned long iterations);
+static int _hayes_dispatch(void);
 
 static char const * _hayes_helper_config_get(Modem * modem,
 		char const * variable);
@@ -56,6 +67,18 @@ static int _hayes_helper_config_set(Modem * modem, char const * variable,
 static int _hayes_helper_error(Modem * modem, char const * message, int ret);
 static void _hayes_helper_event(Modem * modem, ModemEvent * event);
 
+static int _usage(void);
+
+
+/* constants */
+static char const * const _hayes_dispatch_lines[] =
+{
+	"+CSQ: 20,99", "OK", "+CREG: 1,\"0001\",\"0002\"", "RING",
+	"+CMGL: 1,0,,23", "NO CARRIER", "+CME ERROR: 10", "CONNECT",
+	"07911326040000F0040B911346610089F60000208062917314080CC8F71D"
+		"14969741F977FD07", "ERROR", "+CPBR: 1,\"123\",129,\"A\""
+};
+
 
 /* variables */
 static GMainLoop * _loop;
@@ -147,6 +170,158 @@ static gboolean _hayes_on_stop(gpointer data)
 	return FALSE;
 }
 
+
+/* hayes_benchmark */
+static HayesCodeHandler * _dispatch_linear(char const * answer);
+
+static int _hayes_benchmark(unsigned long iterations)
+{
+	const size_t count = sizeof(_hayes_dispatch_lines)
+		/ sizeof(*_hayes_dispatch_lines);
+	char const * const * lines = _hayes_dispatch_lines;
+	size_t i;
+	size_t len;
+	unsigned long j;
+	size_t found[2] = { 0, 0 };
+	double t;
+	double linear;
+	double hash;
+
+	_hayes_code_init();
+	/* compare the cost per line */
+	t = _benchmark_time();
+	for(j = 0; j < iterations; j++)
+		for(i = 0; i < count; i++)
+			found[0] += (_dispatch_linear(lines[i]) != NULL);
+	linear = _benchmark_time() - t;
+	t = _benchmark_time();
+	for(j = 0; j < iterations; j++)
+		for(i = 0; i < count; i++)
+		{
+			for(len = 0; lines[i][len] != '\0'
+					&& lines[i][len] != ':'; len++);
+			found[1] += (_hayes_code_lookup(lines[i], len) != NULL);
+		}
+	hash = _benchmark_time() - t;
+	printf("%s: dispatch: %.1fns/line (linear), %.1fns/line (hash)\n",
+			PROGNAME, linear * 1e9 / ((double)iterations * count),
+			hash * 1e9 / ((double)iterations * count));
+	return (found[0] == found[1]) ? 0 : -1;
+}
+
+
+/* hayes_dispatch */
+static HayesCommandHandler _dispatch_linear_command(char const * attention);
+static HayesRequestHandler * _dispatch_linear_request(unsigned int type);
+
+static int _hayes_dispatch(void)
+{
+	int ret = 0;
+	const size_t count = sizeof(_hayes_dispatch_lines)
+		/ sizeof(*_hayes_dispatch_lines);
+	char const * const * lines = _hayes_dispatch_lines;
+	char const * commands[] =
+	{
+		"AT+CSQ", "AT+CPBR=1,10", "AT+CGMI", "ATD0123456789;", "ATA",
+		"AT+CMGL=4", "AT+CFUN?", "ATE0"
+	};
+	size_t i;
+	size_t len;
+	unsigned int type;
+	HayesCommand * command;
+
+	_hayes_code_init();
+	_hayes_request_init();
+	/* check the lookups against the reference implementation */
+	for(i = 0; i < count; i++)
+	{
+		for(len = 0; lines[i][len] != '\0' && lines[i][len] != ':';
+				len++);
+		if(_hayes_code_lookup(lines[i], len) != _dispatch_linear(
+					lines[i]))
+		{
+			fprintf(stderr, "%s: %s: Dispatch mismatch\n",
+					PROGNAME, lines[i]);
+			ret = -1;
+		}
+	}
+	for(i = 0; i < sizeof(commands) / sizeof(*commands); i++)
+	{
+		if((command = hayes_command_new(commands[i])) == NULL)
+			return -error_print(PROGNAME);
+		_queue_command_bind(command);
+		if(hayes_command_get_handler(command)
+				!= _dispatch_linear_command(commands[i]))
+		{
+			fprintf(stderr, "%s: %s: Binding mismatch\n",
+					PROGNAME, commands[i]);
+			ret = -1;
+		}
+		hayes_command_delete(command);
+	}
+	for(type = 0; type < HAYES_REQUEST_COUNT; type++)
+		if(_hayes_request_table[type] != _dispatch_linear_request(type))
+		{
+			fprintf(stderr, "%s: %u: Request mismatch\n",
+					PROGNAME, type);
+			ret = -1;
+		}
+	return ret;
+}
+
+static HayesCodeHandler * _dispatch_linear(char const * answer)
+{
+	const size_t count = sizeof(_hayes_code_handlers)
+		/ sizeof(*_hayes_code_handlers);
+	size_t i;
+	size_t len;
+	HayesCodeHandler * hch;
+
+	/* as previously implemented by _hayes_parse_trigger() */
+	for(i = 0; i < count; i++)
+	{
+		hch = &_hayes_code_handlers[i];
+		len = strlen(hch->code);
+		if(strncmp(hch->code, answer, len) == 0
+				&& (answer[len] == ':' || answer[len] == '\0'))
+			return hch;
+	}
+	return NULL;
+}
+
+static HayesCommandHandler _dispatch_linear_command(char const * attention)
+{
+	const size_t count = sizeof(_hayes_code_handlers)
+		/ sizeof(*_hayes_code_handlers);
+	size_t i;
+	size_t len;
+	HayesCodeHandler * hch;
+
+	for(i = 0; i < count; i++)
+	{
+		hch = &_hayes_code_handlers[i];
+		len = strlen(hch->code);
+		if(strncmp(hch->code, &attention[2], len) == 0
+				&& !isalnum((unsigned char)attention[2 + len]))
+			return hch->callback;
+	}
+	return NULL;
+}
+
+static HayesRequestHandler * _dispatch_linear_request(unsigned int type)
+{
+	const size_t count = sizeof(_hayes_request_handlers)
+		/ sizeof(*_hayes_request_handlers);
+	size_t i;
+
+	/* as previously implemented by _hayes_request_channel() */
+	for(i = 0; i < count; i++)
+		if(_hayes_request_handlers[i].type == type)
+			return &_hayes_request_handlers[i];
+	return NULL;
+}
+
+
 /* helpers */
 /* hayes_helper_config_get */
 static char const * _hayes_helper_config_get(Modem * modem,
@@ -206,10 +381,46 @@ static void _hayes_helper_event(Modem * modem, ModemEvent * event)
 }
 
 
+/* usage */
+static int _usage(void)
+{
+	fputs("Usage: " PROGNAME " [-b][-n iterations]\n"
+"  -b	Benchmark the dispatching of the answers\n"
+"  -n	Number of iterations (default: 100000)\n", stderr);
+	return 1;
+}
+
+
 /* public */
 /* functions */
 /* main */
-int main(void)
+int main(int argc, char * argv[])
 {
+	int o;
+	int benchmark = 0;
+	unsigned long iterations = 100000;
+	char * p;
+
+	while((o = getopt(argc, argv, "bn:")) != -1)
+		switch(o)
+		{
+			case 'b':
+				benchmark = 1;
+				break;
+			case 'n':
+				iterations = strtoul(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0'
+						|| iterations == 0)
+					return _usage();
+				break;
+			default:
+				return _usage();
+		}
+	if(optind != argc)
+		return _usage();
+	if(_hayes_dispatch() != 0)
+		return 2;
+	if(benchmark)
+		return (_hayes_benchmark(iterations) == 0) ? 0 : 2;
 	return (_hayes() == 0) ? 0 : 2;
 }
@@ -0,0 +1,186 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <stdio.h>
+#include <string.h>
+#include "../src/modems/hayes/latency.c"
+
+#ifndef PROGNAME
+# define PROGNAME "latency"
+#endif
+
+
+/* private */
+/* prototypes */
+static int _latency(void);
+
+
+/* functions */
+/* latency */
+static int _latency_name(void);
+static int _latency_percentiles(void);
+static int _latency_timeout(void);
+
+static int _latency(void)
+{
+	int ret = 0;
+
+	ret |= _latency_name();
+	ret |= _latency_percentiles();
+	ret |= _latency_timeout();
+	return ret;
+}
+
+static int _latency_name(void)
+{
+	HayesLatency latency;
+	char const * names[][2] =
+	{
+		{ "ATD+33123456789;",	"ATD"		},
+		{ "ATD*100#;",		"ATD"		},
+		{ "AT+CMGS=153",	"AT+CMGS"	},
+		{ "AT+CPBR=1,10",	"AT+CPBR"	},
+		{ "AT+CPIN?",		"AT+CPIN?"	},
+		{ "AT&F",		"AT&F"		},
+		{ "ATE0V1",		"ATE"		}
+	};
+	size_t i;
+
+	printf("%s: Testing names\n", PROGNAME);
+	for(i = 0; i < sizeof(names) / sizeof(*names); i++)
+	{
+		hayeslatency_set_name(&latency, names[i][0]);
+		if(strcmp(latency.name, names[i][1]) != 0)
+		{
+			fprintf(stderr, "%s: \"%s\": \"%s\", \"%s\" expected\n",
+					PROGNAME, names[i][0], latency.name,
+					names[i][1]);
+			return 2;
+		}
+	}
+	return 0;
+}
+
+static int _latency_percentiles(void)
+{
+	HayesLatency latency;
+	const unsigned int percents[] = { 50, 95, 99 };
+	gint64 expected;
+	gint64 value;
+	unsigned int i;
+	size_t j;
+
+	printf("%s: Testing percentiles\n", PROGNAME);
+	hayeslatency_init(&latency);
+	if(hayeslatency_get_percentile(&latency, 50) != 0)
+		return 2;
+	/* 1ms to 200ms, evenly */
+	for(i = 1; i <= 200; i++)
+		hayeslatency_record(&latency, i * 1000);
+	for(j = 0; j < sizeof(percents) / sizeof(*percents); j++)
+	{
+		expected = percents[j] * 2000;
+		value = hayeslatency_get_percentile(&latency, percents[j]);
+		/* the buckets are precise to 25% */
+		if(value < expected || value > expected + expected / 4)
+		{
+			fprintf(stderr, "%s: p%u: %" G_GINT64_FORMAT
+					"us, %" G_GINT64_FORMAT "us expected\n",
+					PROGNAME, percents[j], value,
+					expected);
+			return 2;
+		}
+	}
+	if(hayeslatency_get_percentile(&latency, 100) != 200000)
+		return 2;
+	/* the oldest samples lose their weight */
+	for(i = 0; i < HAYESLATENCY_WINDOW * 8; i++)
+		hayeslatency_record(&latency, 10000);
+	if((value = hayeslatency_get_percentile(&latency, 99)) > 12500)
+	{
+		fprintf(stderr, "%s: p99: %" G_GINT64_FORMAT "us after decay\n",
+				PROGNAME, value);
+		return 2;
+	}
+	return 0;
+}
+
+static int _latency_timeout(void)
+{
+	HayesLatency latency;
+	unsigned int i;
+	unsigned int timeout;
+
+	printf("%s: Testing timeouts\n", PROGNAME);
+	hayeslatency_init(&latency);
+	/* not enough samples yet */
+	if(hayeslatency_get_timeout(&latency, 30000, 3000, 30000) != 30000)
+		return 2;
+	for(i = 0; i < HAYESLATENCY_SAMPLES; i++)
+		hayeslatency_record(&latency, 50000);
+	/* quick commands get the floor */
+	if((timeout = hayeslatency_get_timeout(&latency, 30000, 3000, 30000))
+			!= 3000)
+	{
+		fprintf(stderr, "%s: %ums, 3000ms expected\n", PROGNAME,
+				timeout);
+		return 2;
+	}
+	/* slow commands get more time but never more than the ceiling */
+	for(i = 0; i < HAYESLATENCY_WINDOW; i++)
+		hayeslatency_record(&latency, 10000000);
+	if(hayeslatency_get_timeout(&latency, 30000, 3000, 30000) != 30000)
+		return 2;
+	hayeslatency_init(&latency);
+	for(i = 0; i < HAYESLATENCY_SAMPLES; i++)
+		hayeslatency_record(&latency, 2000000);
+	timeout = hayeslatency_get_timeout(&latency, 30000, 3000, 30000);
+	if(timeout < 8000 || timeout > 10000)
+	{
+		fprintf(stderr, "%s: %ums, 8000ms expected\n", PROGNAME,
+				timeout);
+		return 2;
+	}
+	/* back off after timeouts until answered again */
+	hayeslatency_record_timeout(&latency);
+	if(hayeslatency_get_timeout(&latency, 30000, 3000, 30000)
+			!= MIN(timeout * 2, 30000))
+		return 2;
+	hayeslatency_record(&latency, 2000000);
+	if(hayeslatency_get_timeout(&latency, 30000, 3000, 30000) != timeout)
+		return 2;
+	return 0;
+}
+
+
+/* public */
+/* functions */
+/* main */
+int main(void)
+{
+	return (_latency() == 0) ? 0 : 2;
+}
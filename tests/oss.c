@@ -27,20 +27,29 @@
 
 #include <unistd.h>
 #include <stdio.h>
+#include <time.h>
 #include "../src/plugins/oss.c"
+#include "benchmark.c"
+
+#ifndef PROGNAME
+# define PROGNAME "oss"
+#endif
 
 
 /* private */
 /* prototypes */
 static int _oss(char const * filename);
+static int _oss_benchmark(char const * path, unsigned long iterations);
 
 static int _usage(void);
 
 
 /* functions */
 /* plugins */
-static char const * _oss_config_get(Phone * phone, char const * section,
-		char const * variable);
+static PhoneConfigSection * _oss_config_section(Phone * phone,
+		char const * section);
+static char const * _oss_config_section_get(Phone * phone,
+		PhoneConfigSection * section, char const * variable);
 static int _oss_error(Phone * phone, char const * message, int ret);
 
 static int _oss(char const * filename)
@@ -50,19 +59,108 @@ static int _oss(char const * filename)
 	PhoneEvent event;
 
 	memset(&helper, 0, sizeof(helper));
-	helper.config_get = _oss_config_get;
+	helper.config_section = _oss_config_section;
+	helper.config_section_get = _oss_config_section_get;
 	helper.error = _oss_error;
 	if((oss = _oss_init(&helper)) == NULL)
 		return 2;
 	event.type = PHONE_EVENT_TYPE_AUDIO_PLAY;
 	event.audio_play.sample = filename;
 	_oss_event(oss, &event);
+#ifndef __APPLE__
+	/* wait for the playback to complete */
+	while(oss->play_sample != NULL)
+		g_main_context_iteration(NULL, TRUE);
+#endif
 	_oss_destroy(oss);
 	return 0;
 }
 
-static char const * _oss_config_get(Phone * phone, char const * section,
-		char const * variable)
+
+/* oss_benchmark */
+static int _oss_benchmark(char const * path, unsigned long iterations)
+{
+#ifndef __APPLE__
+	OSS * oss;
+	PhonePluginHelper helper;
+	OSSSample sample;
+	double t0;
+	double t1;
+	double t2;
+	size_t i;
+	size_t mapped = 0;
+	size_t pcm = 0;
+	unsigned long n;
+
+	memset(&helper, 0, sizeof(helper));
+	helper.config_section = _oss_config_section;
+	helper.config_section_get = _oss_config_section_get;
+	helper.error = _oss_error;
+	if((oss = _oss_init(&helper)) == NULL)
+		return 2;
+	/* startup */
+	_oss_sample_flush(oss);
+	t0 = _benchmark_time();
+	_oss_sample_preload(oss, path);
+	t1 = _benchmark_time();
+	if(oss->samples_cnt == 0)
+	{
+		fprintf(stderr, "%s: %s: %s\n", PROGNAME, path,
+				"No samples found");
+		_oss_destroy(oss);
+		return 2;
+	}
+	for(i = 0; i < oss->samples_cnt; i++)
+	{
+		mapped += oss->samples[i].map_size;
+		pcm += oss->samples[i].size;
+	}
+	printf("%s: %zu samples preloaded in %.3fms\n", PROGNAME,
+			oss->samples_cnt, (t1 - t0) * 1000.0);
+	printf("%s: %zu bytes mapped, %zu bytes of PCM data\n", PROGNAME,
+			mapped, pcm);
+	/* key presses, from the cache or reopening the sample every time */
+	t0 = _benchmark_time();
+	for(n = 0; n < iterations; n++)
+		if(_oss_sample_get(oss, oss->samples[n % oss->samples_cnt].name)
+				== NULL)
+			break;
+	t1 = _benchmark_time();
+	for(n = 0; n < iterations; n++)
+	{
+		if(_oss_sample_open(&sample, path,
+					oss->samples[n % oss->samples_cnt].name)
+				!= 0)
+			break;
+		_oss_sample_close(&sample);
+	}
+	t2 = _benchmark_time();
+	printf("%s: key press %.3fus (cached), %.3fus (reopened)\n",
+			PROGNAME, (t1 - t0) * 1000000.0 / iterations,
+			(t2 - t1) * 1000000.0 / iterations);
+	_oss_destroy(oss);
+	return (n == iterations) ? 0 : 2;
+#else
+	(void) path;
+	(void) iterations;
+
+	fprintf(stderr, "%s: %s\n", PROGNAME, "Not supported");
+	return 2;
+#endif
+}
+
+
+static PhoneConfigSection * _oss_config_section(Phone * phone,
+		char const * section)
+{
+	(void) phone;
+	(void) section;
+
+	return NULL;
+}
+
+static char const * _oss_config_section_get(Phone * phone,
+		PhoneConfigSection * section, char const * variable)
 {
 	(void) phone;
 	(void) section;
@@ -83,7 +181,10 @@ static int _oss_error(Phone * phone, char const * message, int ret)
 /* usage */
 static int _usage(void)
 {
-	fputs("Usage: oss sample...\n", stderr);
+	fputs("Usage: " PROGNAME " sample...\n"
+"       " PROGNAME " -b directory [-n iterations]\n"
+"  -b	Benchmark the sample cache with the samples in this directory\n"
+"  -n	Number of key presses to measure (default: 10000)\n", stderr);
 	return 1;
 }
 
@@ -95,13 +196,28 @@ int main(int argc, char * argv[])
 {
 	int ret = 0;
 	int o;
+	char const * benchmark = NULL;
+	unsigned long iterations = 10000;
+	char * p;
 
-	while((o = getopt(argc, argv, "")) != -1)
+	while((o = getopt(argc, argv, "b:n:")) != -1)
 		switch(o)
 		{
+			case 'b':
+				benchmark = optarg;
+				break;
+			case 'n':
+				iterations = strtoul(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0'
+						|| iterations == 0)
+					return _usage();
+				break;
 			default:
 				return _usage();
 		}
+	if(benchmark != NULL)
+		return (optind == argc) ? _oss_benchmark(benchmark,
+				iterations) : _usage();
 	if(optind == argc)
 		return _usage();
 	while(optind < argc)
@@ -31,11 +31,17 @@
 #include <time.h>
 #include "Phone/modem.h"
 #include "../src/modems/hayes/channel.c"
+#include "../src/modems/hayes/cmux.c"
 #include "../src/modems/hayes/command.c"
 #include "../src/modems/hayes/common.c"
+#include "../src/modems/hayes/concat.c"
+#include "../src/modems/hayes/gsm.c"
+#include "../src/modems/hayes/latency.c"
 #include "../src/modems/hayes/pdu.c"
 #include "../src/modems/hayes/quirks.c"
+#include "../src/modems/hayes/trace.c"
 #include "../src/modems/hayes.c"
+#include "benchmark.c"
 
 #ifndef PROGNAME
 # define PROGNAME "pdu"
@@ -50,6 +56,9 @@ static int _pdu_decode(char const * pdu, char const * number,
 		char const * datetime, ModemMessageEncoding encoding,
 		char const * message);
 static int _pdu_encode(void);
+static int _pdu_gsm(void);
+static int _pdu_concatenated(void);
+static int _pdu_septets(unsigned int iterations);
 
 
 /* functions */
@@ -65,6 +74,8 @@ static int _pdu(void)
 				MODEM_MESSAGE_ENCODING_UTF8,
 				"This is a PDU message") != 0) ? 1 : 0;
 	ret |= (_pdu_encode() != 0) ? 2 : 0;
+	ret |= (_pdu_concatenated() != 0) ? 4 : 0;
+	ret |= (_pdu_gsm() != 0) ? 8 : 0;
 	return ret;
 }
 
@@ -82,7 +93,7 @@ static int _pdu_decode(char const * pdu, char const * number,
 	struct tm t;
 	size_t len;
 
-	if((p = _cmgr_pdu_parse(pdu, &timestamp, buf, &e, &len)) == NULL)
+	if((p = _cmgr_pdu_parse(pdu, &timestamp, buf, &e, &len, NULL)) == NULL)
 	{
 		fputs(PROGNAME ": Unable to decode PDU\n", stderr);
 		return -1;
@@ -137,8 +148,420 @@ static int _pdu_encode(void)
 }
 
 
+/* pdu_gsm */
+static int _gsm_convert(char const * text, char const * gsm, size_t septets,
+		char const * expected);
+
+static int _pdu_gsm(void)
+{
+	int ret = 0;
+
+	/* the default alphabet, including '@' as 0x00 and the space */
+	ret |= _gsm_convert("@ $", "\x00\x20\x02", 3, NULL);
+	ret |= _gsm_convert("@\xc2\xa3$\xc2\xa5\xc3\xa8\xc3\xa9\xc3\xb9"
+			"\xc3\xac\xc3\xb2\xc3\x87\n\xc3\x98\xc3\xb8\r"
+			"\xc3\x85\xc3\xa5", "\x00\x01\x02\x03\x04\x05\x06\x07"
+			"\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f", 16, NULL);
+	ret |= _gsm_convert("\xc3\x84\xc3\x96\xc3\x91\xc3\x9c\xc2\xa7"
+			"\xc2\xbf\xc3\xa4\xc3\xb6\xc3\xb1\xc3\xbc\xc3\xa0",
+			"\x5b\x5c\x5d\x5e\x5f\x60\x7b\x7c\x7d\x7e\x7f", 11,
+			NULL);
+	/* the greek capital letters */
+	ret |= _gsm_convert("\xce\x94\xce\xa6\xce\x93\xce\x9b\xce\xa9"
+			"\xce\xa0\xce\xa8\xce\xa3\xce\x98\xce\x9e",
+			"\x10\x12\x13\x14\x15\x16\x17\x18\x19\x1a", 10,
+			NULL);
+	/* the escape set, euro sign included */
+	ret |= _gsm_convert("\f^{}\\[~]|\xe2\x82\xac",
+			"\x1b\x0a\x1b\x14\x1b\x28\x1b\x29\x1b\x2f\x1b\x3c"
+			"\x1b\x3d\x1b\x3e\x1b\x40\x1b\x65", 20, NULL);
+	/* anything else is replaced with '?' */
+	ret |= _gsm_convert("a\xce\xb1" "b\xe2\x98\xba" "c\x01", "a?b?c?",
+			6, "a?b?c?");
+	/* unassigned escapes fallback to the default alphabet */
+	if(_gsm_convert(NULL, "\x1b" "A", 2, "A") != 0)
+		ret = -1;
+	return ret;
+}
+
+static int _gsm_convert(char const * text, char const * gsm, size_t septets,
+		char const * expected)
+{
+	int ret = 0;
+	char * p;
+	size_t len;
+
+	if(expected == NULL)
+		expected = text;
+	if(text != NULL)
+	{
+		/* from UTF-8 */
+		if((p = hayesgsm_from_utf8(text, strlen(text), &len)) == NULL)
+			return -error_print(PROGNAME);
+		if(len != septets || memcmp(p, gsm, septets) != 0)
+		{
+			fprintf(stderr, "%s: %s: %s\n", PROGNAME, expected,
+					"Did not match the septets");
+			ret = -1;
+		}
+		free(p);
+	}
+	/* and back to UTF-8 */
+	if((p = hayesgsm_to_utf8(gsm, septets, &len)) == NULL)
+		return -error_print(PROGNAME);
+	if(len != strlen(expected) || strcmp(p, expected) != 0)
+	{
+		fprintf(stderr, "%s: %s: %s (\"%s\")\n", PROGNAME, expected,
+				"Did not match the text", p);
+		ret = -1;
+	}
+	free(p);
+	return ret;
+}
+
+
+/* pdu_concatenated */
+static int _concatenated_encode(size_t length, size_t escape, size_t count);
+static int _concatenated_header(void);
+static int _concatenated_reassemble(void);
+static HayesConcatMessage * _concatenated_part(char const * number,
+		unsigned int id, char const * content);
+
+static int _pdu_concatenated(void)
+{
+	int ret = 0;
+
+	/* single messages */
+	ret |= _concatenated_encode(HAYESPDU_SEPTETS_MAX, 0, 1);
+	/* exactly two full parts */
+	ret |= _concatenated_encode(HAYESPDU_SEPTETS_MAX + 1, 0, 2);
+	ret |= _concatenated_encode(153 * 2, 0, 2);
+	ret |= _concatenated_encode(153 * 2 + 1, 0, 3);
+	/* an escape sequence straddling the first two parts */
+	ret |= _concatenated_encode(153 * 2 + 1, 152, 3);
+	ret |= _concatenated_header();
+	ret |= _concatenated_reassemble();
+	return ret;
+}
+
+static int _concatenated_encode(size_t length, size_t escape, size_t count)
+{
+	int ret = 0;
+	/* "1100" "04" "812143" "00" "00" "AA" for the number "1234" */
+	const size_t offset = 18;
+	char * text;
+	char ** pdus;
+	size_t parts;
+	size_t i;
+	unsigned int udl;
+	unsigned char buf[HAYESPDU_OCTETS_MAX];
+	char septets[HAYESPDU_SEPTETS_MAX];
+	char * p;
+	size_t len;
+	String * s = string_new("");
+
+	if((text = malloc(length + 3)) == NULL)
+		return -1;
+	for(i = 0; i < length; i++)
+		text[i] = 'a' + (i % 26);
+	text[i] = '\0';
+	if(escape != 0)
+		/* replace a character by the euro sign */
+		memcpy(&text[escape], "\xe2\x82\xac", 3);
+	if((pdus = hayespdu_encode_concatenated("1234",
+					MODEM_MESSAGE_ENCODING_UTF8,
+					strlen(text), text, 0, 42, &parts))
+			== NULL)
+	{
+		free(text);
+		return -1;
+	}
+	if(parts != count)
+	{
+		fprintf(stderr, "%s: %zu: %zu: %s\n", PROGNAME, length, parts,
+				"Did not match the number of parts");
+		ret = -1;
+	}
+	/* decode the parts again */
+	for(i = 0; i < parts && ret == 0; i++)
+	{
+		if(sscanf(&pdus[i][offset], "%02X", &udl) != 1
+				|| udl > HAYESPDU_SEPTETS_MAX
+				|| hayespdu_hex_decode(buf, &pdus[i][offset + 2],
+					HAYESPDU_SEPTETS_SIZE(udl))
+				!= HAYESPDU_SEPTETS_SIZE(udl))
+		{
+			ret = -1;
+			break;
+		}
+		hayespdu_septets_unpack(septets, buf, udl);
+		len = (parts > 1) ? 7 : 0;
+		if(parts > 1 && (pdus[i][0] != '5' || buf[0] != 5
+					|| buf[3] != 42 || buf[4] != parts
+					|| buf[5] != i + 1))
+		{
+			fprintf(stderr, "%s: %zu: %s\n", PROGNAME, i + 1,
+					"Did not match the header");
+			ret = -1;
+		}
+		if((p = hayesgsm_to_utf8(&septets[len], udl - len, &len))
+				== NULL)
+			ret = -1;
+		else if(string_append(&s, p) != 0)
+			ret = -1;
+		free(p);
+	}
+	if(ret == 0 && strcmp(s, text) != 0)
+	{
+		fprintf(stderr, "%s: %zu: %s\n", PROGNAME, length,
+				"Did not match the concatenated message");
+		ret = -1;
+	}
+	string_delete(s);
+	for(i = 0; i < parts; i++)
+		free(pdus[i]);
+	free(pdus);
+	free(text);
+	return ret;
+}
+
+static int _concatenated_header(void)
+{
+	/* an unrelated element, then a 16-bit reference */
+	unsigned char const header16[] = { 0x24, 0x01, 0x00,
+		0x08, 0x04, 0x12, 0x34, 0x03, 0x02 };
+	unsigned char const header8[] = { 0x00, 0x03, 0x42, 0x02, 0x01 };
+	unsigned char const invalid[] = { 0x00, 0x03, 0x42, 0x02, 0x03 };
+	unsigned int reference;
+	unsigned int sequence;
+	unsigned int count;
+
+	if(hayespdu_header_concatenated(header16, sizeof(header16), &reference,
+				&sequence, &count) != 0 || reference != 0x1234
+			|| sequence != 2 || count != 3)
+		return -1;
+	if(hayespdu_header_concatenated(header8, sizeof(header8), &reference,
+				&sequence, &count) != 0 || reference != 0x42
+			|| sequence != 1 || count != 2)
+		return -1;
+	if(hayespdu_header_concatenated(invalid, sizeof(invalid), &reference,
+				&sequence, &count) == 0)
+		return -1;
+	return 0;
+}
+
+static int _concatenated_reassemble(void)
+{
+	int ret = -1;
+	HayesConcat * concat;
+	HayesConcatMessage * message = NULL;
+	unsigned int i;
+
+	if((concat = hayesconcat_new()) == NULL)
+		return -1;
+	/* out of order, with a duplicate and another message in between */
+	if(hayesconcat_add(concat, _concatenated_part("123", 3, "c"), 7, 3, 3,
+				1000) == NULL
+			&& hayesconcat_add(concat, _concatenated_part("456", 9,
+					"x"), 7, 1, 2, 1000) == NULL
+			&& hayesconcat_add(concat, _concatenated_part("123", 1,
+					"a"), 7, 1, 3, 1001) == NULL
+			&& hayesconcat_add(concat, _concatenated_part("123", 4,
+					"c"), 7, 3, 3, 1002) == NULL
+			&& (message = hayesconcat_add(concat,
+					_concatenated_part("123", 2, "b"), 7,
+					2, 3, 1003)) != NULL)
+	{
+		/* every part is known, including the duplicate */
+		if(message->id == 1 && message->length == 3
+				&& strcmp(message->content, "abc") == 0
+				&& message->ids_cnt == 4
+				&& message->ids[0] == 3 && message->ids[1] == 1
+				&& message->ids[2] == 4 && message->ids[3] == 2)
+			ret = 0;
+		hayesconcatmessage_delete(message);
+		message = NULL;
+	}
+	/* missing parts are given up on eventually */
+	if(ret == 0 && hayesconcat_get_expiry(concat)
+			!= 1000 + HAYESCONCAT_TIMEOUT)
+		ret = -1;
+	if(ret == 0 && hayesconcat_expire(concat, 1000
+				+ HAYESCONCAT_TIMEOUT - 1) != NULL)
+		ret = -1;
+	if(ret == 0 && ((message = hayesconcat_expire(concat, 1000
+						+ HAYESCONCAT_TIMEOUT)) == NULL
+				|| strcmp(message->content, "x") != 0))
+		ret = -1;
+	hayesconcatmessage_delete(message);
+	message = NULL;
+	if(ret == 0 && hayesconcat_get_expiry(concat) != 0)
+		ret = -1;
+	/* the oldest message is given up on first when full */
+	for(i = 0; ret == 0 && i <= HAYESCONCAT_CAPACITY; i++)
+		if(hayesconcat_add(concat, _concatenated_part("123", i, "y"),
+					i, 1, 2, 2000 + i) != NULL)
+			ret = -1;
+	if(ret == 0 && hayesconcat_get_expiry(concat) != 1)
+		ret = -1;
+	if(ret == 0 && ((message = hayesconcat_expire(concat, 2000
+						+ HAYESCONCAT_CAPACITY))
+				== NULL || message->id != 0))
+		ret = -1;
+	hayesconcatmessage_delete(message);
+	if(ret == 0 && hayesconcat_expire(concat, 2000 + HAYESCONCAT_CAPACITY)
+			!= NULL)
+		ret = -1;
+	hayesconcat_delete(concat);
+	if(ret != 0)
+		fputs(PROGNAME ": Could not reassemble messages\n", stderr);
+	return ret;
+}
+
+static HayesConcatMessage * _concatenated_part(char const * number,
+		unsigned int id, char const * content)
+{
+	HayesConcatMessage * message;
+
+	if((message = malloc(sizeof(*message))) == NULL)
+		return NULL;
+	memset(message, 0, sizeof(*message));
+	message->id = id;
+	snprintf(message->number, sizeof(message->number), "%s", number);
+	message->content = strdup(content);
+	message->length = strlen(content);
+	return message;
+}
+
+
+/* pdu_septets */
+static void _septets_reference(unsigned char * buf, char const * septets,
+		size_t count);
+
+static int _pdu_septets(unsigned int iterations)
+{
+	int ret = 0;
+	/* 64 concatenated segments of 153 septets each */
+	const size_t count = 64 * 153;
+	const size_t size = HAYESPDU_SEPTETS_SIZE(count);
+	char * septets;
+	char * unpacked;
+	unsigned char * buf;
+	unsigned char * ref;
+	char * hex;
+	size_t i;
+	size_t len;
+	unsigned int j;
+	double t;
+	double pack;
+	double unpack;
+
+	septets = malloc(count);
+	unpacked = malloc(count);
+	buf = malloc(size);
+	ref = malloc(size);
+	hex = malloc((size * 2) + 1);
+	if(septets == NULL || unpacked == NULL || buf == NULL || ref == NULL
+			|| hex == NULL)
+	{
+		free(septets);
+		free(unpacked);
+		free(buf);
+		free(ref);
+		free(hex);
+		return -1;
+	}
+	for(i = 0; i < count; i++)
+		septets[i] = (i * 37 + 11) & 0x7f;
+	/* check every partial word against the reference implementation */
+	for(len = 0; len <= 64 && ret == 0; len++)
+	{
+		memset(buf, 0, size);
+		memset(ref, 0, size);
+		_septets_reference(ref, septets, len);
+		if(hayespdu_septets_pack(buf, septets, len)
+				!= HAYESPDU_SEPTETS_SIZE(len)
+				|| memcmp(buf, ref, size) != 0)
+		{
+			fprintf(stderr, "%s: %zu: %s\n", PROGNAME, len,
+					"Did not match the packed septets");
+			ret = -1;
+		}
+		hayespdu_hex_encode(hex, buf, HAYESPDU_SEPTETS_SIZE(len));
+		if(hayespdu_hex_decode(ref, hex, HAYESPDU_SEPTETS_SIZE(len))
+				!= HAYESPDU_SEPTETS_SIZE(len)
+				|| memcmp(buf, ref, HAYESPDU_SEPTETS_SIZE(len))
+				!= 0)
+		{
+			fprintf(stderr, "%s: %zu: %s\n", PROGNAME, len,
+					"Did not match the hexadecimal");
+			ret = -1;
+		}
+		hayespdu_septets_unpack(unpacked, buf, len);
+		if(memcmp(unpacked, septets, len) != 0)
+		{
+			fprintf(stderr, "%s: %zu: %s\n", PROGNAME, len,
+					"Did not match the unpacked septets");
+			ret = -1;
+		}
+	}
+	/* compare the throughput on long payloads */
+	t = _benchmark_time();
+	for(j = 0; j < iterations; j++)
+	{
+		hayespdu_septets_pack(buf, septets, count);
+		hayespdu_hex_encode(hex, buf, size);
+	}
+	pack = _benchmark_time() - t;
+	t = _benchmark_time();
+	for(j = 0; j < iterations; j++)
+	{
+		hayespdu_hex_decode(buf, hex, size);
+		hayespdu_septets_unpack(unpacked, buf, count);
+	}
+	unpack = _benchmark_time() - t;
+	if(memcmp(unpacked, septets, count) != 0)
+	{
+		fputs(PROGNAME ": Did not match the payload\n", stderr);
+		ret = -1;
+	}
+	t = _benchmark_time();
+	for(j = 0; j < iterations; j++)
+		_septets_reference(ref, septets, count);
+	t = _benchmark_time() - t;
+	printf("%s: septets: %zu per payload, %.1f MB/s (packing),"
+			" %.1f MB/s (unpacking), %.1f MB/s (reference)\n",
+			PROGNAME, count, count * (double)iterations / pack / 1e6,
+			count * (double)iterations / unpack / 1e6,
+			count * (double)iterations / t / 1e6);
+	free(septets);
+	free(unpacked);
+	free(buf);
+	free(ref);
+	free(hex);
+	return ret;
+}
+
+static void _septets_reference(unsigned char * buf, char const * septets,
+		size_t count)
+{
+	size_t i;
+	size_t bit;
+
+	/* one bit at a time */
+	memset(buf, 0, HAYESPDU_SEPTETS_SIZE(count));
+	for(i = 0; i < count * 7; i++)
+	{
+		bit = (septets[i / 7] >> (i % 7)) & 0x1;
+		buf[i / 8] |= bit << (i % 8);
+	}
+}
+
+
 /* main */
 int main(void)
 {
+	if(_pdu_septets(1000) != 0)
+		return 2;
 	return (_pdu() << 1);
 }
@@ -0,0 +1,287 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+
+
+#ifdef __linux__
+# define _GNU_SOURCE /* for splice() */
+#endif
+#include "../src/modems/hayes/channel.c"
+#include "../src/modems/hayes/cmux.c"
+#include "../src/modems/hayes/command.c"
+#include "../src/modems/hayes/common.c"
+#include "../src/modems/hayes/concat.c"
+#include "../src/modems/hayes/gsm.c"
+#include "../src/modems/hayes/latency.c"
+#include "../src/modems/hayes/pdu.c"
+#include "../src/modems/hayes/quirks.c"
+#include "../src/modems/hayes/trace.c"
+#include "../src/modems/hayes.c"
+#include "../config.h"
+#include <sys/resource.h>
+
+#ifndef PROGNAME
+# define PROGNAME "ppp"
+#endif
+
+
+/* private */
+/* types */
+struct _Modem
+{
+	Config * config;
+};
+
+typedef struct _PPP
+{
+	Hayes * hayes;
+	char const * mode;
+	size_t total;
+	size_t in;
+	size_t out;
+	int sink;
+	char buf[HAYESCHANNEL_PUMP_SIZE];
+} PPP;
+
+
+/* prototypes */
+static int _ppp(size_t total);
+static int _ppp_run(Hayes * hayes, char const * mode, int splice,
+		size_t total);
+
+static char const * _ppp_helper_config_get(Modem * modem,
+		char const * variable);
+static int _ppp_helper_error(Modem * modem, char const * message, int ret);
+static void _ppp_helper_event(Modem * modem, ModemEvent * event);
+
+static int _usage(void);
+
+
+/* variables */
+static GMainLoop * _loop;
+
+
+/* functions */
+/* ppp */
+static int _ppp(size_t total)
+{
+	int ret = 0;
+	Modem modem;
+	ModemPluginHelper helper;
+	Hayes * hayes;
+
+	if((modem.config = config_new()) == NULL)
+		return -error_print(PROGNAME);
+	config_set(modem.config, NULL, "device", "/dev/null");
+	memset(&helper, 0, sizeof(helper));
+	helper.modem = &modem;
+	helper.config_get = _ppp_helper_config_get;
+	helper.error = _ppp_helper_error;
+	helper.event = _ppp_helper_event;
+	if((hayes = plugin.init(&helper)) == NULL)
+	{
+		config_delete(modem.config);
+		return -1;
+	}
+	_loop = g_main_loop_new(NULL, FALSE);
+#ifdef SPLICE_F_MOVE
+	ret |= _ppp_run(hayes, "splice", 1, total);
+#endif
+	ret |= _ppp_run(hayes, "copy", 0, total);
+	g_main_loop_unref(_loop);
+	plugin.destroy(hayes);
+	config_delete(modem.config);
+	return ret;
+}
+
+
+/* ppp_run */
+static gboolean _run_on_can_write(GIOChannel * source, GIOCondition condition,
+		gpointer data);
+static gboolean _run_on_can_read(GIOChannel * source, GIOCondition condition,
+		gpointer data);
+static double _run_cpu(void);
+
+static int _ppp_run(Hayes * hayes, char const * mode, int splice,
+		size_t total)
+{
+	HayesChannel * channel = &hayes->channel;
+	PPP ppp;
+	int modem[2];
+	int pppd[2];
+	int idle[2];
+	GIOChannel * source;
+	guint wr;
+	guint rd;
+	gint64 t;
+	double cpu;
+
+	/* the modem, pppd's input and (idle) output are all pipes */
+	if(pipe(modem) != 0 || pipe(pppd) != 0 || pipe(idle) != 0)
+		return -error_set_print(PROGNAME, 1, "%s", strerror(errno));
+	memset(&ppp, 0, sizeof(ppp));
+	ppp.hayes = hayes;
+	ppp.mode = mode;
+	ppp.total = total;
+	ppp.sink = pppd[0];
+	memset(ppp.buf, 'P', sizeof(ppp.buf));
+	fcntl(modem[1], F_SETFL, O_NONBLOCK);
+	fcntl(pppd[0], F_SETFL, O_NONBLOCK);
+	channel->channel = g_io_channel_unix_new(modem[0]);
+	channel->rd_ppp_channel = g_io_channel_unix_new(idle[0]);
+	channel->wr_ppp_channel = g_io_channel_unix_new(pppd[1]);
+	if(_hayes_pump_start(hayes, channel) != 0)
+		return -1;
+	channel->ppp_in.splice = splice;
+	channel->ppp_out.splice = splice;
+	source = g_io_channel_unix_new(modem[1]);
+	wr = g_io_add_watch(source, G_IO_OUT, _run_on_can_write, &ppp);
+	g_io_channel_unref(source);
+	source = g_io_channel_unix_new(pppd[0]);
+	rd = g_io_add_watch(source, G_IO_IN, _run_on_can_read, &ppp);
+	g_io_channel_unref(source);
+	t = g_get_monotonic_time();
+	cpu = _run_cpu();
+	g_main_loop_run(_loop);
+	t = g_get_monotonic_time() - t;
+	cpu = _run_cpu() - cpu;
+	printf("%s: %s: %lu bytes in %.3fs (%.1f MB/s, %.3fs CPU)\n",
+			PROGNAME, mode, (unsigned long)ppp.out,
+			t / 1000000.0, (t > 0) ? ppp.out / (double)t : 0.0,
+			cpu);
+	g_source_remove(wr);
+	g_source_remove(rd);
+	_hayes_pump_stop(channel);
+	hayeschannel_stop(channel);
+	close(modem[1]);
+	close(pppd[0]);
+	close(idle[1]);
+	return (ppp.out == total) ? 0 : -1;
+}
+
+static gboolean _run_on_can_write(GIOChannel * source, GIOCondition condition,
+		gpointer data)
+{
+	PPP * ppp = data;
+	size_t size = min(sizeof(ppp->buf), ppp->total - ppp->in);
+	ssize_t cnt;
+	(void) condition;
+
+	if(size == 0)
+		return TRUE;
+	if((cnt = write(g_io_channel_unix_get_fd(source), ppp->buf, size)) > 0)
+		ppp->in += cnt;
+	return TRUE;
+}
+
+static gboolean _run_on_can_read(GIOChannel * source, GIOCondition condition,
+		gpointer data)
+{
+	PPP * ppp = data;
+	char buf[HAYESCHANNEL_PUMP_SIZE];
+	ssize_t cnt;
+	(void) condition;
+
+	while((cnt = read(g_io_channel_unix_get_fd(source), buf, sizeof(buf)))
+			> 0)
+		ppp->out += cnt;
+	if(ppp->out >= ppp->total)
+		g_main_loop_quit(_loop);
+	return TRUE;
+}
+
+static double _run_cpu(void)
+{
+	struct rusage ru;
+
+	if(getrusage(RUSAGE_SELF, &ru) != 0)
+		return 0.0;
+	return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1000000.0
+		+ ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1000000.0;
+}
+
+
+/* helpers */
+/* ppp_helper_config_get */
+static char const * _ppp_helper_config_get(Modem * modem,
+		char const * variable)
+{
+	return config_get(modem->config, NULL, variable);
+}
+
+
+/* ppp_helper_error */
+static int _ppp_helper_error(Modem * modem, char const * message, int ret)
+{
+	(void) modem;
+
+	fprintf(stderr, "%s: %s\n", PROGNAME, message);
+	return ret;
+}
+
+
+/* ppp_helper_event */
+static void _ppp_helper_event(Modem * modem, ModemEvent * event)
+{
+	(void) modem;
+	(void) event;
+}
+
+
+/* usage */
+static int _usage(void)
+{
+	fputs("Usage: " PROGNAME " [-s size]\n"
+"  -s	Amount of data to relay (default: 64MB)\n", stderr);
+	return 1;
+}
+
+
+/* public */
+/* functions */
+/* main */
+int main(int argc, char * argv[])
+{
+	int o;
+	size_t total = 64 * 1024 * 1024;
+	char * p;
+
+	while((o = getopt(argc, argv, "s:")) != -1)
+		switch(o)
+		{
+			case 's':
+				total = strtoul(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0')
+					return _usage();
+				break;
+			default:
+				return _usage();
+		}
+	if(optind != argc)
+		return _usage();
+	return (_ppp(total) == 0) ? 0 : 2;
+}
@@ -0,0 +1,1122 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+
+
+#ifdef __linux__
+# define _GNU_SOURCE /* for posix_openpt() */
+#endif
+#include "../src/modems/hayes/channel.c"
+#include "../src/modems/hayes/cmux.c"
+#include "../src/modems/hayes/command.c"
+#include "../src/modems/hayes/common.c"
+#include "../src/modems/hayes/concat.c"
+#include "../src/modems/hayes/gsm.c"
+#include "../src/modems/hayes/latency.c"
+#include "../src/modems/hayes/pdu.c"
+#include "../src/modems/hayes/quirks.c"
+#include "../src/modems/hayes/trace.c"
+#include "../src/modems/hayes.c"
+#include "../config.h"
+
+#ifndef PROGNAME
+# define PROGNAME "replay"
+#endif
+
+
+/* private */
+/* types */
+struct _Modem
+{
+	Config * config;
+};
+
+typedef struct _ReplayEntry
+{
+	char * command;
+	char * answer;
+} ReplayEntry;
+
+typedef struct _Replay
+{
+	Hayes * hayes;
+
+	/* transcript */
+	ReplayEntry * entries;
+	size_t entries_cnt;
+
+	/* fake DCE */
+	int fd;
+	int slave;
+	GIOChannel * channel;
+	guint source;
+	char buf[4096];
+	size_t buf_cnt;
+	int echo;
+	size_t cursor;
+	char * out;
+	size_t out_cnt;
+	guint out_source;
+	guint out_hold;
+	unsigned int delay;
+	int batch_error;
+	size_t dce_lines;
+	size_t dce_commands;
+
+	/* workload */
+	guint timeout;
+	unsigned int iterations;
+	size_t commands;
+	gint64 queued;
+	gint64 * latencies;
+	size_t latencies_cnt;
+	size_t lines;
+	size_t allocations;
+	gint64 start;
+	int ret;
+
+	/* fake SIM */
+	unsigned int sim;
+	size_t sim_commands;
+	size_t sim_reads;
+	size_t sim_messages;
+	gint64 sim_done;
+
+	/* fake phonebook */
+	unsigned int phonebook;
+	size_t phonebook_reads;
+	size_t phonebook_contacts;
+	gint64 phonebook_longest;
+	gint64 phonebook_done;
+
+	/* startup */
+	int startup;
+
+	/* logging */
+	char const * logfile;
+} Replay;
+
+
+/* constants */
+/* transcript used by default, as decoded from the "logfile" option with
+ * "trace -t" */
+static char const _replay_transcript[] =
+	"\nPHONE: ATZE0V1\r\n"
+	"\nMODEM: \r\nOK\r\n"
+	"\nPHONE: AT+CPIN?\r\n"
+	"\nMODEM: \r\n+CPIN: READY\r\n\r\nOK\r\n"
+	"\nPHONE: AT+CGMI\r\n"
+	"\nMODEM: \r\nDeforaOS\r\n\r\nOK\r\n"
+	"\nPHONE: AT+CGMM\r\n"
+	"\nMODEM: \r\nPhone\r\n\r\nOK\r\n"
+	"\nPHONE: AT+CSQ\r\n"
+	"\nMODEM: \r\n+CSQ: 20,99\r\n\r\nOK\r\n"
+	"\nPHONE: AT+CREG?\r\n"
+	"\nMODEM: \r\n+CREG: 2,1,\"0001\",\"0002\"\r\n\r\nOK\r\n"
+	"\nPHONE: AT+COPS?\r\n"
+	"\nMODEM: \r\n+COPS: 0,0,\"DeforaOS\"\r\n\r\nOK\r\n"
+	"\nPHONE: AT+CBC\r\n"
+	"\nMODEM: \r\n+CBC: 0,80\r\n\r\nOK\r\n"
+	"\nPHONE: AT+CPBR=1,10\r\n"
+	"\nMODEM: \r\n+CPBR: 1,\"0123456789\",129,\"Alice\"\r\n"
+	"+CPBR: 2,\"+33123456789\",145,\"Bob\"\r\n"
+	"+CPBR: 3,\"112\",129,\"Emergency\"\r\n\r\nOK\r\n"
+	"\nPHONE: AT+CMGL=4\r\n"
+	"\nMODEM: \r\n+CMGL: 1,1,,24\r\n"
+	"07911326040000F0040B911346610089F60000208062917314080CC8F71D"
+	"14969741F977FD07\r\n\r\nOK\r\n";
+
+/* transcript used by default at startup, until registered, as a modem known
+ * to accept several commands per line */
+static char const _replay_startup[] =
+	"\nPHONE: ATZE0V1\r\n"
+	"\nMODEM: \r\nOK\r\n"
+	"\nPHONE: AT+CGMI\r\n"
+	"\nMODEM: \r\nSierra Wireless Inc.\r\n\r\nOK\r\n"
+	"\nPHONE: AT+CGMM\r\n"
+	"\nMODEM: \r\nSierra Wireless EM7345 4G LTE\r\n\r\nOK\r\n"
+	"\nPHONE: AT+CFUN?\r\n"
+	"\nMODEM: \r\n+CFUN: 1\r\n\r\nOK\r\n"
+	"\nPHONE: AT+CPIN?\r\n"
+	"\nMODEM: \r\n+CPIN: READY\r\n\r\nOK\r\n"
+	"\nPHONE: AT+CREG?\r\n"
+	"\nMODEM: \r\n+CREG: 2,1,\"0001\",\"0002\"\r\n\r\nOK\r\n"
+	"\nPHONE: AT+COPS?\r\n"
+	"\nMODEM: \r\n+COPS: 0,0,\"DeforaOS\"\r\n\r\nOK\r\n";
+
+/* time taken by the fake SIM to read a phonebook entry, in milliseconds */
+#define REPLAY_PHONEBOOK_DELAY	2
+
+/* message stored on the fake SIM, in PDU mode */
+static char const _replay_sim_pdu[] = "07911326040000F0040B911346610089F6"
+	"0000208062917314080CC8F71D14969741F977FD07";
+
+
+/* variables */
+static GMainLoop * _loop;
+static Replay * _replay;
+
+
+/* prototypes */
+static int _replay_run(Replay * replay, char const * transcript);
+static int _replay_parse(Replay * replay, char const * transcript);
+static char * _replay_read(char const * filename);
+
+static char const * _replay_helper_config_get(Modem * modem,
+		char const * variable);
+static int _replay_helper_config_set(Modem * modem, char const * variable,
+		char const * value);
+static int _replay_helper_error(Modem * modem, char const * message, int ret);
+static void _replay_helper_event(Modem * modem, ModemEvent * event);
+
+static int _usage(void);
+
+
+/* functions */
+/* allocations */
+#ifdef __GLIBC__
+extern void * __libc_calloc(size_t nmemb, size_t size);
+extern void * __libc_malloc(size_t size);
+extern void * __libc_realloc(void * ptr, size_t size);
+
+static size_t _replay_allocations = 0;
+
+void * calloc(size_t nmemb, size_t size)
+{
+	_replay_allocations++;
+	return __libc_calloc(nmemb, size);
+}
+
+void * malloc(size_t size)
+{
+	_replay_allocations++;
+	return __libc_malloc(size);
+}
+
+void * realloc(void * ptr, size_t size)
+{
+	_replay_allocations++;
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+
+/* replay_run */
+static gboolean _run_on_dce(GIOChannel * source, GIOCondition condition,
+		gpointer data);
+static void _run_dce_line(Replay * replay, char const * line);
+static int _run_dce_command(Replay * replay, char const * line, int last);
+static size_t _run_dce_length(char const * command);
+static int _run_dce_sim(Replay * replay, char const * line);
+static int _run_dce_sim_phonebook(Replay * replay, char const * line);
+static void _run_dce_flush(Replay * replay);
+static void _run_dce_write(Replay * replay, char const * buf, size_t size);
+static gboolean _run_on_dce_hold(gpointer data);
+static gboolean _run_on_dce_out(GIOChannel * source, GIOCondition condition,
+		gpointer data);
+static int _run_idle(Replay * replay);
+static gboolean _run_on_ready(gpointer data);
+static gboolean _run_on_sim(gpointer data);
+static int _run_queue(Replay * replay);
+static HayesCommandStatus _run_on_command(HayesCommand * command,
+		HayesCommandStatus status, HayesChannel * channel);
+static void _run_report(Replay * replay);
+static int _run_report_compare(void const * a, void const * b);
+static void _run_report_sim(Replay * replay);
+static void _run_report_startup(Replay * replay);
+static gboolean _run_on_startup(gpointer data);
+
+static int _replay_run(Replay * replay, char const * transcript)
+{
+	Modem modem;
+	ModemPluginHelper helper;
+	char const * p;
+
+	if(_replay_parse(replay, transcript) != 0)
+		return -1;
+	if(replay->entries_cnt == 0)
+		return -error_set_print(PROGNAME, 1, "%s",
+				"No commands in the transcript");
+	if((replay->latencies = malloc(sizeof(*replay->latencies)
+					* replay->entries_cnt
+					* replay->iterations)) == NULL)
+		return -error_set_print(PROGNAME, 1, "%s", strerror(errno));
+	/* the fake DCE sits on the master side of a pseudo-terminal */
+	if((replay->fd = posix_openpt(O_RDWR | O_NOCTTY)) < 0
+			|| grantpt(replay->fd) != 0
+			|| unlockpt(replay->fd) != 0
+			|| (p = ptsname(replay->fd)) == NULL
+			|| (replay->slave = open(p, O_RDWR | O_NOCTTY)) < 0)
+		return -error_set_print(PROGNAME, 1, "%s", strerror(errno));
+	fcntl(replay->fd, F_SETFL, fcntl(replay->fd, F_GETFL) | O_NONBLOCK);
+	replay->echo = 1;
+	replay->channel = g_io_channel_unix_new(replay->fd);
+	g_io_channel_set_encoding(replay->channel, NULL, NULL);
+	g_io_channel_set_buffered(replay->channel, FALSE);
+	replay->source = g_io_add_watch(replay->channel, G_IO_IN, _run_on_dce,
+			replay);
+	/* the plug-in opens the slave side */
+	if((modem.config = config_new()) == NULL)
+		return -error_print(PROGNAME);
+	config_set(modem.config, NULL, "device", p);
+	config_set(modem.config, NULL, "hwflow", "0");
+	if(replay->logfile != NULL)
+		config_set(modem.config, NULL, "logfile", replay->logfile);
+	memset(&helper, 0, sizeof(helper));
+	helper.modem = &modem;
+	helper.config_get = _replay_helper_config_get;
+	helper.config_set = _replay_helper_config_set;
+	helper.error = _replay_helper_error;
+	helper.event = _replay_helper_event;
+	if((replay->hayes = plugin.init(&helper)) == NULL)
+	{
+		config_delete(modem.config);
+		return -1;
+	}
+	_replay = replay;
+	replay->start = g_get_monotonic_time();
+	plugin.start(replay->hayes, 0);
+	if(replay->startup)
+		/* give up if not registered in time */
+		replay->timeout = g_timeout_add(10000, _run_on_startup, replay);
+	else
+		replay->timeout = g_timeout_add(100, _run_on_ready, replay);
+	g_main_loop_run(_loop);
+	if(replay->timeout != 0)
+		g_source_remove(replay->timeout);
+	plugin.stop(replay->hayes);
+	plugin.destroy(replay->hayes);
+	config_delete(modem.config);
+	g_source_remove(replay->source);
+	if(replay->out_source != 0)
+		g_source_remove(replay->out_source);
+	if(replay->out_hold != 0)
+		g_source_remove(replay->out_hold);
+	free(replay->out);
+	g_io_channel_shutdown(replay->channel, TRUE, NULL);
+	g_io_channel_unref(replay->channel);
+	close(replay->slave);
+	return replay->ret;
+}
+
+static gboolean _run_on_dce(GIOChannel * source, GIOCondition condition,
+		gpointer data)
+{
+	Replay * replay = data;
+	ssize_t cnt;
+	char * p;
+	char * q;
+	(void) condition;
+
+	if((cnt = read(g_io_channel_unix_get_fd(source),
+					&replay->buf[replay->buf_cnt],
+					sizeof(replay->buf) - replay->buf_cnt
+					- 1)) <= 0)
+		return (cnt < 0 && errno == EAGAIN) ? TRUE : FALSE;
+	replay->buf_cnt += cnt;
+	replay->buf[replay->buf_cnt] = '\0';
+	/* answer every complete command */
+	for(p = replay->buf; (q = strchr(p, '\r')) != NULL; p = q + 1)
+	{
+		*q = '\0';
+		if(*p == '\n')
+			p++;
+		if(*p != '\0')
+			_run_dce_line(replay, p);
+	}
+	if(*p == '\n')
+		p++;
+	replay->buf_cnt = strlen(p);
+	memmove(replay->buf, p, replay->buf_cnt);
+	if(replay->buf_cnt == sizeof(replay->buf) - 1)
+		replay->buf_cnt = 0; /* discard overlong commands */
+	return TRUE;
+}
+
+static void _run_dce_line(Replay * replay, char const * line)
+{
+	static char const ok[] = "\r\nOK\r\n";
+	static char const error[] = "\r\nERROR\r\n";
+	char buf[sizeof(replay->buf) + 2];
+	char const * p;
+	size_t i;
+	size_t len;
+
+	/* echo the command back until told otherwise */
+	if(replay->echo)
+	{
+		_run_dce_write(replay, line, strlen(line));
+		_run_dce_write(replay, "\r", 1);
+	}
+	if(strncmp(line, "AT", 2) == 0 && line[2] != '+')
+		for(p = &line[2]; *p != '\0'; p++)
+			if(p[0] == 'E' && (p[1] == '0' || p[1] == '1'))
+				replay->echo = p[1] - '0';
+	replay->dce_lines++;
+	/* every command line takes a while to be answered */
+	if(replay->delay > 0 && replay->out_hold == 0)
+		replay->out_hold = g_timeout_add(replay->delay,
+				_run_on_dce_hold, replay);
+	/* answer whole lines as recorded first */
+	if(_run_dce_command(replay, line, -1) >= 0)
+		return;
+	/* split the command line as per V.250 */
+	p = (strncmp(line, "AT", 2) == 0) ? &line[2] : line;
+	for(i = 0; *p != '\0' && (len = _run_dce_length(p)) > 0; p += len, i++);
+	if(*p != '\0' || i < 2)
+	{
+		_run_dce_command(replay, line, 1);
+		return;
+	}
+	for(p = &line[2]; *p != '\0'; p += len)
+	{
+		len = _run_dce_length(p);
+		if(replay->batch_error && *p == '+' && p != &line[2])
+		{
+			/* the commands before were executed already */
+			replay->lines += 2;
+			_run_dce_write(replay, error, sizeof(error) - 1);
+			return;
+		}
+		snprintf(buf, sizeof(buf), "AT%.*s", (int)((p[len - 1] == ';')
+					? len - 1 : len), p);
+		if(_run_dce_command(replay, buf, 0) != 0)
+			return;
+	}
+	replay->lines += 2;
+	_run_dce_write(replay, ok, sizeof(ok) - 1);
+}
+
+static int _run_dce_command(Replay * replay, char const * line, int last)
+{
+	static char const ok[] = "\r\nOK\r\n";
+	char const * p;
+	size_t i;
+	size_t j;
+	char const * answer = NULL;
+	size_t len;
+
+	replay->dce_commands++;
+	if(last < 0 && (replay->sim > 0 || replay->phonebook > 0)
+			&& _run_dce_sim(replay, line) == 0)
+		return 0;
+	/* answer as recorded, in order */
+	for(i = 0; i < replay->entries_cnt; i++)
+	{
+		j = (replay->cursor + i) % replay->entries_cnt;
+		if(strcmp(replay->entries[j].command, line) != 0)
+			continue;
+		answer = replay->entries[j].answer;
+		replay->cursor = (j + 1) % replay->entries_cnt;
+		break;
+	}
+	if(answer == NULL)
+	{
+		/* the whole line may still be split in commands */
+		if(last < 0)
+		{
+			replay->dce_commands--;
+			return -1;
+		}
+		answer = ok;
+	}
+	len = strlen(answer);
+	if(last == 0)
+	{
+		/* only the last command of the line is terminated */
+		if(len < sizeof(ok) - 1 || strcmp(&answer[len - sizeof(ok)
+					+ 1], ok) != 0)
+			last = 1;
+		else
+			len -= sizeof(ok) - 1;
+	}
+	for(p = answer; (p = memchr(p, '\n', &answer[len] - p)) != NULL; p++)
+		replay->lines++;
+	if(len > 0)
+		_run_dce_write(replay, answer, len);
+	return (last == 0) ? 0 : 1;
+}
+
+static size_t _run_dce_length(char const * command)
+{
+	size_t len = 0;
+
+	/* extended commands last until the next semicolon */
+	if(command[0] == '+')
+		return strcspn(command, ";") + ((strchr(command, ';') != NULL)
+				? 1 : 0);
+	/* basic commands are a letter and a number */
+	if(command[len] == '&')
+		len++;
+	if(!isalpha((unsigned char)command[len]))
+		return 0;
+	for(len++; isdigit((unsigned char)command[len]); len++);
+	return len;
+}
+
+static int _run_dce_sim(Replay * replay, char const * line)
+{
+	static char const ok[] = "\r\n\r\nOK\r\n";
+	const size_t length = (sizeof(_replay_sim_pdu) - 1) / 2 - 8;
+	char buf[sizeof(_replay_sim_pdu) + 32];
+	unsigned int u;
+	unsigned int i;
+
+	replay->sim_commands++;
+	if(strncmp(line, "AT+CPBR=", 8) == 0)
+		return _run_dce_sim_phonebook(replay, &line[8]);
+	/* the message i is stored with the status (i % 4) */
+	if(sscanf(line, "AT+CMGL=%u", &u) == 1)
+	{
+		for(i = 1; i <= replay->sim; i++)
+		{
+			if(u != 4 && u != i % 4)
+				continue;
+			snprintf(buf, sizeof(buf), "\r\n+CMGL: %u,%u,,%zu\r\n%s",
+					i, i % 4, length, _replay_sim_pdu);
+			_run_dce_write(replay, buf, strlen(buf));
+			replay->lines += 2;
+		}
+	}
+	else if(sscanf(line, "AT+CMGR=%u", &u) == 1 && u >= 1
+			&& u <= replay->sim)
+	{
+		snprintf(buf, sizeof(buf), "\r\n+CMGR: %u,,%zu\r\n%s", u % 4,
+				length, _replay_sim_pdu);
+		_run_dce_write(replay, buf, strlen(buf));
+		replay->lines += 2;
+	}
+	else
+		return -1;
+	replay->sim_reads++;
+	_run_dce_write(replay, ok, sizeof(ok) - 1);
+	replay->lines += 3;
+	return 0;
+}
+
+static int _run_dce_sim_phonebook(Replay * replay, char const * line)
+{
+	static char const ok[] = "\r\n\r\nOK\r\n";
+	char buf[80];
+	unsigned int from;
+	unsigned int to;
+	unsigned int i;
+	gint64 delay;
+
+	if(replay->phonebook == 0)
+		return -1;
+	if(strcmp(line, "?") == 0)
+	{
+		snprintf(buf, sizeof(buf), "\r\n+CPBR: (1-%u),40,18",
+				replay->phonebook);
+		_run_dce_write(replay, buf, strlen(buf));
+		_run_dce_write(replay, ok, sizeof(ok) - 1);
+		replay->lines += 4;
+		return 0;
+	}
+	if(sscanf(line, "%u,%u", &from, &to) != 2 || to < from)
+		return -1;
+	/* the SIM takes a while to read the entries */
+	delay = (gint64)(to - from + 1) * REPLAY_PHONEBOOK_DELAY;
+	if(delay > replay->phonebook_longest)
+		replay->phonebook_longest = delay;
+	if(replay->out_hold == 0)
+		replay->out_hold = g_timeout_add(delay, _run_on_dce_hold,
+				replay);
+	for(i = max(from, 1); i <= to && i <= replay->phonebook; i++)
+	{
+		snprintf(buf, sizeof(buf), "\r\n+CPBR: %u,\"+3312345%04u\","
+				"145,\"Contact %u\"", i, i, i);
+		_run_dce_write(replay, buf, strlen(buf));
+		replay->lines++;
+	}
+	replay->phonebook_reads++;
+	_run_dce_write(replay, ok, sizeof(ok) - 1);
+	replay->lines += 3;
+	return 0;
+}
+
+static void _run_dce_flush(Replay * replay)
+{
+	if(replay->out_hold == 0 && replay->out_source == 0
+			&& _run_on_dce_out(replay->channel, G_IO_OUT, replay)
+			== TRUE)
+		replay->out_source = g_io_add_watch(replay->channel, G_IO_OUT,
+				_run_on_dce_out, replay);
+}
+
+static void _run_dce_write(Replay * replay, char const * buf, size_t size)
+{
+	char * p;
+
+	/* the plug-in may only read once we return */
+	if((p = realloc(replay->out, replay->out_cnt + size)) == NULL)
+	{
+		error_set_print(PROGNAME, 1, "%s", strerror(errno));
+		return;
+	}
+	replay->out = p;
+	memcpy(&p[replay->out_cnt], buf, size);
+	replay->out_cnt += size;
+	_run_dce_flush(replay);
+}
+
+static gboolean _run_on_dce_hold(gpointer data)
+{
+	Replay * replay = data;
+
+	replay->out_hold = 0;
+	_run_dce_flush(replay);
+	return FALSE;
+}
+
+static gboolean _run_on_dce_out(GIOChannel * source, GIOCondition condition,
+		gpointer data)
+{
+	Replay * replay = data;
+	ssize_t cnt;
+	(void) condition;
+
+	while(replay->out_cnt > 0)
+		if((cnt = write(g_io_channel_unix_get_fd(source), replay->out,
+						replay->out_cnt)) > 0)
+		{
+			replay->out_cnt -= cnt;
+			memmove(replay->out, &replay->out[cnt],
+					replay->out_cnt);
+		}
+		else if(cnt < 0 && (errno == EAGAIN || errno == EINTR))
+			/* wait until the plug-in reads */
+			return TRUE;
+		else
+		{
+			error_set_print(PROGNAME, 1, "%s", strerror(errno));
+			replay->out_cnt = 0;
+		}
+	replay->out_source = 0;
+	return FALSE;
+}
+
+static int _run_idle(Replay * replay)
+{
+	HayesChannel * channel = &replay->hayes->channel;
+	size_t i;
+
+	if(channel->mode != HAYESCHANNEL_MODE_COMMAND
+			|| hayeschannel_queue_get_current(channel) != NULL)
+		return 0;
+	for(i = 0; i < sizeof(channel->queue) / sizeof(*channel->queue); i++)
+		if(channel->queue[i].head != NULL)
+			return 0;
+	return 1;
+}
+
+static gboolean _run_on_ready(gpointer data)
+{
+	Replay * replay = data;
+
+	/* wait for the initialization to complete */
+	if(!_run_idle(replay))
+		return TRUE;
+	replay->timeout = 0;
+	replay->lines = 0;
+	if(replay->sim > 0 || replay->phonebook > 0)
+	{
+		/* synchronize the SIM, as the phone does at startup */
+		replay->sim_commands = 0;
+		replay->start = g_get_monotonic_time();
+		if(replay->sim > 0)
+			plugin.trigger(replay->hayes, MODEM_EVENT_TYPE_MESSAGE);
+		if(replay->phonebook > 0)
+			_hayes_request_type(replay->hayes,
+					&replay->hayes->channel,
+					MODEM_REQUEST_CONTACT_LIST);
+		replay->timeout = g_timeout_add(10, _run_on_sim, replay);
+		return FALSE;
+	}
+	replay->start = g_get_monotonic_time();
+#ifdef __GLIBC__
+	replay->allocations = _replay_allocations;
+#endif
+	if(_run_queue(replay) != 0)
+	{
+		replay->ret = -1;
+		g_main_loop_quit(_loop);
+	}
+	return FALSE;
+}
+
+static gboolean _run_on_sim(gpointer data)
+{
+	Replay * replay = data;
+
+	if(!_run_idle(replay))
+		return TRUE;
+	replay->timeout = 0;
+	_run_report_sim(replay);
+	g_main_loop_quit(_loop);
+	return FALSE;
+}
+
+static gboolean _run_on_startup(gpointer data)
+{
+	Replay * replay = data;
+
+	replay->timeout = 0;
+	replay->ret = -error_set_print(PROGNAME, 1, "%s",
+			"Not registered in time");
+	g_main_loop_quit(_loop);
+	return FALSE;
+}
+
+static int _run_queue(Replay * replay)
+{
+	Hayes * hayes = replay->hayes;
+	HayesCommand * command;
+	ReplayEntry * entry;
+
+	entry = &replay->entries[replay->commands % replay->entries_cnt];
+	if((command = hayes_command_new(entry->command)) == NULL)
+		return -error_print(PROGNAME);
+	hayes_command_set_callback(command, _run_on_command, &hayes->channel);
+	hayes_command_set_timeout(command, 5000);
+	replay->queued = g_get_monotonic_time();
+	if(_hayes_queue_command(hayes, &hayes->channel, command) != 0)
+	{
+		hayes_command_delete(command);
+		return -error_set_print(PROGNAME, 1, "%s: %s", entry->command,
+				"Could not queue the command");
+	}
+	return 0;
+}
+
+static HayesCommandStatus _run_on_command(HayesCommand * command,
+		HayesCommandStatus status, HayesChannel * channel)
+{
+	Replay * replay = _replay;
+
+	status = _on_request_generic(command, status, channel);
+	switch(status)
+	{
+		case HCS_ERROR:
+		case HCS_SUCCESS:
+		case HCS_TIMEOUT:
+			break;
+		default:
+			return status;
+	}
+	replay->latencies[replay->latencies_cnt++] = g_get_monotonic_time()
+		- replay->queued;
+	if(status == HCS_TIMEOUT)
+		replay->ret = -error_set_print(PROGNAME, 1, "%s: %s",
+				hayes_command_get_attention(command),
+				"Timeout");
+	if(++replay->commands < replay->entries_cnt * replay->iterations)
+	{
+		/* the next command is sent once this one is unqueued */
+		if(_run_queue(replay) != 0)
+			replay->ret = -1;
+		else
+			return status;
+	}
+	_run_report(replay);
+	g_main_loop_quit(_loop);
+	return status;
+}
+
+static void _run_report(Replay * replay)
+{
+	gint64 elapsed = g_get_monotonic_time() - replay->start;
+	double seconds = (elapsed > 0) ? elapsed / 1000000.0 : 1e-6;
+	size_t allocations = 0;
+
+#ifdef __GLIBC__
+	allocations = _replay_allocations - replay->allocations;
+#endif
+	if(replay->latencies_cnt == 0)
+		return;
+	qsort(replay->latencies, replay->latencies_cnt,
+			sizeof(*replay->latencies), _run_report_compare);
+	printf("%s: %lu commands, %lu lines in %.3fs\n", PROGNAME,
+			(unsigned long)replay->latencies_cnt,
+			(unsigned long)replay->lines, seconds);
+	printf("%s: %.0f lines/s, %.0f commands/s\n", PROGNAME,
+			replay->lines / seconds,
+			replay->latencies_cnt / seconds);
+#ifdef __GLIBC__
+	printf("%s: %.2f allocations/line\n", PROGNAME, (replay->lines > 0)
+			? allocations / (double)replay->lines : 0.0);
+#else
+	(void) allocations;
+#endif
+	printf("%s: round-trip p50 %luus, p99 %luus\n", PROGNAME,
+			(unsigned long)replay->latencies[
+			replay->latencies_cnt / 2],
+			(unsigned long)replay->latencies[
+			(replay->latencies_cnt * 99) / 100]);
+}
+
+static int _run_report_compare(void const * a, void const * b)
+{
+	gint64 const * la = a;
+	gint64 const * lb = b;
+
+	return (*la < *lb) ? -1 : ((*la > *lb) ? 1 : 0);
+}
+
+static void _run_report_sim(Replay * replay)
+{
+	gint64 elapsed = replay->sim_done - replay->start;
+
+	if(replay->phonebook > 0)
+	{
+		elapsed = replay->phonebook_done - replay->start;
+		if(replay->phonebook_contacts != replay->phonebook)
+			replay->ret = -error_set_print(PROGNAME, 1, "%lu/%u%s",
+					(unsigned long)
+					replay->phonebook_contacts,
+					replay->phonebook,
+					" contacts reported");
+		printf("%s: %u contacts in the phonebook\n", PROGNAME,
+				replay->phonebook);
+		printf("%s: %lu reads, the longest for %lums\n", PROGNAME,
+				(unsigned long)replay->phonebook_reads,
+				(unsigned long)replay->phonebook_longest);
+		printf("%s: %.0f contacts/s, synchronized in %.3fs\n",
+				PROGNAME, (elapsed > 0)
+				? replay->phonebook_contacts * 1000000.0
+				/ elapsed : 0.0, elapsed / 1000000.0);
+		elapsed = replay->sim_done - replay->start;
+	}
+	if(replay->sim == 0)
+		return;
+	if(replay->sim_messages != replay->sim)
+		replay->ret = -error_set_print(PROGNAME, 1, "%lu/%u%s",
+				(unsigned long)replay->sim_messages,
+				replay->sim, " messages reported");
+	printf("%s: %u messages on the SIM\n", PROGNAME, replay->sim);
+	printf("%s: %lu commands, %lu for the messages\n", PROGNAME,
+			(unsigned long)replay->sim_commands,
+			(unsigned long)replay->sim_reads);
+	printf("%s: %lu lines, synchronized in %.3fs\n", PROGNAME,
+			(unsigned long)replay->lines,
+			(elapsed > 0) ? elapsed / 1000000.0 : 0.0);
+}
+
+static void _run_report_startup(Replay * replay)
+{
+	gint64 ready = replay->hayes->ready;
+
+	printf("%s: %lu command lines, %lu commands\n", PROGNAME,
+			(unsigned long)replay->dce_lines,
+			(unsigned long)replay->dce_commands);
+	printf("%s: %lu lines, registered in %.3fms\n", PROGNAME,
+			(unsigned long)replay->lines, ready / 1000.0);
+}
+
+
+/* replay_parse */
+static char const * _parse_record(char const * transcript, int * phone);
+static int _parse_append(char ** string, char const * buf, size_t size);
+
+static int _replay_parse(Replay * replay, char const * transcript)
+{
+	char const * p;
+	char const * q;
+	int phone;
+	int next;
+	ReplayEntry * entry = NULL;
+	int complete = 1;
+	size_t size;
+
+	/* records start with "\nPHONE: " or "\nMODEM: " */
+	for(p = _parse_record(transcript, &phone); p != NULL; p = q)
+	{
+		if((q = _parse_record(p, &next)) != NULL)
+			size = q - p - 8;
+		else
+			size = strlen(p);
+		if(phone && complete)
+		{
+			/* new command */
+			if((entry = realloc(replay->entries,
+							sizeof(*entry)
+							* (replay->entries_cnt
+								+ 1))) == NULL)
+				return -error_set_print(PROGNAME, 1, "%s",
+						strerror(errno));
+			replay->entries = entry;
+			entry = &replay->entries[replay->entries_cnt++];
+			entry->command = NULL;
+			entry->answer = NULL;
+		}
+		if(entry == NULL)
+			; /* ignore anything before the first command */
+		else if(_parse_append(phone ? &entry->command : &entry->answer,
+					p, size) != 0)
+			return -error_set_print(PROGNAME, 1, "%s",
+					strerror(errno));
+		if(phone)
+			complete = (entry->command != NULL
+					&& strchr(entry->command, '\r')
+					!= NULL);
+		else
+			complete = 1;
+		phone = next;
+	}
+	for(size = 0; size < replay->entries_cnt; size++)
+	{
+		entry = &replay->entries[size];
+		entry->command[strcspn(entry->command, "\r\n")] = '\0';
+		if(entry->answer == NULL && (entry->answer = strdup("")) == NULL)
+			return -error_set_print(PROGNAME, 1, "%s",
+					strerror(errno));
+	}
+	return 0;
+}
+
+static char const * _parse_record(char const * transcript, int * phone)
+{
+	char const * p;
+	char const * q;
+
+	p = strstr(transcript, "\nPHONE: ");
+	q = strstr(transcript, "\nMODEM: ");
+	if(p == NULL && q == NULL)
+		return NULL;
+	if((*phone = (q == NULL || (p != NULL && p < q))) == 0)
+		p = q;
+	return p + 8;
+}
+
+static int _parse_append(char ** string, char const * buf, size_t size)
+{
+	size_t len = (*string != NULL) ? strlen(*string) : 0;
+	char * p;
+
+	if((p = realloc(*string, len + size + 1)) == NULL)
+		return -1;
+	memcpy(&p[len], buf, size);
+	p[len + size] = '\0';
+	*string = p;
+	return 0;
+}
+
+
+/* replay_read */
+static char * _replay_read(char const * filename)
+{
+	FILE * fp;
+	char * ret = NULL;
+	size_t len = 0;
+	char * p;
+	size_t size;
+
+	if((fp = fopen(filename, "r")) == NULL)
+	{
+		error_set_print(PROGNAME, 1, "%s: %s", filename,
+				strerror(errno));
+		return NULL;
+	}
+	do
+	{
+		if((p = realloc(ret, len + BUFSIZ + 1)) == NULL)
+		{
+			free(ret);
+			fclose(fp);
+			error_set_print(PROGNAME, 1, "%s", strerror(errno));
+			return NULL;
+		}
+		ret = p;
+		len += (size = fread(&ret[len], 1, BUFSIZ, fp));
+	}
+	while(size == BUFSIZ);
+	ret[len] = '\0';
+	if(ferror(fp))
+	{
+		error_set_print(PROGNAME, 1, "%s: %s", filename,
+				strerror(errno));
+		free(ret);
+		ret = NULL;
+	}
+	fclose(fp);
+	return ret;
+}
+
+
+/* helpers */
+/* replay_helper_config_get */
+static char const * _replay_helper_config_get(Modem * modem,
+		char const * variable)
+{
+	return config_get(modem->config, NULL, variable);
+}
+
+
+/* replay_helper_config_set */
+static int _replay_helper_config_set(Modem * modem, char const * variable,
+		char const * value)
+{
+	return config_set(modem->config, NULL, variable, value);
+}
+
+
+/* replay_helper_error */
+static int _replay_helper_error(Modem * modem, char const * message, int ret)
+{
+	(void) modem;
+
+	fprintf(stderr, "%s: %s\n", PROGNAME, message);
+	return ret;
+}
+
+
+/* replay_helper_event */
+static void _replay_helper_event(Modem * modem, ModemEvent * event)
+{
+	(void) modem;
+
+	if(event->type == MODEM_EVENT_TYPE_MESSAGE && _replay != NULL)
+	{
+		_replay->sim_messages++;
+		_replay->sim_done = g_get_monotonic_time();
+	}
+	else if(event->type == MODEM_EVENT_TYPE_CONTACT && _replay != NULL)
+	{
+		_replay->phonebook_contacts++;
+		_replay->phonebook_done = g_get_monotonic_time();
+	}
+	else if(event->type == MODEM_EVENT_TYPE_STATUS && _replay != NULL
+			&& _replay->startup
+			&& event->status.status == MODEM_STATUS_ONLINE)
+		/* authenticate, as the phone does when online */
+		plugin.trigger(_replay->hayes,
+				MODEM_EVENT_TYPE_AUTHENTICATION);
+	else if(event->type == MODEM_EVENT_TYPE_REGISTRATION
+			&& _replay != NULL && _replay->startup
+			&& event->registration.status
+			== MODEM_REGISTRATION_STATUS_REGISTERED
+			&& _replay->timeout != 0)
+	{
+		g_source_remove(_replay->timeout);
+		_replay->timeout = 0;
+		_run_report_startup(_replay);
+		g_main_loop_quit(_loop);
+	}
+}
+
+
+/* usage */
+static int _usage(void)
+{
+	fputs("Usage: " PROGNAME " [-l logfile][-n iterations][-p contacts]"
+		"[-s messages][transcript]\n"
+"       " PROGNAME " -r [-b][-d delay][-l logfile][transcript]\n"
+"  -l	Record the traffic into this trace file\n"
+"  -n	Number of times to replay the transcript (default: 1000)\n"
+"  -p	Synchronize this many contacts from a fake SIM at startup instead\n"
+"  -s	Synchronize this many messages from a fake SIM at startup instead\n"
+"  -r	Measure the time until registered instead\n"
+"  -b	Reject the extended commands following others on a line\n"
+"  -d	Time taken to answer every command line, in milliseconds\n",
+			stderr);
+	return 1;
+}
+
+
+/* public */
+/* functions */
+/* main */
+int main(int argc, char * argv[])
+{
+	int ret;
+	int o;
+	Replay replay;
+	char * transcript = NULL;
+	char * p;
+	size_t i;
+
+	memset(&replay, 0, sizeof(replay));
+	replay.iterations = 1000;
+	while((o = getopt(argc, argv, "bd:l:n:p:rs:")) != -1)
+		switch(o)
+		{
+			case 'b':
+				replay.batch_error = 1;
+				break;
+			case 'd':
+				replay.delay = strtoul(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0')
+					return _usage();
+				break;
+			case 'l':
+				replay.logfile = optarg;
+				break;
+			case 'n':
+				replay.iterations = strtoul(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0'
+						|| replay.iterations == 0)
+					return _usage();
+				break;
+			case 'p':
+				replay.phonebook = strtoul(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0'
+						|| replay.phonebook == 0)
+					return _usage();
+				break;
+			case 'r':
+				replay.startup = 1;
+				break;
+			case 's':
+				replay.sim = strtoul(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0'
+						|| replay.sim == 0)
+					return _usage();
+				break;
+			default:
+				return _usage();
+		}
+	if(optind + 1 < argc)
+		return _usage();
+	if(optind + 1 == argc
+			&& (transcript = _replay_read(argv[optind])) == NULL)
+		return 2;
+	_loop = g_main_loop_new(NULL, FALSE);
+	ret = _replay_run(&replay, (transcript != NULL) ? transcript
+			: (replay.startup ? _replay_startup
+				: _replay_transcript));
+	g_main_loop_unref(_loop);
+	for(i = 0; i < replay.entries_cnt; i++)
+	{
+		free(replay.entries[i].command);
+		free(replay.entries[i].answer);
+	}
+	free(replay.entries);
+	free(replay.latencies);
+	free(transcript);
+	return (ret == 0) ? 0 : 2;
+}
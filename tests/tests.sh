@@ -99,10 +99,17 @@ target="$1"
 $DATE > "$target"
 FAILED=
 echo "Performing tests:" 1>&2
+_test "blacklist"
+_test "blacklist" -b 50000
+_test "cmux"
+_test "config"
 _test "hayes"
+_test "latency"
 _test "modems"
 _test "plugins"
+_test "trace"
 _test "ussd"
+_test "video"
 echo "Expected failures:" 1>&2
 _fail "pdu"
 if [ -n "$FAILED" ]; then
@@ -0,0 +1,385 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "../src/modems/hayes/trace.c"
+
+#ifndef PROGNAME
+# define PROGNAME "trace"
+#endif
+
+
+/* private */
+/* prototypes */
+static int _trace(void);
+static int _trace_benchmark(unsigned long iterations);
+
+static int _error(char const * message, int ret);
+static int _usage(void);
+
+
+/* functions */
+/* trace */
+static int _trace_records(char const * filename);
+static int _trace_overflow(char const * filename);
+static int _trace_rotate(char const * filename);
+static int _trace_check(char const * filename, unsigned long * index,
+		unsigned long * dropped);
+static size_t _trace_fill(char * buf, unsigned long index);
+
+static int _trace(void)
+{
+	int ret = 0;
+	char filename[] = "/tmp/" PROGNAME ".XXXXXX";
+	char rotated[sizeof(filename) + 2];
+	int fd;
+
+	if((fd = mkstemp(filename)) < 0)
+		return -_error(filename, 1);
+	close(fd);
+	snprintf(rotated, sizeof(rotated), "%s.1", filename);
+	ret |= _trace_records(filename);
+	ret |= _trace_overflow(filename);
+	ret |= _trace_rotate(filename);
+	unlink(rotated);
+	unlink(filename);
+	return ret;
+}
+
+static int _trace_records(char const * filename)
+{
+	const unsigned long count = 20000;
+	HayesTrace * trace;
+	char buf[1024];
+	unsigned long i;
+	unsigned long index = 0;
+	unsigned long dropped = 0;
+	size_t size;
+
+	printf("%s: Testing %lu records\n", PROGNAME, count);
+	if((trace = hayestrace_new(filename, 0)) == NULL)
+		return -_error(filename, 1);
+	/* several times the size of the ring buffer, wrapping around */
+	for(i = 0; i < count; i++)
+	{
+		size = _trace_fill(buf, i);
+		hayestrace_record(trace, i % 2, i % 3, buf, size);
+		if(i % 1000 == 999)
+			g_usleep(1000);
+	}
+	hayestrace_delete(trace);
+	if(_trace_check(filename, &index, &dropped) != 0)
+		return 2;
+	if(index != count)
+	{
+		fprintf(stderr, "%s: %lu records read, %lu expected\n",
+				PROGNAME, index, count);
+		return 2;
+	}
+	printf("%s: %lu records dropped\n", PROGNAME, dropped);
+	return 0;
+}
+
+static int _trace_overflow(char const * filename)
+{
+	HayesTrace * trace;
+	char * buf;
+	unsigned long index = 0;
+	unsigned long dropped = 0;
+	size_t size;
+
+	printf("%s: Testing overflows\n", PROGNAME);
+	if((buf = malloc(HAYESTRACE_RING_SIZE)) == NULL)
+		return -_error(filename, 1);
+	if((trace = hayestrace_new(filename, 0)) == NULL)
+	{
+		free(buf);
+		return -_error(filename, 1);
+	}
+	/* this can never fit */
+	_trace_fill(buf, 0);
+	if(hayestrace_record(trace, HAYESTRACE_DIRECTION_PHONE, 0, buf,
+				HAYESTRACE_RING_SIZE) == 0)
+	{
+		fprintf(stderr, "%s: Overflow not detected\n", PROGNAME);
+		hayestrace_delete(trace);
+		free(buf);
+		return 2;
+	}
+	/* the loss is reported along with the next record */
+	size = _trace_fill(buf, 1);
+	hayestrace_record(trace, HAYESTRACE_DIRECTION_MODEM, 0, buf, size);
+	hayestrace_delete(trace);
+	free(buf);
+	if(_trace_check(filename, &index, &dropped) != 0)
+		return 2;
+	if(index != 2 || dropped != 1)
+	{
+		fprintf(stderr, "%s: %lu records read (%lu dropped),"
+				" 2 (1) expected\n", PROGNAME, index, dropped);
+		return 2;
+	}
+	return 0;
+}
+
+static int _trace_rotate(char const * filename)
+{
+	const unsigned long count = 2000;
+	const size_t rotate = 65536;
+	HayesTrace * trace;
+	char rotated[256];
+	char buf[1024];
+	unsigned long i;
+	unsigned long index;
+	unsigned long dropped = 0;
+	size_t size;
+	struct stat st;
+
+	printf("%s: Testing rotation every %zu bytes\n", PROGNAME, rotate);
+	snprintf(rotated, sizeof(rotated), "%s.1", filename);
+	if((trace = hayestrace_new(filename, rotate)) == NULL)
+		return -_error(filename, 1);
+	for(i = 0; i < count; i++)
+	{
+		size = _trace_fill(buf, i);
+		hayestrace_record(trace, HAYESTRACE_DIRECTION_PHONE, 0, buf,
+				size);
+		if(i % 100 == 99)
+			g_usleep(1000);
+	}
+	hayestrace_delete(trace);
+	if(stat(filename, &st) != 0)
+		return -_error(filename, 1);
+	if((size_t)st.st_size > rotate)
+	{
+		fprintf(stderr, "%s: %s: File not rotated\n", PROGNAME,
+				filename);
+		return 2;
+	}
+	/* the records follow each other from the previous file */
+	index = -1;
+	if(_trace_check(rotated, &index, &dropped) != 0)
+		return 2;
+	if(_trace_check(filename, &index, &dropped) != 0)
+		return 2;
+	if(index != count)
+	{
+		fprintf(stderr, "%s: %lu records read, %lu expected\n",
+				PROGNAME, index, count);
+		return 2;
+	}
+	return 0;
+}
+
+static int _trace_check(char const * filename, unsigned long * index,
+		unsigned long * dropped)
+{
+	int ret;
+	FILE * fp;
+	HayesTraceHeader header;
+	HayesTraceRecord record;
+	char * buf = NULL;
+	size_t size = 0;
+	char expected[1024];
+	gint64 timestamp;
+	unsigned long i;
+
+	if((fp = fopen(filename, "r")) == NULL)
+		return -_error(filename, 1);
+	if(hayestrace_read_header(fp, &header) != 0)
+	{
+		fclose(fp);
+		return -_error(filename, 1);
+	}
+	/* rotated files are opened after their first record */
+	timestamp = 0;
+	while((ret = hayestrace_read_record(fp, &record, &buf, &size)) == 0)
+	{
+		if(record.timestamp < timestamp)
+		{
+			fprintf(stderr, "%s: %s: Timestamps out of order\n",
+					PROGNAME, filename);
+			ret = -1;
+			break;
+		}
+		timestamp = record.timestamp;
+		i = _hayestrace_decode32((unsigned char *)buf);
+		if(record.direction == HAYESTRACE_DIRECTION_DROPPED)
+		{
+			if(*index != (unsigned long)-1)
+				*index += i;
+			*dropped += i;
+			continue;
+		}
+		/* the first record of a rotated file sets the index */
+		if(*index == (unsigned long)-1)
+			*index = i;
+		if(i != *index || record.size != _trace_fill(expected, i)
+				|| memcmp(buf, expected, record.size) != 0)
+		{
+			fprintf(stderr, "%s: %s: Record %lu: Unexpected"
+					" content\n", PROGNAME, filename,
+					*index);
+			ret = -1;
+			break;
+		}
+		(*index)++;
+	}
+	free(buf);
+	fclose(fp);
+	if(ret < 0)
+		return -1;
+	return 0;
+}
+
+static size_t _trace_fill(char * buf, unsigned long index)
+{
+	size_t size = 4 + (index * 7) % 1000;
+	size_t i;
+
+	_hayestrace_encode32((unsigned char *)buf, index);
+	for(i = 4; i < size; i++)
+		buf[i] = (index + i) & 0xff;
+	return size;
+}
+
+
+/* trace_benchmark */
+static int _trace_benchmark(unsigned long iterations)
+{
+	char filename[] = "/tmp/" PROGNAME ".XXXXXX";
+	int fd;
+	FILE * fp;
+	HayesTrace * trace;
+	char const prefix[] = "\nMODEM: ";
+	char const buf[] = "\r\n+CSQ: 20,99\r\n\r\nOK\r\n";
+	unsigned long i;
+	gint64 before;
+	gint64 after;
+	gint64 worst;
+	gint64 t;
+
+	if((fd = mkstemp(filename)) < 0)
+		return -_error(filename, 1);
+	close(fd);
+	/* the previous implementation, unbuffered */
+	if((fp = fopen(filename, "w")) == NULL)
+		return -_error(filename, 1);
+	setvbuf(fp, NULL, _IONBF, BUFSIZ);
+	worst = 0;
+	before = g_get_monotonic_time();
+	for(i = 0; i < iterations; i++)
+	{
+		t = g_get_monotonic_time();
+		fprintf(fp, "%s", prefix);
+		fwrite(buf, sizeof(*buf), sizeof(buf) - 1, fp);
+		if((t = g_get_monotonic_time() - t) > worst)
+			worst = t;
+	}
+	after = g_get_monotonic_time();
+	fclose(fp);
+	printf("%s: unbuffered: %.3fus per record, %" G_GINT64_FORMAT
+			"us at worst\n", PROGNAME,
+			(double)(after - before) / iterations, worst);
+	/* the trace recorder */
+	if((trace = hayestrace_new(filename, 0)) == NULL)
+		return -_error(filename, 1);
+	worst = 0;
+	before = g_get_monotonic_time();
+	for(i = 0; i < iterations; i++)
+	{
+		t = g_get_monotonic_time();
+		hayestrace_record(trace, HAYESTRACE_DIRECTION_MODEM, 0, buf,
+				sizeof(buf) - 1);
+		if((t = g_get_monotonic_time() - t) > worst)
+			worst = t;
+	}
+	after = g_get_monotonic_time();
+	hayestrace_delete(trace);
+	printf("%s: trace: %.3fus per record, %" G_GINT64_FORMAT
+			"us at worst\n", PROGNAME,
+			(double)(after - before) / iterations, worst);
+	unlink(filename);
+	return 0;
+}
+
+
+/* error */
+static int _error(char const * message, int ret)
+{
+	fputs(PROGNAME ": ", stderr);
+	perror(message);
+	return ret;
+}
+
+
+/* usage */
+static int _usage(void)
+{
+	fputs("Usage: " PROGNAME " [-b][-n iterations]\n"
+"  -b	Benchmark the cost of logging on the main loop\n"
+"  -n	Number of records to log (default: 100000)\n", stderr);
+	return 1;
+}
+
+
+/* public */
+/* functions */
+/* main */
+int main(int argc, char * argv[])
+{
+	int o;
+	int benchmark = 0;
+	unsigned long iterations = 100000;
+	char * p;
+
+	while((o = getopt(argc, argv, "bn:")) != -1)
+		switch(o)
+		{
+			case 'b':
+				benchmark = 1;
+				break;
+			case 'n':
+				iterations = strtoul(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0'
+						|| iterations == 0)
+					return _usage();
+				break;
+			default:
+				return _usage();
+		}
+	if(optind != argc)
+		return _usage();
+	if(benchmark)
+		return (_trace_benchmark(iterations) == 0) ? 0 : 2;
+	return (_trace() == 0) ? 0 : 2;
+}
@@ -26,10 +26,15 @@
 
 
 #include "../src/modems/hayes/channel.c"
+#include "../src/modems/hayes/cmux.c"
 #include "../src/modems/hayes/command.c"
 #include "../src/modems/hayes/common.c"
+#include "../src/modems/hayes/concat.c"
+#include "../src/modems/hayes/gsm.c"
+#include "../src/modems/hayes/latency.c"
 #include "../src/modems/hayes/pdu.c"
 #include "../src/modems/hayes/quirks.c"
+#include "../src/modems/hayes/trace.c"
 #include "../src/modems/hayes.c"
 
 
@@ -0,0 +1,441 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../src/plugins/video/scale.c"
+#include "../src/plugins/video/yuv.c"
+#include "benchmark.c"
+
+#ifndef PROGNAME
+# define PROGNAME "video"
+#endif
+
+
+/* private */
+/* types */
+typedef enum _VideoFormat
+{
+	VF_YUYV = 0,
+	VF_NV12,
+	VF_YUV420
+} VideoFormat;
+#define VF_LAST		VF_YUV420
+#define VF_COUNT	(VF_LAST + 1)
+
+
+/* constants */
+static char const * _video_formats[VF_COUNT] = { "YUYV", "NV12", "YUV420" };
+
+
+/* prototypes */
+static int _video(void);
+static int _video_benchmark(size_t width, size_t height,
+		unsigned long iterations);
+
+static int _usage(void);
+
+
+/* functions */
+/* video */
+static int _video_accuracy(void);
+static int _video_scale(void);
+static int _video_scale_check(char const * name, size_t width, size_t height,
+		size_t target_width, size_t target_height, unsigned int flags,
+		uint8_t const * rgb, uint8_t const * expected);
+static void _video_convert(VideoFormat format, uint8_t const * frame,
+		size_t width, size_t height, uint8_t * rgb);
+static void _video_random(uint8_t * buf, size_t size);
+static size_t _video_size(VideoFormat format, size_t width, size_t height);
+
+static int _video(void)
+{
+	int ret;
+	const size_t widths[] = { 1, 2, 3, 15, 16, 17, 31, 32, 33, 64, 641 };
+	const size_t heights[] = { 1, 2, 3, 7 };
+	uint8_t * frame;
+	uint8_t * expected;
+	uint8_t * rgb;
+	VideoYUVEngine e;
+	VideoFormat f;
+	size_t w;
+	size_t h;
+	size_t size;
+
+	ret = _video_accuracy() | _video_scale();
+	if((frame = malloc(_video_size(VF_YUYV, 641, 7))) == NULL
+			|| (expected = malloc(641 * 7 * 3)) == NULL
+			|| (rgb = malloc(641 * 7 * 3)) == NULL)
+		return 2;
+	/* every engine must match the scalar one */
+	for(e = VIDEOYUV_ENGINE_SCALAR + 1; e <= VIDEOYUV_ENGINE_LAST; e++)
+	{
+		if(videoyuv_set_engine(e) != 0)
+		{
+			printf("%s: %s: %s\n", PROGNAME,
+					videoyuv_get_engine_name(e),
+					"Not supported");
+			continue;
+		}
+		for(f = 0; f < VF_COUNT; f++)
+			for(w = 0; w < sizeof(widths) / sizeof(*widths); w++)
+				for(h = 0; h < sizeof(heights)
+						/ sizeof(*heights); h++)
+				{
+					size = _video_size(f, widths[w],
+							heights[h]);
+					_video_random(frame, size);
+					videoyuv_set_engine(
+							VIDEOYUV_ENGINE_SCALAR);
+					_video_convert(f, frame, widths[w],
+							heights[h], expected);
+					videoyuv_set_engine(e);
+					_video_convert(f, frame, widths[w],
+							heights[h], rgb);
+					if(memcmp(expected, rgb, widths[w]
+								* heights[h]
+								* 3) == 0)
+						continue;
+					fprintf(stderr, "%s: %s: %s %zux%zu:"
+							" %s\n", PROGNAME,
+							videoyuv_get_engine_name(
+								e),
+							_video_formats[f],
+							widths[w], heights[h],
+							"Not bit-exact");
+					ret = 2;
+				}
+		printf("%s: %s: %s\n", PROGNAME, videoyuv_get_engine_name(e),
+				(ret == 0) ? "Bit-exact" : "Failed");
+	}
+	free(frame);
+	free(expected);
+	free(rgb);
+	return ret;
+}
+
+static int _video_accuracy(void)
+{
+	unsigned int y;
+	unsigned int u;
+	unsigned int v;
+	uint8_t rgb[3];
+	double x[3];
+	int error;
+	size_t i;
+
+	/* against BT.601 in double precision, within one step */
+	for(y = 0; y < 256; y++)
+		for(u = 0; u < 256; u++)
+			for(v = 0; v < 256; v++)
+			{
+				_scalar_pixel(y, u, v, rgb);
+				x[0] = 1.164383 * (y - 16.0)
+					+ 1.596027 * (v - 128.0);
+				x[1] = 1.164383 * (y - 16.0)
+					- 0.391762 * (u - 128.0)
+					- 0.812968 * (v - 128.0);
+				x[2] = 1.164383 * (y - 16.0)
+					+ 2.017232 * (u - 128.0);
+				for(i = 0; i < 3; i++)
+				{
+					x[i] = (x[i] < 0.0) ? 0.0
+						: ((x[i] > 255.0) ? 255.0
+								: x[i]);
+					error = rgb[i] - (int)(x[i] + 0.5);
+					if(error >= -1 && error <= 1)
+						continue;
+					fprintf(stderr, "%s: %u,%u,%u: %s\n",
+							PROGNAME, y, u, v,
+							"Not accurate");
+					return 2;
+				}
+			}
+	printf("%s: %s: %s\n", PROGNAME, videoyuv_get_engine_name(
+				VIDEOYUV_ENGINE_SCALAR), "Accurate");
+	return 0;
+}
+
+static int _video_scale(void)
+{
+	int ret = 0;
+	uint8_t rgb[4 * 2 * 3];
+	uint8_t expected[8 * 8 * 3];
+	size_t x;
+	size_t y;
+
+	_video_random(rgb, sizeof(rgb));
+	/* copies */
+	ret |= _video_scale_check("copy", 4, 2, 4, 2, VIDEOSCALE_BILINEAR,
+			rgb, rgb);
+	/* flips */
+	for(y = 0; y < 2; y++)
+		for(x = 0; x < 4; x++)
+			memcpy(&expected[(y * 4 + x) * 3],
+					&rgb[((1 - y) * 4 + 3 - x) * 3], 3);
+	ret |= _video_scale_check("flip", 4, 2, 4, 2, VIDEOSCALE_HFLIP
+			| VIDEOSCALE_VFLIP | VIDEOSCALE_BILINEAR, rgb,
+			expected);
+	/* scaling */
+	for(y = 0; y < 4; y++)
+		for(x = 0; x < 8; x++)
+			memcpy(&expected[(y * 8 + x) * 3],
+					&rgb[((y / 2) * 4 + x / 2) * 3], 3);
+	ret |= _video_scale_check("scale", 4, 2, 8, 4, 0, rgb, expected);
+	/* letterboxing */
+	memmove(&expected[8 * 2 * 3], expected, 8 * 4 * 3);
+	memset(expected, 0, 8 * 2 * 3);
+	memset(&expected[8 * 6 * 3], 0, 8 * 2 * 3);
+	ret |= _video_scale_check("ratio", 4, 2, 8, 8, VIDEOSCALE_RATIO, rgb,
+			expected);
+	/* interpolation */
+	memset(rgb, 0x42, sizeof(rgb));
+	memset(expected, 0x42, sizeof(expected));
+	ret |= _video_scale_check("bilinear", 4, 2, 8, 8, VIDEOSCALE_BILINEAR,
+			rgb, expected);
+	printf("%s: %s: %s\n", PROGNAME, "scale", (ret == 0) ? "Correct"
+			: "Failed");
+	return ret;
+}
+
+static int _video_scale_check(char const * name, size_t width, size_t height,
+		size_t target_width, size_t target_height, unsigned int flags,
+		uint8_t const * rgb, uint8_t const * expected)
+{
+	VideoScale * scale;
+	uint8_t target[8 * 8 * 3];
+
+	if((scale = videoscale_new(width, height, target_width, target_height,
+					flags)) == NULL)
+		return 2;
+	memset(target, 0xff, sizeof(target));
+	videoscale_apply(scale, rgb, target, target_width * 3);
+	videoscale_delete(scale);
+	if(memcmp(target, expected, target_width * target_height * 3) == 0)
+		return 0;
+	fprintf(stderr, "%s: %s: %s\n", PROGNAME, name, "Wrong output");
+	return 2;
+}
+
+static void _video_convert(VideoFormat format, uint8_t const * frame,
+		size_t width, size_t height, uint8_t * rgb)
+{
+	size_t chroma = ((width + 1) / 2) * ((height + 1) / 2);
+
+	switch(format)
+	{
+		case VF_YUYV:
+			videoyuv_yuyv_to_rgb(frame, ((width + 1) / 2) * 4,
+					width, height, rgb);
+			break;
+		case VF_NV12:
+			videoyuv_nv12_to_rgb(frame, &frame[width * height],
+					width, width, height, rgb);
+			break;
+		case VF_YUV420:
+			videoyuv_yuv420_to_rgb(frame, &frame[width * height],
+					&frame[width * height + chroma],
+					width, width, height, rgb);
+			break;
+	}
+}
+
+static void _video_random(uint8_t * buf, size_t size)
+{
+	size_t i;
+
+	for(i = 0; i < size; i++)
+		buf[i] = rand();
+}
+
+static size_t _video_size(VideoFormat format, size_t width, size_t height)
+{
+	/* with a margin for odd dimensions */
+	switch(format)
+	{
+		case VF_YUYV:
+			return ((width + 1) / 2) * 4 * height;
+		default:
+			return width * height + ((width + 1) / 2)
+				* ((height + 1) / 2) * 2 + width;
+	}
+}
+
+
+/* video_benchmark */
+static void _benchmark_double(uint8_t const * yuyv, size_t size,
+		uint8_t * rgb);
+
+static int _video_benchmark(size_t width, size_t height,
+		unsigned long iterations)
+{
+	const unsigned int flags[] =
+	{
+		VIDEOSCALE_HFLIP | VIDEOSCALE_RATIO,
+		VIDEOSCALE_HFLIP | VIDEOSCALE_RATIO | VIDEOSCALE_BILINEAR
+	};
+	uint8_t * frame;
+	uint8_t * rgb;
+	uint8_t * target;
+	VideoYUVEngine e;
+	VideoFormat f;
+	VideoScale * scale;
+	unsigned long i;
+	unsigned long n;
+	double t0;
+	double t1;
+
+	if((frame = malloc(_video_size(VF_YUYV, width, height))) == NULL
+			|| (rgb = malloc(width * height * 3)) == NULL)
+		return 2;
+	_video_random(frame, _video_size(VF_YUYV, width, height));
+	/* the previous conversion, in double precision */
+	t0 = _benchmark_time();
+	for(n = 0; n < iterations; n++)
+		_benchmark_double(frame, width * height * 2, rgb);
+	t1 = _benchmark_time();
+	printf("%s: %zux%zu %s %s: %.3fms per frame\n", PROGNAME, width,
+			height, _video_formats[VF_YUYV], "double",
+			(t1 - t0) * 1000.0 / iterations);
+	for(e = VIDEOYUV_ENGINE_SCALAR; e <= VIDEOYUV_ENGINE_LAST; e++)
+	{
+		if(videoyuv_set_engine(e) != 0)
+			continue;
+		for(f = 0; f < VF_COUNT; f++)
+		{
+			t0 = _benchmark_time();
+			for(n = 0; n < iterations; n++)
+				_video_convert(f, frame, width, height, rgb);
+			t1 = _benchmark_time();
+			printf("%s: %zux%zu %s %s: %.3fms per frame\n",
+					PROGNAME, width, height,
+					_video_formats[f],
+					videoyuv_get_engine_name(e),
+					(t1 - t0) * 1000.0 / iterations);
+		}
+	}
+	/* rendering to a 480x640 screen, as found on the Openmoko */
+	if((target = malloc(480 * 640 * 3)) == NULL)
+	{
+		free(frame);
+		free(rgb);
+		return 2;
+	}
+	for(n = 0; n < sizeof(flags) / sizeof(*flags); n++)
+	{
+		if((scale = videoscale_new(width, height, 480, 640, flags[n]))
+				== NULL)
+			break;
+		t0 = _benchmark_time();
+		for(i = 0; i < iterations; i++)
+			videoscale_apply(scale, rgb, target, 480 * 3);
+		t1 = _benchmark_time();
+		videoscale_delete(scale);
+		printf("%s: %zux%zu to 480x640 %s: %.3fms per frame\n",
+				PROGNAME, width, height, (flags[n]
+					& VIDEOSCALE_BILINEAR) ? "bilinear"
+				: "nearest", (t1 - t0) * 1000.0 / iterations);
+	}
+	free(target);
+	free(frame);
+	free(rgb);
+	return 0;
+}
+
+static void _benchmark_double(uint8_t const * yuyv, size_t size,
+		uint8_t * rgb)
+{
+	const int amp = 255;
+	size_t i;
+	size_t j;
+	size_t k;
+	double x[3];
+
+	for(i = 0, j = 0; i + 3 < size; i += 4)
+		for(k = 0; k < 4; k += 2, j += 3)
+		{
+			x[2] = amp * (0.004565 * yuyv[i + k]
+					+ 0.007935 * yuyv[i + 1] - 1.088);
+			x[1] = amp * (0.004565 * yuyv[i + k]
+					- 0.001542 * yuyv[i + 1]
+					- 0.003183 * yuyv[i + 3] + 0.531);
+			x[0] = amp * (0.004565 * yuyv[i + k]
+					+ 0.000001 * yuyv[i + 1]
+					+ 0.006250 * yuyv[i + 3] - 0.872);
+			rgb[j] = (x[0] < 0) ? 0 : ((x[0] > 255) ? 255 : x[0]);
+			rgb[j + 1] = (x[1] < 0) ? 0
+				: ((x[1] > 255) ? 255 : x[1]);
+			rgb[j + 2] = (x[2] < 0) ? 0
+				: ((x[2] > 255) ? 255 : x[2]);
+		}
+}
+
+
+/* usage */
+static int _usage(void)
+{
+	fputs("Usage: " PROGNAME " [-b][-n iterations]\n"
+"  -b	Benchmark the conversion and scaling of a 640x480 frame\n"
+"  -n	Number of frames to convert (default: 300)\n", stderr);
+	return 1;
+}
+
+
+/* public */
+/* functions */
+/* main */
+int main(int argc, char * argv[])
+{
+	int o;
+	int benchmark = 0;
+	unsigned long iterations = 300;
+	char * p;
+
+	while((o = getopt(argc, argv, "bn:")) != -1)
+		switch(o)
+		{
+			case 'b':
+				benchmark = 1;
+				break;
+			case 'n':
+				iterations = strtoul(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0'
+						|| iterations == 0)
+					return _usage();
+				break;
+			default:
+				return _usage();
+		}
+	if(optind != argc)
+		return _usage();
+	if(benchmark)
+		return _video_benchmark(640, 480, iterations);
+	return _video();
+}
@@ -42,9 +42,15 @@
 
 /* private */
 /* types */
+struct _PhoneConfigSection
+{
+	String * name;
+};
+
 struct _Phone
 {
 	Config * config;
+	PhoneConfigSection section;
 	PhonePluginHelper helper;
 	PhonePluginDefinition * plugind;
 	PhonePlugin * plugin;
@@ -60,10 +66,19 @@ static int _phone_init(Phone * phone, PhonePluginDefinition * plugind);
 static void _phone_destroy(Phone * phone);
 
 /* helpers */
+static void _helper_config_foreach(Phone * phone, char const * section,
+		PhoneConfigForeachCallback callback, void * priv);
 static char const * _helper_config_get(Phone * phone, char const * section,
 		char const * variable);
 static int _helper_config_set(Phone * phone, char const * section,
 		char const * variable, char const * value);
+static PhoneConfigSection * _helper_config_section(Phone * phone,
+		char const * section);
+static char const * _helper_config_section_get(Phone * phone,
+		PhoneConfigSection * section, char const * variable);
+static int _helper_config_section_set(Phone * phone,
+		PhoneConfigSection * section, char const * variable,
+		char const * value);
 static int _helper_error(Phone * phone, char const * message, int ret);
 static int _helper_request(Phone * phone, ModemRequest * request);
 static int _helper_trigger(Phone * phone, ModemEventType event);
@@ -88,11 +103,16 @@ static int _phone_init(Phone * phone, PhonePluginDefinition * plugind)
 	}
 	memset(&phone->helper, 0, sizeof(phone->helper));
 	phone->helper.phone = phone;
+	phone->helper.config_foreach = _helper_config_foreach;
 	phone->helper.config_get = _helper_config_get;
 	phone->helper.config_set = _helper_config_set;
+	phone->helper.config_section = _helper_config_section;
+	phone->helper.config_section_get = _helper_config_section_get;
+	phone->helper.config_section_set = _helper_config_section_set;
 	phone->helper.error = _helper_error;
 	phone->helper.request = _helper_request;
 	phone->helper.trigger = _helper_trigger;
+	phone->section.name = NULL;
 	phone->plugind = plugind;
 	phone->plugin = NULL;
 	phone->username = NULL;
@@ -111,6 +131,7 @@ static int _phone_init(Phone * phone, PhonePluginDefinition * plugind)
 /* phone_destroy */
 static void _phone_destroy(Phone * phone)
 {
+	string_delete(phone->section.name);
 	free(phone->username);
 	if(phone->password != NULL)
 		string_clear(phone->password);
@@ -123,6 +144,44 @@ static void _phone_destroy(Phone * phone)
 
 
 /* helpers */
+/* helper_config_foreach */
+static void _config_foreach_section(Config const * config,
+		String const * section, String const * variable,
+		String const * value, void * priv);
+
+static void _helper_config_foreach(Phone * phone, char const * section,
+		PhoneConfigForeachCallback callback, void * priv)
+{
+	struct PhoneConfigForeachData
+	{
+		PhoneConfigForeachCallback * callback;
+		void * priv;
+	} pcfd = { callback, priv };
+	String * s;
+
+	if((s = string_new_append("plugin::", section, NULL)) == NULL)
+		return;
+	config_foreach_section(phone->config, s, _config_foreach_section,
+			&pcfd);
+	string_delete(s);
+}
+
+static void _config_foreach_section(Config const * config,
+		String const * section, String const * variable,
+		String const * value, void * priv)
+{
+	struct PhoneConfigForeachData
+	{
+		PhoneConfigForeachCallback * callback;
+		void * priv;
+	} * pcfd = priv;
+	(void) config;
+	(void) section;
+
+	pcfd->callback(variable, value, pcfd->priv);
+}
+
+
 /* helper_config_get */
 static char const * _helper_config_get(Phone * phone, char const * section,
 		char const * variable)
@@ -154,6 +213,43 @@ static int _helper_config_set(Phone * phone, char const * section,
 }
 
 
+/* helper_config_section */
+static PhoneConfigSection * _helper_config_section(Phone * phone,
+		char const * section)
+{
+	String * s;
+
+	/* there is only one plug-in, and thus one section */
+	if((s = string_new_append("plugin::", section, NULL)) == NULL)
+		return NULL;
+	string_delete(phone->section.name);
+	phone->section.name = s;
+	return &phone->section;
+}
+
+
+/* helper_config_section_get */
+static char const * _helper_config_section_get(Phone * phone,
+		PhoneConfigSection * section, char const * variable)
+{
+	if(section == NULL)
+		return NULL;
+	return config_get(phone->config, section->name, variable);
+}
+
+
+/* helper_config_section_set */
+static int _helper_config_section_set(Phone * phone,
+		PhoneConfigSection * section, char const * variable,
+		char const * value)
+{
+	if(section == NULL)
+		return -1;
+	/* FIXME save the configuration if successful */
+	return config_set(phone->config, section->name, variable, value);
+}
+
+
 /* helper_error */
 static int _error_text(char const * message, int ret);
 
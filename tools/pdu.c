@@ -28,10 +28,15 @@
 #include <unistd.h>
 #include <stdio.h>
 #include "../src/modems/hayes/channel.c"
+#include "../src/modems/hayes/cmux.c"
 #include "../src/modems/hayes/command.c"
 #include "../src/modems/hayes/common.c"
+#include "../src/modems/hayes/concat.c"
+#include "../src/modems/hayes/gsm.c"
+#include "../src/modems/hayes/latency.c"
 #include "../src/modems/hayes/pdu.c"
 #include "../src/modems/hayes/quirks.c"
+#include "../src/modems/hayes/trace.c"
 #include "../src/modems/hayes.c"
 
 #ifndef PROGNAME
@@ -58,9 +63,10 @@ static int _pdu_decode(char const * string)
 	struct tm t;
 	char buf[32];
 	size_t len;
+	HayesMessagePart part;
 
-	if((p = _cmgr_pdu_parse(string, &timestamp, number, &encoding, &len))
-			== NULL)
+	if((p = _cmgr_pdu_parse(string, &timestamp, number, &encoding, &len,
+					&part)) == NULL)
 	{
 		fputs(PROGNAME ": Unable to decode PDU\n", stderr);
 		return -1;
@@ -70,6 +76,9 @@ static int _pdu_decode(char const * string)
 	strftime(buf, sizeof(buf), "%d/%m/%Y %H:%M:%S", &t);
 	printf("Timestamp: %s\n", buf);
 	printf("Encoding: %u\n", encoding);
+	if(part.count > 1)
+		printf("Part: %u/%u (reference %u)\n", part.sequence,
+				part.count, part.reference);
 	_hexdump(p, len);
 	if(encoding == MODEM_MESSAGE_ENCODING_UTF8)
 		printf("Message: %s\n", p);
@@ -79,24 +88,25 @@ static int _pdu_decode(char const * string)
 
 static int _pdu_encode(char const * number, char const * string)
 {
-#if 0
-	char * cmd;
-	char * pdu;
+	char ** pdus;
+	size_t count;
+	size_t i;
 
-	if(_message_to_pdu(0, number, GSM_MODEM_ALPHABET_DEFAULT, string,
-				strlen(string), &cmd, &pdu) != 0)
-#endif
+	if((pdus = hayespdu_encode_concatenated(number,
+					MODEM_MESSAGE_ENCODING_UTF8,
+					strlen(string), string, 0, 0, &count))
+			== NULL)
 	{
 		fputs(PROGNAME ": Unable to encode PDU\n", stderr);
 		return -1;
 	}
-#if 0
-	puts(cmd);
-	puts(pdu);
-	free(cmd);
-	free(pdu);
+	for(i = 0; i < count; i++)
+	{
+		puts(pdus[i]);
+		free(pdus[i]);
+	}
+	free(pdus);
 	return 0;
-#endif
 }
 
 
@@ -29,73 +29,78 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <System.h>
 #include "../src/plugins/smscrypt.c"
 
 #ifndef PROGNAME_SMSCRYPT
 # define PROGNAME_SMSCRYPT "smscrypt"
 #endif
+#ifndef PROGNAME
+# define PROGNAME	PROGNAME_SMSCRYPT
+#endif
 
+#include "common.c"
+#include "../tests/benchmark.c"
 
-/* helper_config_foreach */
-static void _config_foreach_section(Config const * config,
-		String const * section, String const * variable,
-		String const * value, void * priv);
 
-static void _helper_config_foreach(Phone * phone, char const * section,
-		PhoneConfigForeachCallback callback, void * priv)
-{
-	Config * config = (Config *)phone;
-	struct PhoneConfigForeachData
-	{
-		PhoneConfigForeachCallback * callback;
-		void * priv;
-	} pcfd = { callback, priv };
+/* private */
+/* constants */
+#define SMSCRYPT_BENCHMARK_NUMBER	"+15550100"
+#define SMSCRYPT_BENCHMARK_SIZE		140
 
-#ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s(%p, \"%s\", %p, %p)\n", __func__,
-			(void *)phone, section, (void *)callback, priv);
-#endif
-	config_foreach_section(config, section, _config_foreach_section, &pcfd);
-}
 
-static void _config_foreach_section(Config const * config,
-		String const * section, String const * variable,
-		String const * value, void * priv)
-{
-	struct PhoneConfigForeachData
-	{
-		PhoneConfigForeachCallback * callback;
-		void * priv;
-	} * pcfd = priv;
+/* prototypes */
+static int _smscrypt(char const * number, char const * message);
+static int _smscrypt_benchmark(unsigned long count, size_t size);
+
+static int _usage(void);
 
-	pcfd->callback(variable, value, pcfd->priv);
-}
 
+/* functions */
+/* smscrypt */
+static void _hexdump(char const * buf, size_t len);
 
-/* helper_config_get */
-static char const * _helper_config_get(Phone * phone, char const * section,
-		char const * variable)
+static int _smscrypt(char const * number, char const * message)
 {
-	Config * config = (Config *)phone;
-#ifdef DEBUG
-	char const * ret;
-
-	fprintf(stderr, "DEBUG: %s(%p, \"%s\", \"%s\")\n", __func__,
-			(void *)phone, section, variable);
-	ret = config_get(config, section, variable);
-	fprintf(stderr, "DEBUG: %s() => \"%s\"\n", __func__, ret);
+	int ret = 0;
+	Phone phone;
+	PhoneEncoding encoding = PHONE_ENCODING_UTF8;
+	char * p;
+	size_t len;
+
+	if(_phone_init(&phone, &plugin) != 0)
+		return -1;
+	if((p = strdup(message)) == NULL)
+	{
+		_smscrypt_destroy(phone.plugin);
+		_phone_destroy(&phone);
+		return -error_set_code(1, "%s", strerror(errno));
+	}
+	printf("Message: \"%s\"\n", p);
+	len = strlen(p);
+	if(_smscrypt_event_sms_sending(phone.plugin, number, &encoding, p, &len)
+			!= 0 || encoding != PHONE_ENCODING_DATA)
+		ret = -error_set_code(1, "%s", "Could not encrypt");
+	else
+	{
+		printf("Encrypted:\n");
+		_hexdump(p, len);
+		if(_smscrypt_event_sms_receiving(phone.plugin, number,
+					&encoding, p, &len) != 0)
+			ret = -error_set_code(1, "%s", "Could not decrypt");
+		else
+			printf("Decrypted: \"%.*s\"\n", (int)len, p);
+	}
+	free(p);
+	_smscrypt_destroy(phone.plugin);
+	_phone_destroy(&phone);
 	return ret;
-#else
-	return config_get(config, section, variable);
-#endif
 }
 
-
-/* hexdump */
 static void _hexdump(char const * buf, size_t len)
 {
-	unsigned char const * b = (unsigned char *)buf;
+	unsigned char const * b = (unsigned char const *)buf;
 	size_t i;
 
 	for(i = 0; i < len; i++)
@@ -110,88 +115,167 @@ static void _hexdump(char const * buf, size_t len)
 }
 
 
+/* smscrypt_benchmark */
+static void _benchmark_reference(SMSCrypt * smscrypt, char * buf, size_t len);
+
+static int _smscrypt_benchmark(unsigned long count, size_t size)
+{
+	int ret = 0;
+	Phone phone;
+	SMSCrypt * smscrypt;
+	PhoneEncoding encoding;
+	char * messages;
+	char * reference;
+	unsigned long seed = 1;
+	size_t i;
+	size_t len;
+	double t0;
+	double t1;
+	double t2;
+	double t3;
+
+	if(_phone_init(&phone, &plugin) != 0)
+		return -1;
+	smscrypt = phone.plugin;
+	if((messages = malloc(count * size)) == NULL
+			|| (reference = malloc(count * size)) == NULL)
+	{
+		free(messages);
+		_smscrypt_destroy(smscrypt);
+		_phone_destroy(&phone);
+		return -error_set_code(1, "%s", strerror(errno));
+	}
+	for(i = 0; i < count * size; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		messages[i] = (seed >> 16) & 0x7f;
+	}
+	memcpy(reference, messages, count * size);
+	_helper_config_section_set(&phone, smscrypt->config,
+			SMSCRYPT_BENCHMARK_NUMBER, "benchmark");
+	/* encrypt every message as it used to */
+	t0 = _benchmark_time();
+	for(i = 0; i < count; i++)
+		_benchmark_reference(smscrypt, &reference[i * size], size);
+	/* encrypt every message */
+	t1 = _benchmark_time();
+	for(i = 0; i < count; i++)
+	{
+		encoding = PHONE_ENCODING_UTF8;
+		len = size;
+		_smscrypt_event_sms_sending(smscrypt, SMSCRYPT_BENCHMARK_NUMBER,
+				&encoding, &messages[i * size], &len);
+	}
+	t2 = _benchmark_time();
+	if(memcmp(messages, reference, count * size) != 0)
+		ret = -error_set_code(1, "%s", "Incompatible encryption");
+	/* decrypt every message */
+	for(i = 0; i < count; i++)
+	{
+		encoding = PHONE_ENCODING_DATA;
+		len = size;
+		_smscrypt_event_sms_receiving(smscrypt,
+				SMSCRYPT_BENCHMARK_NUMBER, &encoding,
+				&messages[i * size], &len);
+	}
+	t3 = _benchmark_time();
+	for(i = 0, seed = 1; ret == 0 && i < count * size; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		if(messages[i] != (char)((seed >> 16) & 0x7f))
+			ret = -error_set_code(1, "%s", "Could not decrypt");
+	}
+	printf("%s: %lu messages of %zu bytes\n", PROGNAME, count, size);
+	printf("%s: encryption %.3fMB/s (byte per byte), %.3fMB/s\n",
+			PROGNAME, count * size / (t1 - t0) / 1000000.0,
+			count * size / (t2 - t1) / 1000000.0);
+	printf("%s: decryption %.3fMB/s\n", PROGNAME,
+			count * size / (t3 - t2) / 1000000.0);
+	free(reference);
+	free(messages);
+	_smscrypt_destroy(smscrypt);
+	_phone_destroy(&phone);
+	return ret;
+}
+
+static void _benchmark_reference(SMSCrypt * smscrypt, char * buf, size_t len)
+{
+	char const * secret;
+	size_t i;
+	size_t j = 0;
+
+	/* look the secret up and hash it for every message */
+	secret = _helper_config_section_get(smscrypt->helper->phone,
+			smscrypt->config, SMSCRYPT_BENCHMARK_NUMBER);
+	SHA1((unsigned char const *)secret, strlen(secret), smscrypt->buf);
+	for(i = 0; i < len; i++)
+	{
+		buf[i] ^= smscrypt->buf[j];
+		smscrypt->buf[j++] = buf[i];
+		if(j != smscrypt->len)
+			continue;
+		SHA1(smscrypt->buf, smscrypt->len, smscrypt->buf);
+		j = 0;
+	}
+	_smscrypt_clear(smscrypt);
+}
+
+
 /* usage */
 static int _usage(void)
 {
-	fputs("Usage: " PROGNAME_SMSCRYPT " [-p number] message\n", stderr);
+	fputs("Usage: " PROGNAME_SMSCRYPT " [-p number] message\n"
+"       " PROGNAME_SMSCRYPT " -b [-n count][-s size]\n"
+"  -b	Measure the throughput over bulk messages\n"
+"  -n	Number of messages to process (default: 100000)\n"
+"  -s	Size of each message (default: 140)\n", stderr);
 	return 1;
 }
 
 
+/* public */
+/* functions */
 /* main */
-static gboolean _main_idle(gpointer data);
-
 int main(int argc, char * argv[])
 {
+	int ret;
 	int o;
-	struct { char const * message; char const * number; } mn;
-	
-	mn.number = NULL;
-	gtk_init(&argc, &argv);
-	while((o = getopt(argc, argv, "p:")) != -1)
+	int benchmark = 0;
+	char const * number = NULL;
+	unsigned long count = 100000;
+	size_t size = SMSCRYPT_BENCHMARK_SIZE;
+	char * p;
+
+	while((o = getopt(argc, argv, "bn:p:s:")) != -1)
 		switch(o)
 		{
+			case 'b':
+				benchmark = 1;
+				break;
+			case 'n':
+				count = strtoul(optarg, &p, 10);
+				if(optarg[0] == '\0' || *p != '\0' || count == 0)
+					return _usage();
+				break;
 			case 'p':
-				mn.number = optarg;
+				number = optarg;
+				break;
+			case 's':
+				size = strtoul(optarg, &p, 10);
+				if(optarg[0] == '\0' || *p != '\0' || size == 0)
+					return _usage();
 				break;
 			default:
 				return _usage();
 		}
-	if(optind + 1 != argc)
+	if(benchmark ? (optind != argc) : (optind + 1 != argc))
 		return _usage();
-	mn.message = argv[optind];
-	g_idle_add(_main_idle, &mn);
-	gtk_main();
-	return 0;
-}
-
-static gboolean _main_idle(gpointer data)
-{
-#if 0
-	struct { char const * message; char const * number; } * mn = data;
-	PhonePluginHelper helper;
-	Config * config;
-	PhoneEncoding encoding = PHONE_ENCODING_UTF8;
-	PhoneEvent event;
-	char * p;
-	size_t len;
-
-	config = config_new();
-	config_load(config, "/home/khorben/.phone"); /* FIXME hardcoded */
-	helper.phone = (Phone*)config;
-	helper.config_foreach = _helper_config_foreach;
-	helper.config_get = _helper_config_get;
-	plugin.helper = &helper;
-	if(_smscrypt_init(&plugin) != 0)
-	{
-		error_print(PROGNAME_SMSCRYPT);
-		return FALSE;
-	}
-	if((p = strdup(mn->message)) == NULL)
-		return FALSE;
-	printf("Message: \"%s\"\n", p);
-	len = strlen(p);
-	event.type = PHONE_EVENT_TYPE_SMS_SENDING;
-	if(_smscrypt_event(&plugin, &event, mn->number, &encoding, &p, &len)
-			!= 0)
-#endif
-		puts("Could not encrypt");
-#if 0
+	gtk_init(&argc, &argv);
+	if(benchmark)
+		ret = _smscrypt_benchmark(count, size);
 	else
-	{
-		printf("Encrypted:\n");
-		_hexdump(p, len);
-		event.type = PHONE_EVENT_TYPE_SMS_RECEIVING;
-		if(_smscrypt_event(&plugin, &event, mn->number, &encoding, &p,
-					&len) != 0)
-			puts("Could not decrypt");
-		else
-			printf("Decrypted: \"%s\"\n", p);
-	}
-	free(p);
-	_smscrypt_destroy(&plugin);
-	config_delete(config);
-#endif
-	gtk_main_quit();
-	return FALSE;
+		ret = _smscrypt(number, argv[optind]);
+	if(ret != 0)
+		error_print(PROGNAME_SMSCRYPT);
+	return (ret == 0) ? 0 : 2;
 }
@@ -0,0 +1,219 @@
+/* $Id$ */
+/* Copyright (c) 2026 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Phone */
+/* Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ITS AUTHORS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+#include "../src/modems/hayes/trace.c"
+
+#ifndef PROGNAME
+# define PROGNAME "trace"
+#endif
+
+
+/* trace */
+/* private */
+/* types */
+typedef struct _TracePrefs
+{
+	int transcript;
+	int channel;
+} TracePrefs;
+
+
+/* prototypes */
+static int _trace(TracePrefs * prefs, char const * filename);
+
+static int _error(char const * message, int ret);
+static int _usage(void);
+
+
+/* functions */
+/* trace */
+static void _trace_dump(HayesTraceHeader * header, HayesTraceRecord * record,
+		char const * buf);
+static void _trace_transcript(HayesTraceRecord * record, char const * buf);
+
+static int _trace(TracePrefs * prefs, char const * filename)
+{
+	int ret;
+	FILE * fp;
+	HayesTraceHeader header;
+	HayesTraceRecord record;
+	char * buf = NULL;
+	size_t size = 0;
+	time_t t;
+
+	if((fp = fopen(filename, "r")) == NULL)
+		return -_error(filename, 1);
+	if(hayestrace_read_header(fp, &header) != 0)
+	{
+		fclose(fp);
+		return -_error(filename, 1);
+	}
+	if(!prefs->transcript)
+	{
+		t = header.realtime / 1000000;
+		printf("%s: started %s", filename, ctime(&t));
+	}
+	while((ret = hayestrace_read_record(fp, &record, &buf, &size)) == 0)
+	{
+		if(prefs->channel >= 0
+				&& record.channel != (unsigned int)prefs->channel)
+			continue;
+		if(prefs->transcript)
+			_trace_transcript(&record, buf);
+		else
+			_trace_dump(&header, &record, buf);
+	}
+	free(buf);
+	if(ret < 0)
+		_error(filename, 1);
+	fclose(fp);
+	return (ret < 0) ? -1 : 0;
+}
+
+static void _trace_dump(HayesTraceHeader * header, HayesTraceRecord * record,
+		char const * buf)
+{
+	gint64 timestamp = header->realtime + record->timestamp
+		- header->monotonic;
+	time_t t = timestamp / 1000000;
+	struct tm tm;
+	char date[16];
+	unsigned char const * p = (unsigned char const *)buf;
+	size_t i;
+
+	/* convert from the monotonic clock */
+	if(localtime_r(&t, &tm) == NULL
+			|| strftime(date, sizeof(date), "%H:%M:%S", &tm) == 0)
+		date[0] = '\0';
+	printf("%s.%06u #%u ", date, (unsigned int)(timestamp % 1000000),
+			record->channel);
+	switch(record->direction)
+	{
+		case HAYESTRACE_DIRECTION_DROPPED:
+			printf("DROPPED: %u\n", (record->size == 4)
+					? _hayestrace_decode32(p) : 0);
+			return;
+		case HAYESTRACE_DIRECTION_MODEM:
+			fputs("MODEM: ", stdout);
+			break;
+		case HAYESTRACE_DIRECTION_PHONE:
+		default:
+			fputs("PHONE: ", stdout);
+			break;
+	}
+	for(i = 0; i < record->size; i++)
+		if(p[i] == '\r')
+			fputs("\\r", stdout);
+		else if(p[i] == '\n')
+			fputs("\\n", stdout);
+		else if(p[i] == '\\')
+			fputs("\\\\", stdout);
+		else if(isprint(p[i]))
+			putchar(p[i]);
+		else
+			printf("\\x%02x", p[i]);
+	putchar('\n');
+}
+
+static void _trace_transcript(HayesTraceRecord * record, char const * buf)
+{
+	switch(record->direction)
+	{
+		case HAYESTRACE_DIRECTION_MODEM:
+			fputs("\nMODEM: ", stdout);
+			break;
+		case HAYESTRACE_DIRECTION_PHONE:
+			fputs("\nPHONE: ", stdout);
+			break;
+		default:
+			return;
+	}
+	fwrite(buf, sizeof(*buf), record->size, stdout);
+}
+
+
+/* error */
+static int _error(char const * message, int ret)
+{
+	fputs(PROGNAME ": ", stderr);
+	perror(message);
+	return ret;
+}
+
+
+/* usage */
+static int _usage(void)
+{
+	fputs("Usage: " PROGNAME " [-t][-c channel] filename...\n"
+"  -t	Output a transcript for the replay test instead\n"
+"  -c	Only output this channel (0: commands, 1: data, 2: notifications)\n",
+			stderr);
+	return 1;
+}
+
+
+/* public */
+/* functions */
+/* main */
+int main(int argc, char * argv[])
+{
+	int ret = 0;
+	int o;
+	TracePrefs prefs;
+	char * p;
+
+	memset(&prefs, 0, sizeof(prefs));
+	prefs.channel = -1;
+	while((o = getopt(argc, argv, "c:t")) != -1)
+		switch(o)
+		{
+			case 'c':
+				prefs.channel = strtol(optarg, &p, 0);
+				if(optarg[0] == '\0' || *p != '\0'
+						|| prefs.channel < 0)
+					return _usage();
+				break;
+			case 't':
+				prefs.transcript = 1;
+				break;
+			default:
+				return _usage();
+		}
+	if(optind == argc)
+		return _usage();
+	for(; optind < argc; optind++)
+		if(_trace(&prefs, argv[optind]) != 0)
+			ret = 2;
+	return ret;
+}